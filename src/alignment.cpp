@@ -1,4 +1,5 @@
 #include "alignment.hpp"
+#include "fastq_reader.hpp"
 #include "vg/io/gafkluge.hpp"
 
 #include <sstream>
@@ -178,85 +179,72 @@ bool get_next_alignment_pair_from_fastqs(gzFile fp1, gzFile fp2, char* buffer, s
     return get_next_alignment_from_fastq(fp1, buffer, len, mate1) && get_next_alignment_from_fastq(fp2, buffer, len, mate2);
 }
 
-size_t fastq_unpaired_for_each_parallel(const string& filename, function<void(Alignment&)> lambda) {
+size_t fastq_unpaired_for_each_parallel(const string& filename, function<void(Alignment&)> lambda,
+                                        size_t reader_threads, double* starved_seconds) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 2 << 22; // 4M
-    char* buf = new char[len];
+    FastqReader reader(filename, reader_threads);
     
     function<bool(Alignment&)> get_read = [&](Alignment& aln) {
-        return get_next_alignment_from_fastq(fp, buf, len, aln);;
+        return reader.get_next_alignment(aln);
     };
     
-    
     size_t nLines = unpaired_for_each_parallel(get_read, lambda);
     
-    delete[] buf;
-    gzclose(fp);
+    if (starved_seconds) {
+        *starved_seconds = reader.get_starved_seconds();
+    }
     return nLines;
     
 }
 
-size_t fastq_paired_interleaved_for_each_parallel(const string& filename, function<void(Alignment&, Alignment&)> lambda) {
-    return fastq_paired_interleaved_for_each_parallel_after_wait(filename, lambda, [](void) {return true;});
+size_t fastq_paired_interleaved_for_each_parallel(const string& filename, function<void(Alignment&, Alignment&)> lambda,
+                                                  size_t reader_threads, double* starved_seconds) {
+    return fastq_paired_interleaved_for_each_parallel_after_wait(filename, lambda, [](void) {return true;},
+                                                                 reader_threads, starved_seconds);
 }
     
-size_t fastq_paired_two_files_for_each_parallel(const string& file1, const string& file2, function<void(Alignment&, Alignment&)> lambda) {
-    return fastq_paired_two_files_for_each_parallel_after_wait(file1, file2, lambda, [](void) {return true;});
+size_t fastq_paired_two_files_for_each_parallel(const string& file1, const string& file2, function<void(Alignment&, Alignment&)> lambda,
+                                                size_t reader_threads, double* starved_seconds) {
+    return fastq_paired_two_files_for_each_parallel_after_wait(file1, file2, lambda, [](void) {return true;},
+                                                               reader_threads, starved_seconds);
 }
     
 size_t fastq_paired_interleaved_for_each_parallel_after_wait(const string& filename,
                                                              function<void(Alignment&, Alignment&)> lambda,
-                                                             function<bool(void)> single_threaded_until_true) {
-    
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
+                                                             function<bool(void)> single_threaded_until_true,
+                                                             size_t reader_threads, double* starved_seconds) {
     
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    FastqReader reader(filename, reader_threads);
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_interleaved_alignment_pair_from_fastq(fp, buf, len, mate1, mate2);
+        return reader.get_next_alignment(mate1) && reader.get_next_alignment(mate2);
     };
     
     size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true);
     
-    delete[] buf;
-    gzclose(fp);
+    if (starved_seconds) {
+        *starved_seconds = reader.get_starved_seconds();
+    }
     return nLines;
 }
     
 size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1, const string& file2,
                                                            function<void(Alignment&, Alignment&)> lambda,
-                                                           function<bool(void)> single_threaded_until_true) {
-    
-    gzFile fp1 = (file1 != "-") ? gzopen(file1.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp1) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file1 << endl; exit(1);
-    }
-    gzFile fp2 = (file2 != "-") ? gzopen(file2.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp2) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file2 << endl; exit(1);
-    }
+                                                           function<bool(void)> single_threaded_until_true,
+                                                           size_t reader_threads, double* starved_seconds) {
     
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    // One reader serves both files, so we use only the reader threads we were given.
+    FastqReader reader(file1, file2, reader_threads);
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_alignment_pair_from_fastqs(fp1, fp2, buf, len, mate1, mate2);
+        return reader.get_next_alignment(mate1) && reader.get_next_alignment(mate2);
     };
     
     size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true);
     
-    delete[] buf;
-    gzclose(fp1);
-    gzclose(fp2);
+    if (starved_seconds) {
+        *starved_seconds = reader.get_starved_seconds();
+    }
     return nLines;
 }
 
@@ -37,22 +37,36 @@ size_t fastq_unpaired_for_each(const string& filename, function<void(Alignment&)
 size_t fastq_paired_interleaved_for_each(const string& filename, function<void(Alignment&, Alignment&)> lambda);
 size_t fastq_paired_two_files_for_each(const string& file1, const string& file2, function<void(Alignment&, Alignment&)> lambda);
 // parallel versions of above
+// These decompress and parse the input on reader_threads background threads
+// (see FastqReader), separate from the OMP threads that run the lambda. If
+// starved_seconds is set, it receives the total time the OMP threads spent
+// waiting for the readers to produce records.
 size_t fastq_unpaired_for_each_parallel(const string& filename,
-                                        function<void(Alignment&)> lambda);
+                                        function<void(Alignment&)> lambda,
+                                        size_t reader_threads = 1,
+                                        double* starved_seconds = nullptr);
     
 size_t fastq_paired_interleaved_for_each_parallel(const string& filename,
-                                                  function<void(Alignment&, Alignment&)> lambda);
+                                                  function<void(Alignment&, Alignment&)> lambda,
+                                                  size_t reader_threads = 1,
+                                                  double* starved_seconds = nullptr);
     
 size_t fastq_paired_interleaved_for_each_parallel_after_wait(const string& filename,
                                                              function<void(Alignment&, Alignment&)> lambda,
-                                                             function<bool(void)> single_threaded_until_true);
+                                                             function<bool(void)> single_threaded_until_true,
+                                                             size_t reader_threads = 1,
+                                                             double* starved_seconds = nullptr);
     
 size_t fastq_paired_two_files_for_each_parallel(const string& file1, const string& file2,
-                                                function<void(Alignment&, Alignment&)> lambda);
+                                                function<void(Alignment&, Alignment&)> lambda,
+                                                size_t reader_threads = 1,
+                                                double* starved_seconds = nullptr);
     
 size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1, const string& file2,
                                                            function<void(Alignment&, Alignment&)> lambda,
-                                                           function<bool(void)> single_threaded_until_true);
+                                                           function<bool(void)> single_threaded_until_true,
+                                                           size_t reader_threads = 1,
+                                                           double* starved_seconds = nullptr);
 
 bam_hdr_t* hts_file_header(string& filename, string& header);
 bam_hdr_t* hts_string_header(string& header,
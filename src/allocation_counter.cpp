@@ -0,0 +1,85 @@
+/// \file allocation_counter.cpp
+///
+/// Replaces the global allocation functions with ones that count allocations
+/// per thread and then allocate as the defaults would.
+///
+
+#include "allocation_counter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace vg {
+
+/// Allocations made by this thread. This is trivially initialized, so it is
+/// safe to use from operator new at any point in a thread's life.
+static thread_local size_t heap_allocations = 0;
+
+size_t thread_heap_allocations() {
+    return heap_allocations;
+}
+
+}
+
+void* operator new(std::size_t size) {
+    vg::heap_allocations++;
+    if (size == 0) {
+        // We still need to return a unique pointer.
+        size = 1;
+    }
+    while (true) {
+        void* allocated = std::malloc(size);
+        if (allocated != nullptr) {
+            return allocated;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (std::bad_alloc& e) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (std::bad_alloc& e) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* allocated) noexcept {
+    std::free(allocated);
+}
+
+void operator delete[](void* allocated) noexcept {
+    std::free(allocated);
+}
+
+void operator delete(void* allocated, std::size_t) noexcept {
+    std::free(allocated);
+}
+
+void operator delete[](void* allocated, std::size_t) noexcept {
+    std::free(allocated);
+}
+
+void operator delete(void* allocated, const std::nothrow_t&) noexcept {
+    std::free(allocated);
+}
+
+void operator delete[](void* allocated, const std::nothrow_t&) noexcept {
+    std::free(allocated);
+}
@@ -0,0 +1,24 @@
+#ifndef VG_ALLOCATION_COUNTER_HPP_INCLUDED
+#define VG_ALLOCATION_COUNTER_HPP_INCLUDED
+
+/// \file allocation_counter.hpp
+///
+/// Counts heap allocations made through operator new, for each thread, so
+/// that code can measure how much it really allocates.
+///
+
+#include <cstddef>
+
+namespace vg {
+
+/**
+ * Get the number of times the calling thread has allocated memory through
+ * operator new since it started. Allocations made directly with malloc() are
+ * not counted. Take the difference between two calls to count the
+ * allocations made in between.
+ */
+size_t thread_heap_allocations();
+
+}
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * \file async_alignment_emitter.cpp
+ * Implementation for AsyncAlignmentEmitter
+ */
+
+
+#include "async_alignment_emitter.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace vg {
+
+using namespace std;
+
+/// Move everything in src onto the end of dest.
+template<typename T>
+static void append_batch(vector<T>& dest, vector<T>&& src) {
+    if (dest.empty()) {
+        dest = std::move(src);
+    } else {
+        dest.reserve(dest.size() + src.size());
+        std::move(src.begin(), src.end(), back_inserter(dest));
+    }
+}
+
+size_t AsyncAlignmentEmitter::Batch::size() const {
+    return singles.size() + mapped_singles.size() + pairs1.size() + mapped_pairs1.size();
+}
+
+AsyncAlignmentEmitter::AsyncAlignmentEmitter(unique_ptr<AlignmentEmitter>&& backing, size_t max_threads,
+                                             size_t writer_threads, Stats* stats) :
+    backing(std::move(backing)), filling(max_threads), queue(MAX_QUEUED_BATCHES),
+    writer_threads(max(min(writer_threads, max_threads), (size_t) 1)), stop(false), stats(stats),
+    batches_enqueued(0), total_queue_depth(0), max_queue_depth(0), blocked_nanoseconds(0) {
+
+    // The writers need their own OpenMP team so that each one gets its own
+    // thread number, and so its own buffers, in the backing emitter.
+    writer_thread = thread([&]() {
+        #pragma omp parallel num_threads(this->writer_threads)
+        {
+            write_all();
+        }
+    });
+}
+
+AsyncAlignmentEmitter::~AsyncAlignmentEmitter() {
+    // Nobody else can be emitting now, so hand off everyone's leftovers.
+    for (auto& batch : filling) {
+        if (batch && batch->size() != 0) {
+            enqueue(batch.release());
+        }
+    }
+    stop.store(true);
+    writer_thread.join();
+
+    if (stats != nullptr) {
+        stats->batches = batches_enqueued.load();
+        stats->max_queue_depth = max_queue_depth.load();
+        stats->mean_queue_depth = stats->batches == 0 ? 0.0 : (double) total_queue_depth.load() / stats->batches;
+        stats->blocked_seconds = blocked_nanoseconds.load() / 1e9;
+    }
+}
+
+void AsyncAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
+    append_batch(get_batch().singles, std::move(aln_batch));
+    check_batch();
+}
+
+void AsyncAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+    append_batch(get_batch().mapped_singles, std::move(alns_batch));
+    check_batch();
+}
+
+void AsyncAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+                                       vector<int64_t>&& tlen_limit_batch) {
+    Batch* batch = &get_batch();
+    if (!batch->pairs1.empty() && batch->pair_tlen_limits.empty() != tlen_limit_batch.empty()) {
+        // Don't mix pairs with and without length limits in one call to the
+        // backing emitter.
+        enqueue(filling[omp_get_thread_num()].release());
+        batch = &get_batch();
+    }
+    append_batch(batch->pairs1, std::move(aln1_batch));
+    append_batch(batch->pairs2, std::move(aln2_batch));
+    append_batch(batch->pair_tlen_limits, std::move(tlen_limit_batch));
+    check_batch();
+}
+
+void AsyncAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+                                              vector<vector<Alignment>>&& alns2_batch,
+                                              vector<int64_t>&& tlen_limit_batch) {
+    Batch* batch = &get_batch();
+    if (!batch->mapped_pairs1.empty() && batch->mapped_pair_tlen_limits.empty() != tlen_limit_batch.empty()) {
+        // Don't mix pairs with and without length limits in one call to the
+        // backing emitter.
+        enqueue(filling[omp_get_thread_num()].release());
+        batch = &get_batch();
+    }
+    append_batch(batch->mapped_pairs1, std::move(alns1_batch));
+    append_batch(batch->mapped_pairs2, std::move(alns2_batch));
+    append_batch(batch->mapped_pair_tlen_limits, std::move(tlen_limit_batch));
+    check_batch();
+}
+
+AsyncAlignmentEmitter::Batch& AsyncAlignmentEmitter::get_batch() {
+    auto& batch = filling.at(omp_get_thread_num());
+    if (!batch) {
+        batch.reset(new Batch());
+    }
+    return *batch;
+}
+
+void AsyncAlignmentEmitter::check_batch() {
+    auto& batch = filling[omp_get_thread_num()];
+    if (batch->size() >= BATCH_SIZE) {
+        enqueue(batch.release());
+    }
+}
+
+void AsyncAlignmentEmitter::enqueue(Batch* batch) {
+    size_t depth = queue.was_size();
+
+    if (!queue.try_push(batch)) {
+        // The writers are behind, so wait for them.
+        auto wait_start = chrono::steady_clock::now();
+        unique_lock<mutex> lock(space_mutex);
+        space_ready.wait(lock, [&]() { return queue.try_push(batch); });
+        lock.unlock();
+        blocked_nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - wait_start).count();
+    }
+
+    batches_enqueued++;
+    total_queue_depth += depth;
+    size_t seen = max_queue_depth.load();
+    while (depth > seen && !max_queue_depth.compare_exchange_weak(seen, depth)) {
+        // Someone else raised the max; try again against the new value.
+    }
+}
+
+void AsyncAlignmentEmitter::write_all() {
+    size_t idle_rounds = 0;
+    while (true) {
+        Batch* batch;
+        if (queue.try_pop(batch)) {
+            idle_rounds = 0;
+            {
+                // Taking the lock means any caller that found the queue full
+                // is already waiting, so it won't miss the signal.
+                lock_guard<mutex> lock(space_mutex);
+            }
+            space_ready.notify_all();
+            write_batch(*batch);
+            delete batch;
+        } else if (stop.load()) {
+            // Nothing more will be enqueued, so once the queue looks empty
+            // after seeing stop, we are done.
+            if (!queue.try_pop(batch)) {
+                break;
+            }
+            write_batch(*batch);
+            delete batch;
+        } else if (idle_rounds < 100) {
+            idle_rounds++;
+            this_thread::yield();
+        } else {
+            // Don't burn a core while the mappers are busy.
+            this_thread::sleep_for(chrono::microseconds(100));
+        }
+    }
+}
+
+void AsyncAlignmentEmitter::write_batch(Batch& batch) {
+    if (!batch.singles.empty()) {
+        backing->emit_singles(std::move(batch.singles));
+    }
+    if (!batch.mapped_singles.empty()) {
+        backing->emit_mapped_singles(std::move(batch.mapped_singles));
+    }
+    if (!batch.pairs1.empty()) {
+        backing->emit_pairs(std::move(batch.pairs1), std::move(batch.pairs2), std::move(batch.pair_tlen_limits));
+    }
+    if (!batch.mapped_pairs1.empty()) {
+        backing->emit_mapped_pairs(std::move(batch.mapped_pairs1), std::move(batch.mapped_pairs2),
+                                   std::move(batch.mapped_pair_tlen_limits));
+    }
+}
+
+}
@@ -0,0 +1,167 @@
+#ifndef VG_ASYNC_ALIGNMENT_EMITTER_HPP_INCLUDED
+#define VG_ASYNC_ALIGNMENT_EMITTER_HPP_INCLUDED
+
+/** \file
+ *
+ * Holds a wrapper AlignmentEmitter that moves serialization, compression, and
+ * writing of alignments off of the mapping threads.
+ */
+
+#include "vg/io/alignment_emitter.hpp"
+
+#include <atomic_queue.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An AlignmentEmitter implementation that collects alignments from each
+ * calling thread into batches, and hands full batches through a bounded
+ * lock-free queue to dedicated writer threads, which send them on to a backing
+ * AlignmentEmitter that it owns.
+ *
+ * The backing emitter does all its encoding, compression, and locking on the
+ * writer threads. Writer threads run as an OpenMP team, so each has its own
+ * omp_get_thread_num() and so its own per-thread buffers in the backing
+ * emitter, which must have been made for at least as many threads.
+ *
+ * If the writers fall behind and the queue fills up, calling threads wait for
+ * space. Output order between calls is not preserved, as with the per-thread
+ * buffered emitters.
+ */
+class AsyncAlignmentEmitter : public vg::io::AlignmentEmitter {
+public:
+
+    /// Summary of how full the queue was over the emitter's lifetime.
+    struct Stats {
+        /// Number of batches passed through the queue
+        size_t batches = 0;
+        /// Largest number of batches seen waiting in the queue
+        size_t max_queue_depth = 0;
+        /// Mean number of batches waiting in the queue when a batch was added
+        double mean_queue_depth = 0;
+        /// Total time calling threads spent waiting for queue space
+        double blocked_seconds = 0;
+    };
+
+    /**
+     * Make a new AsyncAlignmentEmitter that takes ownership of the given
+     * backing emitter, accepts alignments from up to max_threads OMP threads,
+     * and writes with the given number of writer threads (at least 1).
+     *
+     * If stats is set, it will be filled in when the emitter is destroyed.
+     */
+    AsyncAlignmentEmitter(unique_ptr<AlignmentEmitter>&& backing, size_t max_threads,
+                          size_t writer_threads = 1, Stats* stats = nullptr);
+
+    /// Flush all partial batches, wait for the writers to finish them, and
+    /// then destroy the backing emitter. Must not be called while other
+    /// threads are still emitting.
+    ~AsyncAlignmentEmitter();
+
+    // Not copyable or movable
+    AsyncAlignmentEmitter(const AsyncAlignmentEmitter& other) = delete;
+    AsyncAlignmentEmitter& operator=(const AsyncAlignmentEmitter& other) = delete;
+    AsyncAlignmentEmitter(AsyncAlignmentEmitter&& other) = delete;
+    AsyncAlignmentEmitter& operator=(AsyncAlignmentEmitter&& other) = delete;
+
+    /// Emit a batch of Alignments
+    virtual void emit_singles(vector<Alignment>&& aln_batch);
+    /// Emit batch of Alignments with secondaries. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch);
+    /// Emit a batch of pairs of Alignments.
+    virtual void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+        vector<int64_t>&& tlen_limit_batch);
+    /// Emit the mappings of a batch of pairs of Alignments. All secondaries
+    /// must have is_secondary set already.
+    virtual void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+        vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch);
+
+    /// How many reads or pairs should a calling thread collect before handing
+    /// them to the writers?
+    static const size_t BATCH_SIZE = 256;
+
+    /// How many full batches can be waiting for the writers before calling
+    /// threads stop and wait?
+    static const size_t MAX_QUEUED_BATCHES = 256;
+
+protected:
+
+    /// Alignments collected by one thread, to be emitted together.
+    struct Batch {
+        vector<Alignment> singles;
+        vector<vector<Alignment>> mapped_singles;
+        vector<Alignment> pairs1;
+        vector<Alignment> pairs2;
+        vector<int64_t> pair_tlen_limits;
+        vector<vector<Alignment>> mapped_pairs1;
+        vector<vector<Alignment>> mapped_pairs2;
+        vector<int64_t> mapped_pair_tlen_limits;
+
+        /// Get the number of reads or pairs in the batch.
+        size_t size() const;
+    };
+
+    /// Get the calling thread's partial batch, creating it if needed.
+    Batch& get_batch();
+
+    /// Hand the calling thread's partial batch to the writers if it is full.
+    void check_batch();
+
+    /// Hand the given batch to the writers, waiting if the queue is full.
+    void enqueue(Batch* batch);
+
+    /// Main loop of the writer threads.
+    void write_all();
+
+    /// Send everything in a batch to the backing emitter.
+    void write_batch(Batch& batch);
+
+    /// The emitter that does the real work, on the writer threads
+    unique_ptr<AlignmentEmitter> backing;
+
+    /// Partial batch for each calling thread
+    vector<unique_ptr<Batch>> filling;
+
+    /// Full batches waiting for the writers. Never holds nullptr.
+    atomic_queue::AtomicQueueB<Batch*> queue;
+
+    /// Held by callers waiting for queue space, and by writers before they
+    /// signal that there is space
+    mutex space_mutex;
+    /// Signaled when a writer takes a batch out of the queue
+    condition_variable space_ready;
+
+    /// Number of writer threads to run
+    size_t writer_threads;
+
+    /// Thread that hosts the OpenMP team of writers
+    thread writer_thread;
+
+    /// Set by the destructor once nothing more will be enqueued
+    atomic<bool> stop;
+
+    /// Where to put our stats when we are done, if anywhere
+    Stats* stats;
+
+    /// Number of batches enqueued
+    atomic<size_t> batches_enqueued;
+    /// Sum of the queue depths seen when enqueueing
+    atomic<size_t> total_queue_depth;
+    /// Largest queue depth seen when enqueueing
+    atomic<size_t> max_queue_depth;
+    /// Total time callers have spent waiting for queue space, in nanoseconds
+    atomic<int64_t> blocked_nanoseconds;
+};
+
+}
+
+#endif
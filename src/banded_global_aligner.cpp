@@ -8,6 +8,13 @@
 #include "banded_global_aligner.hpp"
 #include "vg/io/json2pb.h"
 
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 //#define debug_banded_aligner_objects
 //#define debug_banded_aligner_graph_processing
 //#define debug_banded_aligner_fill_matrix
@@ -16,6 +23,205 @@
 
 namespace vg {
 
+namespace banded_kernel {
+
+kernel_type best() {
+    static const kernel_type fastest = supported(kernel_sse41) ? kernel_sse41 : kernel_scalar;
+    return fastest;
+}
+
+bool supported(kernel_type kernel) {
+    switch (kernel) {
+    case kernel_scalar:
+        return true;
+    case kernel_sse41:
+#if defined(__x86_64__)
+        return __builtin_cpu_supports("sse4.1");
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* name(kernel_type kernel) {
+    switch (kernel) {
+    case kernel_scalar:
+        return "scalar";
+    case kernel_sse41:
+        return "sse4.1";
+    default:
+        return "unknown";
+    }
+}
+
+/// The kernel that new fills will use
+static atomic<int> current_kernel(-1);
+
+kernel_type get_kernel() {
+    int kernel = current_kernel.load();
+    if (kernel < 0) {
+        return best();
+    }
+    return (kernel_type) kernel;
+}
+
+void set_kernel(kernel_type kernel) {
+    current_kernel.store(supported(kernel) ? kernel : kernel_scalar);
+}
+
+template <class IntType>
+static void fill_interior_scalar(const IntType* prev_match, const IntType* prev_insert_row,
+                                 const IntType* prev_insert_col, const IntType* match_scores,
+                                 IntType* match, IntType* insert_col, int64_t begin, int64_t end,
+                                 int8_t gap_open, int8_t gap_extend) {
+    for (int64_t i = begin; i < end; i++) {
+        match[i] = match_scores[i] + max(max(prev_match[i], prev_insert_row[i]), prev_insert_col[i]);
+    }
+    for (int64_t i = begin; i + 1 < end; i++) {
+        insert_col[i] = max(max(prev_match[i + 1] - gap_open, prev_insert_row[i + 1] - gap_open),
+                            prev_insert_col[i + 1] - gap_extend);
+    }
+}
+
+#if defined(__x86_64__)
+
+// The scalar gap arithmetic happens in int and is then truncated, so the
+// vector kernels widen for the gap penalties and truncate back down. The
+// match additions wrap in the narrow type just like the scalar ones.
+
+__attribute__((__target__("sse4.1")))
+static void fill_interior_sse41(const int8_t* prev_match, const int8_t* prev_insert_row,
+                                const int8_t* prev_insert_col, const int8_t* match_scores,
+                                int8_t* match, int8_t* insert_col, int64_t begin, int64_t end,
+                                int8_t gap_open, int8_t gap_extend) {
+    int64_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __m128i best = _mm_max_epi8(_mm_max_epi8(_mm_loadu_si128((const __m128i*) (prev_match + i)),
+                                                 _mm_loadu_si128((const __m128i*) (prev_insert_row + i))),
+                                    _mm_loadu_si128((const __m128i*) (prev_insert_col + i)));
+        _mm_storeu_si128((__m128i*) (match + i),
+                         _mm_add_epi8(_mm_loadu_si128((const __m128i*) (match_scores + i)), best));
+    }
+    for (; i < end; i++) {
+        match[i] = match_scores[i] + max(max(prev_match[i], prev_insert_row[i]), prev_insert_col[i]);
+    }
+    
+    const __m128i open = _mm_set1_epi16(gap_open);
+    const __m128i extend = _mm_set1_epi16(gap_extend);
+    const __m128i low_byte = _mm_set1_epi16(0xFF);
+    i = begin;
+    for (; i + 17 <= end; i += 16) {
+        __m128i m = _mm_loadu_si128((const __m128i*) (prev_match + i + 1));
+        __m128i r = _mm_loadu_si128((const __m128i*) (prev_insert_row + i + 1));
+        __m128i c = _mm_loadu_si128((const __m128i*) (prev_insert_col + i + 1));
+        __m128i lo = _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(_mm_cvtepi8_epi16(m), open),
+                                                 _mm_sub_epi16(_mm_cvtepi8_epi16(r), open)),
+                                   _mm_sub_epi16(_mm_cvtepi8_epi16(c), extend));
+        __m128i hi = _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(_mm_cvtepi8_epi16(_mm_srli_si128(m, 8)), open),
+                                                 _mm_sub_epi16(_mm_cvtepi8_epi16(_mm_srli_si128(r, 8)), open)),
+                                   _mm_sub_epi16(_mm_cvtepi8_epi16(_mm_srli_si128(c, 8)), extend));
+        _mm_storeu_si128((__m128i*) (insert_col + i),
+                         _mm_packus_epi16(_mm_and_si128(lo, low_byte), _mm_and_si128(hi, low_byte)));
+    }
+    for (; i + 1 < end; i++) {
+        insert_col[i] = max(max(prev_match[i + 1] - gap_open, prev_insert_row[i + 1] - gap_open),
+                            prev_insert_col[i + 1] - gap_extend);
+    }
+}
+
+__attribute__((__target__("sse4.1")))
+static void fill_interior_sse41(const int16_t* prev_match, const int16_t* prev_insert_row,
+                                const int16_t* prev_insert_col, const int16_t* match_scores,
+                                int16_t* match, int16_t* insert_col, int64_t begin, int64_t end,
+                                int8_t gap_open, int8_t gap_extend) {
+    int64_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m128i best = _mm_max_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*) (prev_match + i)),
+                                                   _mm_loadu_si128((const __m128i*) (prev_insert_row + i))),
+                                     _mm_loadu_si128((const __m128i*) (prev_insert_col + i)));
+        _mm_storeu_si128((__m128i*) (match + i),
+                         _mm_add_epi16(_mm_loadu_si128((const __m128i*) (match_scores + i)), best));
+    }
+    for (; i < end; i++) {
+        match[i] = match_scores[i] + max(max(prev_match[i], prev_insert_row[i]), prev_insert_col[i]);
+    }
+    
+    const __m128i open = _mm_set1_epi32(gap_open);
+    const __m128i extend = _mm_set1_epi32(gap_extend);
+    const __m128i low_half = _mm_set1_epi32(0xFFFF);
+    i = begin;
+    for (; i + 9 <= end; i += 8) {
+        __m128i m = _mm_loadu_si128((const __m128i*) (prev_match + i + 1));
+        __m128i r = _mm_loadu_si128((const __m128i*) (prev_insert_row + i + 1));
+        __m128i c = _mm_loadu_si128((const __m128i*) (prev_insert_col + i + 1));
+        __m128i lo = _mm_max_epi32(_mm_max_epi32(_mm_sub_epi32(_mm_cvtepi16_epi32(m), open),
+                                                 _mm_sub_epi32(_mm_cvtepi16_epi32(r), open)),
+                                   _mm_sub_epi32(_mm_cvtepi16_epi32(c), extend));
+        __m128i hi = _mm_max_epi32(_mm_max_epi32(_mm_sub_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(m, 8)), open),
+                                                 _mm_sub_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(r, 8)), open)),
+                                   _mm_sub_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(c, 8)), extend));
+        _mm_storeu_si128((__m128i*) (insert_col + i),
+                         _mm_packus_epi32(_mm_and_si128(lo, low_half), _mm_and_si128(hi, low_half)));
+    }
+    for (; i + 1 < end; i++) {
+        insert_col[i] = max(max(prev_match[i + 1] - gap_open, prev_insert_row[i + 1] - gap_open),
+                            prev_insert_col[i + 1] - gap_extend);
+    }
+}
+
+#endif
+
+template <class IntType>
+void fill_interior(kernel_type kernel, const IntType* prev_match, const IntType* prev_insert_row,
+                   const IntType* prev_insert_col, const IntType* match_scores,
+                   IntType* match, IntType* insert_col, int64_t begin, int64_t end,
+                   int8_t gap_open, int8_t gap_extend) {
+    // only the narrow types have vector kernels
+    fill_interior_scalar(prev_match, prev_insert_row, prev_insert_col, match_scores,
+                         match, insert_col, begin, end, gap_open, gap_extend);
+}
+
+template <>
+void fill_interior<int8_t>(kernel_type kernel, const int8_t* prev_match, const int8_t* prev_insert_row,
+                           const int8_t* prev_insert_col, const int8_t* match_scores,
+                           int8_t* match, int8_t* insert_col, int64_t begin, int64_t end,
+                           int8_t gap_open, int8_t gap_extend) {
+#if defined(__x86_64__)
+    if (kernel == kernel_sse41) {
+        fill_interior_sse41(prev_match, prev_insert_row, prev_insert_col, match_scores,
+                            match, insert_col, begin, end, gap_open, gap_extend);
+        return;
+    }
+#endif
+    fill_interior_scalar(prev_match, prev_insert_row, prev_insert_col, match_scores,
+                         match, insert_col, begin, end, gap_open, gap_extend);
+}
+
+template <>
+void fill_interior<int16_t>(kernel_type kernel, const int16_t* prev_match, const int16_t* prev_insert_row,
+                            const int16_t* prev_insert_col, const int16_t* match_scores,
+                            int16_t* match, int16_t* insert_col, int64_t begin, int64_t end,
+                            int8_t gap_open, int8_t gap_extend) {
+#if defined(__x86_64__)
+    if (kernel == kernel_sse41) {
+        fill_interior_sse41(prev_match, prev_insert_row, prev_insert_col, match_scores,
+                            match, insert_col, begin, end, gap_open, gap_extend);
+        return;
+    }
+#endif
+    fill_interior_scalar(prev_match, prev_insert_row, prev_insert_col, match_scores,
+                         match, insert_col, begin, end, gap_open, gap_extend);
+}
+
+template void fill_interior<int32_t>(kernel_type, const int32_t*, const int32_t*, const int32_t*, const int32_t*,
+                                     int32_t*, int32_t*, int64_t, int64_t, int8_t, int8_t);
+template void fill_interior<int64_t>(kernel_type, const int64_t*, const int64_t*, const int64_t*, const int64_t*,
+                                     int64_t*, int64_t*, int64_t, int64_t, int8_t, int8_t);
+
+}
+
 template<class IntType>
 BandedGlobalAligner<IntType>::BABuilder::BABuilder(Alignment& alignment) :
                                                    alignment(alignment),
@@ -556,7 +762,28 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
     cerr << "[BAMatrix::fill_matrix]: seeding finished, moving to subsequent columns" << endl;
 #endif
     
-    // iterate through the rest of the columns
+    // iterate through the rest of the columns, working on one column at a time in buffers that are
+    // indexed by diagonal so that the interior of the column can be filled with a vector kernel
+    banded_kernel::kernel_type kernel = banded_kernel::get_kernel();
+    vector<IntType> column_buffers(ncols > 1 ? 7 * band_height : 0, min_inf);
+    IntType* prev_match = column_buffers.data();
+    IntType* prev_insert_row = prev_match + band_height;
+    IntType* prev_insert_col = prev_insert_row + band_height;
+    IntType* curr_match = prev_insert_col + band_height;
+    IntType* curr_insert_row = curr_match + band_height;
+    IntType* curr_insert_col = curr_insert_row + band_height;
+    IntType* match_scores = curr_insert_col + band_height;
+    
+    if (ncols > 1) {
+        // gather the first column
+        for (int64_t i = iter_start; i < iter_stop; i++) {
+            idx = i * ncols;
+            prev_match[i] = match[idx];
+            prev_insert_row[i] = insert_row[idx];
+            prev_insert_col[i] = insert_col[idx];
+        }
+    }
+    
     for (int64_t j = 1; j < ncols; j++) {
         
         // are we clipping any diagonals because they are outside the range of the matrix in this column?
@@ -566,109 +793,95 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
         
         int64_t iter_start = top_diag_outside ? -(top_diag + j) : 0;
         int64_t iter_stop = bottom_diag_outside ? band_height + int64_t(read.size()) - bottom_diag - j - 1 : band_height;
+        // we always fill the first cell, even if the column is otherwise empty
+        int64_t column_stop = max(iter_stop, iter_start + 1);
         
-        idx = iter_start * ncols + j;
-        
-        IntType match_score;
+        // scores of a match in each cell of this column
+        int ref_code = 5 * nt_table[node_seq[j]];
         if (qual_adjusted) {
-            match_score = score_mat[25 * base_quality[iter_start + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[iter_start + top_diag + j]]];
+            for (int64_t i = iter_start; i < column_stop; i++) {
+                match_scores[i] = score_mat[25 * base_quality[i + top_diag + j] + ref_code + nt_table[read[i + top_diag + j]]];
+            }
         }
         else {
-            match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[iter_start + top_diag + j]]];
+            for (int64_t i = iter_start; i < column_stop; i++) {
+                match_scores[i] = score_mat[ref_code + nt_table[read[i + top_diag + j]]];
+            }
         }
+        
         if (top_diag_outside || top_diag_abutting) {
             // match after implied gap along top edge
-            match[idx] = match_score - gap_open - (cumulative_seq_len + j - 1) * gap_extend;
+            curr_match[iter_start] = match_scores[iter_start] - gap_open - (cumulative_seq_len + j - 1) * gap_extend;
             
 #ifdef debug_banded_aligner_fill_matrix
-            cerr << "[BAMatrix::fill_matrix]: on upper edge of matrix at rectangle coords (" << iter_start << ", " << j << "), match score of node char " << j << " (" << node_seq[j] << ") and read char " << iter_start + top_diag + j << " (" << read[iter_start + top_diag + j] << ") is " << (int) match_score << ", leading gap length is " << cumulative_seq_len + j << " for total match matrix score of " << (int) match[idx] << endl;
+            cerr << "[BAMatrix::fill_matrix]: on upper edge of matrix at rectangle coords (" << iter_start << ", " << j << "), match score of node char " << j << " (" << node_seq[j] << ") and read char " << iter_start + top_diag + j << " (" << read[iter_start + top_diag + j] << ") is " << (int) match_scores[iter_start] << ", leading gap length is " << cumulative_seq_len + j << " for total match matrix score of " << (int) curr_match[iter_start] << endl;
 #endif
         }
         else {
-            diag_idx = iter_start * ncols + (j - 1);
             // cells should be present to do normal diagonal iteration
-            match[idx] = match_score + max(max(match[diag_idx], insert_row[diag_idx]), insert_col[diag_idx]);
+            curr_match[iter_start] = match_scores[iter_start] + max(max(prev_match[iter_start], prev_insert_row[iter_start]),
+                                                                    prev_insert_col[iter_start]);
         }
         
         if (top_diag_outside) {
             // gap open after implied gap along top edge
-            insert_row[idx] = -2 * gap_open - (cumulative_seq_len + j) * gap_extend;
+            curr_insert_row[iter_start] = -2 * gap_open - (cumulative_seq_len + j) * gap_extend;
         }
         else {
             // cannot reach this node with row insert (outside the diagonal)
-            insert_row[idx] = min_inf;
+            curr_insert_row[iter_start] = min_inf;
         }
         
         // normal iteration along row unless band height is 1
         if (band_height != 1) {
-            int64_t left_idx = (iter_start + 1) * ncols + (j - 1);
-            insert_col[idx] = max(max(match[left_idx] - gap_open, insert_row[left_idx] - gap_open),
-                                  insert_col[left_idx] - gap_extend);
+            curr_insert_col[iter_start] = max(max(prev_match[iter_start + 1] - gap_open, prev_insert_row[iter_start + 1] - gap_open),
+                                              prev_insert_col[iter_start + 1] - gap_extend);
         }
         else {
-            insert_col[idx] = min_inf;
+            curr_insert_col[iter_start] = min_inf;
         }
         
+        // the match and column insert cells below the first only depend on the previous column
+        banded_kernel::fill_interior<IntType>(kernel, prev_match, prev_insert_row, prev_insert_col, match_scores,
+                                              curr_match, curr_insert_col, iter_start + 1, iter_stop,
+                                              gap_open, gap_extend);
         
-        for (int64_t i = iter_start + 1; i < iter_stop - 1; i++) {
-            // indices of the current and previous cells in the rectangularized band
-            idx = i * ncols + j;
-            up_idx = (i - 1) * ncols + j;
-            diag_idx = i * ncols + (j - 1);
-            left_idx = (i + 1) * ncols + (j - 1);
-            
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[i + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-            }
-            
-            match[idx] = match_score + max(max(match[diag_idx], insert_row[diag_idx]), insert_col[diag_idx]);
-            
-            insert_row[idx] = max(max(match[up_idx] - gap_open, insert_row[up_idx] - gap_extend),
-                                  insert_col[up_idx] - gap_open);
-            
-            insert_col[idx] = max(max(match[left_idx] - gap_open, insert_row[left_idx] - gap_open),
-                                  insert_col[left_idx] - gap_extend);
-            
-#ifdef debug_banded_aligner_fill_matrix
-            cerr << "[BAMatrix::fill_matrix]: in interior of matrix at rectangle coords (" << i << ", " << j << "), match score of node char " << j << " (" << node_seq[j] << ") and read char " << i + top_diag + j << " (" << read[i + top_diag + j] << ") is " << (int) match_score << ", leading gap length is " << cumulative_seq_len + j << " for total match matrix score of " << (int) match[idx] << endl;
-#endif
-        }
-        
-        // stop iteration one cell early to handle logic on bottom edge of band
+        // the kernel stops the column inserts one cell early to handle logic on bottom edge of band
         
         // skip this step in edge case where read length is 1
         if (iter_stop - 1 > iter_start) {
-            idx = (iter_stop - 1) * ncols + j;
-            up_idx = (iter_stop - 2) * ncols + j;
-            diag_idx = (iter_stop - 1) * ncols + (j - 1);
-            
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[iter_stop + top_diag + j - 1] + 5 * nt_table[node_seq[j]] + nt_table[read[iter_stop + top_diag + j - 1]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[iter_stop + top_diag + j - 1]]];
-            }
-            
-            match[idx] = match_score + max(max(match[diag_idx], insert_row[diag_idx]), insert_col[diag_idx]);
-            
-            insert_row[idx] = max(max(match[up_idx] - gap_open, insert_row[up_idx] - gap_extend),
-                                  insert_col[up_idx] - gap_open);
-            
             if (bottom_diag_outside) {
                 // along the bottom edge of the matrix, so the cell to the right is still there
-                left_idx = iter_stop * ncols + (j - 1);
-                insert_col[idx] = max(max(match[left_idx] - gap_open, insert_row[left_idx] - gap_open),
-                                      insert_col[left_idx] - gap_extend);
-                
+                curr_insert_col[iter_stop - 1] = max(max(prev_match[iter_stop] - gap_open, prev_insert_row[iter_stop] - gap_open),
+                                                     prev_insert_col[iter_stop] - gap_extend);
             }
             else {
                 // cell to the right is outside the band
-                insert_col[idx] = min_inf;
+                curr_insert_col[iter_stop - 1] = min_inf;
             }
         }
+        
+        // row inserts depend on the cell above, so they have to be done in order
+        for (int64_t i = iter_start + 1; i < iter_stop; i++) {
+            curr_insert_row[i] = max(max(curr_match[i - 1] - gap_open, curr_insert_row[i - 1] - gap_extend),
+                                     curr_insert_col[i - 1] - gap_open);
+            
+#ifdef debug_banded_aligner_fill_matrix
+            cerr << "[BAMatrix::fill_matrix]: in interior of matrix at rectangle coords (" << i << ", " << j << "), match score of node char " << j << " (" << node_seq[j] << ") and read char " << i + top_diag + j << " (" << read[i + top_diag + j] << ") is " << (int) match_scores[i] << ", leading gap length is " << cumulative_seq_len + j << " for total match matrix score of " << (int) curr_match[i] << endl;
+#endif
+        }
+        
+        // scatter the column back into the rectangularized band
+        for (int64_t i = iter_start; i < column_stop; i++) {
+            idx = i * ncols + j;
+            match[idx] = curr_match[i];
+            insert_row[idx] = curr_insert_row[i];
+            insert_col[idx] = curr_insert_col[i];
+        }
+        
+        swap(prev_match, curr_match);
+        swap(prev_insert_row, curr_insert_row);
+        swap(prev_insert_col, curr_insert_col);
     }
     
 #ifdef debug_banded_aligner_print_matrices
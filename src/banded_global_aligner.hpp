@@ -34,6 +34,45 @@ namespace vg {
         int get_count();
     };
     
+    /**
+     * Kernels for filling the interior of one column of a node's band in the
+     * BandedGlobalAligner. The band is processed a column at a time, and within
+     * a column the match and column-insert cells only depend on the previous
+     * column, so they can be computed for many diagonals at once. The 8- and
+     * 16-bit matrices can use SSE4.1; wider ones always use the scalar kernel.
+     * All kernels give identical results, including on overflow.
+     */
+    namespace banded_kernel {
+    
+        enum kernel_type { kernel_scalar, kernel_sse41 };
+        
+        /// Returns the fastest kernel supported by the current CPU.
+        kernel_type best();
+        
+        /// Returns true if the kernel can be used on the current CPU.
+        bool supported(kernel_type kernel);
+        
+        /// Returns a human-readable name for the kernel.
+        const char* name(kernel_type kernel);
+        
+        /// Returns the kernel that BandedGlobalAligners will use. Defaults to best().
+        kernel_type get_kernel();
+        
+        /// Choose the kernel that BandedGlobalAligners will use, for testing and
+        /// benchmarking. Falls back to scalar if the kernel is not supported.
+        void set_kernel(kernel_type kernel);
+        
+        /// Fill in cells [begin, end) of a column of the match matrix, and cells
+        /// [begin, end - 1) of the column insert matrix, from the previous
+        /// column and the match scores of the current column. All arrays are
+        /// indexed by diagonal within the band.
+        template <class IntType>
+        void fill_interior(kernel_type kernel, const IntType* prev_match, const IntType* prev_insert_row,
+                           const IntType* prev_insert_col, const IntType* match_scores,
+                           IntType* match, IntType* insert_col, int64_t begin, int64_t end,
+                           int8_t gap_open, int8_t gap_extend);
+    }
+    
     /**
      * The outward-facing interface for banded global graph alignment. It computes optimal alignment
      * of a DNA sequence to a DAG with POA. The alignment will start at any source node in the graph and
@@ -0,0 +1,93 @@
+/// \file candidate_alignment.cpp
+///
+/// Conversions of candidate alignments to output formats.
+///
+
+#include "candidate_alignment.hpp"
+#include "annotation.hpp"
+
+#include "vg/io/alignment_io.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/// Set the value for the given name in a list of named values, replacing any
+/// value it already has.
+template<typename Value>
+static void set_named_value(vector<pair<string, Value>>& values, const string& name, const Value& value) {
+    for (auto& named_value : values) {
+        if (named_value.first == name) {
+            named_value.second = value;
+            return;
+        }
+    }
+    values.emplace_back(name, value);
+}
+
+void set_annotation(CandidateAlignment& candidate, const string& name, double value) {
+    set_named_value(candidate.number_annotations, name, value);
+}
+
+void set_annotation(CandidateAlignment& candidate, const string& name, bool value) {
+    set_named_value(candidate.flag_annotations, name, value);
+}
+
+void set_annotation(CandidateAlignment& candidate, const string& name, const string& value) {
+    set_named_value(candidate.string_annotations, name, value);
+}
+
+void set_annotation(CandidateAlignment& candidate, const string& name, const vector<double>& value) {
+    set_named_value(candidate.list_annotations, name, value);
+}
+
+/// Fill in an Alignment of the given read from a candidate alignment of it,
+/// reusing whatever memory the Alignment already has.
+static void fill_alignment(const Alignment& read, const CandidateAlignment& candidate, Alignment& alignment) {
+    alignment = read;
+    alignment.clear_refpos();
+    alignment.clear_path();
+    to_proto_path(candidate.path, *alignment.mutable_path());
+    alignment.set_score(candidate.score);
+    alignment.set_identity(candidate.identity);
+    alignment.set_mapping_quality(candidate.mapping_quality);
+    alignment.set_is_secondary(candidate.is_secondary);
+    for (auto& annotation : candidate.number_annotations) {
+        set_annotation(alignment, annotation.first, annotation.second);
+    }
+    for (auto& annotation : candidate.flag_annotations) {
+        set_annotation(alignment, annotation.first, annotation.second);
+    }
+    for (auto& annotation : candidate.string_annotations) {
+        set_annotation(alignment, annotation.first, annotation.second);
+    }
+    for (auto& annotation : candidate.list_annotations) {
+        set_annotation(alignment, annotation.first, annotation.second);
+    }
+}
+
+Alignment candidate_to_alignment(const Alignment& read, const CandidateAlignment& candidate) {
+    Alignment alignment;
+    fill_alignment(read, candidate, alignment);
+    return alignment;
+}
+
+void candidate_to_gaf(ostream& out, const HandleGraph& graph, const Alignment& read,
+                      const CandidateAlignment& candidate,
+                      const string* prev_name, const string* next_name) {
+    thread_local Alignment alignment;
+    fill_alignment(read, candidate, alignment);
+    // The read's own links never apply to a candidate, so these are all the
+    // links there are.
+    alignment.clear_fragment_prev();
+    alignment.clear_fragment_next();
+    if (prev_name != nullptr) {
+        alignment.mutable_fragment_prev()->set_name(*prev_name);
+    }
+    if (next_name != nullptr) {
+        alignment.mutable_fragment_next()->set_name(*next_name);
+    }
+    out << vg::io::alignment_to_gaf(graph, alignment);
+}
+
+}
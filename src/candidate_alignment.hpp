@@ -0,0 +1,83 @@
+/// \file candidate_alignment.hpp
+///
+/// Defines the lightweight alignment the MinimizerMapper carries through
+/// mapping, and its conversions to output formats.
+///
+
+#ifndef VG_CANDIDATE_ALIGNMENT_HPP_INCLUDED
+#define VG_CANDIDATE_ALIGNMENT_HPP_INCLUDED
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vg/vg.pb.h>
+#include "path.hpp"
+#include "handle.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A candidate alignment of a read, as it is kept through extension, tail
+ * alignment, pairing, rescue, winner selection and MAPQ. It holds only what
+ * differs between candidates for the same read, in non-protobuf form, so
+ * making, copying and discarding candidates is cheap. The read's name,
+ * sequence and qualities stay in the read's Alignment, and the two are only
+ * put together when the candidate is output.
+ *
+ * Annotations are kept as plain named values, one list per type, and are
+ * set with the set_annotation() overloads below.
+ */
+struct CandidateAlignment {
+    path_t path;
+    int32_t score = 0;
+    double identity = 0.0;
+    int32_t mapping_quality = 0;
+    bool is_secondary = false;
+
+    /// Annotations to add to the read's own when the candidate is output,
+    /// in the order they were first set.
+    vector<pair<string, double>> number_annotations;
+    vector<pair<string, bool>> flag_annotations;
+    vector<pair<string, string>> string_annotations;
+    vector<pair<string, vector<double>>> list_annotations;
+};
+
+/// Set a number annotation on a candidate, replacing any earlier value with
+/// the same name. Picked over the protobuf Struct templates in annotation.hpp,
+/// so Funnel::annotate_mapped_alignment() works on candidates too.
+void set_annotation(CandidateAlignment& candidate, const string& name, double value);
+
+/// Set a flag annotation on a candidate, replacing any earlier value.
+void set_annotation(CandidateAlignment& candidate, const string& name, bool value);
+
+/// Set a string annotation on a candidate, replacing any earlier value.
+void set_annotation(CandidateAlignment& candidate, const string& name, const string& value);
+
+/// Set a list annotation on a candidate, replacing any earlier value.
+void set_annotation(CandidateAlignment& candidate, const string& name, const vector<double>& value);
+
+/**
+ * Make an Alignment of the given read from a candidate alignment of it. Any
+ * old path, score, identity or mapping quality on the read are replaced, and
+ * the candidate's annotations are added to the read's.
+ */
+Alignment candidate_to_alignment(const Alignment& read, const CandidateAlignment& candidate);
+
+/**
+ * Write the given candidate alignment of the given read as a GAF line,
+ * without a trailing newline, with fragment links to prev_name and next_name
+ * if set. The line comes from vg::io::alignment_to_gaf(), by way of an
+ * Alignment that each thread keeps and refills, so its protobuf fields keep
+ * their memory from read to read.
+ */
+void candidate_to_gaf(ostream& out, const HandleGraph& graph, const Alignment& read,
+                      const CandidateAlignment& candidate,
+                      const string* prev_name = nullptr, const string* next_name = nullptr);
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * \file candidate_alignment_emitter.cpp
+ *
+ * Implements a system for emitting the candidate alignments of mapped reads
+ * in multiple formats.
+ */
+
+#include "candidate_alignment_emitter.hpp"
+
+#include <omp.h>
+
+namespace vg {
+using namespace std;
+
+CandidateAlignmentEmitter::CandidateAlignmentEmitter(unique_ptr<vg::io::AlignmentEmitter>&& backing) :
+    backing(std::move(backing)) {
+    // Nothing to do
+}
+
+CandidateAlignmentEmitter::CandidateAlignmentEmitter(const string& filename, size_t max_threads, const HandleGraph& graph) :
+    graph(&graph), out_file(filename == "-" ? nullptr : new ofstream(filename)) {
+
+    if (out_file.get() != nullptr && !*out_file) {
+        // Make sure we opened a file if we aren't writing to standard output
+        cerr << "error:[vg::CandidateAlignmentEmitter] failed to open " << filename << " for writing" << endl;
+        exit(1);
+    }
+
+    multiplexer.reset(new vg::io::StreamMultiplexer(out_file.get() != nullptr ? *out_file : cout, max_threads));
+}
+
+void CandidateAlignmentEmitter::emit_single(const Alignment& read, vector<CandidateAlignment>&& mappings) {
+    if (backing) {
+        vector<Alignment> alignments;
+        alignments.reserve(mappings.size());
+        for (auto& mapping : mappings) {
+            alignments.emplace_back(candidate_to_alignment(read, mapping));
+        }
+        backing->emit_mapped_single(std::move(alignments));
+    } else {
+        size_t thread_number = omp_get_thread_num();
+        ostream& out = multiplexer->get_thread_stream(thread_number);
+        for (auto& mapping : mappings) {
+            candidate_to_gaf(out, *graph, read, mapping);
+            out << "\n";
+        }
+        multiplexer->register_breakpoint(thread_number);
+    }
+}
+
+void CandidateAlignmentEmitter::emit_pair(const Alignment& read1, const Alignment& read2,
+                                          vector<CandidateAlignment>&& mappings1, vector<CandidateAlignment>&& mappings2,
+                                          int64_t tlen_limit) {
+    // Each read points to its partner, if it has any mappings to point to.
+    const string* prev_name = mappings1.empty() ? nullptr : &read1.name();
+    const string* next_name = mappings2.empty() ? nullptr : &read2.name();
+
+    if (backing) {
+        vector<Alignment> alignments1;
+        alignments1.reserve(mappings1.size());
+        for (auto& mapping : mappings1) {
+            alignments1.emplace_back(candidate_to_alignment(read1, mapping));
+            if (next_name) {
+                alignments1.back().mutable_fragment_next()->set_name(*next_name);
+            }
+        }
+        vector<Alignment> alignments2;
+        alignments2.reserve(mappings2.size());
+        for (auto& mapping : mappings2) {
+            alignments2.emplace_back(candidate_to_alignment(read2, mapping));
+            if (prev_name) {
+                alignments2.back().mutable_fragment_prev()->set_name(*prev_name);
+            }
+        }
+        backing->emit_mapped_pair(std::move(alignments1), std::move(alignments2), tlen_limit);
+    } else {
+        size_t thread_number = omp_get_thread_num();
+        ostream& out = multiplexer->get_thread_stream(thread_number);
+        // Pairs go out interleaved, as an AlignmentEmitter would write them.
+        for (size_t i = 0; i < mappings1.size() && i < mappings2.size(); i++) {
+            candidate_to_gaf(out, *graph, read1, mappings1[i], nullptr, next_name);
+            out << "\n";
+            candidate_to_gaf(out, *graph, read2, mappings2[i], prev_name, nullptr);
+            out << "\n";
+        }
+        multiplexer->register_breakpoint(thread_number);
+    }
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef VG_CANDIDATE_ALIGNMENT_EMITTER_HPP_INCLUDED
+#define VG_CANDIDATE_ALIGNMENT_EMITTER_HPP_INCLUDED
+
+/**
+ * \file candidate_alignment_emitter.hpp
+ *
+ * Defines a system for emitting the candidate alignments of mapped reads in
+ * multiple formats.
+ */
+
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include <vg/io/alignment_emitter.hpp>
+#include <vg/io/stream_multiplexer.hpp>
+#include "candidate_alignment.hpp"
+#include "handle.hpp"
+
+namespace vg {
+using namespace std;
+
+/*
+ * Class that handles multithreaded output for the candidate alignments of
+ * reads. GAF is written with candidate_to_gaf(), which reuses one Alignment
+ * per thread. Other formats go through an AlignmentEmitter, and the
+ * Alignments it needs are only made here.
+ */
+class CandidateAlignmentEmitter {
+public:
+
+    /// Send alignments to the given AlignmentEmitter, converting them from
+    /// candidates on the way.
+    CandidateAlignmentEmitter(unique_ptr<vg::io::AlignmentEmitter>&& backing);
+
+    /// Write alignments as GAF to the given file, or "-" for standard output,
+    /// from up to the given number of threads. The graph must have all the
+    /// nodes the alignments visit.
+    CandidateAlignmentEmitter(const string& filename, size_t max_threads, const HandleGraph& graph);
+
+    // Not copyable or movable
+    CandidateAlignmentEmitter(const CandidateAlignmentEmitter& other) = delete;
+    CandidateAlignmentEmitter& operator=(const CandidateAlignmentEmitter& other) = delete;
+    CandidateAlignmentEmitter(CandidateAlignmentEmitter&& other) = delete;
+    CandidateAlignmentEmitter& operator=(CandidateAlignmentEmitter&& other) = delete;
+
+    /// Emit the mappings of a single read, winner first.
+    void emit_single(const Alignment& read, vector<CandidateAlignment>&& mappings);
+
+    /// Emit the mappings of a pair of reads, with corresponding entries
+    /// paired together. Reads will be linked to their pair partners. The
+    /// tlen_limit is as for AlignmentEmitter::emit_mapped_pair().
+    void emit_pair(const Alignment& read1, const Alignment& read2,
+                   vector<CandidateAlignment>&& mappings1, vector<CandidateAlignment>&& mappings2,
+                   int64_t tlen_limit = 0);
+
+private:
+
+    /// Where Alignments go, if we aren't writing GAF ourselves.
+    unique_ptr<vg::io::AlignmentEmitter> backing;
+
+    /// The graph to get node lengths and sequences from for GAF.
+    const HandleGraph* graph = nullptr;
+
+    /// If we are writing GAF to a file, this holds the open file. Otherwise
+    /// (for standard output or a backing emitter) it is empty.
+    unique_ptr<ofstream> out_file;
+
+    /// If we are writing GAF, this shares the output stream between threads.
+    unique_ptr<vg::io::StreamMultiplexer> multiplexer;
+};
+
+}
+
+#endif
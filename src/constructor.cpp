@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <memory>
 
+#include <omp.h>
+
 //#define debug
 
 namespace vg {
@@ -535,7 +537,8 @@ namespace vg {
                         if (alt != upper_case_alt) {
                             if (!lowercase_warned_alt && warn_on_lowercase) {
                                 #pragma omp critical (cerr)
-                                {
+                                if (!lowercase_warned_alt) {
+                                    // Chunks can be constructed in parallel, so check again now that we have the lock
                                     cerr << "warning:[vg::Constructor] Lowercase characters found in "
                                          << "variant, coercing to uppercase:\n" << *variant << endl;
                                     lowercase_warned_alt = true;
@@ -1800,6 +1803,59 @@ namespace vg {
             callback(chunk.graph);
         };
 
+        // The chunks themselves are independent, so we construct them in
+        // batches on multiple threads. Then we wire them up and emit them in
+        // order on this thread, so IDs come out the same as if we had built
+        // them one at a time.
+        struct PendingChunk {
+            string reference_sequence;
+            vector<vcflib::Variant> variants;
+            size_t start;
+            size_t end;
+            ConstructedChunk constructed;
+        };
+        vector<PendingChunk> pending_chunks;
+        size_t max_pending_chunks = max(omp_get_max_threads(), 1) * 2;
+
+        // Construct, wire up, and emit all the pending chunks
+        auto finish_pending_chunks = [&]() {
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < pending_chunks.size(); i++) {
+                PendingChunk& pending = pending_chunks[i];
+                pending.constructed = construct_chunk(std::move(pending.reference_sequence), reference_contig,
+                                                      std::move(pending.variants), pending.start);
+            }
+            for (PendingChunk& pending : pending_chunks) {
+                // Wire up and emit the chunk graph
+                wire_and_emit(pending.constructed);
+
+                // Say we've completed the chunk
+                update_progress(pending.end - leading_offset);
+            }
+            pending_chunks.clear();
+        };
+
+        // Queue up the chunk from chunk_start to chunk_end with the variants
+        // in chunk_variants, and set up a new chunk after it.
+        auto finish_chunk = [&]() {
+            pending_chunks.emplace_back();
+            PendingChunk& pending = pending_chunks.back();
+            // Get the ref sequence we need
+            pending.reference_sequence = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
+            pending.variants = std::move(chunk_variants);
+            pending.start = chunk_start;
+            pending.end = chunk_end;
+
+            if (pending_chunks.size() >= max_pending_chunks) {
+                finish_pending_chunks();
+            }
+
+            // Set up a new chunk
+            chunk_start = chunk_end;
+            chunk_end = 0;
+            chunk_variants.clear();
+        };
+
         bool do_external_insertions = false;
         FastaReference* insertion_fasta;
 
@@ -1980,22 +2036,8 @@ namespace vg {
                             min((size_t) reference_end,
                                 (size_t) (chunk_start + bases_per_chunk))));
 
-                // Get the ref sequence we need
-                auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-                // Call the construction
-                auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-                // Wire up and emit the chunk graph
-                wire_and_emit(result);
-
-                // Say we've completed the chunk
-                update_progress(chunk_end - leading_offset);
-
-                // Set up a new chunk
-                chunk_start = chunk_end;
-                chunk_end = 0;
-                chunk_variants.clear();
+                // Send it off for construction and start a new chunk
+                finish_chunk();
 
                 // Loop again on the same variant.
             }
@@ -2016,24 +2058,13 @@ namespace vg {
                     min((size_t) reference_end,
                         (size_t) (chunk_start + bases_per_chunk)));
 
-            // Get the ref sequence we need
-            auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-            // Call the construction
-            auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-            // Wire up and emit the chunk graph
-            wire_and_emit(result);
-
-            // Say we've completed the chunk
-            update_progress(chunk_end - leading_offset);
-
-            // Set up a new chunk
-            chunk_start = chunk_end;
-            chunk_end = 0;
-            chunk_variants.clear();
+            // Send it off for construction and start a new chunk
+            finish_chunk();
         }
 
+        // Construct whatever is left
+        finish_pending_chunks();
+
         // All the chunks have been wired and emitted.
         
         if (last_node_buffer.id() != 0) {
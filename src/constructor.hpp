@@ -178,6 +178,9 @@ public:
      *
      * Calls the given callback with constructed graph chunks, in a single
      * thread. Chunks may contain dangling edges into the next chunk.
+     *
+     * Chunks are constructed in batches on multiple OMP threads, but are
+     * emitted in order, with the same IDs as if they were built one at a time.
      */
     void construct_graph(string vcf_contig, FastaReference& reference, VcfBuffer& variant_source,
          const vector<FastaReference*>& insertion, const function<void(Graph&)>& callback);
@@ -167,6 +167,64 @@ void Deconstructor::get_genotypes(vcflib::Variant& v, const vector<string>& name
     }
 }
 
+void Deconstructor::get_gbwt_genotypes(vcflib::Variant& v, const vector<vector<gbwt::size_type>>& trav_to_gbwt_paths,
+                                       size_t gbwt_trav_offset, const vector<int>& trav_to_allele) {
+    v.format.push_back("GT");
+
+    // get the alleles that each phase of each sample takes through the site
+    // (haplotypes with the same traversal were found together, so we don't look at each one's traversal)
+    map<string, map<size_t, vector<int>>> sample_to_phase_alleles;
+    for (size_t i = 0; i < trav_to_gbwt_paths.size(); ++i) {
+        int allele = trav_to_allele.at(i + gbwt_trav_offset);
+        for (gbwt::size_type path_id : trav_to_gbwt_paths[i]) {
+            const gbwt::PathName& path_name = gbwt->metadata.path(path_id);
+            sample_to_phase_alleles[gbwt->metadata.sample(path_name.sample)][path_name.phase].push_back(allele);
+        }
+    }
+
+    // write out a phased genotype for each sample, with "." for phases that don't cross the site
+    set<string> conflicts;
+    for (auto& sample_name : sample_names) {
+        auto found = sample_to_phase_alleles.find(sample_name);
+        if (found == sample_to_phase_alleles.end()) {
+            v.samples[sample_name]["GT"] = {"."};
+            continue;
+        }
+        string genotype;
+        for (size_t phase : gbwt_sample_phases.at(sample_name)) {
+            if (!genotype.empty()) {
+                genotype += "|";
+            }
+            auto phase_alleles = found->second.find(phase);
+            if (phase_alleles == found->second.end()) {
+                genotype += ".";
+                continue;
+            }
+            // a phase can cross the site more than once.  if it takes different alleles when it does,
+            // flag a conflict and use the most frequent one, preferring non-ref when possible
+            map<int, int> allele_frequencies;
+            for (int allele : phase_alleles->second) {
+                ++allele_frequencies[allele];
+            }
+            if (allele_frequencies.size() > 1) {
+                conflicts.insert(sample_name);
+            }
+            int chosen_allele = allele_frequencies.begin()->first;
+            for (auto& allele_frequency : allele_frequencies) {
+                if (allele_frequency.second > allele_frequencies[chosen_allele] ||
+                    (allele_frequency.second == allele_frequencies[chosen_allele] && chosen_allele == 0)) {
+                    chosen_allele = allele_frequency.first;
+                }
+            }
+            genotype += std::to_string(chosen_allele);
+        }
+        v.samples[sample_name]["GT"] = {genotype};
+    }
+    for (auto& conflict_sample : conflicts) {
+        v.info["CONFLICT"].push_back(conflict_sample);
+    }
+}
+
 pair<vector<int>, bool> Deconstructor::choose_traversals(const vector<int>& travs, const vector<int>& trav_to_allele,
                                                          const vector<string>& trav_to_name) {
     assert(!travs.empty());
@@ -271,6 +329,22 @@ bool Deconstructor::deconstruct_site(const Snarl* snarl) {
         return false;
     }
 
+    // add in the gbwt haplotype traversals.  each distinct traversal comes once, with all the
+    // haplotypes that take it
+    size_t gbwt_trav_offset = path_travs.first.size();
+    vector<vector<gbwt::size_type>> trav_to_gbwt_paths;
+    if (gbwt) {
+        pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> gbwt_travs = gbwt_trav_finder->find_path_traversals(*snarl);
+        for (int i = 0; i < gbwt_travs.first.size(); ++i) {
+            path_travs.first.push_back(std::move(gbwt_travs.first[i]));
+            // dummy names so we can use the same code as the named path traversals above
+            path_trav_names.push_back(" gbwt" + std::to_string(i));
+            // dummy handles so we can use the same code as the named path traversals above
+            path_travs.second.push_back(make_pair(step_handle_t(), step_handle_t()));
+        }
+        trav_to_gbwt_paths = std::move(gbwt_travs.second);
+    }
+
     // add in the exhaustive traversals
     if (!path_restricted) {
         // exhaustive traversal can't do all snarls
@@ -353,7 +427,9 @@ bool Deconstructor::deconstruct_site(const Snarl* snarl) {
         vector<int> trav_to_allele = get_alleles(v, path_travs.first, ref_trav_idx, prev_char, use_start);
 
         // Fill in the genotypes
-        if (path_restricted) {
+        if (gbwt) {
+            get_gbwt_genotypes(v, trav_to_gbwt_paths, gbwt_trav_offset, trav_to_allele);
+        } else if (path_restricted) {
             get_genotypes(v, path_trav_names, trav_to_allele);
         }
 
@@ -373,7 +449,8 @@ bool Deconstructor::deconstruct_site(const Snarl* snarl) {
  */
 void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHandleGraph* graph, SnarlManager* snarl_manager,
                                 bool path_restricted_traversals, int ploidy, bool include_nested,
-                                const unordered_map<string, string>* path_to_sample) {
+                                const unordered_map<string, string>* path_to_sample,
+                                const gbwt::GBWT* gbwt) {
 
     this->graph = graph;
     this->snarl_manager = snarl_manager;
@@ -381,26 +458,39 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
     this->ploidy =ploidy;
     this->path_to_sample = path_to_sample;
     this->ref_paths = set<string>(ref_paths.begin(), ref_paths.end());
+    this->gbwt = gbwt;
     assert(path_to_sample == nullptr || path_restricted);
+    assert(gbwt == nullptr || (path_restricted && path_to_sample == nullptr));
     
-    // Keep track of the non-reference paths in the graph.  They'll be our sample names
     sample_names.clear();
-    graph->for_each_path_handle([&](const path_handle_t& path_handle) {
-            string path_name = graph->get_path_name(path_handle);
-            if (!this->ref_paths.count(path_name)) {
-                // rely on the given map.  if a path isn't in it, it'll be ignored
-                if (path_to_sample) {
-                    if (path_to_sample->count(path_name)) {
-                        sample_names.insert(path_to_sample->find(path_name)->second);
+    gbwt_sample_phases.clear();
+    if (gbwt) {
+        // The gbwt haplotypes are our samples
+        for (gbwt::size_type i = 0; i < gbwt->metadata.paths(); ++i) {
+            const gbwt::PathName& path_name = gbwt->metadata.path(i);
+            string sample_name = gbwt->metadata.sample(path_name.sample);
+            sample_names.insert(sample_name);
+            gbwt_sample_phases[sample_name].insert(path_name.phase);
+        }
+    } else {
+        // Keep track of the non-reference paths in the graph.  They'll be our sample names
+        graph->for_each_path_handle([&](const path_handle_t& path_handle) {
+                string path_name = graph->get_path_name(path_handle);
+                if (!this->ref_paths.count(path_name)) {
+                    // rely on the given map.  if a path isn't in it, it'll be ignored
+                    if (path_to_sample) {
+                        if (path_to_sample->count(path_name)) {
+                            sample_names.insert(path_to_sample->find(path_name)->second);
+                        }
+                        // if we have the map, we only consider paths there-in
+                    }
+                    else {
+                        // no name mapping, just use every path as is
+                        sample_names.insert(path_name);
                     }
-                    // if we have the map, we only consider paths there-in
-                }
-                else {
-                    // no name mapping, just use every path as is
-                    sample_names.insert(path_name);
                 }
-            }
-        });
+            });
+    }
     
     // print the VCF header
     stringstream stream;
@@ -410,6 +500,8 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
     }
     if (path_to_sample) {
         stream << "##FORMAT=<ID=PI,Number=.,Type=String,Description=\"Path information. Original vg path name for sample as well as its allele (can be many paths per sample)\">" << endl;
+    }
+    if (path_to_sample || gbwt) {
         stream << "##INFO=<ID=CONFLICT,Number=.,Type=String,Description=\"Sample names for which there are multiple paths in the graph with conflicting alleles (details in PI field)\">" << endl;
     }
     for(auto& refpath : ref_paths) {
@@ -434,8 +526,22 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
 
     // create the traversal finder
     map<string, const Alignment*> reads_by_name;
-    path_trav_finder = unique_ptr<PathTraversalFinder>(new PathTraversalFinder(*graph,
-                                                                               *snarl_manager));
+    if (gbwt) {
+        // we only need the embedded paths for the reference, so don't look at any others
+        vector<string> graph_ref_paths;
+        for (auto& ref_path : ref_paths) {
+            if (graph->has_path(ref_path)) {
+                graph_ref_paths.push_back(ref_path);
+            }
+        }
+        path_trav_finder = unique_ptr<PathTraversalFinder>(new PathTraversalFinder(*graph,
+                                                                                   *snarl_manager,
+                                                                                   graph_ref_paths));
+        gbwt_trav_finder = unique_ptr<GBWTTraversalFinder>(new GBWTTraversalFinder(*graph, *gbwt));
+    } else {
+        path_trav_finder = unique_ptr<PathTraversalFinder>(new PathTraversalFinder(*graph,
+                                                                                   *snarl_manager));
+    }
     
     if (!path_restricted) {
         trav_finder = unique_ptr<TraversalFinder>(new ExhaustiveTraversalFinder(*graph,
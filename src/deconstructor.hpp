@@ -30,10 +30,13 @@ public:
     Deconstructor();
     ~Deconstructor();
 
-    // deconstruct the entire graph to cout
+    // deconstruct the entire graph to cout.
+    // if a gbwt is given, its haplotypes are used as the alt traversals and samples
+    // instead of the non-reference embedded paths
     void deconstruct(vector<string> refpaths, const PathPositionHandleGraph* grpah, SnarlManager* snarl_manager,
                      bool path_restricted_traversals, int ploidy, bool include_nested,
-                     const unordered_map<string, string>* path_to_sample = nullptr); 
+                     const unordered_map<string, string>* path_to_sample = nullptr,
+                     const gbwt::GBWT* gbwt = nullptr); 
     
 private:
 
@@ -48,6 +51,11 @@ private:
     // write traversal path names as genotypes
     void get_genotypes(vcflib::Variant& v, const vector<string>& names, const vector<int>& trav_to_allele);
 
+    // write the genotypes of the gbwt samples, given the gbwt path ids that take each traversal
+    // (traversal i has the paths in trav_to_gbwt_paths[i - gbwt_trav_offset])
+    void get_gbwt_genotypes(vcflib::Variant& v, const vector<vector<gbwt::size_type>>& trav_to_gbwt_paths,
+                            size_t gbwt_trav_offset, const vector<int>& trav_to_allele);
+
     // given a set of traversals associated with a particular sample, select a set of size <ploidy> for the VCF
     // the highest-frequency ALT traversal is chosen
     // the bool returned is true if multiple traversals map to different alleles, more than ploidy.
@@ -81,6 +89,14 @@ private:
     unique_ptr<PathTraversalFinder> path_trav_finder;
     // we optionally use another (exhaustive for now) traversal finder if we don't want to rely on paths
     unique_ptr<TraversalFinder> trav_finder;
+    // or we take the alt traversals from the haplotypes in a gbwt
+    unique_ptr<GBWTTraversalFinder> gbwt_trav_finder;
+
+    // the gbwt, if we are using one
+    const gbwt::GBWT* gbwt = nullptr;
+
+    // all the phases of each gbwt sample, which make up its genotype
+    map<string, set<size_t>> gbwt_sample_phases;
 
     // the ref paths
     set<string> ref_paths;
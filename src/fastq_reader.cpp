@@ -0,0 +1,258 @@
+#include "fastq_reader.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "vg/io/alignment_io.hpp"
+
+/**
+ * \file fastq_reader.cpp: implementation of the FastqReader class
+ */
+
+namespace vg {
+
+using namespace std;
+
+FastqReader::FastqReader(const string& filename, size_t reader_threads) : stop(false), starved_nanoseconds(0) {
+    // The reader thread counts as one of the reader threads, and any others
+    // inflate BGZF blocks.
+    inputs.reserve(1);
+    open_input(filename, max<size_t>(reader_threads, 1) - 1);
+    filling.reserve(BATCH_SIZE);
+    reader_thread = thread(&FastqReader::read_all, this);
+}
+
+FastqReader::FastqReader(const string& filename1, const string& filename2, size_t reader_threads) : stop(false), starved_nanoseconds(0) {
+    // One reader thread serves both files, and they split any others for
+    // inflating BGZF blocks.
+    size_t helper_threads = max<size_t>(reader_threads, 1) - 1;
+    inputs.reserve(2);
+    open_input(filename1, (helper_threads + 1) / 2);
+    open_input(filename2, helper_threads / 2);
+    filling.reserve(BATCH_SIZE * inputs.size());
+    reader_thread = thread(&FastqReader::read_all, this);
+}
+
+FastqReader::~FastqReader() {
+    {
+        // Tell the reader to stop even if it is blocked on a full queue.
+        lock_guard<mutex> lock(queue_mutex);
+        stop = true;
+    }
+    space_ready.notify_all();
+    reader_thread.join();
+    for (InputFile& input : inputs) {
+        bgzf_close(input.fp);
+    }
+}
+
+void FastqReader::open_input(const string& filename, size_t helper_threads) {
+    inputs.emplace_back();
+    InputFile& input = inputs.back();
+    input.filename = filename;
+    input.fp = bgzf_open(filename.c_str(), "r");
+    if (!input.fp) {
+        cerr << "[vg::fastq_reader.cpp] couldn't open " << filename << endl; exit(1);
+    }
+    if (helper_threads > 0) {
+        // Let HTSlib inflate BGZF blocks on helper threads. This is a no-op
+        // for plain gzip or uncompressed input.
+        bgzf_mt(input.fp, helper_threads, 256);
+    }
+}
+
+bool FastqReader::get_next_alignment(Alignment& alignment) {
+    lock_guard<mutex> consumer_lock(consumer_mutex);
+
+    if (next_in_draining >= draining.size()) {
+        // We need a new batch
+        draining.clear();
+        next_in_draining = 0;
+
+        unique_lock<mutex> lock(queue_mutex);
+        if (queue.empty() && !done) {
+            // We are going to have to wait for the reader.
+            auto wait_start = chrono::steady_clock::now();
+            batch_ready.wait(lock, [&]() { return !queue.empty() || done; });
+            starved_nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - wait_start).count();
+        }
+        if (queue.empty()) {
+            // Reader is done and everything has been handed out.
+            return false;
+        }
+        draining = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        space_ready.notify_one();
+    }
+
+    // Hand out the record without copying it.
+    alignment.Swap(&draining[next_in_draining++]);
+    return true;
+}
+
+double FastqReader::get_starved_seconds() const {
+    return starved_nanoseconds.load() / 1e9;
+}
+
+void FastqReader::read_all() {
+    while (!stop) {
+        filling.emplace_back();
+        if (!read_record(inputs[0], filling.back())) {
+            filling.pop_back();
+            break;
+        }
+        if (inputs.size() > 1) {
+            // Keep the mates together, as if the input was interleaved.
+            filling.emplace_back();
+            if (!read_record(inputs[1], filling.back())) {
+                // The second file ran out first, so the last mate 1 has no partner.
+                filling.pop_back();
+                filling.pop_back();
+                break;
+            }
+        }
+
+        if (filling.size() >= BATCH_SIZE * inputs.size()) {
+            if (!publish_batch()) {
+                break;
+            }
+        }
+    }
+
+    if (!filling.empty()) {
+        publish_batch();
+    }
+
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        done = true;
+    }
+    batch_ready.notify_all();
+}
+
+void FastqReader::read_chunk(InputFile& input) {
+    if (input.start > 0) {
+        // Carry over any partial record.
+        memmove(&input.buffer[0], &input.buffer[input.start], input.filled - input.start);
+        input.filled -= input.start;
+        input.start = 0;
+    }
+    if (input.buffer.size() < input.filled + READ_CHUNK_SIZE + 1) {
+        // A record may be longer than a chunk, so make room for more.
+        input.buffer.resize(input.filled + READ_CHUNK_SIZE + 1);
+    }
+    ssize_t got = bgzf_read(input.fp, &input.buffer[input.filled], READ_CHUNK_SIZE);
+    if (got < 0) {
+        cerr << "[vg::fastq_reader.cpp] error reading " << input.filename << endl; exit(1);
+    }
+    input.filled += got;
+    if (got == 0) {
+        input.at_eof = true;
+        if (input.filled > 0 && input.buffer[input.filled - 1] != '\n') {
+            // Terminate the last line so the parser sees a complete record.
+            // We reserved the extra byte for this.
+            input.buffer[input.filled++] = '\n';
+        }
+    }
+}
+
+bool FastqReader::read_record(InputFile& input, Alignment& alignment) {
+    while (true) {
+        size_t used = parse_record(input.buffer.data() + input.start, input.buffer.data() + input.filled, alignment);
+        if (used != 0) {
+            input.start += used;
+            return true;
+        }
+        if (input.at_eof) {
+            if (input.start != input.filled) {
+                cerr << "[vg::fastq_reader.cpp] error: incomplete fastq record in " << input.filename << endl; exit(1);
+            }
+            return false;
+        }
+        read_chunk(input);
+    }
+}
+
+size_t FastqReader::parse_record(const char* begin, const char* end, Alignment& alignment) {
+    const char* cursor = begin;
+
+    // Get the next line as a range not including the newline, and advance
+    // past it. Return false if there is no complete line.
+    auto next_line = [&](const char*& line_start, const char*& line_end) {
+        const char* newline = (const char*) memchr(cursor, '\n', end - cursor);
+        if (newline == nullptr) {
+            return false;
+        }
+        line_start = cursor;
+        line_end = newline;
+        cursor = newline + 1;
+        return true;
+    };
+
+    const char* line_start;
+    const char* line_end;
+
+    // handle name
+    if (!next_line(line_start, line_end)) {
+        return 0;
+    }
+    bool is_fasta;
+    if (line_start != line_end && *line_start == '@') {
+        is_fasta = false;
+    } else if (line_start != line_end && *line_start == '>') {
+        is_fasta = true;
+    } else {
+        string found = line_start == line_end ? string() : string(line_start, 1);
+        cerr << "[vg::fastq_reader.cpp] error: found unexpected delimiter " << found << " in fastq/fasta input" << endl; exit(1);
+    }
+    // trim off leading @ and things after the first space, but keep trailing /1 /2
+    const char* name_end = (const char*) memchr(line_start, ' ', line_end - line_start);
+    if (name_end == nullptr) {
+        name_end = line_end;
+    }
+    const char* name_start = line_start + 1;
+
+    // handle sequence
+    const char* seq_start;
+    const char* seq_end;
+    if (!next_line(seq_start, seq_end)) {
+        return 0;
+    }
+
+    const char* qual_start = nullptr;
+    const char* qual_end = nullptr;
+    if (!is_fasta) {
+        // handle "+" sep and quality
+        if (!next_line(line_start, line_end) || !next_line(qual_start, qual_end)) {
+            return 0;
+        }
+    }
+
+    // We have a complete record, so fill in the Alignment for it.
+    alignment.set_name(name_start, name_end - name_start);
+    alignment.set_sequence(seq_start, seq_end - seq_start);
+    if (!is_fasta) {
+        alignment.set_quality(string_quality_char_to_short(string(qual_start, qual_end - qual_start)));
+    }
+
+    return cursor - begin;
+}
+
+bool FastqReader::publish_batch() {
+    unique_lock<mutex> lock(queue_mutex);
+    space_ready.wait(lock, [&]() { return queue.size() < MAX_QUEUED_BATCHES || stop; });
+    if (stop) {
+        return false;
+    }
+    queue.emplace_back(std::move(filling));
+    lock.unlock();
+    batch_ready.notify_one();
+
+    filling = vector<Alignment>();
+    filling.reserve(BATCH_SIZE * inputs.size());
+    return true;
+}
+
+}
@@ -0,0 +1,159 @@
+#ifndef VG_FASTQ_READER_HPP_INCLUDED
+#define VG_FASTQ_READER_HPP_INCLUDED
+
+/**
+ * \file fastq_reader.hpp
+ * Defines a background FASTQ/FASTA reader that keeps decompression and record
+ * parsing off of the threads that consume the reads.
+ */
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <htslib/bgzf.h>
+
+#include <vg/vg.pb.h>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Reads FASTQ (or single-line FASTA) records from a file, or a pair of files,
+ * which may be plain text, gzip, or BGZF compressed.
+ *
+ * A dedicated thread pulls large decompressed buffers out of the file, splits
+ * them into records in place, and parses the records into batches of
+ * Alignments, which are handed to consumers through a bounded queue. For BGZF
+ * input, additional HTSlib worker threads inflate blocks in parallel.
+ *
+ * Consumers call get_next_alignment(), which is safe to call from multiple
+ * threads but is designed to be driven by one thread at a time, as the
+ * for_each_parallel drivers do.
+ */
+class FastqReader {
+public:
+
+    /// Open the given file ("-" for standard input) and start reading it in
+    /// the background, using the given total number of reader threads (at
+    /// least 1).
+    FastqReader(const string& filename, size_t reader_threads = 1);
+
+    /// Open the given pair of files of mate 1 and mate 2 reads and start
+    /// reading them in the background, using the given total number of reader
+    /// threads (at least 1) between them. Records come out interleaved, mate 1
+    /// then mate 2, as they would from an interleaved file. If one file runs
+    /// out early, the records without partners are dropped.
+    FastqReader(const string& filename1, const string& filename2, size_t reader_threads = 1);
+
+    /// Stop the reader thread and close the files.
+    ~FastqReader();
+
+    FastqReader(const FastqReader& other) = delete;
+    FastqReader& operator=(const FastqReader& other) = delete;
+
+    /// Fill in the given Alignment with the next record. Return false if there
+    /// are no more records.
+    bool get_next_alignment(Alignment& alignment);
+
+    /// Get the total number of seconds that callers of get_next_alignment()
+    /// have spent blocked, waiting for the reader to produce records.
+    double get_starved_seconds() const;
+
+    /// How many records (or pairs of records) should go in each batch handed
+    /// to consumers?
+    static const size_t BATCH_SIZE = 512;
+
+    /// How many full batches can be waiting for consumers before the reader
+    /// thread stops and waits?
+    static const size_t MAX_QUEUED_BATCHES = 64;
+
+    /// How many bytes should we try to decompress at a time?
+    static const size_t READ_CHUNK_SIZE = 4 << 20; // 4M
+
+protected:
+
+    /// A file being read, with its decompressed text. Bytes [start, filled)
+    /// of the buffer are valid and not yet parsed.
+    struct InputFile {
+        /// Name of the file, for error messages
+        string filename;
+        /// The open file
+        BGZF* fp = nullptr;
+        /// Decompressed text
+        string buffer;
+        /// Where the next record starts in the buffer
+        size_t start = 0;
+        /// How many bytes of the buffer are valid
+        size_t filled = 0;
+        /// Set when the file has no more to read
+        bool at_eof = false;
+    };
+
+    /// Open a file for reading, with the given number of extra threads for
+    /// inflating BGZF blocks.
+    void open_input(const string& filename, size_t helper_threads);
+
+    /// Main loop of the reader thread.
+    void read_all();
+
+    /// Decompress another chunk of the given input into its buffer, after
+    /// moving any partial record to the start of the buffer.
+    void read_chunk(InputFile& input);
+
+    /// Fill in the given Alignment with the next record from the given
+    /// input, reading more of the file as needed. Returns false if there are
+    /// no more records. A partial record at the end of the file is an error.
+    bool read_record(InputFile& input, Alignment& alignment);
+
+    /// Parse one complete record out of the given buffer range into the
+    /// given Alignment. Returns the number of bytes used, or 0 if the range
+    /// doesn't hold a complete record.
+    size_t parse_record(const char* begin, const char* end, Alignment& alignment);
+
+    /// Hand the in-progress batch off to consumers, waiting if the queue is
+    /// full. Returns false if the reader has been asked to stop.
+    bool publish_batch();
+
+    /// The files we are reading. Records from a pair of files are read in
+    /// turn, so the mates stay together.
+    vector<InputFile> inputs;
+
+    /// The thread doing the reading
+    thread reader_thread;
+
+    /// Batch being filled by the reader thread
+    vector<Alignment> filling;
+
+    /// Full batches waiting for consumers
+    deque<vector<Alignment>> queue;
+    /// Protects queue and done
+    mutex queue_mutex;
+    /// Signaled when a batch is added or reading finishes
+    condition_variable batch_ready;
+    /// Signaled when a batch is removed or consumers want the reader to stop
+    condition_variable space_ready;
+    /// Set by the reader thread when it has published everything
+    bool done = false;
+    /// Set by the destructor to ask the reader thread to stop early
+    atomic<bool> stop;
+
+    /// Batch being drained by consumers
+    vector<Alignment> draining;
+    /// Next record in draining to hand out
+    size_t next_in_draining = 0;
+    /// Protects draining and next_in_draining
+    mutex consumer_mutex;
+
+    /// Total time consumers have spent waiting, in nanoseconds
+    atomic<int64_t> starved_nanoseconds;
+};
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <omp.h>
 
 /**
  * \file funnel.hpp: implementation of the Funnel class
@@ -40,6 +41,9 @@ void Funnel::stage(const string& name) {
     
     // Save the name
     stage_name = name;
+
+    // And start the clock
+    stage_start_time = chrono::steady_clock::now();
 }
 
 void Funnel::stage_stop() {
@@ -51,6 +55,9 @@ void Funnel::stage_stop() {
         // Stop any process/produce 
         processed_input();
         produced_output();
+
+        // Record how long it ran
+        stages.back().duration += chrono::duration<double>(chrono::steady_clock::now() - stage_start_time).count();
         
         // Say the stage is stopped 
         stage_name.clear();
@@ -69,6 +76,9 @@ void Funnel::substage(const string& name) {
     
     // Save the name 
     substage_name = name;
+
+    // And start the clock
+    substage_start_time = chrono::steady_clock::now();
 }
     
 void Funnel::substage_stop() {
@@ -76,6 +86,19 @@ void Funnel::substage_stop() {
         // A substage was running.
         
         // Substages don't bound produce/process.
+
+        // Add the time to the substage's total
+        double duration = chrono::duration<double>(chrono::steady_clock::now() - substage_start_time).count();
+        auto& substage_durations = stages.back().substage_durations;
+        auto found = substage_durations.begin();
+        while (found != substage_durations.end() && found->first != substage_name) {
+            ++found;
+        }
+        if (found == substage_durations.end()) {
+            substage_durations.emplace_back(substage_name, duration);
+        } else {
+            found->second += duration;
+        }
         
         // Say the stage is stopped 
         substage_name.clear();
@@ -235,6 +258,19 @@ void Funnel::for_each_stage(const function<void(const string&, const vector<size
     }
 }
 
+void Funnel::for_each_stage_time(const function<void(const string&, double)>& callback) const {
+    for (size_t i = 0; i < stages.size(); i++) {
+        if (i + 1 == stages.size() && !stage_name.empty()) {
+            // This stage is still running
+            break;
+        }
+        callback(stages[i].name, stages[i].duration);
+        for (auto& substage : stages[i].substage_durations) {
+            callback(stages[i].name + "/" + substage.first, substage.second);
+        }
+    }
+}
+
 void Funnel::for_each_filter(const function<void(const string&, const string&,
     const FilterPerformance&, const FilterPerformance&, const vector<double>&, const vector<double>&)>& callback) const {
     
@@ -395,47 +431,6 @@ void Funnel::to_dot(ostream& out) {
 
     out << "}" << endl;
 }
-void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness) {
-    for_each_stage([&](const string& stage, const vector<size_t>& result_sizes) {
-        // Save the number of items
-        set_annotation(aln, "stage_" + stage + "_results", (double)result_sizes.size());
-    });
-
-    if (annotate_correctness) {
-        // And with the last stage at which we had any descendants of the correct seed hit locations
-        set_annotation(aln, "last_correct_stage", last_correct_stage());
-    }
-    
-    // Annotate with the performances of all the filters
-    // We need to track filter number
-    size_t filter_num = 0;
-    for_each_filter([&](const string& stage, const string& filter,
-        const Funnel::FilterPerformance& by_count, const Funnel::FilterPerformance& by_size,
-        const vector<double>& filter_statistics_correct, const vector<double>& filter_statistics_non_correct) {
-
-            string filter_id = to_string(filter_num) + "_" + filter + "_" + stage;
-
-            // Save the stats
-            set_annotation(aln, "filter_" + filter_id + "_passed_count_total", (double) by_count.passing);
-            set_annotation(aln, "filter_" + filter_id + "_failed_count_total", (double) by_count.failing);
-            set_annotation(aln, "filter_" + filter_id + "_passed_size_total", (double) by_size.passing);
-            set_annotation(aln, "filter_" + filter_id + "_failed_size_total", (double) by_size.failing);
-            
-            if (annotate_correctness) {
-                set_annotation(aln, "filter_" + filter_id + "_passed_count_correct", (double) by_count.passing_correct);
-                set_annotation(aln, "filter_" + filter_id + "_failed_count_correct", (double) by_count.failing_correct);
-                set_annotation(aln, "filter_" + filter_id + "_passed_size_correct", (double) by_size.passing_correct);
-                set_annotation(aln, "filter_" + filter_id + "_failed_size_correct", (double) by_size.failing_correct);
-            }
-            
-            // Save the correct and non-correct filter statistics, even if
-            // everything is non-correct because correctness isn't computed
-            set_annotation(aln, "filterstats_" + filter_id + "_correct", filter_statistics_correct);
-            set_annotation(aln, "filterstats_" + filter_id + "_noncorrect", filter_statistics_non_correct);
-            filter_num++;
-        });
-}
-
 Funnel::Item& Funnel::get_item(size_t index) {
     assert(!stages.empty());
     if (index >= stages.back().items.size()) {
@@ -458,21 +453,106 @@ size_t Funnel::create_item() {
     // Return the index used
     return next_index;
 }
-    
-
-
 
+StageLatencyProfile::StageLatencyProfile(size_t thread_count) {
+    for (size_t i = 0; i < thread_count; i++) {
+        thread_histograms.emplace_back(new unordered_map<string, Histogram>());
+    }
 }
 
+void StageLatencyProfile::add(const Funnel& funnel) {
+    funnel.for_each_stage_time([&](const string& stage, double seconds) {
+        add_time(stage, seconds);
+    });
+}
 
+void StageLatencyProfile::add_time(const string& stage, double seconds) {
+    Histogram& histogram = (*thread_histograms.at(omp_get_thread_num()))[stage];
+    
+    // Find the power-of-two nanosecond bin
+    uint64_t nanoseconds = max(seconds, 0.0) * 1e9;
+    size_t bin = 0;
+    while (bin + 1 < histogram.bins.size() && (nanoseconds >> (bin + 1)) != 0) {
+        bin++;
+    }
+    histogram.bins[bin]++;
+    histogram.count++;
+    histogram.total_seconds += seconds;
+    histogram.max_seconds = max(histogram.max_seconds, seconds);
+}
 
+void StageLatencyProfile::Histogram::merge(const Histogram& other) {
+    for (size_t i = 0; i < bins.size(); i++) {
+        bins[i] += other.bins[i];
+    }
+    count += other.count;
+    total_seconds += other.total_seconds;
+    max_seconds = max(max_seconds, other.max_seconds);
+}
 
+double StageLatencyProfile::Histogram::quantile(double q) const {
+    size_t seen = 0;
+    for (size_t i = 0; i < bins.size(); i++) {
+        seen += bins[i];
+        if (seen > 0 && seen >= q * count) {
+            // Report the top of the bin, but never more than the true max
+            return min(ldexp(1.0, i + 1) / 1e9, max_seconds);
+        }
+    }
+    return max_seconds;
+}
 
+map<string, StageLatencyProfile::Histogram> StageLatencyProfile::merged() const {
+    map<string, Histogram> all;
+    for (auto& histograms : thread_histograms) {
+        for (auto& kv : *histograms) {
+            all[kv.first].merge(kv.second);
+        }
+    }
+    return all;
+}
 
+void StageLatencyProfile::write_tsv(ostream& out) const {
+    out << "#stage\tcount\ttotal_seconds\tmean_us\tp50_us\tp90_us\tp99_us\tmax_us" << endl;
+    for (auto& kv : merged()) {
+        const Histogram& h = kv.second;
+        out << kv.first << "\t" << h.count << "\t" << h.total_seconds
+            << "\t" << (h.count ? h.total_seconds / h.count * 1e6 : 0.0)
+            << "\t" << h.quantile(0.5) * 1e6
+            << "\t" << h.quantile(0.9) * 1e6
+            << "\t" << h.quantile(0.99) * 1e6
+            << "\t" << h.max_seconds * 1e6 << endl;
+    }
+}
 
+void StageLatencyProfile::write_json(ostream& out) const {
+    out << "{\"stages\": [";
+    bool first = true;
+    for (auto& kv : merged()) {
+        const Histogram& h = kv.second;
+        if (!first) {
+            out << ",";
+        }
+        first = false;
+        out << endl << "  {\"stage\": \"" << kv.first << "\", \"count\": " << h.count
+            << ", \"total_seconds\": " << h.total_seconds
+            << ", \"mean_us\": " << (h.count ? h.total_seconds / h.count * 1e6 : 0.0)
+            << ", \"p50_us\": " << h.quantile(0.5) * 1e6
+            << ", \"p90_us\": " << h.quantile(0.9) * 1e6
+            << ", \"p99_us\": " << h.quantile(0.99) * 1e6
+            << ", \"max_us\": " << h.max_seconds * 1e6
+            << ", \"bins_log2_ns\": [";
+        // Leave off the empty bins at the end
+        size_t used_bins = h.bins.size();
+        while (used_bins > 0 && h.bins[used_bins - 1] == 0) {
+            used_bins--;
+        }
+        for (size_t i = 0; i < used_bins; i++) {
+            out << (i ? ", " : "") << h.bins[i];
+        }
+        out << "]}";
+    }
+    out << endl << "]}" << endl;
+}
 
-
-
-
-
-
+}
@@ -4,11 +4,14 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <map>
 #include <cassert>
 #include <cmath>
 #include <functional>
 #include <iostream>
 #include <limits>
+#include <chrono>
+#include <memory>
 #include <vg/vg.pb.h>
 #include "annotation.hpp"
 
@@ -131,6 +134,11 @@ public:
     
     /// Call the given callback with stage name, and vector of result item sizes at that stage, for each stage.
     void for_each_stage(const function<void(const string&, const vector<size_t>&)>& callback) const;
+
+    /// Call the given callback with the name and wall-clock duration in seconds of each stage that has
+    /// been stopped, in order. Then, after each stage, the callback is called for each substage that was run in it, with
+    /// the name "stage/substage" and the total time spent in that substage.
+    void for_each_stage_time(const function<void(const string&, double)>& callback) const;
     
     /// Represents the performance of a filter, for either item counts or total item sizes.
     /// Note that passing_correct and failing_correct will always be 0 if nothing is tagged correct.
@@ -158,8 +166,10 @@ public:
     /// Set an alignments annotations with the number of results at each stage
     /// if annotate_correctness is true, also annotate the alignment with the
     /// number of correct results at each stage. This assumes that we've been
-    /// tracking correctness all along
-    void annotate_mapped_alignment(Alignment& aln, bool annotate_correctness);
+    /// tracking correctness all along. Works on anything that
+    /// set_annotation() works on.
+    template<typename Annotated>
+    void annotate_mapped_alignment(Annotated& aln, bool annotate_correctness);
     
 protected:
     
@@ -179,6 +189,12 @@ protected:
     /// what's the current current-stage output we are generating?
     /// Will be numeric_limits<size_t>::max() if none.
     size_t output_in_progress = numeric_limits<size_t>::max();
+
+    /// When did the current stage start?
+    chrono::steady_clock::time_point stage_start_time;
+
+    /// When did the current substage start?
+    chrono::steady_clock::time_point substage_start_time;
     
     // Now members we need for provenance tracking
     
@@ -209,6 +225,10 @@ protected:
         size_t projected_count = 0;
         /// Does this stage contain any items tagged as correct?
         bool has_correct = false;
+        /// How long was the stage running for, in seconds?
+        double duration = 0;
+        /// Total time spent in each substage, in order of first appearance
+        vector<pair<string, double>> substage_durations;
     };
     
     /// Ensure an item with the given index exists in the current stage and return a reference to it.
@@ -226,6 +246,52 @@ protected:
     vector<Stage> stages;
 };
 
+/**
+ * Collects histograms of how long each Funnel stage and substage takes, over
+ * many funnels run on many threads, for reporting where the time goes without
+ * full provenance tracking. Each thread records into its own histograms; they
+ * are merged when reported.
+ */
+class StageLatencyProfile {
+public:
+    /// Make a profile with room for the given number of threads.
+    StageLatencyProfile(size_t thread_count);
+
+    /// Record the stage times from a stopped Funnel, on the current thread.
+    void add(const Funnel& funnel);
+
+    /// Record the given time for the given stage, on the current thread.
+    void add_time(const string& stage, double seconds);
+
+    /// Write a TSV with a line of summary statistics (count, total, mean,
+    /// and approximate percentiles and max) for each stage.
+    void write_tsv(ostream& out) const;
+
+    /// Write the summary statistics, and the histogram bins, as JSON.
+    void write_json(ostream& out) const;
+
+protected:
+
+    /// Histogram over power-of-two nanosecond bins: bin i counts times in [2^i, 2^(i+1)) ns.
+    struct Histogram {
+        vector<size_t> bins = vector<size_t>(64, 0);
+        size_t count = 0;
+        double total_seconds = 0;
+        double max_seconds = 0;
+
+        /// Add another histogram into this one.
+        void merge(const Histogram& other);
+        /// Get the upper bound, in seconds, of the bin holding the given quantile.
+        double quantile(double q) const;
+    };
+
+    /// Merge all the threads' histograms, by stage name
+    map<string, Histogram> merged() const;
+
+    /// Histograms for each thread, by stage name
+    vector<unique_ptr<unordered_map<string, Histogram>>> thread_histograms;
+};
+
 template<typename Iterator>
 void Funnel::merge_group(Iterator prev_stage_items_begin, Iterator prev_stage_items_end) {
     // There must be a prev stage to merge from
@@ -255,6 +321,48 @@ void Funnel::merge_group(Iterator prev_stage_items_begin, Iterator prev_stage_it
     get_item(index).group_size = get_item(index).prev_stage_items.size();
 }
 
+template<typename Annotated>
+void Funnel::annotate_mapped_alignment(Annotated& aln, bool annotate_correctness) {
+    for_each_stage([&](const string& stage, const vector<size_t>& result_sizes) {
+        // Save the number of items
+        set_annotation(aln, "stage_" + stage + "_results", (double)result_sizes.size());
+    });
+
+    if (annotate_correctness) {
+        // And with the last stage at which we had any descendants of the correct seed hit locations
+        set_annotation(aln, "last_correct_stage", last_correct_stage());
+    }
+    
+    // Annotate with the performances of all the filters
+    // We need to track filter number
+    size_t filter_num = 0;
+    for_each_filter([&](const string& stage, const string& filter,
+        const Funnel::FilterPerformance& by_count, const Funnel::FilterPerformance& by_size,
+        const vector<double>& filter_statistics_correct, const vector<double>& filter_statistics_non_correct) {
+
+            string filter_id = to_string(filter_num) + "_" + filter + "_" + stage;
+
+            // Save the stats
+            set_annotation(aln, "filter_" + filter_id + "_passed_count_total", (double) by_count.passing);
+            set_annotation(aln, "filter_" + filter_id + "_failed_count_total", (double) by_count.failing);
+            set_annotation(aln, "filter_" + filter_id + "_passed_size_total", (double) by_size.passing);
+            set_annotation(aln, "filter_" + filter_id + "_failed_size_total", (double) by_size.failing);
+            
+            if (annotate_correctness) {
+                set_annotation(aln, "filter_" + filter_id + "_passed_count_correct", (double) by_count.passing_correct);
+                set_annotation(aln, "filter_" + filter_id + "_failed_count_correct", (double) by_count.failing_correct);
+                set_annotation(aln, "filter_" + filter_id + "_passed_size_correct", (double) by_size.passing_correct);
+                set_annotation(aln, "filter_" + filter_id + "_failed_size_correct", (double) by_size.failing_correct);
+            }
+            
+            // Save the correct and non-correct filter statistics, even if
+            // everything is non-correct because correctness isn't computed
+            set_annotation(aln, "filterstats_" + filter_id + "_correct", filter_statistics_correct);
+            set_annotation(aln, "filterstats_" + filter_id + "_noncorrect", filter_statistics_non_correct);
+            filter_num++;
+        });
+}
+
 }
 
 #endif
@@ -2,10 +2,15 @@
 
 #include <algorithm>
 #include <cstring>
+#include <limits>
 #include <queue>
 #include <set>
 #include <stack>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 namespace vg {
 
 //------------------------------------------------------------------------------
@@ -17,6 +22,209 @@ constexpr double GaplessExtender::OVERLAP_THRESHOLD;
 
 //------------------------------------------------------------------------------
 
+namespace gapless_kernel {
+
+// The scalar kernel compares 8 characters at a time and falls back to
+// character-by-character comparison in blocks that contain mismatches.
+
+size_t scan_forward_scalar(const char* read, const char* node, size_t length, size_t budget, uint32_t& mismatches) {
+    size_t i = 0;
+    while (i < length) {
+        size_t len = std::min(length - i, sizeof(std::uint64_t));
+        std::uint64_t a = 0, b = 0;
+        std::memcpy(&a, read + i, len);
+        std::memcpy(&b, node + i, len);
+        if (a != b) {
+            for (size_t j = i; j < i + len; j++) {
+                if (read[j] != node[j]) {
+                    if (budget == 0) {
+                        return j;
+                    }
+                    budget--; mismatches++;
+                }
+            }
+        }
+        i += len;
+    }
+    return length;
+}
+
+size_t scan_backward_scalar(const char* read_end, const char* node_end, size_t length, size_t budget, uint32_t& mismatches) {
+    size_t i = 0;
+    while (i < length) {
+        size_t len = std::min(length - i, sizeof(std::uint64_t));
+        std::uint64_t a = 0, b = 0;
+        std::memcpy(&a, read_end - i - len, len);
+        std::memcpy(&b, node_end - i - len, len);
+        if (a != b) {
+            for (size_t j = i; j < i + len; j++) {
+                if (read_end[-1 - static_cast<std::ptrdiff_t>(j)] != node_end[-1 - static_cast<std::ptrdiff_t>(j)]) {
+                    if (budget == 0) {
+                        return j;
+                    }
+                    budget--; mismatches++;
+                }
+            }
+        }
+        i += len;
+    }
+    return length;
+}
+
+#if defined(__x86_64__)
+
+// The vector kernels turn each block into a bitmask with bit k set if
+// character k mismatches, and then visit the set bits in scan order.
+
+// Consume the mismatches in a forward block mask. Returns true and sets the
+// result if the budget runs out inside the block.
+inline bool consume_forward(std::uint32_t mask, size_t block_start, size_t& budget, uint32_t& mismatches, size_t& result) {
+    while (mask != 0) {
+        if (budget == 0) {
+            result = block_start + __builtin_ctz(mask);
+            return true;
+        }
+        budget--; mismatches++;
+        mask &= mask - 1;
+    }
+    return false;
+}
+
+// Consume the mismatches in a backward block mask of the given width, where
+// bit width - 1 is the character closest to the end. Returns true and sets the
+// result if the budget runs out inside the block.
+inline bool consume_backward(std::uint32_t mask, size_t width, size_t block_start, size_t& budget, uint32_t& mismatches, size_t& result) {
+    while (mask != 0) {
+        size_t bit = 31 - __builtin_clz(mask);
+        if (budget == 0) {
+            result = block_start + (width - 1 - bit);
+            return true;
+        }
+        budget--; mismatches++;
+        mask ^= std::uint32_t(1) << bit;
+    }
+    return false;
+}
+
+size_t scan_forward_sse(const char* read, const char* node, size_t length, size_t budget, uint32_t& mismatches) {
+    size_t i = 0, result = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(read + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(node + i));
+        std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) & 0xFFFF;
+        if (consume_forward(mask, i, budget, mismatches, result)) {
+            return result;
+        }
+    }
+    return i + scan_forward_scalar(read + i, node + i, length - i, budget, mismatches);
+}
+
+size_t scan_backward_sse(const char* read_end, const char* node_end, size_t length, size_t budget, uint32_t& mismatches) {
+    size_t i = 0, result = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(read_end - i - 16));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(node_end - i - 16));
+        std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) & 0xFFFF;
+        if (consume_backward(mask, 16, i, budget, mismatches, result)) {
+            return result;
+        }
+    }
+    return i + scan_backward_scalar(read_end - i, node_end - i, length - i, budget, mismatches);
+}
+
+__attribute__((__target__("avx2")))
+size_t scan_forward_avx2(const char* read, const char* node, size_t length, size_t budget, uint32_t& mismatches) {
+    size_t i = 0, result = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(read + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(node + i));
+        std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+        if (consume_forward(mask, i, budget, mismatches, result)) {
+            return result;
+        }
+    }
+    return i + scan_forward_sse(read + i, node + i, length - i, budget, mismatches);
+}
+
+__attribute__((__target__("avx2")))
+size_t scan_backward_avx2(const char* read_end, const char* node_end, size_t length, size_t budget, uint32_t& mismatches) {
+    size_t i = 0, result = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(read_end - i - 32));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(node_end - i - 32));
+        std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+        if (consume_backward(mask, 32, i, budget, mismatches, result)) {
+            return result;
+        }
+    }
+    return i + scan_backward_sse(read_end - i, node_end - i, length - i, budget, mismatches);
+}
+
+#endif
+
+bool supported(kernel_type kernel) {
+    switch (kernel) {
+    case kernel_scalar:
+        return true;
+#if defined(__x86_64__)
+    case kernel_sse:
+        return true;
+    case kernel_avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+kernel_type best() {
+    static const kernel_type result = (supported(kernel_avx2) ? kernel_avx2 : (supported(kernel_sse) ? kernel_sse : kernel_scalar));
+    return result;
+}
+
+const char* name(kernel_type kernel) {
+    switch (kernel) {
+    case kernel_scalar:
+        return "scalar";
+    case kernel_sse:
+        return "sse";
+    case kernel_avx2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
+
+size_t scan_forward(kernel_type kernel, const char* read, const char* node, size_t length, size_t budget, uint32_t& mismatches) {
+    switch (kernel) {
+#if defined(__x86_64__)
+    case kernel_avx2:
+        return scan_forward_avx2(read, node, length, budget, mismatches);
+    case kernel_sse:
+        return scan_forward_sse(read, node, length, budget, mismatches);
+#endif
+    default:
+        return scan_forward_scalar(read, node, length, budget, mismatches);
+    }
+}
+
+size_t scan_backward(kernel_type kernel, const char* read_end, const char* node_end, size_t length, size_t budget, uint32_t& mismatches) {
+    switch (kernel) {
+#if defined(__x86_64__)
+    case kernel_avx2:
+        return scan_backward_avx2(read_end, node_end, length, budget, mismatches);
+    case kernel_sse:
+        return scan_backward_sse(read_end, node_end, length, budget, mismatches);
+#endif
+    default:
+        return scan_backward_scalar(read_end, node_end, length, budget, mismatches);
+    }
+}
+
+} // namespace gapless_kernel
+
+//------------------------------------------------------------------------------
+
 bool GaplessExtension::contains(const HandleGraph& graph, seed_type seed) const {
     handle_t expected_handle = GaplessExtender::get_handle(seed);
     size_t expected_node_offset = GaplessExtender::get_node_offset(seed);
@@ -101,26 +309,34 @@ size_t GaplessExtension::overlap(const HandleGraph& graph, const GaplessExtensio
     return result;
 }
 
-Path GaplessExtension::to_path(const HandleGraph& graph, const std::string& sequence) const {
+// Mapping ranks only exist in the protobuf representation.
+static void set_mapping_rank(Mapping& mapping, size_t rank) {
+    mapping.set_rank(rank);
+}
 
-    Path result;
+static void set_mapping_rank(path_mapping_t& mapping, size_t rank) {
+    // Nothing to do
+}
 
-    auto mismatch = this->mismatch_positions.begin(); // The next mismatch.
-    size_t read_offset = this->read_interval.first;   // Current offset in the read.
-    size_t node_offset = this->offset;                // Current offset in the current node.
-    for (size_t i = 0; i < this->path.size(); i++) {
-        size_t limit = std::min(read_offset + graph.get_length(this->path[i]) - node_offset, this->read_interval.second);
-        Mapping& mapping = *(result.add_mapping());
-        mapping.mutable_position()->set_node_id(graph.get_id(this->path[i]));
+// Fill in a Path or a path_t with the mappings and edits of an extension.
+template<typename PathType>
+static void extension_path(const GaplessExtension& extension, const HandleGraph& graph, const std::string& sequence, PathType& result) {
+    auto mismatch = extension.mismatch_positions.begin(); // The next mismatch.
+    size_t read_offset = extension.read_interval.first;   // Current offset in the read.
+    size_t node_offset = extension.offset;                // Current offset in the current node.
+    for (size_t i = 0; i < extension.path.size(); i++) {
+        size_t limit = std::min(read_offset + graph.get_length(extension.path[i]) - node_offset, extension.read_interval.second);
+        auto& mapping = *(result.add_mapping());
+        mapping.mutable_position()->set_node_id(graph.get_id(extension.path[i]));
         mapping.mutable_position()->set_offset(node_offset);
-        mapping.mutable_position()->set_is_reverse(graph.get_is_reverse(this->path[i]));
-        while (mismatch != this->mismatch_positions.end() && *mismatch < limit) {
+        mapping.mutable_position()->set_is_reverse(graph.get_is_reverse(extension.path[i]));
+        while (mismatch != extension.mismatch_positions.end() && *mismatch < limit) {
             if (read_offset < *mismatch) {
-                Edit& exact_match = *(mapping.add_edit());
+                auto& exact_match = *(mapping.add_edit());
                 exact_match.set_from_length(*mismatch - read_offset);
                 exact_match.set_to_length(*mismatch - read_offset);
             }
-            Edit& edit = *(mapping.add_edit());
+            auto& edit = *(mapping.add_edit());
             edit.set_from_length(1);
             edit.set_to_length(1);
             edit.set_sequence(std::string(1, sequence[*mismatch]));
@@ -128,15 +344,26 @@ Path GaplessExtension::to_path(const HandleGraph& graph, const std::string& sequ
             ++mismatch;
         }
         if (read_offset < limit) {
-            Edit& exact_match = *(mapping.add_edit());
+            auto& exact_match = *(mapping.add_edit());
             exact_match.set_from_length(limit - read_offset);
             exact_match.set_to_length(limit - read_offset);
             read_offset = limit;
         }
-        mapping.set_rank(i + 1);
+        set_mapping_rank(mapping, i + 1);
         node_offset = 0;
     }
+}
+
+Path GaplessExtension::to_path(const HandleGraph& graph, const std::string& sequence) const {
+    Path result;
+    extension_path(*this, graph, sequence, result);
+    return result;
+}
 
+path_t GaplessExtension::to_path_t(const HandleGraph& graph, const std::string& sequence) const {
+    path_t result;
+    result.mutable_mapping()->reserve(this->path.size());
+    extension_path(*this, graph, sequence, result);
     return result;
 }
 
@@ -181,30 +408,18 @@ void set_score(GaplessExtension& extension, const Aligner* aligner) {
     extension.score += static_cast<int32_t>(extension.right_full * aligner->full_length_bonus); 
 }
 
+// How many more mismatches can we afford before the count reaches the limit?
+size_t mismatch_budget(const GaplessExtension& match, uint32_t mismatch_limit) {
+    return (match.internal_score + 1 < mismatch_limit ? mismatch_limit - 1 - match.internal_score : 0);
+}
+
 // Match the initial node, assuming that read_offset or node_offset is 0.
 // Updates internal_score and old_score; use set_score() to compute score.
 void match_initial(GaplessExtension& match, const std::string& seq, gbwtgraph::view_type target) {
-    size_t node_offset = match.offset;
-    size_t left = std::min(seq.length() - match.read_interval.second, target.second - node_offset);
-    while (left > 0) {
-        size_t len = std::min(left, sizeof(std::uint64_t));
-        std::uint64_t a = 0, b = 0;
-        std::memcpy(&a, seq.data() + match.read_interval.second, len);
-        std::memcpy(&b, target.first + node_offset, len);
-        if (a == b) {
-            match.read_interval.second += len;
-            node_offset += len;
-        } else {
-            for (size_t i = 0; i < len; i++) {
-                if (seq[match.read_interval.second] != target.first[node_offset]) {
-                    match.internal_score++;
-                }
-                match.read_interval.second++;
-                node_offset++;
-            }
-        }
-        left -= len;
-    }
+    size_t left = std::min(seq.length() - match.read_interval.second, target.second - match.offset);
+    match.read_interval.second += gapless_kernel::scan_forward(gapless_kernel::best(),
+                                                               seq.data() + match.read_interval.second, target.first + match.offset,
+                                                               left, std::numeric_limits<size_t>::max(), match.internal_score);
     match.old_score = match.internal_score;
 }
 
@@ -212,30 +427,11 @@ void match_initial(GaplessExtension& match, const std::string& seq, gbwtgraph::v
 // Updates internal_score; use set_score() to recompute score.
 // Returns the tail offset (the number of characters matched).
 size_t match_forward(GaplessExtension& match, const std::string& seq, gbwtgraph::view_type target, uint32_t mismatch_limit) {
-    size_t node_offset = 0;
-    size_t left = std::min(seq.length() - match.read_interval.second, target.second - node_offset);
-    while (left > 0) {
-        size_t len = std::min(left, sizeof(std::uint64_t));
-        std::uint64_t a = 0, b = 0;
-        std::memcpy(&a, seq.data() + match.read_interval.second, len);
-        std::memcpy(&b, target.first + node_offset, len);
-        if (a == b) {
-            match.read_interval.second += len;
-            node_offset += len;
-        } else {
-            for (size_t i = 0; i < len; i++) {
-                if (seq[match.read_interval.second] != target.first[node_offset]) {
-                    if (match.internal_score + 1 >= mismatch_limit) {
-                        return node_offset;
-                    }
-                    match.internal_score++;
-                }
-                match.read_interval.second++;
-                node_offset++;
-            }
-        }
-        left -= len;
-    }
+    size_t left = std::min(seq.length() - match.read_interval.second, target.second);
+    size_t node_offset = gapless_kernel::scan_forward(gapless_kernel::best(),
+                                                      seq.data() + match.read_interval.second, target.first,
+                                                      left, mismatch_budget(match, mismatch_limit), match.internal_score);
+    match.read_interval.second += node_offset;
     return node_offset;
 }
 
@@ -244,28 +440,11 @@ size_t match_forward(GaplessExtension& match, const std::string& seq, gbwtgraph:
 // Updates internal_score; use set_score() to recompute score.
 void match_backward(GaplessExtension& match, const std::string& seq, gbwtgraph::view_type target, uint32_t mismatch_limit) {
     size_t left = std::min(match.read_interval.first, match.offset);
-    while (left > 0) {
-        size_t len = std::min(left, sizeof(std::uint64_t));
-        std::uint64_t a = 0, b = 0;
-        std::memcpy(&a, seq.data() + match.read_interval.first - len, len);
-        std::memcpy(&b, target.first + match.offset - len, len);
-        if (a == b) {
-            match.read_interval.first -= len;
-            match.offset -= len;
-        } else {
-            for (size_t i = 0; i < len; i++) {
-                if (seq[match.read_interval.first - 1] != target.first[match.offset - 1]) {
-                    if (match.internal_score + 1 >= mismatch_limit) {
-                        return;
-                    }
-                    match.internal_score++;
-                }
-                match.read_interval.first--;
-                match.offset--;
-            }
-        }
-        left -= len;
-    }
+    size_t len = gapless_kernel::scan_backward(gapless_kernel::best(),
+                                               seq.data() + match.read_interval.first, target.first + match.offset,
+                                               left, mismatch_budget(match, mismatch_limit), match.internal_score);
+    match.read_interval.first -= len;
+    match.offset -= len;
 }
 
 // Sort full-length extensions by internal_score, remove ones that are not
@@ -347,12 +526,18 @@ void find_mismatches(const std::string& seq, const gbwtgraph::CachedGBWTGraph& g
         size_t node_offset = extension.offset, read_offset = extension.read_interval.first;
         for (const handle_t& handle : extension.path) {
             gbwtgraph::view_type target = graph.get_sequence_view(handle);
-            while (node_offset < target.second && read_offset < extension.read_interval.second) {
-                if (target.first[node_offset] != seq[read_offset]) {
+            size_t left = std::min(target.second - node_offset, extension.read_interval.second - read_offset);
+            // Find the mismatches one at a time with a zero budget.
+            while (left > 0) {
+                uint32_t found = 0;
+                size_t len = gapless_kernel::scan_forward(gapless_kernel::best(),
+                                                          seq.data() + read_offset, target.first + node_offset,
+                                                          left, 0, found);
+                node_offset += len; read_offset += len; left -= len;
+                if (left > 0) {
                     extension.mismatch_positions.push_back(read_offset);
+                    node_offset++; read_offset++; left--;
                 }
-                node_offset++;
-                read_offset++;
             }
             node_offset = 0;
         }
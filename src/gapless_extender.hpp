@@ -83,6 +83,9 @@ struct GaplessExtension
     /// Convert the extension into a Path.
     Path to_path(const HandleGraph& graph, const std::string& sequence) const;
 
+    /// Convert the extension into a path_t, without going through protobuf.
+    path_t to_path_t(const HandleGraph& graph, const std::string& sequence) const;
+
     /// For priority queues.
     bool operator<(const GaplessExtension& another) const {
         return (this->score < another.score);
@@ -102,6 +105,49 @@ struct GaplessExtension
 
 //------------------------------------------------------------------------------
 
+/**
+ * Sequence comparison kernels for gapless extension. A kernel compares a read
+ * interval to a node interval of the same length and reports how far the
+ * match can be extended before running out of the mismatch budget.
+ *
+ * The vectorized kernels compare 16 (SSE) or 32 (AVX2) characters per step and
+ * locate the mismatches in each block from the comparison bitmask. All kernels
+ * give identical results. The best kernel supported by the CPU is chosen at
+ * runtime.
+ */
+namespace gapless_kernel {
+
+    enum kernel_type { kernel_scalar, kernel_sse, kernel_avx2 };
+
+    /// Returns the fastest kernel supported by the current CPU.
+    kernel_type best();
+
+    /// Returns true if the kernel can be used on the current CPU.
+    bool supported(kernel_type kernel);
+
+    /// Returns a human-readable name for the kernel.
+    const char* name(kernel_type kernel);
+
+    /**
+     * Compare read[0, length) to node[0, length) from left to right. Stop
+     * before the first mismatch that would exceed the budget. Returns the
+     * number of characters matched and adds the number of mismatches in them
+     * to 'mismatches'.
+     */
+    size_t scan_forward(kernel_type kernel, const char* read, const char* node, size_t length, size_t budget, uint32_t& mismatches);
+
+    /**
+     * Compare read[-length, 0) to node[-length, 0) from right to left. Stop
+     * before the first mismatch that would exceed the budget. Returns the
+     * number of characters matched and adds the number of mismatches in them
+     * to 'mismatches'.
+     */
+    size_t scan_backward(kernel_type kernel, const char* read_end, const char* node_end, size_t length, size_t budget, uint32_t& mismatches);
+
+} // namespace gapless_kernel
+
+//------------------------------------------------------------------------------
+
 /**
  * A class that supports haplotype-consistent seed extension using GBWTGraph. Each seed
  * is a pair of matching read/graph positions and each extension is a gapless alignment
@@ -0,0 +1,179 @@
+#include "gcsa_jump_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+/**
+ * \file gcsa_jump_table.cpp: implementation of the GCSAJumpTable class
+ */
+
+namespace vg {
+
+using namespace std;
+
+GCSAJumpTable::GCSAJumpTable(const gcsa::GCSA& gcsa, size_t max_length) :
+    table_length(max_length), gcsa_size(gcsa.size()) {
+
+    if (max_length == 0 || max_length > MAX_LENGTH) {
+        throw runtime_error("GCSA jump table k-mer length must be between 1 and " + to_string(MAX_LENGTH));
+    }
+
+    ranges.resize(level_start(max_length + 1), gcsa::Range::empty_range());
+
+    gcsa::range_type full_range(0, gcsa.size() - 1);
+    const char* bases = "ACGT";
+
+    for (size_t length = 1; length <= max_length; length++) {
+        // Each k-mer is its first base backward-searched from the range of the
+        // rest of it, which we filled in on the last pass.
+        size_t start = level_start(length);
+        size_t count = size_t(1) << (2 * length);
+        size_t suffix_start = length == 1 ? 0 : level_start(length - 1);
+        size_t suffix_mask = (count >> 2) - 1;
+
+#pragma omp parallel for schedule(static, 4096)
+        for (size_t i = 0; i < count; i++) {
+            gcsa::range_type suffix_range = length == 1 ? full_range : ranges[suffix_start + (i & suffix_mask)];
+            if (gcsa::Range::empty(suffix_range)) {
+                // No longer k-mer can match either
+                continue;
+            }
+            char first = bases[i >> (2 * (length - 1))];
+            ranges[start + i] = gcsa.LF(suffix_range, gcsa.alpha.char2comp[first]);
+        }
+    }
+}
+
+size_t GCSAJumpTable::max_length() const {
+    return table_length;
+}
+
+bool GCSAJumpTable::matches(const gcsa::GCSA& gcsa) const {
+    if (gcsa.size() != gcsa_size || table_length == 0) {
+        return false;
+    }
+    // Spot check a spread of k-mers at every length against LF steps, so a
+    // table left over from a different build of the same size is caught
+    gcsa::range_type full_range(0, gcsa.size() - 1);
+    const char* bases = "ACGT";
+    const size_t checks_per_length = 16;
+    for (size_t length = 1; length <= table_length; length++) {
+        size_t count = size_t(1) << (2 * length);
+        size_t stride = max<size_t>(count / checks_per_length, 1);
+        for (size_t i = 0; i < count; i += stride) {
+            gcsa::range_type range = full_range;
+            for (size_t j = 0; j < length && !gcsa::Range::empty(range); j++) {
+                // The last base of the k-mer is in the low bits
+                range = gcsa.LF(range, gcsa.alpha.char2comp[bases[(i >> (2 * j)) & 3]]);
+            }
+            const gcsa::range_type& stored = ranges[level_start(length) + i];
+            if (gcsa::Range::empty(range) ? !gcsa::Range::empty(stored) : range != stored) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t GCSAJumpTable::longest_suffix(string::const_iterator begin, string::const_iterator end,
+                                     size_t max_jump, gcsa::range_type& range) const {
+
+    size_t limit = min(min(max_jump, table_length), (size_t) (end - begin));
+
+    // Encode suffixes of increasing length until we run out or hit a
+    // non-ACGT character.
+    array<size_t, MAX_LENGTH + 1> codes;
+    size_t usable = 0;
+    size_t code = 0;
+    for (auto it = end; usable < limit;) {
+        --it;
+        int base = encode(*it);
+        if (base < 0) {
+            break;
+        }
+        code |= size_t(base) << (2 * usable);
+        ++usable;
+        codes[usable] = code;
+    }
+
+    // Any suffix of a matching k-mer matches, so binary search for the
+    // longest matching length.
+    size_t low = 0;
+    size_t high = usable;
+    while (low < high) {
+        size_t mid = (low + high + 1) / 2;
+        if (gcsa::Range::empty(ranges[level_start(mid) + codes[mid]])) {
+            high = mid - 1;
+        } else {
+            low = mid;
+        }
+    }
+
+    if (low != 0) {
+        range = ranges[level_start(low) + codes[low]];
+    }
+    return low;
+}
+
+gcsa::range_type GCSAJumpTable::suffix_range(string::const_iterator end, size_t length) const {
+    size_t code = 0;
+    auto it = end;
+    for (size_t i = 0; i < length; i++) {
+        --it;
+        code |= size_t(encode(*it)) << (2 * i);
+    }
+    return ranges[level_start(length) + code];
+}
+
+void GCSAJumpTable::serialize(ostream& out) const {
+    uint64_t header[3] = {MAGIC, (uint64_t) table_length, (uint64_t) gcsa_size};
+    out.write((const char*) header, sizeof(header));
+    out.write((const char*) ranges.data(), ranges.size() * sizeof(gcsa::range_type));
+    if (!out) {
+        throw runtime_error("Could not write GCSA jump table");
+    }
+}
+
+void GCSAJumpTable::load(istream& in) {
+    uint64_t header[3];
+    in.read((char*) header, sizeof(header));
+    if (!in || header[0] != MAGIC) {
+        throw runtime_error("Could not load GCSA jump table");
+    }
+    if (header[1] == 0 || header[1] > MAX_LENGTH) {
+        throw runtime_error("GCSA jump table has invalid k-mer length " + to_string(header[1]));
+    }
+    table_length = header[1];
+    gcsa_size = header[2];
+    ranges.resize(level_start(table_length + 1));
+    in.read((char*) ranges.data(), ranges.size() * sizeof(gcsa::range_type));
+    if (!in) {
+        throw runtime_error("GCSA jump table is truncated");
+    }
+}
+
+unique_ptr<GCSAJumpTable> load_gcsa_jump_table(const string& gcsa_name, const gcsa::GCSA& gcsa) {
+    unique_ptr<GCSAJumpTable> jump_table;
+    ifstream in(gcsa_name + ".jmp", ios::binary);
+    if (in) {
+        jump_table.reset(new GCSAJumpTable());
+        try {
+            jump_table->load(in);
+        }
+        catch (const runtime_error& e) {
+            // A corrupt table only costs us speed, so search without it
+            cerr << "warning:[vg::GCSAJumpTable] ignoring jump table " << gcsa_name << ".jmp: " << e.what() << endl;
+            jump_table.reset();
+            return jump_table;
+        }
+        if (!jump_table->matches(gcsa)) {
+            cerr << "warning:[vg::GCSAJumpTable] ignoring jump table " << gcsa_name << ".jmp, which was not built from " << gcsa_name << endl;
+            jump_table.reset();
+        }
+    }
+    return jump_table;
+}
+
+}
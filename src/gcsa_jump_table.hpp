@@ -0,0 +1,118 @@
+#ifndef VG_GCSA_JUMP_TABLE_HPP_INCLUDED
+#define VG_GCSA_JUMP_TABLE_HPP_INCLUDED
+
+#include <gcsa/gcsa.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * \file gcsa_jump_table.hpp
+ *
+ * Side index of precomputed GCSA2 backward search ranges for short k-mers.
+ */
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Holds the GCSA2 range of every DNA k-mer up to a maximum length, as found by
+ * backward searching from the full range. A MEM search that is starting from
+ * the full range can look up the longest matching suffix of the read in one
+ * step, instead of taking one LF step per base, and ends up in exactly the
+ * state it would have reached by stepping.
+ *
+ * Only uppercase ACGT k-mers are stored; searches fall back to LF steps at
+ * any other character.
+ */
+class GCSAJumpTable {
+public:
+
+    /// Make an empty table. load() must be called before use.
+    GCSAJumpTable() = default;
+
+    /// Build a table for all k-mers of length 1 through max_length against
+    /// the given GCSA. Uses OMP threads.
+    GCSAJumpTable(const gcsa::GCSA& gcsa, size_t max_length);
+
+    /// Get the longest k-mer length in the table.
+    size_t max_length() const;
+
+    /// Return true if the table was built against an index that looks like
+    /// the given one.
+    bool matches(const gcsa::GCSA& gcsa) const;
+
+    /// Find the longest suffix of [begin, end), of at most max_jump bases,
+    /// that has a nonempty GCSA range, and put its range in range. Returns the
+    /// length of the suffix, or 0 (leaving range alone) if even the last base
+    /// cannot be looked up.
+    size_t longest_suffix(string::const_iterator begin, string::const_iterator end,
+                          size_t max_jump, gcsa::range_type& range) const;
+
+    /// Get the range for the suffix of the given length ending at end, which
+    /// must be made of ACGT and be no longer than max_length().
+    gcsa::range_type suffix_range(string::const_iterator end, size_t length) const;
+
+    /// Write the table to a stream.
+    void serialize(ostream& out) const;
+
+    /// Load a table written by serialize(). Throws runtime_error if the
+    /// stream does not hold a table.
+    void load(istream& in);
+
+    /// Longest k-mer length we allow, to bound the table at 4^14 entries.
+    static const size_t MAX_LENGTH = 14;
+
+protected:
+
+    /// Get the 2-bit code for a base, or -1 if it has none.
+    static inline int encode(char base);
+
+    /// Get the position in ranges where the k-mers of the given length start.
+    static inline size_t level_start(size_t length);
+
+    /// Magic number at the start of serialized tables
+    static const uint64_t MAGIC = 0x4a43534147677600;
+
+    /// Longest k-mer length stored
+    size_t table_length = 0;
+
+    /// Size of the GCSA the table was built against
+    gcsa::size_type gcsa_size = 0;
+
+    /// The range for each k-mer, grouped by length and then ordered by 2-bit
+    /// encoding with the first base most significant
+    vector<gcsa::range_type> ranges;
+};
+
+/// Load the jump table stored next to the given GCSA file (as FILE.jmp), if
+/// there is one. Returns null if there is no table, or if it cannot be read
+/// or was not built from the given GCSA, in which case a warning is printed.
+unique_ptr<GCSAJumpTable> load_gcsa_jump_table(const string& gcsa_name, const gcsa::GCSA& gcsa);
+
+inline int GCSAJumpTable::encode(char base) {
+    switch (base) {
+    case 'A':
+        return 0;
+    case 'C':
+        return 1;
+    case 'G':
+        return 2;
+    case 'T':
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+inline size_t GCSAJumpTable::level_start(size_t length) {
+    // Sum of 4^l for l from 1 to length - 1
+    return ((size_t(1) << (2 * length)) - 4) / 3;
+}
+
+}
+
+#endif
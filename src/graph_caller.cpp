@@ -13,14 +13,27 @@ GraphCaller::GraphCaller(SnarlCaller& snarl_caller,
 GraphCaller::~GraphCaller() {
 }
 
-void GraphCaller::call_top_level_snarls(const HandleGraph& graph, int ploidy, bool recurse_on_fail) {
+/// Sort some items by descending cost (computed in parallel), keeping ties in order
+template<typename T, typename CostFunction>
+static void sort_by_cost(vector<T>& items, const CostFunction& get_cost) {
+    vector<pair<size_t, T>> costed_items(items.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < items.size(); ++i) {
+        costed_items[i] = make_pair(get_cost(items[i]), items[i]);
+    }
+    std::stable_sort(costed_items.begin(), costed_items.end(), [](const pair<size_t, T>& a, const pair<size_t, T>& b) {
+            return a.first > b.first;
+        });
+    for (size_t i = 0; i < items.size(); ++i) {
+        items[i] = costed_items[i].second;
+    }
+}
 
-    // Used to recurse on children of parents that can't be called
-    size_t thread_count = get_thread_count();
-    vector<vector<const Snarl*>> snarl_queue(thread_count);
+void GraphCaller::call_top_level_snarls(const HandleGraph& graph, int ploidy, bool recurse_on_fail) {
 
-    // Run the snarl caller on a snarl, and queue up the children if it fails
-    auto process_snarl = [&](const Snarl* snarl) {
+    // Run the snarl caller on a snarl, and if it fails, spawn tasks for the children
+    // right away, so they can be picked up by any idle thread
+    function<void(const Snarl*)> process_snarl = [&](const Snarl* snarl) {
 
         if (!snarl_manager.is_trivial(snarl, graph)) {
 
@@ -30,32 +43,83 @@ void GraphCaller::call_top_level_snarls(const HandleGraph& graph, int ploidy, bo
 
             bool was_called = call_snarl(*snarl, ploidy);
             if (!was_called && recurse_on_fail) {
-                const vector<const Snarl*>& children = snarl_manager.children_of(snarl);
-                vector<const Snarl*>& thread_queue = snarl_queue[omp_get_thread_num()];
-                thread_queue.insert(thread_queue.end(), children.begin(), children.end());
+                for (const Snarl* child : snarl_manager.children_of(snarl)) {
+#pragma omp task
+                    process_snarl(child);
+                }
             }
         }
     };
 
-    // Start with the top level snarls
-    snarl_manager.for_each_top_level_snarl_parallel(process_snarl);
-
-    // Then recurse on any children the snarl caller failed to handle
-    while (!std::all_of(snarl_queue.begin(), snarl_queue.end(),
-                        [](const vector<const Snarl*>& snarl_vec) {return snarl_vec.empty();})) {
-        vector<const Snarl*> cur_queue;
-        for (vector<const Snarl*>& thread_queue : snarl_queue) {
-            cur_queue.reserve(cur_queue.size() + thread_queue.size());
-            std::move(thread_queue.begin(), thread_queue.end(), std::back_inserter(cur_queue));
-            thread_queue.clear();
+    // Call a batch of top level snarls (and any of their children we recurse on) as tasks.
+    // We start the biggest ones first so they don't end up holding up the end of the batch.
+    auto process_snarls = [&](const vector<const Snarl*>& snarls) {
+        vector<const Snarl*> by_cost = snarls;
+        sort_by_cost(by_cost, [&](const Snarl* snarl) {
+                return get_snarl_cost(graph, snarl);
+            });
+#pragma omp parallel
+        {
+#pragma omp single
+            {
+                for (const Snarl* snarl : by_cost) {
+#pragma omp task
+                    process_snarl(snarl);
+                }
+            }
         }
+    };
 
-#pragma omp parallel for schedule(dynamic, 1)
-        for (int i = 0; i < cur_queue.size(); ++i) {
-            process_snarl(cur_queue[i]);
+    const vector<const Snarl*>& top_level_snarls = snarl_manager.top_level_snarls();
+    
+    if (window_size == 0) {
+        process_snarls(top_level_snarls);
+        return;
+    }
+
+    // Otherwise, sort the top level snarls along the reference so we can call them
+    // a window at a time.  Snarls that aren't on the reference get an empty path
+    // name, which sorts them first, as we can't say anything about where their output will land.
+    vector<pair<string, size_t>> ref_positions(top_level_snarls.size());
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t i = 0; i < top_level_snarls.size(); ++i) {
+        if (!get_snarl_ref_position(*top_level_snarls[i], ref_positions[i])) {
+            ref_positions[i] = make_pair(string(), 0);
         }
     }
-  
+    vector<size_t> order(top_level_snarls.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+            return ref_positions[i] < ref_positions[j];
+        });
+
+    vector<const Snarl*> window;
+    for (size_t window_start = 0; window_start < order.size(); window_start += window_size) {
+        size_t window_end = std::min(order.size(), window_start + window_size);
+        window.clear();
+        for (size_t i = window_start; i < window_end; ++i) {
+            window.push_back(top_level_snarls[order[i]]);
+        }
+        // Children lie between their parents' boundaries, so they're finished in the same window
+        process_snarls(window);
+
+        if (window_end < order.size() && !ref_positions[order[window_end]].first.empty()) {
+            finish_window(ref_positions[order[window_end]]);
+        }
+    }
+}
+
+void GraphCaller::set_window_size(size_t window_size) {
+    this->window_size = window_size;
+}
+
+bool GraphCaller::get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const {
+    return false;
+}
+
+void GraphCaller::finish_window(const pair<string, size_t>& next_position) {
 }
 
 static void flip_snarl(Snarl& snarl) {
@@ -65,12 +129,9 @@ static void flip_snarl(Snarl& snarl) {
 }
 
 void GraphCaller::call_top_level_chains(const HandleGraph& graph, int ploidy, size_t max_edges, size_t max_trivial, bool recurse_on_fail) {
-    // Used to recurse on children of parents that can't be called
-    size_t thread_count = get_thread_count();
-    vector<vector<Chain>> chain_queue(thread_count);
 
-    // Run the snarl caller on a chain. queue up the children if it fails
-    auto process_chain = [&](const Chain* chain) {
+    // Run the snarl caller on a chain. spawn tasks for the child chains of any piece that fails
+    function<void(const Chain*)> process_chain = [&](const Chain* chain) {
 
 #ifdef debug
         cerr << "calling top level chain ";
@@ -99,34 +160,47 @@ void GraphCaller::call_top_level_chains(const HandleGraph& graph, int ploidy, si
             
             bool was_called = call_snarl(fake_snarl, ploidy);
             if (!was_called && recurse_on_fail) {
-                vector<Chain>& thread_queue = chain_queue[omp_get_thread_num()];                
                 for (pair<const Snarl*, bool> chain_link : chain_piece) {
-                    const deque<Chain>& child_chains = snarl_manager.chains_of(chain_link.first);
-                    thread_queue.insert(thread_queue.end(), child_chains.begin(), child_chains.end());
+                    for (const Chain& child_chain : snarl_manager.chains_of(chain_link.first)) {
+                        const Chain* child = &child_chain;
+#pragma omp task
+                        process_chain(child);
+                    }
                 }
             }
         }
     };
 
-    // Start with the top level snarls
-    snarl_manager.for_each_top_level_chain_parallel(process_chain);
-
-    // Then recurse on any children the snarl caller failed to handle
-    while (!std::all_of(chain_queue.begin(), chain_queue.end(),
-                        [](const vector<Chain>& chain_vec) {return chain_vec.empty();})) {
-        vector<Chain> cur_queue;
-        for (vector<Chain>& thread_queue : chain_queue) {
-            cur_queue.reserve(cur_queue.size() + thread_queue.size());
-            std::move(thread_queue.begin(), thread_queue.end(), std::back_inserter(cur_queue));
-            thread_queue.clear();
+    // Start with the top level chains, biggest first
+    vector<const Chain*> by_cost;
+    snarl_manager.for_each_top_level_chain([&](const Chain* chain) {
+            by_cost.push_back(chain);
+        });
+    sort_by_cost(by_cost, [&](const Chain* chain) {
+            size_t cost = 0;
+            for (const pair<const Snarl*, bool>& link : *chain) {
+                cost += get_snarl_cost(graph, link.first);
+            }
+            return cost;
+        });
+    
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            for (const Chain* chain : by_cost) {
+#pragma omp task
+                process_chain(chain);
+            }
         }
+    }
+}
 
-#pragma omp parallel for schedule(dynamic, 1)
-        for (int i = 0; i < cur_queue.size(); ++i) {
-            process_chain(&cur_queue[i]);
-        }
-    
+size_t GraphCaller::get_snarl_cost(const HandleGraph& graph, const Snarl* snarl) const {
+    if (snarl_manager.is_trivial(snarl, graph)) {
+        return 0;
     }
+    return snarl_manager.deep_contents(snarl, graph, false).second.size();
 }
 
 vector<Chain> GraphCaller::break_chain(const HandleGraph& graph, const Chain& chain, size_t max_edges, size_t max_trivial) {
@@ -211,19 +285,86 @@ void VCFOutputCaller::add_variant(vcflib::Variant& var) const {
 
 void VCFOutputCaller::write_variants(ostream& out_stream) const {
     vector<vcflib::Variant> all_variants;
-    for (const auto& buf : output_variants) {
+    for (auto& buf : output_variants) {
         all_variants.reserve(all_variants.size() + buf.size());
         std::move(buf.begin(), buf.end(), std::back_inserter(all_variants));
+        buf.clear();
+    }
+    write_sorted(out_stream, all_variants);
+}
+
+void VCFOutputCaller::set_output_stream(ostream* out_stream) {
+    output_stream = out_stream;
+}
+
+void VCFOutputCaller::write_variants_before(const pair<string, size_t>& position) const {
+    if (output_stream == nullptr) {
+        return;
     }
-    std::sort(all_variants.begin(), all_variants.end(), [](const vcflib::Variant& v1, const vcflib::Variant& v2) {
+    auto is_before = [&](const vcflib::Variant& v) {
+        return v.sequenceName < position.first || (v.sequenceName == position.first && (size_t)v.position < position.second);
+    };
+    vector<vcflib::Variant> ready_variants;
+    for (auto& buf : output_variants) {
+        // move the ready variants out of the buffer, sliding the others down to fill the gaps
+        size_t kept = 0;
+        for (size_t i = 0; i < buf.size(); ++i) {
+            if (is_before(buf[i])) {
+                ready_variants.push_back(std::move(buf[i]));
+            } else {
+                if (kept != i) {
+                    buf[kept] = std::move(buf[i]);
+                }
+                ++kept;
+            }
+        }
+        buf.resize(kept);
+    }
+    write_sorted(*output_stream, ready_variants);
+}
+
+void VCFOutputCaller::write_sorted(ostream& out_stream, vector<vcflib::Variant>& variants) const {
+    std::sort(variants.begin(), variants.end(), [](const vcflib::Variant& v1, const vcflib::Variant& v2) {
             return v1.sequenceName < v2.sequenceName || (v1.sequenceName == v2.sequenceName && v1.position < v2.position);
         });
-    for (auto v : all_variants) {
+    for (auto& v : variants) {
         v.setVariantCallFile(output_vcf);
         out_stream << v << endl;
     }
 }
 
+bool VCFOutputCaller::get_ref_position(const PathPositionHandleGraph& graph, const Snarl& snarl,
+                                       const map<string, size_t>& ref_offsets, pair<string, size_t>& ref_position) const {
+    bool found = false;
+    for (const Visit& visit : {snarl.start(), snarl.end()}) {
+        if (!graph.has_node(visit.node_id())) {
+            continue;
+        }
+        graph.for_each_step_on_handle(graph.get_handle(visit.node_id()), [&](step_handle_t step) {
+                string name = graph.get_path_name(graph.get_path_handle_of_step(step));
+                size_t offset = 0;
+                if (ref_offsets.empty()) {
+                    if (Paths::is_alt(name)) {
+                        return;
+                    }
+                } else {
+                    auto it = ref_offsets.find(name);
+                    if (it == ref_offsets.end()) {
+                        return;
+                    }
+                    offset = it->second;
+                }
+                // +1 to match the 1-based VCF positions of the variants
+                pair<string, size_t> step_position(name, graph.get_position_of_step(step) + offset + 1);
+                if (!found || step_position < ref_position) {
+                    ref_position = std::move(step_position);
+                    found = true;
+                }
+            });
+    }
+    return found;
+}
+
 void VCFOutputCaller::emit_variant(const PathPositionHandleGraph& graph, SnarlCaller& snarl_caller,
                                    const Snarl& snarl, const vector<SnarlTraversal>& called_traversals,
                                    const vector<int>& genotype, int ref_trav_idx, const unique_ptr<SnarlCaller::CallInfo>& call_info,
@@ -643,6 +784,9 @@ VCFGenotyper::VCFGenotyper(const PathHandleGraph& graph,
     traversals_only(traversals_only),
     gaf_output(gaf_output) {
 
+    for (const string& ref_path : ref_paths) {
+        ref_offsets[ref_path] = 0;
+    }
     scan_contig_lengths();    
 }
 
@@ -816,6 +960,16 @@ tuple<string, size_t, size_t> VCFGenotyper::get_ref_positions(const vector<vcfli
     return make_tuple(ref_path, ref_range.first, ref_range.second);
 }
 
+bool VCFGenotyper::get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const {
+    // we can only order the snarls if we've got path positions
+    const PathPositionHandleGraph* pp_graph = dynamic_cast<const PathPositionHandleGraph*>(&graph);
+    return pp_graph != nullptr && get_ref_position(*pp_graph, snarl, ref_offsets, ref_position);
+}
+
+void VCFGenotyper::finish_window(const pair<string, size_t>& next_position) {
+    write_variants_before(next_position);
+}
+
 unordered_map<string, size_t> VCFGenotyper::scan_contig_lengths() const {
 
     unordered_map<string, size_t> ref_lengths;
@@ -1189,6 +1343,14 @@ pair<string, PathIndex*> LegacyCaller::find_index(const Snarl& snarl, const vect
     return make_pair("", nullptr);
 }
 
+bool LegacyCaller::get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const {
+    return get_ref_position(graph, snarl, ref_offsets, ref_position);
+}
+
+void LegacyCaller::finish_window(const pair<string, size_t>& next_position) {
+    write_variants_before(next_position);
+}
+
 FlowCaller::FlowCaller(const PathPositionHandleGraph& graph,
                        SupportBasedSnarlCaller& snarl_caller,
                        SnarlManager& snarl_manager,
@@ -1222,6 +1384,14 @@ FlowCaller::~FlowCaller() {
 
 }
 
+bool FlowCaller::get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const {
+    return get_ref_position(graph, snarl, ref_offsets, ref_position);
+}
+
+void FlowCaller::finish_window(const pair<string, size_t>& next_position) {
+    write_variants_before(next_position);
+}
+
 bool FlowCaller::call_snarl(const Snarl& managed_snarl, int ploidy) {
 
     // todo: In order to experiment with merging consecutive snarls to make longer traversals,
@@ -33,7 +33,8 @@ public:
 
     /// Run call_snarl() on every top-level snarl in the manager.
     /// For any that return false, try the children, etc. (when recurse_on_fail true)
-    /// Snarls are processed in parallel
+    /// Snarls are processed in parallel as tasks, biggest first, with children spawned as soon as
+    /// their parent fails
     virtual void call_top_level_snarls(const HandleGraph& graph,
                                        int ploidy,
                                        bool recurse_on_fail = true);
@@ -50,8 +51,26 @@ public:
     /// Call a given snarl, and print the output to out_stream
     virtual bool call_snarl(const Snarl& snarl, int ploidy) = 0;
 
+    /// Make call_top_level_snarls() work through the top-level snarls in reference order,
+    /// window_size at a time, running finish_window() after each window so output can
+    /// be flushed as we go rather than held until the end.  0 (default) turns this off.
+    void set_window_size(size_t window_size);
+
 protected:
 
+    /// Get the leftmost 1-based reference position (path name and offset) of a snarl's
+    /// boundary nodes, used to order the snarls when calling in windows.  Returns false if the
+    /// snarl is not on the reference, which is always the case in this default implementation.
+    virtual bool get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const;
+
+    /// Called when a window of top-level snarls (and any children they recursed to) is done.
+    /// All the snarls that remain to be called have a reference position of at least next_position. 
+    virtual void finish_window(const pair<string, size_t>& next_position);
+
+    /// Estimate how long a snarl will take to call, from the number of edges in it, so
+    /// the big ones can be started first
+    size_t get_snarl_cost(const HandleGraph& graph, const Snarl* snarl) const;
+
     /// Break up a chain into bits that we want to call using size heuristics
     vector<Chain> break_chain(const HandleGraph& graph, const Chain& chain, size_t max_edges, size_t max_trivial);
     
@@ -62,6 +81,9 @@ protected:
 
     /// Our snarls
     SnarlManager& snarl_manager;
+
+    /// Number of top-level snarls to call per window (0 to call them all at once)
+    size_t window_size = 0;
 };
 
 /**
@@ -81,6 +103,14 @@ public:
 
     /// Sort then write variants in the buffer
     void write_variants(ostream& out_stream) const;
+
+    /// Stream variants to the given output (whose header must already be written) as
+    /// write_variants_before() finds them safe to write, instead of holding them all.
+    void set_output_stream(ostream* out_stream);
+
+    /// Sort then write the buffered variants that come before the given (path, 1-based position)
+    /// to the output stream, if one was set.  The rest stay in the buffer.
+    void write_variants_before(const pair<string, size_t>& position) const;
     
 protected:
 
@@ -98,6 +128,15 @@ protected:
     /// clean up the alleles to not share common prefixes / suffixes
     /// if len_override given, just do that many bases without thinking
     void flatten_common_allele_ends(vcflib::Variant& variant, bool backward, size_t len_override) const;
+
+    /// get the leftmost 1-based position (including offset) of the snarl's boundary nodes on the
+    /// reference paths given as keys of ref_offsets (or any non-alt path, at offset 0, if empty).
+    /// the lexicographically lowest path wins, to match the order write_variants() sorts in
+    bool get_ref_position(const PathPositionHandleGraph& graph, const Snarl& snarl,
+                          const map<string, size_t>& ref_offsets, pair<string, size_t>& ref_position) const;
+
+    /// sort and print some variants
+    void write_sorted(ostream& out_stream, vector<vcflib::Variant>& variants) const;
     
     /// output vcf
     mutable vcflib::VariantCallFile output_vcf;
@@ -108,6 +147,9 @@ protected:
     /// output buffers (1/thread) (for sorting)
     mutable vector<vector<vcflib::Variant>> output_variants;
 
+    /// where to stream variants as they're ready (if not null)
+    ostream* output_stream = nullptr;
+
     /// print up to this many uncalled alleles when doing ref-genotpes in -a mode
     size_t max_uncalled_alleles = 5;
 };
@@ -183,6 +225,12 @@ protected:
     /// munge out the contig lengths from the VCF header
     virtual unordered_map<string, size_t> scan_contig_lengths() const;
 
+    /// the reference position of a snarl, for calling in windows
+    virtual bool get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const;
+
+    /// write the variants that are safe to write after a window
+    virtual void finish_window(const pair<string, size_t>& next_position);
+
 protected:
 
     /// the graph
@@ -191,6 +239,9 @@ protected:
     /// input VCF to genotype, must have been loaded etc elsewhere
     vcflib::VariantCallFile& input_vcf;
 
+    /// reference paths (all at offset 0, as we use the input VCF's coordinates)
+    map<string, size_t> ref_offsets;
+
     /// traversal finder uses alt paths to map VCF alleles from input_vcf
     /// back to traversals in the snarl
     VCFTraversalFinder traversal_finder;
@@ -251,6 +302,12 @@ protected:
     /// look up a path index for a site and return its name too
     pair<string, PathIndex*> find_index(const Snarl& snarl, const vector<PathIndex*> path_indexes) const;
 
+    /// the reference position of a snarl, for calling in windows
+    virtual bool get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const;
+
+    /// write the variants that are safe to write after a window
+    virtual void finish_window(const pair<string, size_t>& next_position);
+
 protected:
 
     /// the graph
@@ -320,6 +377,14 @@ public:
     virtual string vcf_header(const PathHandleGraph& graph, const vector<string>& contigs,
                               const vector<size_t>& contig_length_overrides = {}) const;
 
+protected:
+
+    /// the reference position of a snarl, for calling in windows
+    virtual bool get_snarl_ref_position(const Snarl& snarl, pair<string, size_t>& ref_position) const;
+
+    /// write the variants that are safe to write after a window
+    virtual void finish_window(const pair<string, size_t>& next_position);
+
 protected:
 
     /// the graph
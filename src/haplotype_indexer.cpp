@@ -7,6 +7,8 @@
 #include <vector>
 #include <string>
 
+#include <omp.h>
+
 #include <vg/io/stream.hpp>
 
 #include "gbwt_helper.hpp"
@@ -20,6 +22,38 @@ using namespace std;
 
 namespace vg {
 
+namespace {
+
+/// A VCF record that has been located on the reference path.
+struct LocatedVariant {
+    size_t ref_pos, ref_end;
+    /// Paths for the alternate alleles.
+    std::vector<gbwt::vector_type> alleles;
+    /// The original VCF line, for parsing the genotypes.
+    std::string line;
+    /// Phasings for the samples in the sample range, if parsed in advance.
+    std::vector<gbwt::Phasing> phasings;
+};
+
+/// A region of a contig, parsed on its own.
+struct ParsedRegion {
+    /// VCF coordinates for setRegion(); end 0 means the end of the contig.
+    size_t start = 0, end = 0;
+    /// Records starting before this position belong to an earlier region.
+    size_t skip_before = 0;
+    /// Variants in VCF order. Their phasings assume that all samples were
+    /// diploid before the region.
+    std::vector<LocatedVariant> variants;
+    /// Warnings in VCF order, flagged as missing variants or not. Only the
+    /// first few missing variants are listed.
+    std::vector<std::pair<bool, std::string>> warnings;
+    /// Number of variants missing from the graph.
+    size_t missing_variants = 0;
+    double seconds = 0.0;
+};
+
+}
+
 HaplotypeIndexer::HaplotypeIndexer() {
     // Use the same temp directory as VG for GBWT temp files.
     gbwt::TempFile::setDirectory(temp_file::get_dir());
@@ -92,6 +126,28 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
     std::mt19937 rng(0xDEADBEEF);
     std::uniform_int_distribution<std::mt19937::result_type> random_bit(0, 1);
     size_t found_missing_variants = 0;
+
+    // Print a warning about a variant, counting the missing ones.
+    auto report_warning = [&](bool missing, const std::string& message) {
+        if (missing) {
+            found_missing_variants++;
+            if (!this->warn_on_missing_variants || found_missing_variants > this->max_missing_variant_warnings) {
+                return;
+            }
+        }
+        #pragma omp critical
+        {
+            // The user might not know it. Warn them in case they mixed up their VCFs.
+            std::cerr << "warning: [HaplotypeIndexer::parse_vcf] " << message << std::endl;
+            if (missing && found_missing_variants == this->max_missing_variant_warnings) {
+                std::cerr << "warning: [HaplotypeIndexer::parse_vcf] suppressing further missing variant warnings" << std::endl;
+            }
+        }
+    };
+
+    // Separate VCF readers for the threads parsing regions of a contig.
+    std::vector<std::unique_ptr<vcflib::VariantCallFile>> region_files(this->parse_threads);
+
     for (size_t path_id = 0; path_id < paths.size(); path_id++) {
         std::string path_name = graph.get_path_name(paths[path_id]);
         std::string vcf_contig_name = (this->path_to_vcf.count(path_name) > 0 ? this->path_to_vcf.at(path_name) : path_name);
@@ -130,8 +186,10 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
         std::vector<gbwt::PhasingInformation> phasings;
 
         // Add the reference to VariantPaths.
+        size_t path_length = 0;
         for (handle_t handle : graph.scan_path(paths[path_id])) {
             variants.appendToReference(gbwt::Node::encode(graph.get_id(handle), graph.get_is_reverse(handle)));
+            path_length += graph.get_length(handle);
         }
         variants.indexReference();
 
@@ -149,17 +207,17 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
             variants.addFile(phasings.back().name(), phasings.back().offset(), phasings.back().size());
         }
 
-        // Parse the variants and the phasings.
-        size_t variants_processed = 0;
-        std::vector<bool> was_diploid(sample_range.second, true); // Was the sample diploid at the previous site?
-        do {
+        // Determine the reference nodes for the variant and the paths for the
+        // alternate alleles. Returns false if the variant should be skipped,
+        // with a warning if there is something to warn about.
+        auto locate_variant = [&](vcflib::Variant& var, LocatedVariant& located, std::pair<bool, std::string>& warning) -> bool {
             // Skip variants with non-DNA sequence, as they are not included in the graph.
             bool isDNA = allATGC(var.ref);
             for (std::vector<std::string>::iterator a = var.alt.begin(); a != var.alt.end(); ++a) {
                 if (!allATGC(*a)) isDNA = false;
             }
             if (!isDNA) {
-                continue;
+                return false;
             }
             
             if (this->rename_variants) {
@@ -178,12 +236,9 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
             if (!ref_path.empty()) {
                 ref_pos = variants.firstOccurrence(ref_path.front());
                 if (ref_pos == variants.invalid_position()) {
-                    #pragma omp critical
-                    {
-                        std::cerr << "warning: [HaplotypeIndexer::parse_vcf] invalid ref path for " << var_name << " at "
-                            << var.sequenceName << ":" << var.position << std::endl;
-                    }
-                    continue;
+                    warning.first = false;
+                    warning.second = "invalid ref path for " + var_name + " at " + var.sequenceName + ":" + std::to_string(var.position);
+                    return false;
                 }
             } else {
                 // Try using the alternate alleles instead.
@@ -212,40 +267,50 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
                 }
                 if (!found) {
                     // This variant from the VCF is just not in the graph, so skip it.
-                    found_missing_variants++;
-                    if (this->warn_on_missing_variants && found_missing_variants <= this->max_missing_variant_warnings) {
-                        #pragma omp critical
-                        {
-                            // The user might not know it. Warn them in case they mixed up their VCFs.
-                            std::cerr << "warning: [HaplotypeIndexer::parse_vcf] alt and ref paths for " << var_name
-                                    << " at " << var.sequenceName << ":" << var.position
-                                    << " missing/empty! Was the variant skipped during construction?" << std::endl;
-                            if (found_missing_variants == this->max_missing_variant_warnings) {
-                                std::cerr << "warning: [HaplotypeIndexer::parse_vcf] suppressing further missing variant warnings" << std::endl;
-                            }
-                        }
-                    }
-                    continue;
+                    warning.first = true;
+                    warning.second = "alt and ref paths for " + var_name + " at " + var.sequenceName + ":" + std::to_string(var.position)
+                        + " missing/empty! Was the variant skipped during construction?";
+                    return false;
                 }
             }
-            variants.addSite(ref_pos, ref_pos + ref_path.size());
+            located.ref_pos = ref_pos;
+            located.ref_end = ref_pos + ref_path.size();
 
-            // Add alternate alleles to the site.
+            // Determine the alternate alleles.
             for (size_t alt_index = 1; alt_index < var.alleles.size(); alt_index++) {
                 std::string alt_path_name = "_alt_" + var_name + "_" + std::to_string(alt_index);
                 if (graph.has_path(alt_path_name)) {
-                    variants.addAllele(extract_as_gbwt_path(graph, alt_path_name));
+                    located.alleles.push_back(extract_as_gbwt_path(graph, alt_path_name));
                 } else {
-                    variants.addAllele(ref_path);
+                    located.alleles.push_back(ref_path);
                 }
             }
+            located.line = var.originalLine;
+            return true;
+        };
 
-            // Store the phasings in PhasingInformation structures.
-            std::vector<std::string> genotypes = parseGenotypes(var.originalLine, num_samples);
+        // Add a located variant as a site and store the phasings in
+        // PhasingInformation structures. If the phasings were parsed in
+        // advance, they must be consistent with was_diploid.
+        size_t variants_processed = 0;
+        std::vector<bool> was_diploid(sample_range.second, true); // Was the sample diploid at the previous site?
+        auto add_variant = [&](const LocatedVariant& located) {
+            variants.addSite(located.ref_pos, located.ref_end);
+            for (const gbwt::vector_type& allele : located.alleles) {
+                variants.addAllele(allele);
+            }
+            std::vector<std::string> genotypes;
+            if (located.phasings.empty()) {
+                genotypes = parseGenotypes(located.line, num_samples);
+            }
             for (size_t batch = 0; batch < phasings.size(); batch++) {
                 std::vector<gbwt::Phasing> current_phasings;
                 for (size_t sample = phasings[batch].offset(); sample < phasings[batch].limit(); sample++) {
-                    current_phasings.emplace_back(genotypes[sample], was_diploid[sample], this->phase_homozygous);
+                    if (located.phasings.empty()) {
+                        current_phasings.emplace_back(genotypes[sample], was_diploid[sample], this->phase_homozygous);
+                    } else {
+                        current_phasings.push_back(located.phasings[sample - sample_range.first]);
+                    }
                     was_diploid[sample] = current_phasings.back().diploid;
                     if(this->force_phasing) {
                         current_phasings.back().forcePhased([&]() {
@@ -256,8 +321,164 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
                 phasings[batch].append(current_phasings);
             }
             variants_processed++;
+        };
+
+        if (this->parse_threads <= 1) {
+            // Parse the variants and the phasings.
+            do {
+                LocatedVariant located;
+                std::pair<bool, std::string> warning;
+                if (locate_variant(var, located, warning)) {
+                    add_variant(located);
+                } else if (!warning.second.empty()) {
+                    report_warning(warning.first, warning.second);
+                }
+            }
+            while (variant_file.is_open() && variant_file.getNextVariant(var) && var.sequenceName == vcf_contig_name); // End of variants.
+        } else {
+            // Split the contig into regions. A variant belongs to the region
+            // where it starts, or to the first region if it starts earlier.
+            size_t first = 1, last = path_length;
+            bool open_ended = true;
+            if (this->regions.count(vcf_contig_name)) {
+                std::pair<size_t, size_t> region = this->regions.at(vcf_contig_name);
+                first = region.first;
+                last = region.second;
+                open_ended = false;
+            }
+            size_t region_length = std::max(this->parse_region_length, size_t(1));
+            std::vector<ParsedRegion> parsed_regions;
+            for (size_t start = first; ; start += region_length) {
+                parsed_regions.emplace_back();
+                ParsedRegion& region = parsed_regions.back();
+                region.start = start;
+                region.skip_before = (start == first ? 0 : start);
+                if (start + region_length > last) {
+                    region.end = (open_ended ? 0 : last);
+                    break;
+                }
+                region.end = start + region_length - 1;
+            }
+            if (this->show_progress) {
+                #pragma omp critical
+                {
+                    std::cerr << job_name << ": Parsing path " << path_name << " in " << parsed_regions.size() << " regions using " << this->parse_threads << " threads" << std::endl;
+                }
+            }
+
+            // Parse the phasings in a region as if every sample was diploid
+            // before it.
+            auto parse_region = [&](ParsedRegion& region, vcflib::VariantCallFile& region_file) {
+                double start = gbwt::readTimer();
+                region_file.setRegion(vcf_contig_name, region.start, region.end);
+                vcflib::Variant var(region_file);
+                std::vector<bool> diploid(sample_range.second, true);
+                while (region_file.is_open() && region_file.getNextVariant(var) && var.sequenceName == vcf_contig_name) {
+                    if ((size_t) var.position < region.skip_before) {
+                        continue;
+                    }
+                    LocatedVariant located;
+                    std::pair<bool, std::string> warning;
+                    if (!locate_variant(var, located, warning)) {
+                        if (warning.first) {
+                            region.missing_variants++;
+                            if (region.missing_variants > this->max_missing_variant_warnings) {
+                                continue;
+                            }
+                        }
+                        if (!warning.second.empty()) {
+                            region.warnings.push_back(std::move(warning));
+                        }
+                        continue;
+                    }
+                    std::vector<std::string> genotypes = parseGenotypes(located.line, num_samples);
+                    located.phasings.reserve(sample_range.second - sample_range.first);
+                    for (size_t sample = sample_range.first; sample < sample_range.second; sample++) {
+                        located.phasings.emplace_back(genotypes[sample], diploid[sample], this->phase_homozygous);
+                        diploid[sample] = located.phasings.back().diploid;
+                    }
+                    region.variants.push_back(std::move(located));
+                }
+                region.seconds = gbwt::readTimer() - start;
+            };
+
+            // Fix the phasings in a region for the samples that were not
+            // diploid before it. Once the ploidy agrees with what the region
+            // assumed, the rest of the phasings for the sample are correct.
+            auto stitch_region = [&](ParsedRegion& region) {
+                std::vector<size_t> mismatched;
+                for (size_t sample = sample_range.first; sample < sample_range.second; sample++) {
+                    if (!was_diploid[sample]) {
+                        mismatched.push_back(sample);
+                    }
+                }
+                for (size_t i = 0; i < region.variants.size() && !mismatched.empty(); i++) {
+                    std::vector<std::string> genotypes = parseGenotypes(region.variants[i].line, num_samples);
+                    size_t tail = 0;
+                    for (size_t sample : mismatched) {
+                        size_t offset = sample - sample_range.first;
+                        bool diploid_before = (i == 0 ? was_diploid[sample] : region.variants[i - 1].phasings[offset].diploid);
+                        gbwt::Phasing& phasing = region.variants[i].phasings[offset];
+                        bool assumed = phasing.diploid;
+                        phasing = gbwt::Phasing(genotypes[sample], diploid_before, this->phase_homozygous);
+                        if (phasing.diploid != assumed) {
+                            mismatched[tail] = sample;
+                            tail++;
+                        }
+                    }
+                    mismatched.resize(tail);
+                }
+            };
+
+            // Parse the regions in rounds, so that only the regions in the
+            // current round are in memory.
+            for (size_t round_start = 0; round_start < parsed_regions.size(); round_start += this->parse_threads) {
+                size_t round_end = std::min(round_start + this->parse_threads, parsed_regions.size());
+                #pragma omp parallel for num_threads(this->parse_threads) schedule(dynamic, 1)
+                for (size_t i = round_start; i < round_end; i++) {
+                    size_t thread_num = omp_get_thread_num();
+                    if (region_files[thread_num] == nullptr) {
+                        region_files[thread_num].reset(new vcflib::VariantCallFile());
+                        region_files[thread_num]->parseSamples = false;
+                        std::string temp_filename = filename;
+                        region_files[thread_num]->open(temp_filename);
+                        if (!region_files[thread_num]->is_open()) {
+                            std::cerr << "error: [HaplotypeIndexer::parse_vcf] could not open " << filename << std::endl;
+                            std::exit(EXIT_FAILURE);
+                        }
+                    }
+                    parse_region(parsed_regions[i], *(region_files[thread_num]));
+                }
+
+                // Add the variants in order.
+                for (size_t i = round_start; i < round_end; i++) {
+                    ParsedRegion& region = parsed_regions[i];
+                    size_t listed_missing = 0;
+                    for (auto& warning : region.warnings) {
+                        report_warning(warning.first, warning.second);
+                        listed_missing += warning.first;
+                    }
+                    found_missing_variants += region.missing_variants - listed_missing;
+                    stitch_region(region);
+                    for (const LocatedVariant& located : region.variants) {
+                        add_variant(located);
+                    }
+                    if (this->show_progress) {
+                        #pragma omp critical
+                        {
+                            std::cerr << job_name << ": Region " << vcf_contig_name << ":" << region.start << "-";
+                            if (region.end == 0) {
+                                std::cerr << "end";
+                            } else {
+                                std::cerr << region.end;
+                            }
+                            std::cerr << ": " << region.variants.size() << " variants in " << region.seconds << " seconds" << std::endl;
+                        }
+                    }
+                    region = ParsedRegion();
+                }
+            }
         }
-        while (variant_file.is_open() && variant_file.getNextVariant(var) && var.sequenceName == vcf_contig_name); // End of variants.
         if (this->show_progress) {
             size_t phasing_bytes = 0;
             for (size_t batch = 0; batch < phasings.size(); batch++) {
@@ -67,7 +67,19 @@ public:
 
     /// Number of samples to process together in a haplotype batch.
     size_t samples_in_batch = 200;
-    
+
+    /// Number of threads for parsing a single contig. If this is more than
+    /// one, each contig is split into regions of parse_region_length VCF
+    /// positions that are parsed in parallel and then stitched together in
+    /// order, which gives the same parse as a single thread. The variants
+    /// in the regions being parsed at the same time are kept in memory.
+    /// Nested OpenMP parallelism must be enabled if parse_vcf() is called
+    /// from a parallel region.
+    size_t parse_threads = 1;
+
+    /// Length of the regions that are parsed in parallel, in VCF positions.
+    size_t parse_region_length = 100000;
+
     /// Size of the GBWT buffer in millions of nodes
     size_t gbwt_buffer_size = gbwt::DynamicGBWT::INSERT_BATCH_SIZE / gbwt::MILLION;
     
@@ -21,7 +21,8 @@ using namespace std;
 unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, 
                                                    const vector<path_handle_t>& paths, size_t max_threads,
                                                    const HandleGraph* graph, bool hts_raw,
-                                                   bool hts_spliced) {
+                                                   bool hts_spliced, size_t writer_threads,
+                                                   AsyncAlignmentEmitter::Stats* writer_stats) {
 
     
     unique_ptr<AlignmentEmitter> emitter;
@@ -47,6 +48,11 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
             emitter = make_unique<HTSAlignmentEmitter>(filename, format, path_names_and_lengths, max_threads);
         }
         
+        if (writer_threads > 0) {
+            // Do BAM encoding and compression on dedicated writer threads
+            emitter = make_unique<AsyncAlignmentEmitter>(std::move(emitter), max_threads, writer_threads, writer_stats);
+        }
+        
         if (!hts_raw) {
             // Need to surject
             
@@ -60,6 +66,11 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
         // The non-HTSlib formats don't actually use the path name and length info.
         // See https://github.com/vgteam/libvgio/issues/34
         emitter = get_non_hts_alignment_emitter(filename, format, {}, max_threads, graph);
+        
+        if (writer_threads > 0) {
+            // Do serialization and compression on dedicated writer threads
+            emitter = make_unique<AsyncAlignmentEmitter>(std::move(emitter), max_threads, writer_threads, writer_stats);
+        }
     }
     
     return emitter;
@@ -20,6 +20,7 @@
 #include <vg/io/protobuf_emitter.hpp>
 #include <vg/io/stream_multiplexer.hpp>
 #include "handle.hpp"
+#include "async_alignment_emitter.hpp"
 #include "vg/io/alignment_emitter.hpp"
 
 namespace vg {
@@ -42,10 +43,17 @@ using namespace vg::io;
 ///
 /// Automatically applies per-thread buffering, but needs to know how many OMP
 /// threads will be in use.
+///
+/// If writer_threads is nonzero, encoding, compression, and writing happen on
+/// that many dedicated writer threads instead of on the calling threads (see
+/// AsyncAlignmentEmitter), and writer_stats, if set, will be filled in with
+/// queue statistics when the emitter is destroyed. Surjection still happens on
+/// the calling threads.
 unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, 
                                                    const vector<path_handle_t>& paths, size_t max_threads,
                                                    const HandleGraph* graph = nullptr, bool hts_raw = false,
-                                                   bool hts_spliced = false);
+                                                   bool hts_spliced = false, size_t writer_threads = 0,
+                                                   AsyncAlignmentEmitter::Stats* writer_stats = nullptr);
                                                    
 /**
  * Produce a list of path handles in a fixed order, suitable for use with
@@ -340,8 +340,12 @@ bool IndexManager::can_get_snarls() const {
 
 void IndexManager::ensure_distance() {
     ensure(distance, distance_override, "dist", [&](ifstream& in) {
-        // Load distance index from the file
-        auto loaded = vg::io::VPKG::load_one<MinimumDistanceIndex>(in);
+        // Load distance index from the file, mapping it in place if we can
+        string filename = distance_override.empty() ? get_filename("dist") : distance_override;
+        unique_ptr<MinimumDistanceIndex> loaded(new MinimumDistanceIndex());
+        if (!loaded->load_mapped(filename)) {
+            loaded = vg::io::VPKG::load_one<MinimumDistanceIndex>(in);
+        }
         distance.reset(loaded.release());
     }, [&](ofstream& out) {
         // Make and save
@@ -353,8 +357,8 @@ void IndexManager::ensure_distance() {
         distance = make_shared<MinimumDistanceIndex>(graph.get(), snarls.get());
         
         if (out.is_open()) {
-            // Save it
-            vg::io::VPKG::save(*distance, out);
+            // Save it bare, so it can be mapped next time
+            distance->serialize(out);
         }
     });
 }
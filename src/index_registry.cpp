@@ -6,6 +6,15 @@
 #include <sstream>
 #include <vector>
 #include <map>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#include <omp.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <bdsg/hash_graph.hpp>
 #include <bdsg/packed_graph.hpp>
@@ -26,6 +35,8 @@
 #include "gbwt_helper.hpp"
 #include "kmer.hpp"
 #include "source_sink_overlay.hpp"
+#include "gcsa_jump_table.hpp"
+#include "memusage.hpp"
 
 #include "io/save_handle_graph.hpp"
 
@@ -45,6 +56,7 @@ int IndexingParameters::pruning_max_edge_count = 3;
 int IndexingParameters::pruning_min_component_size = 33;
 int IndexingParameters::gcsa_initial_kmer_length = gcsa::Key::MAX_LENGTH;
 int IndexingParameters::gcsa_doubling_steps = gcsa::ConstructionParameters::DOUBLING_STEPS;
+int IndexingParameters::gcsa_jump_table_length = 10;
 bool IndexingParameters::verbose = false;
 
 IndexRegistry VGIndexes::get_vg_index_registry() {
@@ -73,6 +85,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
     registry.register_index("Pruned VG", "pruned.vg");
     registry.register_index("Haplotype-Pruned VG + NodeMapping", "haplopruned.vg");
     registry.register_index("GCSA + LCP", "gcsa");
+    registry.register_index("GCSA Jump Table", "gcsa.jmp");
     
     /*********************
      * A few handy lambda functions
@@ -649,6 +662,39 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         return construct_gcsa(inputs, prefix, suffix);
     });
     
+    ////////////////////////////////////
+    // GCSA Jump Table Recipes
+    ////////////////////////////////////
+    
+#ifdef debug_index_registry
+    cerr << "registering GCSA jump table recipes" << endl;
+#endif
+    
+    registry.register_recipe("GCSA Jump Table", {"GCSA + LCP"},
+                             [&](const vector<const IndexFile*>& inputs,
+                                 const string& prefix, const string& suffix) {
+        if (IndexingParameters::verbose) {
+            cerr << "[IndexRegistry]: Constructing GCSA jump table." << endl;
+        }
+        
+        assert(inputs.size() == 1);
+        assert(inputs.front()->get_filenames().size() == 2);
+        
+        ifstream infile_gcsa;
+        init_in(infile_gcsa, inputs.front()->get_filenames().front());
+        // the mappers look for the table next to the GCSA, so it has to go
+        // where the GCSA went, not at the prefix we were given
+        string output_name = inputs.front()->get_filenames().front() + ".jmp";
+        ofstream outfile_jump_table;
+        init_out(outfile_jump_table, output_name);
+        
+        unique_ptr<gcsa::GCSA> gcsa_index = vg::io::VPKG::load_one<gcsa::GCSA>(infile_gcsa);
+        GCSAJumpTable jump_table(*gcsa_index, IndexingParameters::gcsa_jump_table_length);
+        jump_table.serialize(outfile_jump_table);
+        
+        return vector<string>(1, output_name);
+    });
+    
     return registry;
 }
 
@@ -657,6 +703,9 @@ vector<string> VGIndexes::get_default_map_indexes() {
         "XG",
         "GCSA + LCP"
     };
+    if (IndexingParameters::gcsa_jump_table_length > 0) {
+        indexes.push_back("GCSA Jump Table");
+    }
     return indexes;
 }
 
@@ -702,24 +751,165 @@ void IndexRegistry::make_indexes(const vector<string>& identifiers) {
     // figure out the best plan to make the objectives from the inputs
     auto plan = make_plan(identifiers);
     
-    // execute the plan
-    for (auto& step : plan) {
-        
-        auto index = get_index(step.first);
-        
-        // note: recipes that are simply aliasing a more general file will sometimes
-        // ignore the prefix
-        string index_prefix;
-        if (keep_intermediates || !is_intermediate(index)) {
-            // we're saving this file, put it at the output prfix
-            index_prefix = output_prefix;
+    // find which steps of the plan each step has to wait for
+    unordered_map<string, size_t> plan_step;
+    for (size_t i = 0; i < plan.size(); ++i) {
+        plan_step[plan[i].first] = i;
+    }
+    vector<vector<size_t>> dependents(plan.size());
+    vector<size_t> num_waiting_on(plan.size(), 0);
+    for (size_t i = 0; i < plan.size(); ++i) {
+        for (auto input : get_index(plan[i].first)->get_recipes().at(plan[i].second).inputs) {
+            auto it = plan_step.find(input->get_identifier());
+            if (it != plan_step.end()) {
+                dependents[it->second].push_back(i);
+                ++num_waiting_on[i];
+            }
         }
-        else {
-            // we're not saving this file, make it
-            index_prefix = temp_file::get_dir() + "/" + sha1sum(index->get_identifier());
+    }
+    
+    size_t total_threads = omp_get_max_threads();
+    size_t max_memory = memory_limit;
+    if (max_memory == 0) {
+        max_memory = sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+    }
+    
+    // everything below is guarded by the mutex
+    mutex scheduler_mutex;
+    condition_variable scheduler_cond;
+    // steps whose inputs are finished, in plan order
+    vector<size_t> ready;
+    for (size_t i = 0; i < plan.size(); ++i) {
+        if (num_waiting_on[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+    size_t free_threads = total_threads;
+    size_t reserved_memory = 0;
+    size_t num_finished = 0;
+    // records for the steps that are running, by step
+    unordered_map<size_t, RecipeRun> running;
+    bool failed = false;
+    exception_ptr failure;
+    
+    recipe_runs.clear();
+    vector<thread> workers;
+    
+    // watch the memory use so we can tell what each recipe's peak was
+    bool done = false;
+    thread memory_monitor([&]() {
+        unique_lock<mutex> lock(scheduler_mutex);
+        while (!done) {
+            lock.unlock();
+            size_t rss_kb = get_current_rss_kb();
+            lock.lock();
+            for (auto& run : running) {
+                run.second.peak_rss_kb = max(run.second.peak_rss_kb, rss_kb);
+            }
+            scheduler_cond.wait_for(lock, chrono::milliseconds(100));
+        }
+    });
+    
+    unique_lock<mutex> lock(scheduler_mutex);
+    while (num_finished < plan.size() && !(failed && running.empty())) {
+        
+        // start as many ready steps as the threads and memory allow, in plan order
+        for (size_t i = 0; i < ready.size() && free_threads > 0 && !failed;) {
+            size_t step_idx = ready[i];
+            auto index = get_index(plan[step_idx].first);
+            size_t estimated_memory = index->estimate_memory(plan[step_idx].second);
+            // the estimates are lower bounds, so also count what the running
+            // recipes have really grown to
+            size_t used_memory = max(reserved_memory, get_current_rss_kb() * 1024);
+            if (!running.empty() && used_memory + estimated_memory > max_memory) {
+                // this one doesn't fit yet, but maybe a later one does
+                ++i;
+                continue;
+            }
+            ready.erase(ready.begin() + i);
+            
+            // split the free threads evenly with the other steps that could start now
+            size_t threads = max<size_t>(free_threads / (ready.size() + 1), 1);
+            free_threads -= threads;
+            reserved_memory += estimated_memory;
+            
+            RecipeRun& run = running[step_idx];
+            run.identifier = index->get_identifier();
+            run.threads = threads;
+            run.estimated_memory = estimated_memory;
+            
+            // note: recipes that are simply aliasing a more general file will sometimes
+            // ignore the prefix
+            string index_prefix;
+            if (keep_intermediates || !is_intermediate(index)) {
+                // we're saving this file, put it at the output prfix
+                index_prefix = output_prefix;
+            }
+            else {
+                // we're not saving this file, make it
+                index_prefix = temp_file::get_dir() + "/" + sha1sum(index->get_identifier());
+            }
+            
+#ifdef debug_index_registry
+            cerr << "starting recipe for " << index->get_identifier() << " with " << threads << " threads and " << estimated_memory << " bytes estimated memory" << endl;
+#endif
+            
+            workers.emplace_back([&, step_idx, index, index_prefix, threads, estimated_memory]() {
+                // the recipe's OMP parallel sections will use its share of the threads
+                omp_set_num_threads(threads);
+                auto start = chrono::steady_clock::now();
+                exception_ptr recipe_failure;
+                try {
+                    index->execute_recipe(plan[step_idx].second, index_prefix);
+                }
+                catch (...) {
+                    recipe_failure = current_exception();
+                }
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                size_t rss_kb = get_current_rss_kb();
+                
+                lock_guard<mutex> guard(scheduler_mutex);
+                RecipeRun& run = running.at(step_idx);
+                run.seconds = seconds;
+                run.peak_rss_kb = max(run.peak_rss_kb, rss_kb);
+                recipe_runs.push_back(run);
+                running.erase(step_idx);
+                free_threads += threads;
+                reserved_memory -= estimated_memory;
+                ++num_finished;
+                if (recipe_failure) {
+                    // stop starting new recipes, and report the first failure
+                    if (!failed) {
+                        failure = recipe_failure;
+                    }
+                    failed = true;
+                }
+                else {
+                    for (size_t dependent : dependents[step_idx]) {
+                        if (--num_waiting_on[dependent] == 0) {
+                            ready.push_back(dependent);
+                        }
+                    }
+                }
+                scheduler_cond.notify_all();
+            });
         }
         
-        index->execute_recipe(step.second, index_prefix);
+        if (num_finished < plan.size() && !(failed && running.empty())) {
+            scheduler_cond.wait(lock);
+        }
+    }
+    done = true;
+    scheduler_cond.notify_all();
+    lock.unlock();
+    
+    memory_monitor.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    if (failure) {
+        rethrow_exception(failure);
     }
     
     // clean up intermediate files
@@ -746,6 +936,30 @@ void IndexRegistry::make_indexes(const vector<string>& identifiers) {
     }
 }
 
+const vector<IndexRegistry::RecipeRun>& IndexRegistry::get_recipe_runs() const {
+    return recipe_runs;
+}
+
+void IndexRegistry::print_report(ostream& out) const {
+    size_t name_width = string("Index").size();
+    for (const auto& run : recipe_runs) {
+        name_width = max(name_width, run.identifier.size());
+    }
+    out << left << setw(name_width) << "Index" << right
+        << setw(9) << "Threads"
+        << setw(12) << "Est. MB"
+        << setw(12) << "Seconds"
+        << setw(14) << "Peak RSS MB" << endl;
+    for (const auto& run : recipe_runs) {
+        out << left << setw(name_width) << run.identifier << right
+            << setw(9) << run.threads
+            << setw(12) << run.estimated_memory / (1024 * 1024)
+            << setw(12) << fixed << setprecision(1) << run.seconds
+            << setw(14) << run.peak_rss_kb / 1024 << endl;
+    }
+    out << "Overall peak RSS: " << get_max_rss_kb() / 1024 << " MB" << endl;
+}
+
 void IndexRegistry::register_index(const string& identifier, const string& suffix) {
     // Add this index to the registry
     if (identifier.empty()) {
@@ -797,6 +1011,10 @@ void IndexRegistry::register_recipe(const string& identifier,
     get_index(identifier)->add_recipe(inputs, exec);
 }
 
+void IndexRegistry::set_memory_limit(size_t bytes) {
+    memory_limit = bytes;
+}
+
 IndexFile* IndexRegistry::get_index(const string& identifier) {
     return registry.at(identifier).get();
 }
@@ -1214,6 +1432,22 @@ void IndexFile::execute_recipe(size_t recipe_priority, const string& prefix) {
     filenames = recipe.execute(prefix, this->suffix);
 }
 
+size_t IndexFile::estimate_memory(size_t recipe_priority) const {
+    // Every recipe loads its inputs, and the serialized indexes load at about
+    // their size on disk, so this is a lower bound that needs no per-index
+    // guesswork. make_indexes() makes up the rest from the measured RSS.
+    size_t input_bytes = 0;
+    for (auto input : recipes.at(recipe_priority).inputs) {
+        for (const auto& filename : input->get_filenames()) {
+            struct stat file_stat;
+            if (stat(filename.c_str(), &file_stat) == 0) {
+                input_bytes += file_stat.st_size;
+            }
+        }
+    }
+    return input_bytes;
+}
+
 void IndexFile::add_recipe(const vector<const IndexFile*>& inputs,
                            const function<vector<string>(const vector<const IndexFile*>&,const string&,const string&)>& exec) {
     recipes.emplace_back(inputs, exec);
@@ -1,6 +1,7 @@
 #ifndef VG_INDEX_REGISTRY_HPP_INCLUDED
 #define VG_INDEX_REGISTRY_HPP_INCLUDED
 
+#include <iostream>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -45,6 +46,8 @@ struct IndexingParameters {
     static int gcsa_initial_kmer_length;
     // number of k-mer length doubling steps in GCSA2 [4]
     static int gcsa_doubling_steps;
+    // longest k-mers to precompute GCSA2 ranges for in a jump table next to the GCSA2, or 0 for none [10]
+    static int gcsa_jump_table_length;
     // whether indexing algorithms will log progress (if available) [false]
     static bool verbose;
 };
@@ -88,6 +91,12 @@ public:
                          const vector<string>& input_identifiers,
                          const function<vector<string>(const vector<const IndexFile*>&,const string&,const string&)>& exec);
     
+    /// Limit the memory of recipes that run at the same time. A recipe only
+    /// starts alongside others if its estimate plus the larger of the running
+    /// recipes' estimates and the current RSS fits. A recipe always runs if
+    /// nothing else is running. 0 means use the size of physical memory.
+    void set_memory_limit(size_t bytes);
+    
     /// Indicate a serialized file that contains some identified index
     void provide(const string& identifier, const string& filename);
     
@@ -99,9 +108,33 @@ public:
     
     /// Create and execute a plan to make the indicated indexes using provided inputs
     /// If provided inputs cannot create the desired indexes, throws a
-    /// InsufficientInputException.
+    /// InsufficientInputException. Recipes that don't depend on each other run
+    /// at the same time, splitting the OMP threads between them.
     void make_indexes(const vector<string>& identifiers);
     
+    /// Record of one recipe executed by make_indexes()
+    struct RecipeRun {
+        /// The index that was made
+        string identifier;
+        /// Threads the recipe was given
+        size_t threads = 0;
+        /// Memory the recipe was expected to use, in bytes
+        size_t estimated_memory = 0;
+        /// Wall clock time the recipe took
+        double seconds = 0;
+        /// Peak RSS of the whole process while the recipe was running, in kb,
+        /// which includes any recipes running at the same time
+        size_t peak_rss_kb = 0;
+    };
+    
+    /// Get the recipes executed by the last call to make_indexes(), in the
+    /// order they finished
+    const vector<RecipeRun>& get_recipe_runs() const;
+    
+    /// Write a table of the time and memory used by each recipe in the last
+    /// call to make_indexes()
+    void print_report(ostream& out) const;
+    
     /// Returns the recipe graph in dot format
     string to_dot() const;
     
@@ -132,6 +165,12 @@ protected:
     
     /// should intermediate files end up in the scratch or the output directory?
     bool keep_intermediates = false;
+    
+    /// limit on the memory of concurrent recipes, or 0 for physical memory
+    size_t memory_limit = 0;
+    
+    /// the recipes run by the last call to make_indexes()
+    vector<RecipeRun> recipe_runs;
 };
 
 /**
@@ -167,6 +206,10 @@ public:
     /// Build the index using the recipe with the provided priority
     void execute_recipe(size_t recipe_priority, const string& prefix);
     
+    /// Estimate the bytes of memory that the recipe with the provided priority
+    /// will use, as the total size on disk of its input files
+    size_t estimate_memory(size_t recipe_priority) const;
+    
     /// Returns true if the index was provided through provide method
     bool was_provided_directly() const;
     
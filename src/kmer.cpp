@@ -224,51 +224,285 @@ gcsa::byte_type encode_chars(const vector<char>& chars, const gcsa::Alphabet& al
     return val;
 }
 
-void write_gcsa_kmers(const HandleGraph& graph, int kmer_size, ostream& out, size_t& size_limit, id_t head_id, id_t tail_id) {
+namespace {
+
+/// Reused storage for one thread's KMer enumeration.
+struct GCSAKmerScratch {
+    /// KMers waiting to be handed off
+    vector<gcsa::KMer> kmers;
+    /// Sequence of the kmer being emitted
+    string label;
+    /// Sequence past the end of the start node along the current walk
+    string continuation;
+    /// Positions and bases following the kmer being emitted
+    vector<pair<pos_t, char>> nexts;
+};
+
+/// Context for the kmers starting at one position of the start node.
+struct GCSAKmerStart {
+    /// Predecessor characters, as a GCSA2 byte
+    gcsa::byte_type predecessors = 0;
+    /// Number of predecessor positions
+    size_t predecessor_count = 0;
+    /// ID of the last predecessor position seen
+    id_t predecessor_id = 0;
+};
+
+/**
+ * Walks out from each oriented node, depth-first, and makes the same KMers as
+ * for_each_kmer() and kmer_to_gcsa_kmers() would, with all the kmers starting
+ * on a node sharing the same walks out of it.
+ */
+class GCSAKmerEnumerator {
+public:
+    GCSAKmerEnumerator(const HandleGraph& graph, size_t k, size_t buffer_size,
+                       const function<void(vector<gcsa::KMer>&)>& lambda,
+                       id_t head_id, id_t tail_id) :
+        graph(graph), k(k), buffer_size(buffer_size), lambda(lambda),
+        head_id(head_id), tail_id(tail_id), using_head_tail(head_id + tail_id > 0) {
+        // Nothing to do
+    }
+
+    /// Make all the KMers starting on the given oriented node.
+    void enumerate(const handle_t& handle, GCSAKmerScratch& scratch) {
+        string seq = graph.get_sequence(handle);
+        if (seq.empty()) {
+            return;
+        }
+        id_t handle_id = graph.get_id(handle);
+        bool handle_is_rev = graph.get_is_reverse(handle);
+
+        // Find what comes before the start of the node
+        GCSAKmerStart first;
+        graph.follow_edges(handle, true, [&](const handle_t& prev) {
+            first.predecessors |= char_bit(graph.get_base(prev, graph.get_length(prev) - 1));
+            first.predecessor_count++;
+            first.predecessor_id = graph.get_id(prev);
+        });
+        if (first.predecessor_count == 0 && using_head_tail) {
+            // On the forward head or reverse tail, point to the end of the opposite node
+            if (handle_id == head_id) {
+                first.predecessors = char_bit(graph.get_base(graph.get_handle(tail_id, false), 0));
+                first.predecessor_count = 1;
+                first.predecessor_id = tail_id;
+            } else if (handle_id == tail_id) {
+                first.predecessors = char_bit(graph.get_base(graph.get_handle(head_id, true), 0));
+                first.predecessor_count = 1;
+                first.predecessor_id = head_id;
+            }
+        }
+
+        // Kmers that fit on the node
+        for (size_t i = 0; i + k <= seq.size(); i++) {
+            scratch.label.assign(seq, i, k);
+            emit(scratch, make_pos_t(handle_id, handle_is_rev, i), start_at(seq, i, first, handle_id),
+                 handle, i + k);
+        }
+
+        // Kmers that run off the end
+        if (k > 1) {
+            scratch.continuation.clear();
+            graph.follow_edges(handle, false, [&](const handle_t& next) {
+                extend(scratch, handle, seq, first, next, 0);
+            });
+        }
+    }
+
+protected:
+
+    /// Get the predecessor context of the given offset on the start node.
+    GCSAKmerStart start_at(const string& seq, size_t i, const GCSAKmerStart& first, id_t handle_id) const {
+        if (i == 0) {
+            return first;
+        }
+        GCSAKmerStart start;
+        start.predecessors = char_bit(seq[i - 1]);
+        start.predecessor_count = 1;
+        start.predecessor_id = handle_id;
+        return start;
+    }
+
+    /// Emit all the kmers starting on start and ending on node, where beyond
+    /// bases past the end of start have already been walked, and then walk on.
+    void extend(GCSAKmerScratch& scratch, const handle_t& start, const string& seq,
+                const GCSAKmerStart& first, const handle_t& node, size_t beyond) {
+        size_t node_length = graph.get_length(node);
+        // Every kmer needs at least one base on the start node
+        size_t usable = min(node_length, k - 1 - beyond);
+        for (size_t taken = 1; taken <= usable; taken++) {
+            scratch.continuation.push_back(graph.get_base(node, taken - 1));
+            size_t from_start = k - beyond - taken;
+            if (from_start <= seq.size()) {
+                size_t i = seq.size() - from_start;
+                scratch.label.assign(seq, i, from_start);
+                scratch.label.append(scratch.continuation, 0, beyond + taken);
+                emit(scratch, make_pos_t(graph.get_id(start), graph.get_is_reverse(start), i),
+                     start_at(seq, i, first, graph.get_id(start)), node, taken);
+            }
+        }
+        if (beyond + node_length < k - 1) {
+            // There is still room for kmers to start on the start node and
+            // reach past this one.
+            graph.follow_edges(node, false, [&](const handle_t& next) {
+                extend(scratch, start, seq, first, next, beyond + node_length);
+            });
+        }
+        scratch.continuation.resize(beyond);
+    }
+
+    /// Emit the KMers for the kmer in scratch.label, with the given start
+    /// context, that ends just before the given offset on end.
+    void emit(GCSAKmerScratch& scratch, pos_t begin, const GCSAKmerStart& start,
+              const handle_t& end, size_t end_offset) {
+
+        // Establish what comes next
+        auto& nexts = scratch.nexts;
+        nexts.clear();
+        if (end_offset < graph.get_length(end)) {
+            // On node
+            nexts.emplace_back(make_pos_t(graph.get_id(end), graph.get_is_reverse(end), end_offset),
+                               graph.get_base(end, end_offset));
+        } else {
+            graph.follow_edges(end, false, [&](const handle_t& next) {
+                nexts.emplace_back(make_pos_t(graph.get_id(next), graph.get_is_reverse(next), 0),
+                                   graph.get_base(next, 0));
+            });
+            if (nexts.empty() && using_head_tail) {
+                if (id(begin) == head_id) {
+                    nexts.emplace_back(make_pos_t(tail_id, true, 0),
+                                       graph.get_base(graph.get_handle(tail_id, true), 0));
+                } else if (id(begin) == tail_id) {
+                    nexts.emplace_back(make_pos_t(head_id, false, 0),
+                                       graph.get_base(graph.get_handle(head_id, false), 0));
+                }
+            }
+        }
+        assert(!nexts.empty());
+
+        gcsa::byte_type successors = 0;
+        for (auto& next : nexts) {
+            successors |= char_bit(next.second);
+        }
+
+        if (using_head_tail) {
+            // Flip the reverse head and tail to the other node
+            flip_head_tail(begin);
+            for (auto& next : nexts) {
+                flip_head_tail(next.first);
+            }
+            if (start.predecessor_count == 1 && nexts.size() == 1 && offset(begin) == 0
+                && is_head_or_tail(id(begin)) && is_head_or_tail(start.predecessor_id)
+                && is_head_or_tail(id(nexts.front().first))) {
+                // This runs from a head/tail node to a head/tail node, so skip it
+                return;
+            }
+        }
 
-    // We need an alphabet to parse the internal string format
+        if (offset(begin) >= 1024) {
+#pragma omp critical (error)
+            {
+                cerr << "Found kmer with offset >= 1024. GCSA2 cannot handle nodes greater than 1024 bases long. "
+                     << "To enable indexing, modify your graph using `vg mod -X 256 x.vg >y.vg`. "
+                     << scratch.label << "\t" << id(begin) << ":" << (is_rev(begin) ? "-":"") << offset(begin) << endl;
+                exit(1);
+            }
+        }
+
+        gcsa::KMer kmer;
+        kmer.key = gcsa::Key::encode(alpha, scratch.label, start.predecessors, successors);
+        kmer.from = gcsa::Node::encode(id(begin), offset(begin), is_rev(begin));
+        for (auto& next : nexts) {
+            kmer.to = gcsa::Node::encode(id(next.first), offset(next.first), is_rev(next.first));
+            scratch.kmers.push_back(kmer);
+        }
+
+        if (scratch.kmers.size() > buffer_size) {
+            lambda(scratch.kmers);
+            scratch.kmers.clear();
+        }
+    }
+
+    /// Get the GCSA2 predecessor/successor bit for a character.
+    inline gcsa::byte_type char_bit(char c) const {
+        return 1 << alpha.char2comp[(unsigned char) c];
+    }
+
+    inline bool is_head_or_tail(id_t node_id) const {
+        return node_id == head_id || node_id == tail_id;
+    }
+
+    /// Replace a reverse head or tail position with the start of the other one.
+    inline void flip_head_tail(pos_t& pos) const {
+        if (id(pos) == head_id && is_rev(pos)) {
+            get_id(pos) = tail_id;
+            get_is_rev(pos) = false;
+        } else if (id(pos) == tail_id && is_rev(pos)) {
+            get_id(pos) = head_id;
+            get_is_rev(pos) = false;
+        }
+    }
+
+    const HandleGraph& graph;
+    size_t k;
+    size_t buffer_size;
+    const function<void(vector<gcsa::KMer>&)>& lambda;
+    id_t head_id;
+    id_t tail_id;
+    bool using_head_tail;
     const gcsa::Alphabet alpha;
-    // Each thread is going to make its own KMers, then we'll concatenate these all together at the end.
-    vector<vector<gcsa::KMer> > thread_outputs;
-#pragma omp parallel
-    {
-#pragma omp single
-        {
-            // Set up our write buffers at the given parallelism we expect
-            thread_outputs.resize(omp_get_num_threads());
+};
+
+}
+
+void for_each_gcsa_kmer_batch(const HandleGraph& graph, size_t k, size_t buffer_size,
+                              const function<void(vector<gcsa::KMer>&)>& lambda,
+                              id_t head_id, id_t tail_id) {
+
+    GCSAKmerEnumerator enumerator(graph, k, buffer_size, lambda, head_id, tail_id);
+    vector<GCSAKmerScratch> thread_scratch(omp_get_max_threads());
+    for (auto& scratch : thread_scratch) {
+        scratch.label.reserve(k);
+        scratch.continuation.reserve(k);
+    }
+
+    graph.for_each_handle([&](const handle_t& h) {
+        auto& scratch = thread_scratch.at(omp_get_thread_num());
+        enumerator.enumerate(h, scratch);
+        enumerator.enumerate(graph.flip(h), scratch);
+    }, true);
+
+    for (auto& scratch : thread_scratch) {
+        // Hand off the leftovers
+        if (!scratch.kmers.empty()) {
+            lambda(scratch.kmers);
+            scratch.kmers.clear();
         }
     }
+}
+
+void write_gcsa_kmers(const HandleGraph& graph, int kmer_size, ostream& out, size_t& size_limit, id_t head_id, id_t tail_id) {
+
     // This handles the buffered writing for each thread
     size_t buffer_limit = 1e5; // max 100k kmers per buffer
     size_t total_bytes = 0;
-    auto handle_kmers = [&](vector<gcsa::KMer>& kmers, bool more) {
-        if (!more || kmers.size() > buffer_limit) {
-            size_t bytes_required = kmers.size() * sizeof(gcsa::KMer) + sizeof(gcsa::GraphFileHeader);
+    auto handle_kmers = [&](vector<gcsa::KMer>& kmers) {
+        size_t bytes_required = kmers.size() * sizeof(gcsa::KMer) + sizeof(gcsa::GraphFileHeader);
 #pragma omp critical (gcsa_kmer_out)
-            {
-                if (total_bytes + bytes_required > size_limit) {
-                    cerr << "error: [write_gcsa_kmers()] size limit exceeded" << endl;
-                    exit(EXIT_FAILURE);
-                }
-                gcsa::writeBinary(out, kmers, kmer_size);
-                total_bytes += bytes_required;
+        {
+            if (total_bytes + bytes_required > size_limit) {
+                cerr << "error: [write_gcsa_kmers()] size limit exceeded" << endl;
+                exit(EXIT_FAILURE);
             }
-            kmers.clear();
+            gcsa::writeBinary(out, kmers, kmer_size);
+            total_bytes += bytes_required;
         }
     };
-    // Here we convert our kmer_t to gcsa::KMer
-    auto convert_kmer = [&thread_outputs, &alpha, &head_id, &tail_id, &handle_kmers](const kmer_t& kmer) {
-        // Convert this KmerPosition to several gcsa::KMers, and save them in thread_outputs
-        vector<gcsa::KMer>& thread_output = thread_outputs[omp_get_thread_num()];
-        kmer_to_gcsa_kmers(kmer, alpha, [&thread_output](const gcsa::KMer& k) { thread_output.push_back(k); });
-        // Handle kmer buffered writes, indicating we're not yet done
-        handle_kmers(thread_output, true);
-    };
-    // Run on each KmerPosition. This populates start_end_id, if it was 0, before calling convert_kmer.
-    for_each_kmer(graph, kmer_size, convert_kmer, head_id, tail_id);
-    for(auto& thread_output : thread_outputs) {
-        // Flush our buffers
-        handle_kmers(thread_output, false);
+    // Each thread makes its own KMers directly, and writes them out when its buffer fills
+    for_each_gcsa_kmer_batch(graph, kmer_size, buffer_limit, handle_kmers, head_id, tail_id);
+    if (total_bytes == 0) {
+        // Still write a header, so GCSA2 sees a valid (empty) file
+        vector<gcsa::KMer> empty;
+        handle_kmers(empty);
     }
     size_limit = total_bytes;
 }
@@ -54,6 +54,18 @@ void kmer_to_gcsa_kmers(const kmer_t& kmer, const gcsa::Alphabet& alpha, const f
 /// Encode the chars into the gcsa2 byte
 gcsa::byte_type encode_chars(const vector<char>& chars, const gcsa::Alphabet& alpha);
 
+/**
+ * Iterate over the GCSA2 binary KMers for all the kmers in the graph, exactly
+ * as kmer_to_gcsa_kmers() would make them from for_each_kmer(), but without
+ * building a kmer_t for each one. Each thread fills its own reused buffer, and
+ * passes it to lambda once it holds more than buffer_size KMers. The lambda
+ * may be called from several threads at once, and the buffer is cleared after
+ * it returns. Leftover KMers are passed at the end from the calling thread.
+ */
+void for_each_gcsa_kmer_batch(const HandleGraph& graph, size_t k, size_t buffer_size,
+                              const function<void(vector<gcsa::KMer>&)>& lambda,
+                              id_t head_id = 0, id_t tail_id = 0);
+
 /**
  * Write GCSA2 formatted binary KMers to the given ostream.
  * size_limit is the maximum size of the kmer file in bytes. When the function
@@ -0,0 +1,148 @@
+#include "mappable_int_vector.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+/**
+ * \file mappable_int_vector.cpp: implementations of MappableIntVector and
+ * MappableBitVector
+ */
+
+namespace vg {
+
+using namespace std;
+
+MappableIntVector& MappableIntVector::operator=(sdsl::int_vector<>&& other) {
+    owned = std::move(other);
+    words = nullptr;
+    return *this;
+}
+
+size_t MappableIntVector::size() const {
+    return words == nullptr ? owned.size() : length;
+}
+
+uint8_t MappableIntVector::width() const {
+    return words == nullptr ? owned.width() : bit_width;
+}
+
+void MappableIntVector::resize(size_t size) {
+    words = nullptr;
+    owned.resize(size);
+}
+
+void MappableIntVector::set_to_value(uint64_t value) {
+    sdsl::util::set_to_value(owned, value);
+}
+
+void MappableIntVector::bit_compress() {
+    sdsl::util::bit_compress(owned);
+}
+
+void MappableIntVector::load_sdsl(istream& in) {
+    words = nullptr;
+    owned.load(in);
+}
+
+void MappableIntVector::serialize(ostream& out) const {
+    size_t count = size();
+    uint64_t element_width = width();
+    sdsl::write_member((uint64_t) count, out);
+    sdsl::write_member(element_width, out);
+    size_t word_count = (count * element_width + 63) / 64;
+    const uint64_t* data = words == nullptr ? owned.data() : words;
+    out.write((const char*) data, word_count * sizeof(uint64_t));
+}
+
+void MappableIntVector::map(const uint64_t*& cursor, const uint64_t* end) {
+    length = map_word(cursor, end);
+    uint64_t element_width = map_word(cursor, end);
+    if (element_width > 64 || (element_width == 0 && length != 0)) {
+        throw runtime_error("Distance index file has an invalid vector width");
+    }
+    size_t word_count = (length * element_width + 63) / 64;
+    if (word_count > (size_t) (end - cursor)) {
+        throw runtime_error("Distance index file is truncated");
+    }
+    bit_width = element_width;
+    words = cursor;
+    cursor += word_count;
+    // Don't hold on to any storage of our own
+    sdsl::util::clear(owned);
+}
+
+uint64_t MappableIntVector::map_word(const uint64_t*& cursor, const uint64_t* end) {
+    if (cursor >= end) {
+        throw runtime_error("Distance index file is truncated");
+    }
+    return *(cursor++);
+}
+
+void MappableBitVector::set(size_t i, bool value) {
+    owned[i] = value;
+}
+
+size_t MappableBitVector::size() const {
+    return words == nullptr ? owned.size() : length;
+}
+
+void MappableBitVector::resize(size_t size) {
+    words = nullptr;
+    owned.resize(size);
+}
+
+void MappableBitVector::set_to_value(bool value) {
+    sdsl::util::set_to_value(owned, value);
+}
+
+void MappableBitVector::init_rank() {
+    sdsl::util::assign(owned_rank, sdsl::rank_support_v<1>(&owned));
+}
+
+void MappableBitVector::load_sdsl(istream& in) {
+    words = nullptr;
+    owned.load(in);
+    // The serialized rank support is rebuilt rather than trusted
+    owned_rank.load(in);
+    init_rank();
+}
+
+void MappableBitVector::serialize(ostream& out) const {
+    size_t count = size();
+    sdsl::write_member((uint64_t) count, out);
+
+    size_t word_count = (count + 63) / 64;
+    const uint64_t* data = words == nullptr ? owned.data() : words;
+    vector<uint64_t> ranks;
+    ranks.reserve(word_count / (RANK_BLOCK_BITS / 64) + 2);
+    uint64_t total = 0;
+    for (size_t w = 0; w < word_count; w++) {
+        if (w % (RANK_BLOCK_BITS / 64) == 0) {
+            ranks.push_back(total);
+        }
+        uint64_t word = data[w];
+        if (w + 1 == word_count && count % 64 != 0) {
+            // Don't count or write anything past the end
+            word &= (uint64_t(1) << (count % 64)) - 1;
+        }
+        total += __builtin_popcountll(word);
+        sdsl::write_member(word, out);
+    }
+    ranks.push_back(total);
+    out.write((const char*) ranks.data(), ranks.size() * sizeof(uint64_t));
+}
+
+void MappableBitVector::map(const uint64_t*& cursor, const uint64_t* end) {
+    length = MappableIntVector::map_word(cursor, end);
+    size_t word_count = (length + 63) / 64;
+    size_t rank_count = (length + RANK_BLOCK_BITS - 1) / RANK_BLOCK_BITS + 1;
+    if (word_count + rank_count > (size_t) (end - cursor)) {
+        throw runtime_error("Distance index file is truncated");
+    }
+    words = cursor;
+    block_ranks = cursor + word_count;
+    cursor += word_count + rank_count;
+    sdsl::util::clear(owned);
+}
+
+}
@@ -0,0 +1,224 @@
+#ifndef VG_MAPPABLE_INT_VECTOR_HPP_INCLUDED
+#define VG_MAPPABLE_INT_VECTOR_HPP_INCLUDED
+
+#include <sdsl/int_vector.hpp>
+#include <sdsl/rank_support_v.hpp>
+
+#include <cstdint>
+#include <iostream>
+
+/**
+ * \file mappable_int_vector.hpp
+ *
+ * Bit-packed vectors that can be queried in place from a memory-mapped file.
+ */
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A bit-packed integer vector, packed the same way as an sdsl::int_vector<>.
+ *
+ * While it is being built it owns an sdsl::int_vector<>, and can be resized
+ * and written to like one. It can also be pointed at its own serialized form
+ * somewhere in memory, such as a memory-mapped file, and read from there
+ * without copying anything. A vector pointed at memory that way is read-only.
+ *
+ * The serialized form is a sequence of 64-bit words: the length, the width
+ * in bits, and then the packed data.
+ */
+class MappableIntVector {
+public:
+
+    /// Proxy for an element of a vector that owns its storage, so that
+    /// elements can be assigned to the way they can in an sdsl::int_vector<>.
+    class reference {
+    public:
+        operator uint64_t() const {
+            return static_cast<const MappableIntVector&>(parent)[index];
+        }
+        reference& operator=(uint64_t value) {
+            parent.owned[index] = value;
+            return *this;
+        }
+        reference& operator=(const reference& other) {
+            return *this = (uint64_t) other;
+        }
+    private:
+        reference(MappableIntVector& parent, size_t index) : parent(parent), index(index) {}
+        MappableIntVector& parent;
+        size_t index;
+
+        friend class MappableIntVector;
+    };
+
+    /// Make an empty vector that owns its storage.
+    MappableIntVector() = default;
+
+    /// Take over the contents of the given sdsl::int_vector<>.
+    MappableIntVector& operator=(sdsl::int_vector<>&& other);
+
+    /// Get the value at the given index.
+    inline uint64_t operator[](size_t i) const;
+
+    /// Get a writable reference to the value at the given index. The vector
+    /// must own its storage to be written to.
+    reference operator[](size_t i) {
+        return reference(*this, i);
+    }
+
+    /// Get the number of elements.
+    size_t size() const;
+
+    /// Get the width of each element in bits.
+    uint8_t width() const;
+
+    /// Change the number of elements. The vector will own its storage.
+    void resize(size_t size);
+
+    /// Set every element to the given value.
+    void set_to_value(uint64_t value);
+
+    /// Make the elements as narrow as they can be while still holding the
+    /// largest value.
+    void bit_compress();
+
+    /// Load an sdsl::int_vector<> in sdsl's own format, as written by older
+    /// versions of the distance index. The vector will own its storage.
+    void load_sdsl(istream& in);
+
+    /// Write the vector out in its mappable form.
+    void serialize(ostream& out) const;
+
+    /// Point the vector at its mappable form, starting at cursor, and advance
+    /// cursor past it. The memory must stay valid for as long as the vector
+    /// is used. Throws runtime_error if the vector would run past end.
+    void map(const uint64_t*& cursor, const uint64_t* end);
+
+    /// Read one 64-bit word of mappable data from cursor, and advance cursor
+    /// past it. Throws runtime_error if cursor is already at end.
+    static uint64_t map_word(const uint64_t*& cursor, const uint64_t* end);
+
+protected:
+
+    /// The storage, if we own it
+    sdsl::int_vector<> owned;
+
+    /// The packed data we point to instead, or null if we own our storage
+    const uint64_t* words = nullptr;
+    /// Number of elements in the data we point to
+    size_t length = 0;
+    /// Width of the elements in the data we point to
+    uint8_t bit_width = 0;
+};
+
+/**
+ * A bit vector with rank support that can be queried in place from a
+ * memory-mapped file, the way a MappableIntVector can.
+ *
+ * The serialized form is a sequence of 64-bit words: the length, the packed
+ * bits, and then the number of set bits before each block of 512 bits plus a
+ * final total.
+ */
+class MappableBitVector {
+public:
+
+    /// Make an empty vector that owns its storage.
+    MappableBitVector() = default;
+
+    // The rank support points into the vector, so it can't be copied.
+    MappableBitVector(const MappableBitVector& other) = delete;
+    MappableBitVector& operator=(const MappableBitVector& other) = delete;
+
+    /// Get the bit at the given index.
+    inline bool operator[](size_t i) const;
+
+    /// Set the bit at the given index. The vector must own its storage.
+    void set(size_t i, bool value = true);
+
+    /// Get the number of bits.
+    size_t size() const;
+
+    /// Change the number of bits. The vector will own its storage.
+    void resize(size_t size);
+
+    /// Set every bit to the given value.
+    void set_to_value(bool value);
+
+    /// Build rank support for a vector that owns its storage. Must be called
+    /// after the bits are set and before rank() is used.
+    void init_rank();
+
+    /// Get the number of set bits before the given index.
+    inline size_t rank(size_t i) const;
+
+    /// Load an sdsl::bit_vector and its sdsl::rank_support_v<1> in sdsl's own
+    /// format, as written by older versions of the distance index.
+    void load_sdsl(istream& in);
+
+    /// Write the vector out in its mappable form.
+    void serialize(ostream& out) const;
+
+    /// Point the vector at its mappable form, starting at cursor, and advance
+    /// cursor past it. The memory must stay valid for as long as the vector
+    /// is used. Throws runtime_error if the vector would run past end.
+    void map(const uint64_t*& cursor, const uint64_t* end);
+
+protected:
+
+    /// Number of bits covered by each stored rank
+    static const size_t RANK_BLOCK_BITS = 512;
+
+    /// The storage, if we own it
+    sdsl::bit_vector owned;
+    sdsl::rank_support_v<1> owned_rank;
+
+    /// The packed bits we point to instead, or null if we own our storage
+    const uint64_t* words = nullptr;
+    /// Number of set bits before each block of the bits we point to
+    const uint64_t* block_ranks = nullptr;
+    /// Number of bits we point to
+    size_t length = 0;
+};
+
+inline uint64_t MappableIntVector::operator[](size_t i) const {
+    if (words == nullptr) {
+        return owned[i];
+    }
+    size_t bit = i * bit_width;
+    size_t offset = bit & 63;
+    const uint64_t* word = words + (bit >> 6);
+    uint64_t value = *word >> offset;
+    if (offset + bit_width > 64) {
+        // The value continues into the next word
+        value |= *(word + 1) << (64 - offset);
+    }
+    return bit_width == 64 ? value : value & ((uint64_t(1) << bit_width) - 1);
+}
+
+inline bool MappableBitVector::operator[](size_t i) const {
+    if (words == nullptr) {
+        return owned[i];
+    }
+    return (words[i >> 6] >> (i & 63)) & 1;
+}
+
+inline size_t MappableBitVector::rank(size_t i) const {
+    if (words == nullptr) {
+        return owned_rank.rank(i);
+    }
+    size_t block = i / RANK_BLOCK_BITS;
+    size_t result = block_ranks[block];
+    for (size_t w = block * (RANK_BLOCK_BITS / 64); w < (i >> 6); w++) {
+        result += __builtin_popcountll(words[w]);
+    }
+    if (i & 63) {
+        result += __builtin_popcountll(words[i >> 6] & ((uint64_t(1) << (i & 63)) - 1));
+    }
+    return result;
+}
+
+}
+
+#endif
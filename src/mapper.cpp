@@ -70,6 +70,48 @@ BaseMapper::BaseMapper(void) : BaseMapper(nullptr, nullptr, nullptr) {
     // Nothing to do. Default constructed and can't really do anything.
 }
 
+bool BaseMapper::jump_to_longest_suffix(string::const_iterator seq_begin,
+                                        string::const_iterator& cursor,
+                                        MaximalExactMatch& match,
+                                        int max_mem_length,
+                                        int* max_lcp) const {
+    
+    if (!gcsa_jump_table || match.end != cursor + 1
+        || match.range != gcsa::range_type(0, gcsa->size() - 1)) {
+        // we can only jump at the start of a search
+        return false;
+    }
+    
+    // don't jump past anywhere that stepping would have stopped
+    size_t max_jump = gcsa->order();
+    if (max_mem_length) {
+        max_jump = min(max_jump, (size_t) max_mem_length);
+    }
+    
+    gcsa::range_type range;
+    size_t jump = gcsa_jump_table->longest_suffix(seq_begin, match.end, max_jump, range);
+    if (jump == 0) {
+        return false;
+    }
+    
+    if (max_lcp) {
+        // stepping checks the parent of the range after each step, and every
+        // suffix we skipped over is in the table. the range of a string of
+        // length l has a parent with LCP below l, so the shorter suffixes stop
+        // mattering once we have an LCP of at least l - 1
+        for (size_t length = jump; length > (size_t) *max_lcp + 1; length--) {
+            gcsa::range_type skipped = gcsa_jump_table->suffix_range(match.end, length);
+            *max_lcp = max(*max_lcp, (int) lcp->parent(skipped).lcp());
+        }
+    }
+    
+    // leave everything as it would be after jump successful LF steps
+    match.range = range;
+    match.begin = match.end - jump;
+    cursor = match.begin - 1;
+    return true;
+}
+
 // Use the GCSA2 index to find super-maximal exact matches.
 vector<MaximalExactMatch>
 BaseMapper::find_mems_simple(string::const_iterator seq_begin,
@@ -114,6 +156,10 @@ BaseMapper::find_mems_simple(string::const_iterator seq_begin,
     gcsa::range_type last_range = match.range;
     --cursor; // start off looking at the last character in the query
     while (cursor >= seq_begin) {
+        if (jump_to_longest_suffix(seq_begin, cursor, match, max_mem_length)) {
+            // we took several steps of LF mapping at once
+            continue;
+        }
         // hold onto our previous range
         last_range = match.range;
         // execute one step of LF mapping
@@ -1017,6 +1063,14 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
             continue;
         }
         
+        if (jump_to_longest_suffix(seq_begin, cursor, match, max_mem_length,
+                                   record_max_lcp ? &max_lcp : nullptr)) {
+            // we took several steps of LF mapping at once
+            prev_iter_jumped_lcp = false;
+            mem_length += match.length();
+            continue;
+        }
+        
         // hold onto our previous range
         last_range = match.range;
         
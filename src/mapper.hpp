@@ -19,6 +19,7 @@
 #include "entropy.hpp"
 #include "aligner.hpp"
 #include "mem.hpp"
+#include "gcsa_jump_table.hpp"
 #include "cluster.hpp"
 #include "graph.hpp"
 #include "translator.hpp"
@@ -243,6 +244,17 @@ public:
                      int min_mem_length = 1,
                      int reseed_length = 0);
     
+    // If the MEM search is at a fresh start (full range, nothing matched yet) and
+    // we have a jump table, take as many LF steps as will all succeed at once,
+    // moving the cursor and filling in the match's beginning and range. If
+    // max_lcp is given, it is raised to the largest parent LCP of the ranges
+    // we jumped through, as stepping would have done. Returns true if we jumped.
+    bool jump_to_longest_suffix(string::const_iterator seq_begin,
+                                string::const_iterator& cursor,
+                                MaximalExactMatch& match,
+                                int max_mem_length,
+                                int* max_lcp = nullptr) const;
+    
     vector<MaximalExactMatch>
     find_stripped_matches(string::const_iterator seq_begin,
                           string::const_iterator seq_end,
@@ -373,6 +385,10 @@ public:
     gcsa::GCSA* gcsa = nullptr;
     gcsa::LCPArray* lcp = nullptr;
     
+    // Optional table of GCSA ranges for short k-mers, used to skip the first
+    // LF steps of each MEM search. Must have been built from gcsa.
+    const GCSAJumpTable* gcsa_jump_table = nullptr;
+    
     // Haplotype score provider, if any, for determining haplotype concordance
     haplo::ScoreProvider* haplo_score_provider = nullptr;
     
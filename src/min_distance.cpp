@@ -4,6 +4,8 @@
 
 #include "min_distance.hpp"
 
+#include <vg/io/vpkg.hpp>
+
 using namespace std;
 namespace vg {
 
@@ -28,32 +30,32 @@ MinimumDistanceIndex::MinimumDistanceIndex(const HandleGraph* graph,
     max_node_id = graph->max_node_id();
 
     node_to_component.resize(max_node_id - min_node_id + 1);
-    sdsl::util::set_to_value(node_to_component, 0);
+    node_to_component.set_to_value(0);
 
     component_to_chain_index.resize(24);
-    sdsl::util::set_to_value(component_to_chain_index, 0);
+    component_to_chain_index.set_to_value(0);
 
     component_to_chain_length.resize(24);
-    sdsl::util::set_to_value(component_to_chain_length, 0);
+    component_to_chain_length.set_to_value(0);
 
     primary_snarl_assignments.resize(max_node_id - min_node_id + 1);
     primary_snarl_ranks.resize(max_node_id - min_node_id + 1);
-    sdsl::util::set_to_value(primary_snarl_assignments, 0);
-    sdsl::util::set_to_value(primary_snarl_ranks, 0);
+    primary_snarl_assignments.set_to_value(0);
+    primary_snarl_ranks.set_to_value(0);
 
     secondary_snarl_assignments.resize(max_node_id - min_node_id + 1);
     secondary_snarl_ranks.resize(max_node_id - min_node_id + 1);
-    sdsl::util::set_to_value(secondary_snarl_assignments, 0);
-    sdsl::util::set_to_value(secondary_snarl_ranks, 0);
-    has_secondary_snarl_bv.resize(max_node_id - min_node_id + 1);
-    sdsl::util::set_to_value(has_secondary_snarl_bv, 0);
+    secondary_snarl_assignments.set_to_value(0);
+    secondary_snarl_ranks.set_to_value(0);
+    has_secondary_snarl.resize(max_node_id - min_node_id + 1);
+    has_secondary_snarl.set_to_value(0);
 
     chain_assignments.resize(max_node_id - min_node_id + 1);
     chain_ranks.resize(max_node_id - min_node_id + 1);
-    sdsl::util::set_to_value(chain_assignments, 0);
-    sdsl::util::set_to_value(chain_ranks, 0);
-    has_chain_bv.resize(max_node_id - min_node_id + 1);
-    sdsl::util::set_to_value(has_chain_bv, 0);
+    chain_assignments.set_to_value(0);
+    chain_ranks.set_to_value(0);
+    has_chain.resize(max_node_id - min_node_id + 1);
+    has_chain.set_to_value(0);
 
     tree_depth = 0;
 
@@ -170,15 +172,16 @@ MinimumDistanceIndex::MinimumDistanceIndex(const HandleGraph* graph,
     #endif
 
 
-    util::assign(has_secondary_snarl, rank_support_v<1>(&has_secondary_snarl_bv));
-    util::assign(has_chain, rank_support_v<1>(&has_chain_bv));
+    has_secondary_snarl.init_rank();
+    has_chain.init_rank();
 
     //Remove empty entries of chain/secondary snarl assignments and ranks
     int_vector<> filtered_secondary_assignments 
                   (has_secondary_snarl.rank(max_node_id-min_node_id)+1, 0);
 
     size_t i = 0;
-    for (auto x : secondary_snarl_assignments) {
+    for (size_t j = 0 ; j < secondary_snarl_assignments.size() ; j++) {
+        uint64_t x = secondary_snarl_assignments[j];
         if (x != 0) {
             filtered_secondary_assignments[i] = x;
             i++;
@@ -190,7 +193,8 @@ MinimumDistanceIndex::MinimumDistanceIndex(const HandleGraph* graph,
                   (has_secondary_snarl.rank(max_node_id-min_node_id)+1, 0); 
 
     i = 0;
-    for (auto x : secondary_snarl_ranks) {
+    for (size_t j = 0 ; j < secondary_snarl_ranks.size() ; j++) {
+        uint64_t x = secondary_snarl_ranks[j];
         if (x != 0) {
             filtered_secondary_ranks[i] = x;
             i++;
@@ -201,7 +205,8 @@ MinimumDistanceIndex::MinimumDistanceIndex(const HandleGraph* graph,
     int_vector<> filtered_chain_assignments 
                     (has_chain.rank(max_node_id-min_node_id)+1, 0);
     i = 0;
-    for (auto x : chain_assignments) {
+    for (size_t j = 0 ; j < chain_assignments.size() ; j++) {
+        uint64_t x = chain_assignments[j];
         if (x != 0) {
             filtered_chain_assignments[i] = x;
             i++;
@@ -212,7 +217,8 @@ MinimumDistanceIndex::MinimumDistanceIndex(const HandleGraph* graph,
     int_vector<> filtered_chain_ranks 
                     (has_chain.rank(max_node_id-min_node_id)+1, 0);
     i = 0;
-    for (auto x : chain_ranks) {
+    for (size_t j = 0 ; j < chain_ranks.size() ; j++) {
+        uint64_t x = chain_ranks[j];
         if (x != 0) {
             filtered_chain_ranks[i] = x;
             i++;
@@ -220,17 +226,15 @@ MinimumDistanceIndex::MinimumDistanceIndex(const HandleGraph* graph,
     }
     chain_ranks = move(filtered_chain_ranks);
 
-    util::bit_compress(primary_snarl_assignments);
-    util::bit_compress(primary_snarl_ranks);
-    util::bit_compress(secondary_snarl_assignments);
-    util::bit_compress(secondary_snarl_ranks);
-    util::bit_compress(chain_assignments);
-    util::bit_compress(chain_ranks);
-    util::bit_compress(has_chain_bv);
-    util::bit_compress(has_secondary_snarl_bv);
-    util::bit_compress(node_to_component);
-    util::bit_compress(component_to_chain_index);
-    util::bit_compress(component_to_chain_length);
+    primary_snarl_assignments.bit_compress();
+    primary_snarl_ranks.bit_compress();
+    secondary_snarl_assignments.bit_compress();
+    secondary_snarl_ranks.bit_compress();
+    chain_assignments.bit_compress();
+    chain_ranks.bit_compress();
+    node_to_component.bit_compress();
+    component_to_chain_index.bit_compress();
+    component_to_chain_length.bit_compress();
 
 
     if (cap > 0) {
@@ -270,34 +274,50 @@ MinimumDistanceIndex::MinimumDistanceIndex (istream& in) : MinimumDistanceIndex(
 void MinimumDistanceIndex::load(istream& in){
     //Load serialized index from an istream
     
-    //Check the file's header to make sure it's the correct version
+    //Check the file's header to make sure it's a version we can read
     if (!in) {
         throw runtime_error("Could not load distance index");
-    } else {
-        //Check that the header is correct
-        size_t char_index = 0;
-        //TODO: We're only checking up to the last two so if the header changes this needs to change too
-        while (in.peek() != EOF && char_index < file_header.size()-2) {
-            if ( (char) in.get() != file_header[char_index]) {
-                throw runtime_error ("Distance index file is outdated");
-            }
-            char_index ++;
+    }
+    //The header is the same up to the version number
+    size_t char_index = 0;
+    while (in.peek() != EOF && char_index < file_header.size()-1) {
+        if ( (char) in.get() != file_header[char_index]) {
+            throw runtime_error ("Distance index file is outdated");
         }
-        if (in.peek() == '.') {
-            if ((char) in.get() != '.' || (char)in.get() != '2') {
-                throw runtime_error ("Distance index file is outdated");
-            }
-            include_component = true;
-        } else {
-            cerr << "warning: Loading an out-of-date distance index" << endl;
-            include_component = false;
+        char_index ++;
+    }
+    if (char_index < file_header.size()-1) {
+        throw runtime_error ("Distance index file is outdated");
+    }
+    char version = (char) in.get();
+    if (version == file_header.back()) {
+        //The current version is read in whole and used in place, the same
+        //way a mapped file is
+        size_t loaded_bytes = 0;
+        while (in) {
+            loaded_words.resize(max(loaded_words.size() * 2, (size_t) 1 << 16));
+            in.read((char*) loaded_words.data() + loaded_bytes, 
+                    loaded_words.size() * sizeof(uint64_t) - loaded_bytes);
+            loaded_bytes += in.gcount();
         }
-        char_index+=2;
-        if (char_index < file_header.size()) {
+        loaded_words.resize(loaded_bytes / sizeof(uint64_t));
+        loaded_words.shrink_to_fit();
+        map_words(loaded_words.data(), loaded_words.data() + loaded_words.size());
+        return;
+    } else if (version != '2') {
+        throw runtime_error ("Distance index file is outdated");
+    }
+    if (in.peek() == '.') {
+        if ((char) in.get() != '.' || (char)in.get() != '2') {
             throw runtime_error ("Distance index file is outdated");
         }
+        include_component = true;
+    } else {
+        cerr << "warning: Loading an out-of-date distance index" << endl;
+        include_component = false;
     }
 
+    //Older versions are read into memory
     size_t num_snarls;
     sdsl::read_member(num_snarls, in);
     snarl_indexes.reserve(num_snarls);
@@ -305,19 +325,16 @@ void MinimumDistanceIndex::load(istream& in){
         snarl_indexes.emplace_back(); 
         snarl_indexes.back().load(in, include_component);
     }
-    primary_snarl_assignments.load(in); 
-    primary_snarl_ranks.load(in);
-    secondary_snarl_assignments.load(in);
-    secondary_snarl_ranks.load(in);
-    has_secondary_snarl_bv.load(in);
-    has_secondary_snarl.load(in);
-    util::assign(has_secondary_snarl, 
-                 rank_support_v<1>(&has_secondary_snarl_bv));
+    primary_snarl_assignments.load_sdsl(in); 
+    primary_snarl_ranks.load_sdsl(in);
+    secondary_snarl_assignments.load_sdsl(in);
+    secondary_snarl_ranks.load_sdsl(in);
+    has_secondary_snarl.load_sdsl(in);
 
     if (include_component) {
-        node_to_component.load(in);
-        component_to_chain_index.load(in);
-        component_to_chain_length.load(in);
+        node_to_component.load_sdsl(in);
+        component_to_chain_index.load_sdsl(in);
+        component_to_chain_length.load_sdsl(in);
     }
     //Load serialized chains
     size_t num_chains;
@@ -327,12 +344,9 @@ void MinimumDistanceIndex::load(istream& in){
         chain_indexes.emplace_back();
         chain_indexes.back().load(in);
     }
-    chain_assignments.load(in);
-    chain_ranks.load(in);
-    has_chain_bv.load(in);
-    has_chain.load(in);
-    util::assign(has_chain, 
-                 rank_support_v<1>(&has_chain_bv));
+    chain_assignments.load_sdsl(in);
+    chain_ranks.load_sdsl(in);
+    has_chain.load_sdsl(in);
 
     sdsl::read_member(min_node_id, in );
     sdsl::read_member(max_node_id, in );
@@ -342,22 +356,79 @@ void MinimumDistanceIndex::load(istream& in){
     sdsl::read_member(include_maximum, in );
 
     if (include_maximum) {
-        min_distances.load(in);
-        max_distances.load(in);
+        min_distances.load_sdsl(in);
+        max_distances.load_sdsl(in);
     }
 
 
 
 };
 
+bool MinimumDistanceIndex::load_mapped(const string& filename) {
+    std::error_code error;
+    unique_ptr<mio::mmap_source> mapped_file(new mio::mmap_source());
+    mapped_file->map(filename, error);
+    if (error || mapped_file->size() < file_header.size() ||
+        file_header.compare(0, string::npos, mapped_file->data(), file_header.size()) != 0) {
+        //Not something we can use in place
+        return false;
+    }
+
+    //The mapping starts on a page boundary and the header is a whole number
+    //of words, so the words after it are aligned
+    const uint64_t* begin = (const uint64_t*) (mapped_file->data() + file_header.size());
+    const uint64_t* end = begin + (mapped_file->size() - file_header.size()) / sizeof(uint64_t);
+    mapping = std::move(mapped_file);
+    map_words(begin, end);
+    return true;
+}
+
+void MinimumDistanceIndex::map_words(const uint64_t* cursor, const uint64_t* end) {
+    include_component = true;
+
+    size_t num_snarls = MappableIntVector::map_word(cursor, end);
+    snarl_indexes.resize(num_snarls);
+    for (auto& snarl_index : snarl_indexes) {
+        snarl_index.map(cursor, end);
+    }
+    primary_snarl_assignments.map(cursor, end);
+    primary_snarl_ranks.map(cursor, end);
+    secondary_snarl_assignments.map(cursor, end);
+    secondary_snarl_ranks.map(cursor, end);
+    has_secondary_snarl.map(cursor, end);
+    node_to_component.map(cursor, end);
+    component_to_chain_index.map(cursor, end);
+    component_to_chain_length.map(cursor, end);
+
+    size_t num_chains = MappableIntVector::map_word(cursor, end);
+    chain_indexes.resize(num_chains);
+    for (auto& chain_index : chain_indexes) {
+        chain_index.map(cursor, end);
+    }
+    chain_assignments.map(cursor, end);
+    chain_ranks.map(cursor, end);
+    has_chain.map(cursor, end);
+
+    min_node_id = MappableIntVector::map_word(cursor, end);
+    max_node_id = MappableIntVector::map_word(cursor, end);
+    tree_depth = MappableIntVector::map_word(cursor, end);
+    include_maximum = MappableIntVector::map_word(cursor, end);
+    if (include_maximum) {
+        min_distances.map(cursor, end);
+        max_distances.map(cursor, end);
+    }
+}
+
 void MinimumDistanceIndex::serialize(ostream& out) const {
 
-    //Serialize snarls
+    //Everything is written as 64-bit words so that the index can be mapped
+    //and used in place
 
     //Write the header to the serialized file
     out << file_header;
-    sdsl::write_member(snarl_indexes.size(), out);
-    
+
+    //Serialize snarls
+    sdsl::write_member((uint64_t) snarl_indexes.size(), out);
     for (auto& snarl_index: snarl_indexes) {
         snarl_index.serialize(out);
     }
@@ -365,29 +436,26 @@ void MinimumDistanceIndex::serialize(ostream& out) const {
     primary_snarl_ranks.serialize(out);
     secondary_snarl_assignments.serialize(out);
     secondary_snarl_ranks.serialize(out);
-    has_secondary_snarl_bv.serialize(out);
     has_secondary_snarl.serialize(out);
     node_to_component.serialize(out);
     component_to_chain_index.serialize(out);
     component_to_chain_length.serialize(out);
 
     //Serialize chains 
-    sdsl::write_member(chain_indexes.size(), out);
-    
+    sdsl::write_member((uint64_t) chain_indexes.size(), out);
     for (auto& chain_index: chain_indexes) {
         chain_index.serialize(out);
     }
     chain_assignments.serialize(out);
     chain_ranks.serialize(out);
-    has_chain_bv.serialize(out);
     has_chain.serialize(out);
 
-    sdsl::write_member(min_node_id, out);
-    sdsl::write_member(max_node_id, out);
+    sdsl::write_member((uint64_t) min_node_id, out);
+    sdsl::write_member((uint64_t) max_node_id, out);
 
-    sdsl::write_member(tree_depth, out);
+    sdsl::write_member((uint64_t) tree_depth, out);
 
-    sdsl::write_member(include_maximum, out);
+    sdsl::write_member((uint64_t) include_maximum, out);
     if (include_maximum) {
         min_distances.serialize(out);
         max_distances.serialize(out);
@@ -395,6 +463,14 @@ void MinimumDistanceIndex::serialize(ostream& out) const {
 
 };
 
+unique_ptr<MinimumDistanceIndex> load_minimum_distance_index(const string& filename) {
+    unique_ptr<MinimumDistanceIndex> index(new MinimumDistanceIndex());
+    if (!index->load_mapped(filename)) {
+        index = vg::io::VPKG::load_one<MinimumDistanceIndex>(filename);
+    }
+    return index;
+}
+
 /////////////////////////    MINIMUM INDEX    ///////////////////////////////
 
 
@@ -433,7 +509,7 @@ int64_t MinimumDistanceIndex::calculate_min_index(const HandleGraph* graph,
 
         chain_assignments[first_visit.node_id()-min_node_id] = chain_indexes.size();
         chain_ranks[first_visit.node_id()-min_node_id] = 1;
-        has_chain_bv[first_visit.node_id()-min_node_id] = 1; 
+        has_chain.set(first_visit.node_id()-min_node_id); 
 
         handle_t first_node = graph->get_handle(first_visit.node_id(), first_visit.backward());
         chain_indexes.back().prefix_sum[0] = graph->get_length(first_node) + 1;
@@ -464,7 +540,7 @@ int64_t MinimumDistanceIndex::calculate_min_index(const HandleGraph* graph,
             //already been seen (if the chain loops)
             chain_assignments[second_id-min_node_id] = curr_chain_assignment+1;
             chain_ranks[second_id - min_node_id] = curr_chain_rank + 2;
-            has_chain_bv[snarl_end_id - min_node_id] = 1;
+            has_chain.set(snarl_end_id - min_node_id);
            
         } 
 
@@ -482,7 +558,7 @@ int64_t MinimumDistanceIndex::calculate_min_index(const HandleGraph* graph,
                 if (curr_snarl != NULL) {
                     //If this node represents a snarl or chain, then this snarl
                     //is a secondary snarl
-                    has_secondary_snarl_bv[id-min_node_id] = 1;
+                    has_secondary_snarl.set(id-min_node_id);
                     secondary_snarl_assignments[id - min_node_id] = snarl_assignment+1;
                     secondary_snarl_ranks[id - min_node_id] = all_nodes.size()+1;
                 } else {
@@ -537,7 +613,7 @@ int64_t MinimumDistanceIndex::calculate_min_index(const HandleGraph* graph,
             secondary_snarl_ranks[end_in_chain-min_node_id] = end_in_chain == snarl_end_id ? 
                  (snarl_end_rev ? all_nodes.size()  : all_nodes.size() - 1) :
                  (snarl_start_rev ? 1 : 0);
-            has_secondary_snarl_bv[end_in_chain-min_node_id] = 1;
+            has_secondary_snarl.set(end_in_chain-min_node_id);
         }
 
         //Make the snarl index
@@ -634,7 +710,7 @@ int64_t MinimumDistanceIndex::calculate_min_index(const HandleGraph* graph,
         }
         
         //Bit compress distance matrix of snarl index
-        util::bit_compress(snarl_indexes[snarl_assignment].distances);
+        snarl_indexes[snarl_assignment].distances.bit_compress();
 
         curr_chain_rank ++;
     }//End for loop over snarls in chain
@@ -778,9 +854,9 @@ int64_t MinimumDistanceIndex::calculate_min_index(const HandleGraph* graph,
             }           
           
         }
-        util::bit_compress(cd.prefix_sum);
-        util::bit_compress(cd.loop_fd);
-        util::bit_compress(cd.loop_rev);
+        cd.prefix_sum.bit_compress();
+        cd.loop_fd.bit_compress();
+        cd.loop_rev.bit_compress();
     }
  
     //return length of entire chain
@@ -1187,7 +1263,7 @@ tuple<id_t, bool, bool> MinimumDistanceIndex::into_which_snarl(id_t node_id, boo
         return make_tuple(primary_start.first, primary_start.second, primary_snarl_index.is_trivial_snarl());
     }
 
-    if (has_secondary_snarl_bv[node_id-min_node_id]){ 
+    if (has_secondary_snarl[node_id-min_node_id]){ 
         size_t secondary_assignment = get_secondary_assignment(node_id);
         const SnarlIndex& secondary_snarl_index = snarl_indexes[secondary_assignment];
         pair<id_t, bool> secondary_start (secondary_snarl_index.id_in_parent, 
@@ -1215,351 +1291,404 @@ tuple<id_t, bool, bool> MinimumDistanceIndex::into_which_snarl(id_t node_id, boo
 int64_t MinimumDistanceIndex::node_length(id_t id) const {
     return snarl_indexes[get_primary_assignment(id)].node_length(get_primary_rank(id));
 }
-int64_t MinimumDistanceIndex::min_distance(pos_t pos1, pos_t pos2) const {
-    /*Minimum distance between positions not including the position itself*/
-    
-    int64_t shortest_distance = -1; 
-
-    id_t node_id1 = get_id(pos1);
-    bool node_rev1 = is_rev(pos1);
-    id_t node_id2 = get_id(pos2); 
-    bool node_rev2 = is_rev(pos2);
-
-    if (node_id1 == node_id2 && node_rev1 == node_rev2 ) {
-        //if positions are on the same node and strand
-        int64_t offset1 = get_offset(pos1);
-        int64_t offset2 = get_offset(pos2);
-
-        if (offset1 <= offset2) {
-            shortest_distance = offset2-offset1+1; //+1 to be consistent
-        }
-
-    }
-    
-    //Index into snarl_indexes/chain_indexes of the common ancestor snarl/chain
-    //true if common ancestor is a chain
-    pair<id_t, bool> common_ancestor ( 0, false);
-
-
-#ifdef debugDistance
-    cerr << endl << "Start distance calculation from " << pos1 << "->" <<
-         pos2 << endl;
-
-    cerr << "Shortes distance within same node: " << shortest_distance<<  endl;
-
-    cerr << "Find common ancestor" << endl;
-#endif
-
-
-    //// Find common ancestor of the two snarls
-    unordered_set<pair<id_t, bool>> ancestors1;
-
-    //set of all ancestor snarls and chains (true) of node1
-    pair<id_t, bool> ancestor1 ( snarl_indexes[get_primary_assignment(node_id1)].id_in_parent, false);
-
-#ifdef debugDistance
-    cerr << "Ancestors of 1: ";
-#endif
-
-
-    while (ancestor1.first != 0) {
-#ifdef debugDistance
-        if (ancestor1.second) {cerr << "chain ";}
-        else {cerr << "snarl ";}
-        cerr << ancestor1.first << " ";
-#endif
-        if (ancestor1.second) {
-            //If ancestor1 is a chain
-            size_t chain_assignment = get_chain_assignment(ancestor1.first);
-            ancestors1.emplace(chain_assignment, true );
-            ancestor1 = make_pair(chain_indexes[chain_assignment].parent_id, false);
-
+void MinimumDistanceIndex::get_ancestors(id_t node_id, vector<SnarlTreeAncestor>& ancestors) const {
+    //All ancestor snarls and chains of the node, from the bottom up
+    ancestors.clear();
+    pair<id_t, bool> ancestor (snarl_indexes[get_primary_assignment(node_id)].id_in_parent, false);
+    while (ancestor.first != 0) {
+        if (ancestor.second) {
+            //If the ancestor is a chain
+            size_t chain_assignment = get_chain_assignment(ancestor.first);
+            ancestors.push_back({ancestor.first, true, chain_assignment});
+            ancestor = make_pair(chain_indexes[chain_assignment].parent_id, false);
         } else {
-            size_t snarl_assignment = get_primary_assignment(ancestor1.first);
-            ancestors1.emplace(snarl_assignment, false );
+            size_t snarl_assignment = get_primary_assignment(ancestor.first);
+            ancestors.push_back({ancestor.first, false, snarl_assignment});
             const SnarlIndex& si = snarl_indexes[snarl_assignment];
-            ancestor1 = make_pair(si.parent_id, si.in_chain);
+            ancestor = make_pair(si.parent_id, si.in_chain);
         }
     }
+}
 
-#ifdef debugDistance
-      cerr << endl << "ancestors of 2: ";
-#endif
-
-
-    pair<id_t, bool> ancestor2 ( snarl_indexes[get_primary_assignment(node_id2)].id_in_parent,false);
-    while (ancestor2.first != 0) {
-
-#ifdef debugDistance
-        if (ancestor2.second) {cerr << "chain ";}
-        else {cerr << "snarl ";}
-        cerr << ancestor2.first << " ";
-#endif
-
-        if (ancestor2.second) {
-            //If this ancestor is a chain
-            size_t chain_assignment = get_chain_assignment(ancestor2.first);
-            if (ancestors1.count(make_pair(chain_assignment, true)) != 0) {
-                common_ancestor = ancestor2;
-                break;
+const MinimumDistanceIndex::SnarlTreeAncestor* MinimumDistanceIndex::lowest_common_ancestor(
+                const vector<SnarlTreeAncestor>& ancestors1, 
+                const vector<SnarlTreeAncestor>& ancestors2) {
+    //The snarl tree is shallow, so a scan is cheaper than hashing
+    for (const SnarlTreeAncestor& ancestor2 : ancestors2) {
+        for (const SnarlTreeAncestor& ancestor1 : ancestors1) {
+            if (ancestor1.assignment == ancestor2.assignment && ancestor1.is_chain == ancestor2.is_chain) {
+                return &ancestor2;
             }
-            ancestor2 = make_pair(chain_indexes[chain_assignment].parent_id, false);
-        } else { 
-            size_t snarl_assignment = get_primary_assignment(ancestor2.first);
-            if (ancestors1.count(make_pair(snarl_assignment, false)) != 0) {
-                common_ancestor = ancestor2;
-                break;
-            }
-            const SnarlIndex& si = snarl_indexes[snarl_assignment];
-            ancestor2 = make_pair(si.parent_id, si.in_chain);
         }
     }
-    if (common_ancestor.first == 0) {
+    return nullptr;
+}
+
+int64_t MinimumDistanceIndex::min_distance(pos_t pos1, pos_t pos2) const {
+    /*Minimum distance between positions not including the position itself*/
+
+    vector<SnarlTreeAncestor> ancestors1;
+    vector<SnarlTreeAncestor> ancestors2;
+    get_ancestors(get_id(pos1), ancestors1);
+    get_ancestors(get_id(pos2), ancestors2);
+
+    const SnarlTreeAncestor* common_ancestor = lowest_common_ancestor(ancestors1, ancestors2);
+    if (common_ancestor == nullptr) {
         //If the two positions don't share a common ancestor
         return -1;
     }
 
-#ifdef debugDistance 
-    cerr << endl;
-    if (common_ancestor.second) {
-        cerr << "common ancestor chain ";
-    } else { 
-        cerr << "common ancestor snarl ";
-    }
-    cerr << common_ancestor.first << endl;
-    
+#ifdef debugDistance
+    cerr << endl << "Start distance calculation from " << pos1 << "->" << pos2 << endl;
+    cerr << "common ancestor " << (common_ancestor->is_chain ? "chain " : "snarl ") << common_ancestor->id << endl;
 #endif
 
-    pair<size_t, bool> ancestor ( common_ancestor.second  ? get_chain_assignment(common_ancestor.first)
-                                                         : get_primary_assignment(common_ancestor.first),
-                                  common_ancestor.second);
-
+    //Index into snarl_indexes/chain_indexes of the common ancestor
+    pair<size_t, bool> ancestor (common_ancestor->assignment, common_ancestor->is_chain);
 
     //Find distances from pos1 and pos2 to ends of child snarls of ancestor
     int64_t distL1; int64_t distR1; pair<id_t, bool> snarl_tree_node1;
     tie (distL1, distR1, snarl_tree_node1) = dist_to_common_ancestor(ancestor, pos1, false);
 
-     
     int64_t distL2; int64_t distR2; pair<id_t, bool> snarl_tree_node2;
     tie (distL2, distR2, snarl_tree_node2) = dist_to_common_ancestor(ancestor, pos2, true);
 
-    pair<id_t, bool> parent = common_ancestor;
+    int64_t shortest_distance = same_node_distance(pos1, pos2);
+
+    //Combine the distances at the common ancestor and at everything above it
+    pair<id_t, bool> parent (common_ancestor->id, common_ancestor->is_chain);
+    AncestorLevel level;
     bool lowest_ancestor = true;
     while (parent.first != 0) {
-        //snarl_tree_nodes 1 and 2 are children of parent snarl or chain 
-        if (parent.second) {
-            //If the parent is a chain and both snarl_tree_nodes are snarls
-
-            const ChainIndex& chain_index = chain_indexes[get_chain_assignment(parent.first)]; 
-
-            //If the two nodes are snarls in the common ancestor chain
-            //find the distance between them in the chain
-            const SnarlIndex& snarl_index1 = snarl_indexes[get_primary_assignment( snarl_tree_node1.first)];
-            size_t start_rank1 = get_chain_rank(snarl_index1.id_in_parent);
-            size_t end_rank1 = start_rank1 + 1; 
-            if (snarl_index1.rev_in_parent) {
-                int64_t temp = distL1;
-                distL1 = distR1;
-                distR1 = temp;
-            }
-            int64_t start_len1 = snarl_index1.node_length(snarl_index1.rev_in_parent ? snarl_index1.num_nodes * 2 - 1 : 0);
-            int64_t end_len1 = snarl_index1.node_length(snarl_index1.rev_in_parent ? 0 : snarl_index1.num_nodes * 2 - 1);
-            size_t start_rank2, end_rank2;
-            int64_t start_len2, end_len2;
-
-            if (lowest_ancestor) {
-                //If this is the lowest common ancestor, then there are two
-                //separate nodes that need to be found
-               
-               const SnarlIndex& snarl_index2 = snarl_indexes[get_primary_assignment( snarl_tree_node2.first)];
-               start_rank2 = get_chain_rank(snarl_index2.id_in_parent);
-               end_rank2 = start_rank2+1; 
-               if (snarl_index2.rev_in_parent) {
-                   int64_t temp = distL2;
-                   distL2 = distR2;
-                   distR2 = temp;
-               }
-               start_len2 = snarl_index2.node_length(snarl_index2.rev_in_parent ? snarl_index2.num_nodes * 2 - 1 : 0);
-               end_len2 = snarl_index2.node_length(snarl_index2.rev_in_parent ? 0 : snarl_index2.num_nodes * 2 - 1);
-            } else {
-                //Otherwise just copy the first one
-                start_rank2 = start_rank1;
-                end_rank2 = end_rank1;
-                start_len2 = start_len1;
-                end_len2 = end_len1;
-            }
-
-            //Distance from left of s1 (reverse), left of s2 (forward)
-            int64_t d1 = chain_index.chain_distance(make_pair(start_rank1, true), make_pair(start_rank2, false), start_len1, start_len2);
-            d1 = (distL1 == -1 || distL2 == -1 || d1 == -1) ? -1 : distL1 + distL2 + d1 - start_len1;
+        get_ancestor_level(parent, snarl_tree_node1, snarl_tree_node2, lowest_ancestor, level);
+        apply_ancestor_level(level, distL1, distR1, distL2, distR2, shortest_distance);
+        go_up(parent, snarl_tree_node1);
+        lowest_ancestor = false;
+    }
 
-            //Distance from left of s1 (reverse) to right of s2 (reverse)
-            int64_t d2;
-            if (start_rank1 == end_rank2) {
-                //If snarls share a node, then the distances up to this point
-                //both include the length of the shared node
-                d2 = (distL1 == -1 || distR2 == -1) ? -1 :  distL1 + distR2 - start_len1; 
-            } else {
-                d2 = chain_index.chain_distance(make_pair(start_rank1, true),  make_pair(end_rank2, true), start_len1, end_len2);
-                d2 = (distL1 == -1 || distR2 == -1 || d2 == -1) ? -1 :  distL1 + distR2 + d2 - start_len1;
-            }
+    return shortest_distance == -1 ? -1 : shortest_distance - 1;
+}
 
-            //Distance from right of s1 (fd) to left of s2 (fd)
-            int64_t d3;
-            if (end_rank1 == start_rank2) {
-                d3 = (distR1 == -1 || distL2 == -1) ? -1 :  distR1 + distL2 - end_len1; 
-            } else {
-                d3 = chain_index.chain_distance(make_pair(end_rank1, false), make_pair(start_rank2, false), end_len1, start_len2);
+vector<int64_t> MinimumDistanceIndex::min_distance(const vector<pair<pos_t, pos_t>>& position_pairs) const {
+
+    vector<int64_t> distances (position_pairs.size(), -1);
+
+    //The ancestors of a node depend only on the snarl it is primarily
+    //assigned to, so answer the queries in order of the snarls of their
+    //positions. Then runs of queries share their ancestor walks and their
+    //common ancestor
+    vector<tuple<size_t, size_t, size_t>> order;
+    order.reserve(position_pairs.size());
+    for (size_t i = 0 ; i < position_pairs.size() ; i++) {
+        order.emplace_back(get_primary_assignment(get_id(position_pairs[i].first)),
+                           get_primary_assignment(get_id(position_pairs[i].second)), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    //Distances from each position to the ends of its child of a common
+    //ancestor, by position, direction, and ancestor. Positions usually
+    //appear in many pairs
+    unordered_map<tuple<pos_t, bool, size_t, bool>, tuple<int64_t, int64_t, pair<id_t, bool>>> to_ancestor;
+    //Lookups for combining distances at a common ancestor, by ancestor and
+    //the children the positions are in
+    unordered_map<tuple<size_t, bool, pair<id_t, bool>, pair<id_t, bool>>, AncestorLevel> lowest_levels;
+    //Lookups for carrying distances from a common ancestor up to the root,
+    //which are the same for every pair under that ancestor
+    unordered_map<pair<size_t, bool>, vector<AncestorLevel>> upper_levels;
+
+    auto get_to_ancestor = [&](pos_t pos, bool rev, const pair<size_t, bool>& ancestor) 
+                           -> const tuple<int64_t, int64_t, pair<id_t, bool>>& {
+        tuple<pos_t, bool, size_t, bool> key (pos, rev, ancestor.first, ancestor.second);
+        auto found = to_ancestor.find(key);
+        if (found == to_ancestor.end()) {
+            found = to_ancestor.emplace(key, dist_to_common_ancestor(ancestor, pos, rev)).first;
+        }
+        return found->second;
+    };
 
-                d3 = (distR1 == -1 || distL2 == -1 || d3 == -1) ? -1 : distR1 + distL2 + d3 - end_len1; 
+    vector<SnarlTreeAncestor> ancestors1;
+    vector<SnarlTreeAncestor> ancestors2;
+    //Snarls whose ancestors are in ancestors1 and ancestors2
+    size_t snarl1 = std::numeric_limits<size_t>::max();
+    size_t snarl2 = std::numeric_limits<size_t>::max();
+    const SnarlTreeAncestor* common_ancestor = nullptr;
+    //Levels above the current common ancestor
+    const vector<AncestorLevel>* upper = nullptr;
+
+    for (auto& query : order) {
+        size_t next_snarl1, next_snarl2, i;
+        tie(next_snarl1, next_snarl2, i) = query;
+        if (next_snarl1 != snarl1 || next_snarl2 != snarl2) {
+            if (next_snarl1 != snarl1) {
+                get_ancestors(get_id(position_pairs[i].first), ancestors1);
+                snarl1 = next_snarl1;
             }
+            if (next_snarl2 != snarl2) {
+                get_ancestors(get_id(position_pairs[i].second), ancestors2);
+                snarl2 = next_snarl2;
+            }
+            common_ancestor = lowest_common_ancestor(ancestors1, ancestors2);
+            if (common_ancestor != nullptr) {
+                pair<size_t, bool> ancestor (common_ancestor->assignment, common_ancestor->is_chain);
+                auto found = upper_levels.find(ancestor);
+                if (found == upper_levels.end()) {
+                    found = upper_levels.emplace(ancestor, vector<AncestorLevel>()).first;
+                    pair<id_t, bool> parent (common_ancestor->id, common_ancestor->is_chain);
+                    pair<id_t, bool> snarl_tree_node;
+                    go_up(parent, snarl_tree_node);
+                    while (parent.first != 0) {
+                        found->second.emplace_back();
+                        get_ancestor_level(parent, snarl_tree_node, snarl_tree_node, false, found->second.back());
+                        go_up(parent, snarl_tree_node);
+                    }
+                }
+                upper = &found->second;
+            }
+        }
+        if (common_ancestor == nullptr) {
+            continue;
+        }
 
-            //Distance from right of s1 (fd) to right of s2 (rev)
-            int64_t d4 =  chain_index.chain_distance(make_pair(end_rank1, false),  make_pair(end_rank2, true), end_len1, end_len2);
-            d4 = (distR1 == -1 || distR2 == -1 || d4 == -1) ? -1 : distR1 + distR2 + d4 - end_len1;
-            
-                       
-            shortest_distance = min_pos({d1, d2, d3, d4, shortest_distance});
-
-
-            //Extend distances of both positions to the ends of the chain
-
-            //Find the rank of the end node and current node in the chain
-            size_t chain_end_rank = chain_index.prefix_sum.size() - 2;
-                                    
-            //Get the lengths of start, end, and current node
-            int64_t chain_start_len = node_length(chain_index.id_in_parent);
-
-            int64_t chain_end_len = chain_index.prefix_sum[chain_index.prefix_sum.size()-1] 
-                                - chain_index.prefix_sum[chain_index.prefix_sum.size()-2];
-
-            int64_t dsl = chain_index.chain_distance(make_pair(0, false),  make_pair(start_rank1, false), chain_start_len, start_len1);
-            int64_t dsr = chain_index.chain_distance(make_pair(0, false), make_pair(end_rank1, true), chain_start_len, end_len1);
-            int64_t der = chain_index.chain_distance( make_pair(chain_end_rank, true), make_pair(end_rank1, true), chain_end_len, end_len1);
-            int64_t del = chain_index.chain_distance(make_pair(chain_end_rank, true), make_pair(start_rank1, false), chain_end_len, start_len1);
-
-            int64_t dsl1 = dsl == -1 || distL1 == -1? -1 : distL1 + dsl; 
-            int64_t dsr1 =  dsr == -1 || distR1 == -1? -1 : distR1 + dsr; 
-            int64_t der1 = der == -1 || distR1 == -1? -1 : distR1 + der; 
-            int64_t del1 = del == -1 || distL1 == -1? -1 : distL1 + del; 
- 
-            distL1 = min_pos(dsr1, dsl1);
-            distR1 = min_pos(der1, del1);
+        const pos_t& pos1 = position_pairs[i].first;
+        const pos_t& pos2 = position_pairs[i].second;
+        pair<size_t, bool> ancestor (common_ancestor->assignment, common_ancestor->is_chain);
 
-            if (lowest_ancestor) {
-                //If the two snarl tree nodes are different, need to find 
-                //distances to ends for the second one
+        int64_t distL1; int64_t distR1; pair<id_t, bool> snarl_tree_node1;
+        tie (distL1, distR1, snarl_tree_node1) = get_to_ancestor(pos1, false, ancestor);
+        int64_t distL2; int64_t distR2; pair<id_t, bool> snarl_tree_node2;
+        tie (distL2, distR2, snarl_tree_node2) = get_to_ancestor(pos2, true, ancestor);
 
-                dsl = chain_index.chain_distance(make_pair(0, false),  make_pair(start_rank2, false), chain_start_len, start_len2);
-                dsr = chain_index.chain_distance(make_pair(0, false), make_pair(end_rank2, true), chain_start_len, end_len2);
-                der = chain_index.chain_distance(make_pair(chain_end_rank, true),  make_pair(end_rank2, true), chain_end_len, end_len2);
-                del = chain_index.chain_distance(make_pair(chain_end_rank, true), make_pair(start_rank2, false), chain_end_len, start_len2);
+        int64_t shortest_distance = same_node_distance(pos1, pos2);
 
-            }
+        tuple<size_t, bool, pair<id_t, bool>, pair<id_t, bool>> lowest_key (ancestor.first, ancestor.second,
+                                                                            snarl_tree_node1, snarl_tree_node2);
+        auto lowest = lowest_levels.find(lowest_key);
+        if (lowest == lowest_levels.end()) {
+            lowest = lowest_levels.emplace(lowest_key, AncestorLevel()).first;
+            get_ancestor_level(make_pair(common_ancestor->id, common_ancestor->is_chain), 
+                               snarl_tree_node1, snarl_tree_node2, true, lowest->second);
+        }
+        apply_ancestor_level(lowest->second, distL1, distR1, distL2, distR2, shortest_distance);
+        for (const AncestorLevel& level : *upper) {
+            apply_ancestor_level(level, distL1, distR1, distL2, distR2, shortest_distance);
+        }
 
-            int64_t dsl2 = dsl == -1 || distL2 == -1? -1 : distL2 + dsl; 
-            int64_t dsr2 = dsr == -1 || distR2 == -1? -1 : distR2 + dsr; 
-            int64_t der2 = der == -1 || distR2 == -1? -1 : distR2 + der; 
-            int64_t del2 = del == -1 || distL2 == -1? -1 : distL2 + del; 
+        distances[i] = shortest_distance == -1 ? -1 : shortest_distance - 1;
+    }
+    return distances;
+}
 
-            distL2 = min_pos(dsr2, dsl2);
-            distR2 = min_pos(der2, del2);
+int64_t MinimumDistanceIndex::same_node_distance(pos_t pos1, pos_t pos2) {
+    if (get_id(pos1) == get_id(pos2) && is_rev(pos1) == is_rev(pos2) 
+        && get_offset(pos1) <= get_offset(pos2)) {
+        //if positions are on the same node and strand
+        return get_offset(pos2) - get_offset(pos1) + 1; //+1 to be consistent
+    }
+    return -1;
+}
 
-            snarl_tree_node1 = make_pair(chain_index.id_in_parent,chain_index.rev_in_parent);
+void MinimumDistanceIndex::go_up(pair<id_t, bool>& ancestor, pair<id_t, bool>& snarl_tree_node) const {
+    if (ancestor.second) {
+        const ChainIndex& chain_index = chain_indexes[get_chain_assignment(ancestor.first)];
+        snarl_tree_node = make_pair(chain_index.id_in_parent, chain_index.rev_in_parent);
+        ancestor = make_pair(chain_index.parent_id, false);
+    } else {
+        const SnarlIndex& snarl_index = snarl_indexes[get_primary_assignment(ancestor.first)];
+        snarl_tree_node = make_pair(snarl_index.id_in_parent, snarl_index.rev_in_parent);
+        ancestor = make_pair(snarl_index.parent_id, snarl_index.in_chain);
+    }
+}
 
+void MinimumDistanceIndex::get_ancestor_level(const pair<id_t, bool>& parent, 
+                                              const pair<id_t, bool>& snarl_tree_node1,
+                                              const pair<id_t, bool>& snarl_tree_node2, 
+                                              bool lowest_ancestor, AncestorLevel& level) const {
+    //snarl_tree_nodes 1 and 2 are children of parent snarl or chain 
+    level.is_chain = parent.second;
+    if (parent.second) {
+        //If the parent is a chain and both snarl_tree_nodes are snarls
+
+        const ChainIndex& chain_index = chain_indexes[get_chain_assignment(parent.first)]; 
+
+        //If the two nodes are snarls in the common ancestor chain
+        //find the distance between them in the chain
+        const SnarlIndex& snarl_index1 = snarl_indexes[get_primary_assignment( snarl_tree_node1.first)];
+        size_t start_rank1 = get_chain_rank(snarl_index1.id_in_parent);
+        size_t end_rank1 = start_rank1 + 1; 
+        level.swap1 = snarl_index1.rev_in_parent;
+        int64_t start_len1 = snarl_index1.node_length(snarl_index1.rev_in_parent ? snarl_index1.num_nodes * 2 - 1 : 0);
+        int64_t end_len1 = snarl_index1.node_length(snarl_index1.rev_in_parent ? 0 : snarl_index1.num_nodes * 2 - 1);
+        level.start_len1 = start_len1;
+        level.end_len1 = end_len1;
+
+        size_t start_rank2 = start_rank1;
+        size_t end_rank2 = end_rank1;
+        int64_t start_len2 = start_len1;
+        int64_t end_len2 = end_len1;
+        level.swap2 = false;
+        if (lowest_ancestor) {
+            //If this is the lowest common ancestor, then there are two
+            //separate nodes that need to be found
+            const SnarlIndex& snarl_index2 = snarl_indexes[get_primary_assignment( snarl_tree_node2.first)];
+            start_rank2 = get_chain_rank(snarl_index2.id_in_parent);
+            end_rank2 = start_rank2+1; 
+            level.swap2 = snarl_index2.rev_in_parent;
+            start_len2 = snarl_index2.node_length(snarl_index2.rev_in_parent ? snarl_index2.num_nodes * 2 - 1 : 0);
+            end_len2 = snarl_index2.node_length(snarl_index2.rev_in_parent ? 0 : snarl_index2.num_nodes * 2 - 1);
+        }
 
-#        ifdef debugDistance
-            cerr << "At ancestor chain " << chain_indexes[
-                     get_chain_assignment(parent.first)].id_in_parent << endl;
-            cerr << "Ranks: " << start_rank1 << " " << start_rank2 << endl;
-            
-            cerr << "  Distances within ancestor: " << d1 << ", " << d2
-                                                << ", " << d3 << ", " << d4 << endl;
-            cerr << "  Shortest dist: " << shortest_distance
-                << endl;
-            cerr << "  Distances to ends of ancestor: " << distL1 << " " << distR1
-                 << " " << distL2 << " " << distR2 
-                << endl;
-#        endif
-            parent = make_pair(chain_index.parent_id, false);
+        //Distance from left of s1 (reverse), left of s2 (forward)
+        level.between[0] = chain_index.chain_distance(make_pair(start_rank1, true), make_pair(start_rank2, false), start_len1, start_len2);
+        //Distance from left of s1 (reverse) to right of s2 (reverse)
+        //If snarls share a node, then the distances up to this point
+        //both include the length of the shared node
+        level.shared_start_end = start_rank1 == end_rank2;
+        level.between[1] = level.shared_start_end ? -1 :
+            chain_index.chain_distance(make_pair(start_rank1, true),  make_pair(end_rank2, true), start_len1, end_len2);
+        //Distance from right of s1 (fd) to left of s2 (fd)
+        level.shared_end_start = end_rank1 == start_rank2;
+        level.between[2] = level.shared_end_start ? -1 :
+            chain_index.chain_distance(make_pair(end_rank1, false), make_pair(start_rank2, false), end_len1, start_len2);
+        //Distance from right of s1 (fd) to right of s2 (rev)
+        level.between[3] = chain_index.chain_distance(make_pair(end_rank1, false),  make_pair(end_rank2, true), end_len1, end_len2);
+
+        //Distances to the ends of the chain
+
+        //Find the rank of the end node and current node in the chain
+        size_t chain_end_rank = chain_index.prefix_sum.size() - 2;
+                                
+        //Get the lengths of start, end, and current node
+        int64_t chain_start_len = node_length(chain_index.id_in_parent);
+
+        int64_t chain_end_len = chain_index.prefix_sum[chain_index.prefix_sum.size()-1] 
+                            - chain_index.prefix_sum[chain_index.prefix_sum.size()-2];
+
+        auto chain_ends = [&](size_t start_rank, size_t end_rank, int64_t start_len, int64_t end_len) {
+            return array<int64_t, 4> {
+                chain_index.chain_distance(make_pair(0, false),  make_pair(start_rank, false), chain_start_len, start_len),
+                chain_index.chain_distance(make_pair(0, false), make_pair(end_rank, true), chain_start_len, end_len),
+                chain_index.chain_distance( make_pair(chain_end_rank, true), make_pair(end_rank, true), chain_end_len, end_len),
+                chain_index.chain_distance(make_pair(chain_end_rank, true), make_pair(start_rank, false), chain_end_len, start_len)};
+        };
+        level.to_ends1 = chain_ends(start_rank1, end_rank1, start_len1, end_len1);
+        level.to_ends2 = lowest_ancestor ? chain_ends(start_rank2, end_rank2, start_len2, end_len2) : level.to_ends1;
+    } else {
+        //The two nodes are in the parent snarl
+
+        size_t parent_snarl_index = get_primary_assignment(parent.first);
+        const SnarlIndex& snarl_index = snarl_indexes[parent_snarl_index];
+
+        size_t rank1 = get_primary_assignment(snarl_tree_node1.first)  == parent_snarl_index
+                       ? get_primary_rank(snarl_tree_node1.first) : get_secondary_rank(snarl_tree_node1.first);
+        size_t rev_rank1;
+        if (snarl_tree_node1.second) {
+            //If this node is reversed
+            rev_rank1 = rank1;
+            rank1 = rev_rank1 % 2 == 0 ? rev_rank1 + 1 : rev_rank1 - 1;
         } else {
-            //The two nodes are in the parent snarl
-
-            size_t parent_snarl_index = get_primary_assignment(parent.first);
-            const SnarlIndex& snarl_index = snarl_indexes[parent_snarl_index];
+            rev_rank1 = rank1 % 2 == 0 ? rank1 + 1 : rank1 - 1;
+        }
 
-            size_t rank1 = get_primary_assignment(snarl_tree_node1.first)  == parent_snarl_index
-                           ? get_primary_rank(snarl_tree_node1.first) : get_secondary_rank(snarl_tree_node1.first);
-            size_t rev_rank1;
-            if (snarl_tree_node1.second) {
+        size_t rev_rank2 ;
+        size_t rank2;
+        if (lowest_ancestor) {
+            rank2 = get_primary_assignment(snarl_tree_node2.first ) == parent_snarl_index
+                     ? get_primary_rank(snarl_tree_node2.first) : get_secondary_rank(snarl_tree_node2.first);
+            if (snarl_tree_node2.second) {
                 //If this node is reversed
-                rev_rank1 = rank1;
-                rank1 = rev_rank1 % 2 == 0 ? rev_rank1 + 1 : rev_rank1 - 1;
+                rev_rank2 = rank2;
+                rank2 = rev_rank2 % 2 == 0 ?  rev_rank2 + 1 : rev_rank2 - 1;
             } else {
-                rev_rank1 = rank1 % 2 == 0 ? rank1 + 1 : rank1 - 1;
+                rev_rank2 = rank2 % 2 == 0 ?  rank2 + 1 : rank2 - 1;
             }
+        } else {
+            rank2 = rank1;
+            rev_rank2 = rev_rank1;
+        }
 
-            size_t rev_rank2 ;
-            size_t rank2;
-            if (lowest_ancestor) {
-                rank2 = get_primary_assignment(snarl_tree_node2.first ) == parent_snarl_index
-                         ? get_primary_rank(snarl_tree_node2.first) : get_secondary_rank(snarl_tree_node2.first);
-                if (snarl_tree_node2.second) {
-                    //If this node is reversed
-                    rev_rank2 = rank2;
-                    rank2 = rev_rank2 % 2 == 0 ?  rev_rank2 + 1 : rev_rank2 - 1;
-                } else {
-                    rev_rank2 = rank2 % 2 == 0 ?  rank2 + 1 : rank2 - 1;
-                }
-            } else {
-                rank2 = rank1;
-                rev_rank2 = rev_rank1;
-            }
+        level.between[0] = snarl_index.snarl_distance(rank1, rank2);
+        level.between[1] = snarl_index.snarl_distance(rank1, rev_rank2);
+        level.between[2] = snarl_index.snarl_distance(rev_rank1, rank2);
+        level.between[3] = snarl_index.snarl_distance(rev_rank1, rev_rank2);
 
+        //Distances to the ends of the parent snarl
+        level.to_ends1 = snarl_index.end_distances(rank1);
+        level.to_ends2 = lowest_ancestor ? snarl_index.end_distances(rank2) : level.to_ends1;
+    }
+}
 
-            int64_t d1 = snarl_index.snarl_distance(rank1, rank2);
-            d1 = (distR1 == -1 || distL2 == -1 || d1 == -1) ? -1 : distR1 + distL2 + d1; 
+void MinimumDistanceIndex::apply_ancestor_level(const AncestorLevel& level, int64_t& distL1, int64_t& distR1,
+                                                int64_t& distL2, int64_t& distR2, int64_t& shortest_distance) {
+    if (level.is_chain) {
+        if (level.swap1) {
+            std::swap(distL1, distR1);
+        }
+        if (level.swap2) {
+            std::swap(distL2, distR2);
+        }
+        int64_t start_len1 = level.start_len1;
+        int64_t end_len1 = level.end_len1;
 
-            int64_t d2 = snarl_index.snarl_distance(rank1, rev_rank2);
+        //Distance from left of s1 (reverse), left of s2 (forward)
+        int64_t d1 = level.between[0];
+        d1 = (distL1 == -1 || distL2 == -1 || d1 == -1) ? -1 : distL1 + distL2 + d1 - start_len1;
 
-            d2 = (distR1 == -1 || distR2 == -1 || d2 == -1) ? -1 : distR1 + distR2 + d2;
-            int64_t d3 = snarl_index.snarl_distance(rev_rank1, rank2);
-            d3 = (distL1 == -1 || distL2 == -1 || d3 == -1) ? -1 :  distL1 + distL2 + d3; 
-            int64_t d4 = snarl_index.snarl_distance(rev_rank1, rev_rank2);
-            d4 = (distL1 == -1 || distR2 == -1 || d4 == -1) ? -1 :  distL1 + distR2 + d4; 
+        //Distance from left of s1 (reverse) to right of s2 (reverse)
+        int64_t d2;
+        if (level.shared_start_end) {
+            d2 = (distL1 == -1 || distR2 == -1) ? -1 :  distL1 + distR2 - start_len1; 
+        } else {
+            d2 = level.between[1];
+            d2 = (distL1 == -1 || distR2 == -1 || d2 == -1) ? -1 :  distL1 + distR2 + d2 - start_len1;
+        }
 
-            shortest_distance =  min_pos({d1, d2, d3, d4, shortest_distance});
+        //Distance from right of s1 (fd) to left of s2 (fd)
+        int64_t d3;
+        if (level.shared_end_start) {
+            d3 = (distR1 == -1 || distL2 == -1) ? -1 :  distR1 + distL2 - end_len1; 
+        } else {
+            d3 = level.between[2];
+            d3 = (distR1 == -1 || distL2 == -1 || d3 == -1) ? -1 : distR1 + distL2 + d3 - end_len1; 
+        }
 
-            
-            
-            //Find distances to the ends of the parent snarl
-            tie (distL1, distR1) = snarl_index.dist_to_ends(rank1, distL1, distR1);
-
-            tie (distL2, distR2) = snarl_index.dist_to_ends(rank2, distL2, distR2);
-             
-
-            snarl_tree_node1 = make_pair(snarl_index.id_in_parent, snarl_index.rev_in_parent);
-
-#        ifdef debugDistance
-            cerr << "At ancestor snarl " << snarl_indexes[get_primary_assignment( parent.first)].id_in_parent << endl;
-            cerr << "  Distances within ancestor: " << d1 << ", " << d2
-                                                << ", " << d3 << ", " << d4 << endl;
-            cerr << "  Shortest dist: " << shortest_distance
-                << endl;
-            cerr << "  Distances to ends of ancestor: " << distL1 << " " << distR1
-                 << " " << distL2 << " " << distR2 
-                << endl;
-#        endif
-            parent = make_pair(snarl_index.parent_id, snarl_index.in_chain);
+        //Distance from right of s1 (fd) to right of s2 (rev)
+        int64_t d4 = level.between[3];
+        d4 = (distR1 == -1 || distR2 == -1 || d4 == -1) ? -1 : distR1 + distR2 + d4 - end_len1;
 
-        }
-        lowest_ancestor = false;
+        shortest_distance = min_pos({d1, d2, d3, d4, shortest_distance});
+    } else {
+        int64_t d1 = level.between[0];
+        d1 = (distR1 == -1 || distL2 == -1 || d1 == -1) ? -1 : distR1 + distL2 + d1; 
+        int64_t d2 = level.between[1];
+        d2 = (distR1 == -1 || distR2 == -1 || d2 == -1) ? -1 : distR1 + distR2 + d2;
+        int64_t d3 = level.between[2];
+        d3 = (distL1 == -1 || distL2 == -1 || d3 == -1) ? -1 :  distL1 + distL2 + d3; 
+        int64_t d4 = level.between[3];
+        d4 = (distL1 == -1 || distR2 == -1 || d4 == -1) ? -1 :  distL1 + distR2 + d4; 
+
+        shortest_distance =  min_pos({d1, d2, d3, d4, shortest_distance});
     }
 
-    shortest_distance = shortest_distance == -1 ? -1 : shortest_distance - 1;
-    return shortest_distance;
+    //Extend distances of both positions to the ends of the snarl or chain
+    tie (distL1, distR1) = lift_to_ends(level.to_ends1, distL1, distR1);
+    tie (distL2, distR2) = lift_to_ends(level.to_ends2, distL2, distR2);
 
-};
+#ifdef debugDistance
+    cerr << "  Shortest dist: " << shortest_distance << endl;
+    cerr << "  Distances to ends of ancestor: " << distL1 << " " << distR1
+         << " " << distL2 << " " << distR2 << endl;
+#endif
+}
+
+pair<int64_t, int64_t> MinimumDistanceIndex::lift_to_ends(const array<int64_t, 4>& to_ends, 
+                                                          int64_t distL, int64_t distR) {
+    int64_t dsl = to_ends[0] == -1 || distL == -1 ? -1 : distL + to_ends[0];
+    int64_t dsr = to_ends[1] == -1 || distR == -1 ? -1 : distR + to_ends[1];
+    int64_t der = to_ends[2] == -1 || distR == -1 ? -1 : distR + to_ends[2];
+    int64_t del = to_ends[3] == -1 || distL == -1 ? -1 : distL + to_ends[3];
+
+    return make_pair(min_pos(dsr, dsl), min_pos(der, del));
+}
 
 tuple<int64_t, int64_t, pair<id_t, bool>> MinimumDistanceIndex::dist_to_common_ancestor(
           pair<size_t, bool> common_ancestor, pos_t& pos, bool rev) const {
@@ -1713,13 +1842,13 @@ void MinimumDistanceIndex::print_self() const {
 
              cerr << snarl_indexes[primary_snarl_assignments[i]-1].id_in_parent  << "\t" << primary_snarl_ranks[i]-1 << "\t";
 
-            if (has_secondary_snarl_bv[i] == 0) {
+            if (has_secondary_snarl[i] == 0) {
                 cerr << "/\t/\t";
             } else {
                 cerr << snarl_indexes[secondary_snarl_assignments[has_secondary_snarl.rank(i)]-1].id_in_parent 
                      << "\t" << secondary_snarl_ranks[has_secondary_snarl.rank(i)]-1 << "\t";
             }
-            if (has_chain_bv[i] == 0) {
+            if (has_chain[i] == 0) {
                 cerr << "/\t/\t";
             } else {
                 cerr << chain_indexes[chain_assignments[has_chain.rank(i)]-1].id_in_parent 
@@ -1752,15 +1881,15 @@ MinimumDistanceIndex::SnarlIndex::SnarlIndex(
         nodes in a snarl */
     size_t size = num_nodes * 2;
     is_simple_snarl = true;
-    util::assign(distances, int_vector<>((((size+1)*size)/2) + (size/2), 0));
+    distances = int_vector<>((((size+1)*size)/2) + (size/2), 0);
 }
 
 MinimumDistanceIndex::SnarlIndex::SnarlIndex()  {
 }
 void MinimumDistanceIndex::SnarlIndex::load(istream& in, bool include_component){
-    /*Load contents of SnarlIndex from serialization */
+    /*Load contents of SnarlIndex from an older serialization */
     
-    distances.load(in);
+    distances.load_sdsl(in);
 
     sdsl::read_member(in_chain, in);
     sdsl::read_member(parent_id, in);
@@ -1785,17 +1914,35 @@ void MinimumDistanceIndex::SnarlIndex::serialize(ostream& out) const {
 
     distances.serialize(out);
 
-    sdsl::write_member(in_chain, out);
-    sdsl::write_member(parent_id, out);
-    sdsl::write_member(rev_in_parent, out);
-    sdsl::write_member(id_in_parent, out);
-    sdsl::write_member(end_id, out);
-    sdsl::write_member(num_nodes, out);
-    sdsl::write_member(depth, out);
-    sdsl::write_member(is_unary_snarl, out);
-    sdsl::write_member(is_simple_snarl, out);
-    sdsl::write_member(max_width, out);
+    //Everything is a whole word so the next snarl stays aligned
+    sdsl::write_member((uint64_t) in_chain, out);
+    sdsl::write_member((uint64_t) parent_id, out);
+    sdsl::write_member((uint64_t) rev_in_parent, out);
+    sdsl::write_member((uint64_t) id_in_parent, out);
+    sdsl::write_member((uint64_t) end_id, out);
+    sdsl::write_member((uint64_t) num_nodes, out);
+    sdsl::write_member((uint64_t) depth, out);
+    sdsl::write_member((uint64_t) is_unary_snarl, out);
+    sdsl::write_member((uint64_t) is_simple_snarl, out);
+    sdsl::write_member((uint64_t) max_width, out);
+
+}
 
+void MinimumDistanceIndex::SnarlIndex::map(const uint64_t*& cursor, const uint64_t* end) {
+    /*Point the distances at the serialization in place and read the rest*/
+
+    distances.map(cursor, end);
+
+    in_chain = MappableIntVector::map_word(cursor, end);
+    parent_id = MappableIntVector::map_word(cursor, end);
+    rev_in_parent = MappableIntVector::map_word(cursor, end);
+    id_in_parent = MappableIntVector::map_word(cursor, end);
+    end_id = MappableIntVector::map_word(cursor, end);
+    num_nodes = MappableIntVector::map_word(cursor, end);
+    depth = MappableIntVector::map_word(cursor, end);
+    is_unary_snarl = MappableIntVector::map_word(cursor, end);
+    is_simple_snarl = MappableIntVector::map_word(cursor, end);
+    max_width = MappableIntVector::map_word(cursor, end);
 }
 
 
@@ -1858,6 +2005,10 @@ pair<int64_t, int64_t> MinimumDistanceIndex::SnarlIndex::dist_to_ends(size_t ran
        either end of the snarl
        Rev is true if the node is reversed in the snarl
     */
+    return lift_to_ends(end_distances(rank), distL, distR);
+}
+
+array<int64_t, 4> MinimumDistanceIndex::SnarlIndex::end_distances(size_t rank) const {
     int64_t start_len = node_length(0);
     int64_t end_len = is_unary_snarl ? start_len : node_length(num_nodes * 2 - 1);
     size_t rev_rank = rank % 2 == 0 ? rank + 1 : rank - 1;
@@ -1889,17 +2040,8 @@ pair<int64_t, int64_t> MinimumDistanceIndex::SnarlIndex::dist_to_ends(size_t ran
     } else if (rev_rank == end_rank) {
         der = 0;
     }
- 
-    dsl = dsl == -1 || distL == -1 ? -1 : distL + dsl;
-    dsr = dsr == -1 || distR == -1 ? -1 : distR + dsr;
-    der = der == -1 || distR == -1 ? -1 : distR + der;
-    del = del == -1 || distL == -1 ? -1 : distL + del;
-
-    int64_t dist_start = min_pos(dsr, dsl);
-
-    int64_t dist_end = min_pos(der, del);
 
-    return make_pair(dist_start, dist_end);
+    return {dsl, dsr, der, del};
 }
 
 bool MinimumDistanceIndex::SnarlIndex::is_trivial_snarl() const {
@@ -1981,19 +2123,19 @@ MinimumDistanceIndex::ChainIndex::ChainIndex(
                 is_looping_chain(loops), rev_in_parent(rev_in_parent), max_width(0) {
     
 
-    util::assign(prefix_sum, int_vector<>(length+2, 0));
-    util::assign(loop_fd, int_vector<>(length+1, 0));
-    util::assign(loop_rev, int_vector<>(length+1, 0));
+    prefix_sum = int_vector<>(length+2, 0);
+    loop_fd = int_vector<>(length+1, 0);
+    loop_rev = int_vector<>(length+1, 0);
 
 }
 MinimumDistanceIndex::ChainIndex::ChainIndex()  {
 }
 void MinimumDistanceIndex::ChainIndex::load(istream& in){
-    //Populate object from serialization 
+    //Populate object from an older serialization 
     //
-    prefix_sum.load(in);
-    loop_fd.load(in);
-    loop_rev.load(in);
+    prefix_sum.load_sdsl(in);
+    loop_fd.load_sdsl(in);
+    loop_rev.load_sdsl(in);
 
     sdsl::read_member(parent_id, in);
     sdsl::read_member(rev_in_parent, in);
@@ -2013,15 +2155,30 @@ void MinimumDistanceIndex::ChainIndex::serialize(ostream& out) const {
     loop_fd.serialize(out);
     loop_rev.serialize(out);
 
-    sdsl::write_member(parent_id, out);
-    sdsl::write_member(rev_in_parent, out);
-    sdsl::write_member(id_in_parent, out);
-    sdsl::write_member(end_id, out);
-    sdsl::write_member(is_looping_chain, out);
-    sdsl::write_member(max_width, out);
+    //Everything is a whole word so the next chain stays aligned
+    sdsl::write_member((uint64_t) parent_id, out);
+    sdsl::write_member((uint64_t) rev_in_parent, out);
+    sdsl::write_member((uint64_t) id_in_parent, out);
+    sdsl::write_member((uint64_t) end_id, out);
+    sdsl::write_member((uint64_t) is_looping_chain, out);
+    sdsl::write_member((uint64_t) max_width, out);
    
 
 }
+
+void MinimumDistanceIndex::ChainIndex::map(const uint64_t*& cursor, const uint64_t* end) {
+    //Point the vectors at the serialization in place and read the rest
+    prefix_sum.map(cursor, end);
+    loop_fd.map(cursor, end);
+    loop_rev.map(cursor, end);
+
+    parent_id = MappableIntVector::map_word(cursor, end);
+    rev_in_parent = MappableIntVector::map_word(cursor, end);
+    id_in_parent = MappableIntVector::map_word(cursor, end);
+    end_id = MappableIntVector::map_word(cursor, end);
+    is_looping_chain = MappableIntVector::map_word(cursor, end);
+    max_width = MappableIntVector::map_word(cursor, end);
+}
 int64_t MinimumDistanceIndex::ChainIndex::loop_distance(
          pair<size_t, bool> start, pair<size_t, bool> end, 
          int64_t start_len, int64_t end_len) const {
@@ -2149,20 +2306,20 @@ void MinimumDistanceIndex::ChainIndex::print_self() const {
     
     cerr << "Distances:" << endl;
     cerr << endl;
-    for (auto n : prefix_sum) {
-        cerr << (int64_t)n - 1 << " ";
+    for (size_t i = 0 ; i < prefix_sum.size() ; i++) {
+        cerr << (int64_t)prefix_sum[i] - 1 << " ";
     }
     cerr << endl; 
     cerr << "Loop Forward:" << endl;
     cerr << endl;
-    for (auto n : loop_fd) {
-        cerr << (int64_t)n - 1 << " ";
+    for (size_t i = 0 ; i < loop_fd.size() ; i++) {
+        cerr << (int64_t)loop_fd[i] - 1 << " ";
     }
     cerr << endl; 
     cerr << "Loop Reverse:" << endl;
     cerr << endl;
-    for (auto n : loop_rev) {
-        cerr << (int64_t)n - 1 << " ";
+    for (size_t i = 0 ; i < loop_rev.size() ; i++) {
+        cerr << (int64_t)loop_rev[i] - 1 << " ";
     }
     cerr << endl;
 }
@@ -2175,8 +2332,8 @@ void MinimumDistanceIndex::calculate_max_index(const HandleGraph* graph, int64_t
     min_distances.resize(max_node_id - min_node_id + 1);
     max_distances.resize(max_node_id - min_node_id + 1);
 
-    sdsl::util::set_to_value(min_distances, 0);
-    sdsl::util::set_to_value(max_distances, 0);
+    min_distances.set_to_value(0);
+    max_distances.set_to_value(0);
 
 
     unordered_map<id_t, pair<id_t, bool>> split_to_id;
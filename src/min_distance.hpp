@@ -1,11 +1,15 @@
 #ifndef VG_MIN_DISTANCE_HPP_INCLUDED
 #define VG_MIN_DISTANCE_HPP_INCLUDED
 
+#include <array>
 #include <unordered_set>
 #include <jansson.h>
 
 #include "snarls.hpp"
 #include "hash_map.hpp"
+#include "mappable_int_vector.hpp"
+
+#include <mio/mmap.hpp>
 
 #include "bdsg/hash_graph.hpp"
 
@@ -45,6 +49,12 @@ class MinimumDistanceIndex {
     //Load serialized object from in. Does not rely on the internal graph or 
     //snarl manager pointers.
     void load(istream& in);
+
+    //Memory-map a file holding a bare serialized index in the current format
+    //and query it in place, without reading it into memory. Returns false,
+    //leaving the index empty, if the file can't be mapped or holds anything
+    //else.
+    bool load_mapped(const string& filename);
     
     //Get the length of the given node
     int64_t node_length(id_t id) const;
@@ -55,6 +65,13 @@ class MinimumDistanceIndex {
     ///If there is no path between the two positions then the distance is -1
     int64_t min_distance( pos_t pos1, pos_t pos2) const;
 
+    ///Get the minimum distance between each of a batch of pairs of positions,
+    ///as min_distance() would. Queries are answered grouped by where their
+    ///positions are in the snarl tree, so work on the ancestors they share is
+    ///only done once. This is faster than asking one pair at a time when
+    ///many pairs fall in the same snarls, as they do when clustering seeds.
+    vector<int64_t> min_distance(const vector<pair<pos_t, pos_t>>& position_pairs) const;
+
     ///Get a maximum distance bound between the positions, ignoring direction
     ///Returns a positive value even if the two nodes are unreachable
     int64_t max_distance(pos_t pos1, pos_t pos2) const;
@@ -134,11 +151,15 @@ class MinimumDistanceIndex {
             //Construct an empty SnarlIndex. Must call load after construction to populate it 
             SnarlIndex();
 
-            //Load data from serialization
+            //Load data from an older serialization
             void load(istream& in, bool include_component);
 
             ///Serialize the snarl
             void serialize(ostream& out) const;
+
+            ///Point the snarl at its serialization in memory, and advance
+            ///cursor past it
+            void map(const uint64_t*& cursor, const uint64_t* end);
             
             ///Distance between start and end, not including the lengths of
             ///the two nodes
@@ -172,6 +193,12 @@ class MinimumDistanceIndex {
             pair<int64_t, int64_t> dist_to_ends(size_t rank, 
                                               int64_t distL, int64_t distR) const;
 
+            ///Distances from the start of the snarl to the left and right
+            ///of the node at rank, and from the end of the snarl to the
+            ///right and left of the node, including the boundary node
+            ///lengths. -1 if there is no path
+            array<int64_t, 4> end_distances(size_t rank) const;
+
             ///For use during construction,
             ///add the distance from start to end to the index
             void insert_distance(size_t start, size_t end, int64_t dist);
@@ -192,7 +219,7 @@ class MinimumDistanceIndex {
             /// For child snarls that are unary or only connected to one node
             /// in the snarl, distances between that node leaving the snarl
             /// and any other node is -1
-            int_vector<> distances;
+            MappableIntVector distances;
 
             ///True if this snarl is in a chain
             bool in_chain;
@@ -253,11 +280,15 @@ class MinimumDistanceIndex {
 
             //Constructor from vector of ints after serialization
             ChainIndex();
-            //Load data from serialization
+            //Load data from an older serialization
             void load(istream& in);
 
             ///Serialize the chain
             void serialize(ostream& out) const;
+
+            ///Point the chain at its serialization in memory, and advance
+            ///cursor past it
+            void map(const uint64_t*& cursor, const uint64_t* end);
        
              
             ///Distance between two node sides in a chain. 
@@ -290,18 +321,18 @@ class MinimumDistanceIndex {
             ///the length of the first node in the chain. Similarly, an extra
             ///value is stored at the end of the vector that is the length of the
             ///entire chain
-            int_vector<> prefix_sum;
+            MappableIntVector prefix_sum;
 
             ///For each boundary node of snarls in the chain, the distance
             /// from the start of the node traversing forward to the end of 
             /// the same node traversing backwards -directions relative to the 
             /// direction the node is traversed in the chain
-            int_vector<> loop_fd;
+            MappableIntVector loop_fd;
     
             ///For each boundary node of snarls in the chain, the distance
             /// from the end of the node traversing backward to the start of 
             /// the same node traversing forward
-            int_vector<> loop_rev;
+            MappableIntVector loop_rev;
 
             /// id of parent snarl of the chain 
             ///0 if top level chain
@@ -345,10 +376,10 @@ class MinimumDistanceIndex {
     //Each connected component of the graph gets a unique identifier
     //Identifiers start at 1, 0 indicates that it is not in a component
     //Assigns each node to its connected component
-    sdsl::int_vector<> node_to_component;
+    MappableIntVector node_to_component;
     //TODO: These could be one vector but they're small enough it probably doesn't matter
-    sdsl::int_vector<> component_to_chain_length;
-    sdsl::int_vector<> component_to_chain_index;
+    MappableIntVector component_to_chain_length;
+    MappableIntVector component_to_chain_index;
 
     //Each of the ints in these vectors are offset by 1: 0 is stored as 1, etc.
     //This is so that we can store -1 as 0 instead of int max
@@ -358,7 +389,7 @@ class MinimumDistanceIndex {
     ///containing the node
     ///A primary snarl is the snarl that contains this node as an actual node,
     ///as opposed to a node representing a snarl or chain
-    sdsl::int_vector<> primary_snarl_assignments;
+    MappableIntVector primary_snarl_assignments;
 
     ///For each node, stores the rank of the node in the snarlIndex
     /// indicated by primary_snarl_assignments
@@ -371,7 +402,7 @@ class MinimumDistanceIndex {
     /// If the start node is traversed backwards to enter the snarl, then the
     /// rank 0 will represent the start node in reverse. The rank stored in this
     /// vector will be 1, representing the start node forward
-    sdsl::int_vector<> primary_snarl_ranks;
+    MappableIntVector primary_snarl_ranks;
 
     ///Similar to primary snarls, stores snarl index of secondary snarl
     ///each node belongs to, if any.
@@ -379,23 +410,21 @@ class MinimumDistanceIndex {
     ///netgraph of the parent snarl or a node that participates in multiple
     ///snarls in a chain. The primary snarl will always
     ///be the snarl that occurs first in the chain
-    sdsl::int_vector<> secondary_snarl_assignments;
+    MappableIntVector secondary_snarl_assignments;
 
     ///Stores the ranks of nodes in secondary snarls
-    sdsl::int_vector<> secondary_snarl_ranks;
+    MappableIntVector secondary_snarl_ranks;
     
     ///For each node, stores 1 if the node is in a secondary snarl and 0
     ///otherwise. Use rank to find which index into secondary_snarls
     ///a node's secondary snarl is at
-    sdsl::bit_vector has_secondary_snarl_bv;
-    sdsl::rank_support_v<1> has_secondary_snarl;
+    MappableBitVector has_secondary_snarl;
 
     ///For each node, store the index and rank for the chain that the node
     ///belongs to, if any
-    sdsl::int_vector<> chain_assignments;
-    sdsl::int_vector<> chain_ranks;
-    sdsl::bit_vector has_chain_bv;
-    sdsl::rank_support_v<1> has_chain;
+    MappableIntVector chain_assignments;
+    MappableIntVector chain_ranks;
+    MappableBitVector has_chain;
 
     id_t min_node_id; //minimum node id of the graph
     id_t max_node_id; //maximum node id of the graph
@@ -412,18 +441,29 @@ class MinimumDistanceIndex {
  
     ///For each node in the graph, store the minimum and maximum
     ///distances from a tip to the node
-    sdsl::int_vector<> min_distances;
-    sdsl::int_vector<> max_distances;
+    MappableIntVector min_distances;
+    MappableIntVector max_distances;
 
 
-    //Header for the serialized file
-    string file_header = "distance index version 2.2";
+    //Header for the serialized file. Version 3 is laid out in 64-bit words
+    //so that it can be queried in place; the header is a whole number of words
+    //long to keep everything after it aligned.
+    string file_header = "distance index version 3";
+    //Older versions are read into memory
     //TODO: version 2 (no .anything) doesn't include component but we'll still accept it
     //version 2.1 doesn't include snarl index.is_simple_snarl and will break if we try to load it 
     bool include_component; //TODO: This is true for version 2.2 so it includes node_to_component, etc. 
 
+    //If the index was loaded in the current format, the memory that all the
+    //vectors point into: either a mapping of the file or a copy of the stream
+    unique_ptr<mio::mmap_source> mapping;
+    vector<uint64_t> loaded_words;
+
     ////// Private helper functions
- 
+
+    ///Point all the vectors at an index in the current format, given the
+    ///words after the header
+    void map_words(const uint64_t* cursor, const uint64_t* end);
 
 
 
@@ -467,6 +507,71 @@ class MinimumDistanceIndex {
     tuple<int64_t, int64_t, pair<id_t, bool>> dist_to_common_ancestor(
                 pair<size_t, bool> common_ancestor, pos_t& pos, bool rev) const;
 
+    ///A snarl or chain above a node in the snarl tree
+    struct SnarlTreeAncestor {
+        //The node id it is known by, as stored in parent_id
+        id_t id;
+        bool is_chain;
+        //Index into chain_indexes or snarl_indexes
+        size_t assignment;
+    };
+
+    ///Fill ancestors with the snarls and chains containing the given node,
+    ///from the bottom up
+    void get_ancestors(id_t node_id, vector<SnarlTreeAncestor>& ancestors) const;
+
+    ///Find the lowest entry of ancestors2 that is also in ancestors1, or
+    ///null if there is none. The result points into ancestors2
+    static const SnarlTreeAncestor* lowest_common_ancestor(const vector<SnarlTreeAncestor>& ancestors1,
+                                                           const vector<SnarlTreeAncestor>& ancestors2);
+
+    ///The lookups needed to combine the distances from two positions to the
+    ///ends of their children of an ancestor, and to carry them up to the 
+    ///ends of the ancestor. These don't depend on the positions, so they 
+    ///can be shared by queries under the same ancestor
+    struct AncestorLevel {
+        bool is_chain;
+        //For a chain, whether the distances of each child must be swapped
+        //because the child is reversed in the chain
+        bool swap1;
+        bool swap2;
+        //For a chain, the lengths of the boundary nodes of the first child
+        int64_t start_len1;
+        int64_t end_len1;
+        //For a chain, whether the two children share a boundary node
+        bool shared_start_end;
+        bool shared_end_start;
+        //Distances between the sides of the two children
+        int64_t between[4];
+        //Distances from the sides of each child to the ends of the ancestor,
+        //as returned by SnarlIndex::end_distances
+        array<int64_t, 4> to_ends1;
+        array<int64_t, 4> to_ends2;
+    };
+
+    ///Fill level for the children snarl_tree_node1 and snarl_tree_node2 of
+    ///parent. If lowest_ancestor is false then both children are
+    ///snarl_tree_node1
+    void get_ancestor_level(const pair<id_t, bool>& parent, const pair<id_t, bool>& snarl_tree_node1,
+                            const pair<id_t, bool>& snarl_tree_node2, bool lowest_ancestor,
+                            AncestorLevel& level) const;
+
+    ///Replace ancestor with its parent and snarl_tree_node with ancestor as
+    ///it is known in its parent
+    void go_up(pair<id_t, bool>& ancestor, pair<id_t, bool>& snarl_tree_node) const;
+
+    ///Update shortest_distance with the paths through a level and carry the
+    ///distances of both positions to the ends of the level
+    static void apply_ancestor_level(const AncestorLevel& level, int64_t& distL1, int64_t& distR1,
+                                     int64_t& distL2, int64_t& distR2, int64_t& shortest_distance);
+
+    ///Given the results of SnarlIndex::end_distances for a node and the 
+    ///distances to its sides, get the distances to the start and end
+    static pair<int64_t, int64_t> lift_to_ends(const array<int64_t, 4>& to_ends, int64_t distL, int64_t distR);
+
+    ///Distance between positions on the same node and strand, +1, or -1 
+    static int64_t same_node_distance(pos_t pos1, pos_t pos2);
+
 
     /// Get the index into chain_indexes/rank in chain of node i.
     /// Detects and throws an error if node i never got assigned to a snarl.
@@ -512,6 +617,10 @@ class MinimumDistanceIndex {
 
 };
 
+/// Load a distance index from a file. A bare index in the current format is
+/// memory-mapped and queried in place; anything else is loaded through VPKG.
+unique_ptr<MinimumDistanceIndex> load_minimum_distance_index(const string& filename);
+
 /**
  * The encoding of distances for positions in top-level chains or top-level simple bubbles.
  * Either stores (chain id, chain offset) for a position on a top-level chain, or
@@ -10,6 +10,8 @@
 #include "multipath_alignment.hpp"
 #include "split_strand_graph.hpp"
 #include "subgraph.hpp"
+#include "wavefront_aligner.hpp"
+#include "allocation_counter.hpp"
 
 #include <bdsg/overlays/strand_split_overlay.hpp>
 #include <gbwtgraph/algorithms.h>
@@ -40,7 +42,73 @@ MinimizerMapper::MinimizerMapper(const gbwtgraph::GBWTGraph& graph,
     extender(gbwt_graph, *(get_regular_aligner())), clusterer(distance_index),
     fragment_length_distr(1000,1000,0.95) {
 
-   
+    // Make a slot for each thread's workspace
+    workspaces.resize(omp_get_max_threads());
+}
+
+//-----------------------------------------------------------------------------
+
+constexpr size_t MinimizerMapper::Workspace::CACHE_RESET_INTERVAL;
+
+MinimizerMapper::Workspace::Workspace() : minimizers_by_read(2), seeds_by_read(2), funnels(2) {
+    // Nothing else to do
+}
+
+void MinimizerMapper::Workspace::reset(const gbwtgraph::GBWTGraph& graph) {
+    for (auto& minimizers : minimizers_by_read) {
+        minimizers.clear();
+    }
+    for (auto& seeds : seeds_by_read) {
+        seeds.clear();
+    }
+    seed_matchings.clear();
+    buffer_growths = 0;
+
+    if (cached_graph.get() == nullptr || cached_graph_uses >= CACHE_RESET_INTERVAL) {
+        // The cache grows with every node it sees, so start over once in a while.
+        cached_graph.reset(new gbwtgraph::CachedGBWTGraph(graph));
+        cached_graph_uses = 0;
+        buffer_growths++;
+    }
+    cached_graph_uses++;
+    heap_allocations_at_reset = thread_heap_allocations();
+}
+
+void MinimizerMapper::Workspace::count_buffer_growths() {
+    // List the capacities of all the buffers we manage
+    size_t buffer_count = minimizers_by_read.size() + seeds_by_read.size() + 1;
+    if (known_capacities.size() != buffer_count) {
+        known_capacities.resize(buffer_count, 0);
+    }
+    size_t i = 0;
+    auto check = [&](size_t capacity) {
+        if (capacity > known_capacities[i]) {
+            buffer_growths++;
+            known_capacities[i] = capacity;
+        }
+        i++;
+    };
+    for (auto& minimizers : minimizers_by_read) {
+        check(minimizers.capacity());
+    }
+    for (auto& seeds : seeds_by_read) {
+        check(seeds.capacity());
+    }
+    check(seed_matchings.bucket_count());
+}
+
+size_t MinimizerMapper::Workspace::heap_allocations() const {
+    return thread_heap_allocations() - heap_allocations_at_reset;
+}
+
+MinimizerMapper::Workspace& MinimizerMapper::get_workspace(unique_ptr<Workspace>& fallback) {
+    size_t thread_num = omp_get_thread_num();
+    unique_ptr<Workspace>& slot = (thread_num < workspaces.size() ? workspaces[thread_num] : fallback);
+    if (slot.get() == nullptr) {
+        slot.reset(new Workspace());
+    }
+    slot->reset(gbwt_graph);
+    return *slot;
 }
 
 //-----------------------------------------------------------------------------
@@ -141,12 +209,29 @@ void MinimizerMapper::dump_debug_minimizers(const vector<MinimizerMapper::Minimi
 
 //-----------------------------------------------------------------------------
 
-void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
-    // Ship out all the aligned alignments
-    alignment_emitter.emit_mapped_single(map(aln));
+void MinimizerMapper::map(Alignment& aln, CandidateAlignmentEmitter& alignment_emitter) {
+    vector<CandidateAlignment> mapped = map_candidates(aln);
+    
+    // Ship out all the aligned alignments. This is where they become Alignments, if they ever do.
+    auto output_start = std::chrono::steady_clock::now();
+    alignment_emitter.emit_single(aln, std::move(mapped));
+    if (stage_latencies) {
+        stage_latencies->add_time("output", std::chrono::duration<double>(std::chrono::steady_clock::now() - output_start).count());
+    }
 }
 
 vector<Alignment> MinimizerMapper::map(Alignment& aln) {
+    vector<CandidateAlignment> mapped = map_candidates(aln);
+    
+    vector<Alignment> mappings;
+    mappings.reserve(mapped.size());
+    for (auto& candidate : mapped) {
+        mappings.emplace_back(candidate_to_alignment(aln, candidate));
+    }
+    return mappings;
+}
+
+vector<CandidateAlignment> MinimizerMapper::map_candidates(Alignment& aln) {
     
     if (show_work) {
         #pragma omp critical (cerr)
@@ -156,25 +241,31 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         }
     }
     
-    // Make a new funnel instrumenter to watch us map this read.
-    Funnel funnel;
+    // Get this thread's buffers
+    unique_ptr<Workspace> fallback_workspace;
+    Workspace& workspace = get_workspace(fallback_workspace);
+    
+    // Use its funnel instrumenter to watch us map this read.
+    Funnel& funnel = workspace.funnels[0];
     funnel.start(aln.name());
     
     // Minimizers sorted by score in descending order.
-    std::vector<Minimizer> minimizers = this->find_minimizers(aln.sequence(), funnel);
+    std::vector<Minimizer>& minimizers = workspace.minimizers_by_read[0];
+    this->find_minimizers(aln.sequence(), minimizers, funnel);
 
     // Find the seeds and mark the minimizers that were located.
-    std::vector<Seed> seeds = this->find_seeds(minimizers, aln, funnel);
+    std::vector<Seed>& seeds = workspace.seeds_by_read[0];
+    this->find_seeds(minimizers, aln, seeds, funnel);
 
     // Cluster the seeds. Get sets of input seed indexes that go together.
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.stage("cluster");
     }
-    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, get_distance_limit(aln.sequence().size()));
+    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, get_distance_limit(aln.sequence().size()), workspace.cluster_state);
 
     // Determine the scores and read coverages for each cluster.
     // Also find the best and second-best cluster scores.
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         funnel.substage("score");
     }
     double best_cluster_score = 0.0, second_best_cluster_score = 0.0;
@@ -206,7 +297,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         cluster_score_cutoff = std::min(cluster_score_cutoff, second_best_cluster_score);
     }
 
-    if (track_provenance) {
+    if (track_stages()) {
         // Now we go from clusters to gapless extensions
         funnel.stage("extend");
     }
@@ -275,7 +366,8 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
              
             minimizer_extended_cluster_count.emplace_back(minimizers.size(), 0);
             // Pack the seeds for GaplessExtender.
-            GaplessExtender::cluster_type seed_matchings;
+            GaplessExtender::cluster_type& seed_matchings = workspace.seed_matchings;
+            seed_matchings.clear();
             for (auto seed_index : cluster.seeds) {
                 // Insert the (graph position, read offset) pair.
                 const Seed& seed = seeds[seed_index];
@@ -293,7 +385,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
             }
             
             // Extend seed hits in the cluster into one or more gapless extensions
-            cluster_extensions.emplace_back(std::move(extender.extend(seed_matchings, aln.sequence())));
+            cluster_extensions.emplace_back(std::move(extender.extend(seed_matchings, aln.sequence(), workspace.cached_graph.get())));
 
             kept_cluster_count ++;
             
@@ -356,7 +448,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         
     std::vector<int> cluster_extension_scores = this->score_extensions(cluster_extensions, aln, funnel);
 
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.stage("align");
     }
 
@@ -366,7 +458,9 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
     // Now start the alignment step. Everything has to become an alignment.
 
     // We will fill this with all computed alignments in estimated score order.
-    vector<Alignment> alignments;
+    // They are kept as candidates, and only the ones we output are made into
+    // Alignments.
+    vector<CandidateAlignment> alignments;
     alignments.reserve(cluster_extensions.size());
     // This maps from alignment index back to cluster extension index, for
     // tracing back to minimizers for MAPQ. Can hold
@@ -418,17 +512,17 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
             auto& extensions = cluster_extensions[extension_num];
             
             // Collect the top alignments. Make sure we have at least one always, starting with unaligned.
-            vector<Alignment> best_alignments(1, aln);
+            vector<CandidateAlignment> best_alignments(1);
 
             if (GaplessExtender::full_length_extensions(extensions)) {
                 // We got full-length extensions, so directly convert to an Alignment.
                 
-                if (track_provenance) {
+                if (track_stages()) {
                     funnel.substage("direct");
                 }
                 
                 //Fill in the best alignments from the extension. We know the top one is always full length and exists.
-                this->extension_to_alignment(extensions.front(), best_alignments.front());
+                this->extension_to_candidate(extensions.front(), aln.sequence(), best_alignments.front());
                 
                 if (show_work) {
                     #pragma omp critical (cerr)
@@ -440,8 +534,8 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
                 for (auto next_ext_it = extensions.begin() + 1; next_ext_it != extensions.end() && next_ext_it->full(); ++next_ext_it) {
                     // For all subsequent full length extensions, make them into alignments too.
                     // We want them all to go on to the pairing stage so we don't miss a possible pairing in a tandem repeat.
-                    best_alignments.emplace_back(aln);
-                    this->extension_to_alignment(*next_ext_it, best_alignments.back());
+                    best_alignments.emplace_back();
+                    this->extension_to_candidate(*next_ext_it, aln.sequence(), best_alignments.back());
                     
                     if (show_work) {
                         #pragma omp critical (cerr)
@@ -452,19 +546,19 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
                     
                 }
                 
-                if (track_provenance) {
+                if (track_stages()) {
                     // Stop the current substage
                     funnel.substage_stop();
                 }
             } else if (do_dp) {
                 // We need to do chaining.
                 
-                if (track_provenance) {
+                if (track_stages()) {
                     funnel.substage("chain");
                 }
                 
                 // Do the DP and compute up to 2 alignments
-                best_alignments.emplace_back(aln);
+                best_alignments.emplace_back();
                 find_optimal_tail_alignments(aln, extensions, best_alignments[0], best_alignments[1]);
 
                 if (show_work) {
@@ -474,7 +568,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
                     }
                 }
                 
-                if (track_provenance) {
+                if (track_stages()) {
                     // We're done chaining. Next alignment may not go through this substage.
                     funnel.substage_stop();
                 }
@@ -484,25 +578,25 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
             }
            
             // Have a function to process the best alignments we obtained
-            auto observe_alignment = [&](Alignment& aln) {
-                alignments.emplace_back(std::move(aln));
+            auto observe_alignment = [&](CandidateAlignment& candidate) {
+                alignments.emplace_back(std::move(candidate));
                 alignments_to_source.push_back(extension_num);
 
                 if (track_provenance) {
     
                     funnel.project(extension_num);
-                    funnel.score(alignments.size() - 1, alignments.back().score());
+                    funnel.score(alignments.size() - 1, alignments.back().score);
                 }
                 if (show_work) {
                     #pragma omp critical (cerr)
                     {
                         cerr << log_name() << "Produced alignment from gapless extension group " << extension_num
-                            << " with score " << alignments.back().score() << ": " << pb2json(alignments.back()) << endl;
+                            << " with score " << alignments.back().score << ": " << debug_string(alignments.back().path) << endl;
                     }
                 }
             };
             
-            for(auto aln_it = best_alignments.begin() ; aln_it != best_alignments.end() && aln_it->score() != 0 && aln_it->score() >= best_alignments[0].score() * 0.8; ++aln_it) {
+            for(auto aln_it = best_alignments.begin() ; aln_it != best_alignments.end() && aln_it->score != 0 && aln_it->score >= best_alignments[0].score * 0.8; ++aln_it) {
                 //For each additional alignment with score at least 0.8 of the best score
                 observe_alignment(*aln_it);
             }
@@ -560,7 +654,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
     
     if (alignments.size() == 0) {
         // Produce an unaligned Alignment
-        alignments.emplace_back(aln);
+        alignments.emplace_back();
         alignments_to_source.push_back(numeric_limits<size_t>::max());
         
         if (track_provenance) {
@@ -569,13 +663,13 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         }
     }
     
-    if (track_provenance) {
+    if (track_stages()) {
         // Now say we are finding the winner(s)
         funnel.stage("winner");
     }
     
     // Fill this in with the alignments we will output as mappings
-    vector<Alignment> mappings;
+    vector<CandidateAlignment> mappings;
     mappings.reserve(min(alignments.size(), max_multimaps));
     
     // Grab all the scores in order for MAPQ computation.
@@ -583,13 +677,13 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
     scores.reserve(alignments.size());
     
     process_until_threshold_a(alignments, (std::function<double(size_t)>) [&](size_t i) -> double {
-        return alignments.at(i).score();
+        return alignments.at(i).score;
     }, 0, 1, max_multimaps, [&](size_t alignment_num) {
         // This alignment makes it
         // Called in score order
         
         // Remember the score at its rank
-        scores.emplace_back(alignments[alignment_num].score());
+        scores.emplace_back(alignments[alignment_num].score);
         
         // Remember the output alignment
         mappings.emplace_back(std::move(alignments[alignment_num]));
@@ -606,7 +700,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         // We already have enough alignments, although this one has a good score
         
         // Remember the score at its rank anyway
-        scores.emplace_back(alignments[alignment_num].score());
+        scores.emplace_back(alignments[alignment_num].score);
         
         if (track_provenance) {
             funnel.fail("max-multimaps", alignment_num);
@@ -617,14 +711,14 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         assert(false);
     });
     
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.substage("mapq");
     }
 
     if (show_work) {
         #pragma omp critical (cerr)
         {
-            cerr << log_name() << "Picked best alignment " << pb2json(mappings[0]) << endl;
+            cerr << log_name() << "Picked best alignment with score " << mappings[0].score << ": " << debug_string(mappings[0].path) << endl;
             cerr << log_name() << "For scores";
             for (auto& score : scores) cerr << " " << score << ":" << endl;
         }
@@ -633,7 +727,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
     assert(!mappings.empty());
     // Compute MAPQ if not unmapped. Otherwise use 0 instead of the 50% this would give us.
     // Use exact mapping quality 
-    double mapq = (mappings.front().path().mapping_size() == 0) ? 0 : 
+    double mapq = (mappings.front().path.mapping_size() == 0) ? 0 : 
         get_regular_aligner()->compute_mapping_quality(scores, false) ;
 
 #ifdef print_minimizer_table
@@ -675,10 +769,10 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
     }
         
     // Make sure to clamp 0-60.
-    mappings.front().set_mapping_quality(max(min(mapq, 60.0), 0.0));
+    mappings.front().mapping_quality = max(min(mapq, 60.0), 0.0);
    
     
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.substage_stop();
     }
     
@@ -687,15 +781,28 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
         auto& out = mappings[i];
         
         // Assign primary and secondary status
-        out.set_is_secondary(i > 0);
+        out.is_secondary = i > 0;
     }
     
     // Stop this alignment
     funnel.stop();
+
+    if (stage_latencies) {
+        stage_latencies->add(funnel);
+    }
     
     if (track_provenance) {
+        // Count the heap allocations for this read before annotating makes more.
+        size_t heap_allocations = workspace.heap_allocations();
+        
         funnel.annotate_mapped_alignment(mappings[0], track_correctness);
         
+        // Report how often the reused buffers had to grow for this read, and
+        // how much allocating mapping it really took.
+        workspace.count_buffer_growths();
+        set_annotation(mappings[0], "workspace_buffer_growths", (double) workspace.buffer_growths);
+        set_annotation(mappings[0], "heap_allocations", (double) heap_allocations);
+        
         // Annotate with parameters used for the filters.
         set_annotation(mappings[0], "param_hit-cap", (double) hit_cap);
         set_annotation(mappings[0], "param_hard-hit-cap", (double) hard_hit_cap);
@@ -727,7 +834,7 @@ vector<Alignment> MinimizerMapper::map(Alignment& aln) {
              assert(minimizer.hits<=hard_hit_cap) ;
          }
     }
-    cerr << "\t" << uncapped_mapq << "\t" << mapq_explored_cap << "\t"  << mappings.front().mapping_quality() << "\t";
+    cerr << "\t" << uncapped_mapq << "\t" << mapq_explored_cap << "\t"  << mappings.front().mapping_quality << "\t";
     cerr << "\t";
     for (auto& score : scores) {
         cerr << score << ",";
@@ -769,25 +876,50 @@ void MinimizerMapper::pair_all(pair<vector<Alignment>, vector<Alignment>>& mappi
 
 pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment& aln1, Alignment& aln2,
                                                       vector<pair<Alignment, Alignment>>& ambiguous_pair_buffer){
+    return candidates_to_alignments(aln1, aln2, map_paired_candidates(aln1, aln2, ambiguous_pair_buffer));
+}
+
+pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment& aln1, Alignment& aln2) {
+    return candidates_to_alignments(aln1, aln2, map_paired_candidates(aln1, aln2));
+}
+
+pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::candidates_to_alignments(const Alignment& aln1, const Alignment& aln2,
+    pair<vector<CandidateAlignment>, vector<CandidateAlignment>>&& mapped) const {
+    
+    pair<vector<Alignment>, vector<Alignment>> mappings;
+    mappings.first.reserve(mapped.first.size());
+    for (auto& candidate : mapped.first) {
+        mappings.first.emplace_back(candidate_to_alignment(aln1, candidate));
+    }
+    mappings.second.reserve(mapped.second.size());
+    for (auto& candidate : mapped.second) {
+        mappings.second.emplace_back(candidate_to_alignment(aln2, candidate));
+    }
+    pair_all(mappings);
+    return mappings;
+}
+
+pair<vector<CandidateAlignment>, vector<CandidateAlignment>> MinimizerMapper::map_paired_candidates(Alignment& aln1, Alignment& aln2,
+    vector<pair<Alignment, Alignment>>& ambiguous_pair_buffer) {
     if (fragment_length_distr.is_finalized()) {
 
         //If we know the fragment length distribution then we just map paired ended 
-        return map_paired(aln1, aln2);
+        return map_paired_candidates(aln1, aln2);
     } else {
         //If we don't know the fragment length distribution, map the reads single ended
 
-        vector<Alignment> alns1(map(aln1));
-        vector<Alignment> alns2(map(aln2));
+        vector<CandidateAlignment> alns1(map_candidates(aln1));
+        vector<CandidateAlignment> alns2(map_candidates(aln2));
 
         // Check if the separately-mapped ends are both sufficiently perfect and sufficiently unique
         int32_t max_score_aln_1 = get_regular_aligner()->score_exact_match(aln1, 0, aln1.sequence().size());
         int32_t max_score_aln_2 = get_regular_aligner()->score_exact_match(aln2, 0, aln2.sequence().size());
         if (!alns1.empty() && ! alns2.empty()  && 
-            alns1.front().mapping_quality() == 60 && alns2.front().mapping_quality() == 60 &&
-            alns1.front().score() >= max_score_aln_1 * 0.85 && alns2.front().score() >= max_score_aln_2 * 0.85) {
+            alns1.front().mapping_quality == 60 && alns2.front().mapping_quality == 60 &&
+            alns1.front().score >= max_score_aln_1 * 0.85 && alns2.front().score >= max_score_aln_2 * 0.85) {
 
             //Flip the second alignment to get the proper fragment distance 
-            reverse_complement_alignment_in_place(&alns2.front(), [&](vg::id_t node_id) {
+            reverse_complement_path_in_place(&alns2.front().path, [&](vg::id_t node_id) {
                     return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
                     });           
             int64_t dist = distance_between(alns1.front(), alns2.front());
@@ -798,21 +930,20 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 //If the distance between them is ambiguous or it it large enough that we don't think it's valid, leave them unmapped
 
                 ambiguous_pair_buffer.emplace_back(aln1, aln2);
-                pair<vector<Alignment>, vector<Alignment>> empty;
+                pair<vector<CandidateAlignment>, vector<CandidateAlignment>> empty;
                 return empty;
             }
 
             //If we're keeping this alignment, flip the second alignment back
-            reverse_complement_alignment_in_place(&alns2.front(), [&](vg::id_t node_id) {
+            reverse_complement_path_in_place(&alns2.front().path, [&](vg::id_t node_id) {
                     return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
                     });           
             // If that all checks out, say they're mapped, emit them, and register their distance and orientations
             fragment_length_distr.register_fragment_length(dist);
 
-            pair<vector<Alignment>, vector<Alignment>> mapped_pair;
+            pair<vector<CandidateAlignment>, vector<CandidateAlignment>> mapped_pair;
             mapped_pair.first.emplace_back(std::move(alns1.front()));
             mapped_pair.second.emplace_back(std::move(alns2.front()));
-            pair_all(mapped_pair);
 
 #ifdef debug_fragment_distr
             //Print stats about finalizing the fragment length distribution, copied from mpmap
@@ -844,13 +975,13 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             // Otherwise, discard the mappings and put them in the ambiguous buffer
 
             ambiguous_pair_buffer.emplace_back(aln1, aln2);
-            pair<vector<Alignment>, vector<Alignment>> empty;
+            pair<vector<CandidateAlignment>, vector<CandidateAlignment>> empty;
             return empty;
         }
     }
 }
 
-pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment& aln1, Alignment& aln2) {
+pair<vector<CandidateAlignment>, vector<CandidateAlignment>> MinimizerMapper::map_paired_candidates(Alignment& aln1, Alignment& aln2) {
     
     if (show_work) {
         #pragma omp critical (cerr)
@@ -875,9 +1006,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         }
         
         // Map single-ended and bail
-        auto mapped_pair = make_pair(map(aln1), map(aln2));
-        pair_all(mapped_pair);
-        return mapped_pair;
+        return make_pair(map_candidates(aln1), map_candidates(aln2));
     }
 
 
@@ -891,9 +1020,12 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     });
 
 
-    // Make two new funnel instrumenters to watch us map this read pair.
-    vector<Funnel> funnels;
-    funnels.resize(2);
+    // Get this thread's buffers
+    unique_ptr<Workspace> fallback_workspace;
+    Workspace& workspace = get_workspace(fallback_workspace);
+
+    // Use its two funnel instrumenters to watch us map this read pair.
+    vector<Funnel>& funnels = workspace.funnels;
     // Start this alignment 
     funnels[0].start(aln1.name());
     funnels[1].start(aln2.name());
@@ -909,21 +1041,21 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     }
     
     // Minimizers for both reads, sorted by score in descending order.
-    std::vector<std::vector<Minimizer>> minimizers_by_read(2);
-    minimizers_by_read[0] = this->find_minimizers(aln1.sequence(), funnels[0]);
-    minimizers_by_read[1] = this->find_minimizers(aln2.sequence(), funnels[1]);
+    std::vector<std::vector<Minimizer>>& minimizers_by_read = workspace.minimizers_by_read;
+    this->find_minimizers(aln1.sequence(), minimizers_by_read[0], funnels[0]);
+    this->find_minimizers(aln2.sequence(), minimizers_by_read[1], funnels[1]);
 
     // Seeds for both reads, stored in separate vectors.
-    std::vector<std::vector<Seed>> seeds_by_read(2);
-    seeds_by_read[0] = this->find_seeds(minimizers_by_read[0], aln1, funnels[0]);
-    seeds_by_read[1] = this->find_seeds(minimizers_by_read[1], aln2, funnels[1]);
+    std::vector<std::vector<Seed>>& seeds_by_read = workspace.seeds_by_read;
+    this->find_seeds(minimizers_by_read[0], aln1, seeds_by_read[0], funnels[0]);
+    this->find_seeds(minimizers_by_read[1], aln2, seeds_by_read[1], funnels[1]);
 
     // Cluster the seeds. Get sets of input seed indexes that go together.
-    if (track_provenance) {
+    if (track_stages()) {
         funnels[0].stage("cluster");
         funnels[1].stage("cluster");
     }
-    std::vector<std::vector<Cluster>> all_clusters = clusterer.cluster_seeds(seeds_by_read, get_distance_limit(aln1.sequence().size()), fragment_distance_limit);
+    std::vector<std::vector<Cluster>> all_clusters = clusterer.cluster_seeds(seeds_by_read, get_distance_limit(aln1.sequence().size()), fragment_distance_limit, workspace.cluster_state);
 
 
     //Keep track of which fragment clusters (clusters of clusters) have read clusters from each end
@@ -964,7 +1096,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         }
     }
 
-    if (track_provenance) {
+    if (track_stages()) {
         funnels[0].substage("score");
         funnels[1].substage("score");
     }
@@ -1061,7 +1193,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
  
     //For each fragment cluster (cluster of clusters), for each read, a vector of all alignments + the order they were fed into the funnel 
     //so the funnel can track them
-    vector<pair<vector<Alignment>, vector<Alignment>>> alignments;
+    vector<pair<vector<CandidateAlignment>, vector<CandidateAlignment>>> alignments;
     vector<pair<vector<size_t>, vector<size_t>>> alignment_indices;
     pair<int, int> best_alignment_scores (0, 0); // The best alignment score for each end   
 
@@ -1070,6 +1202,11 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     alignments.resize(max_fragment_num + 2);
     alignment_indices.resize(max_fragment_num + 2);
 
+    if (track_stages()) {
+        // The second read waits while the first is extended and aligned, so stop its clock
+        funnels[1].stage_stop();
+    }
+
     //Now that we've scored each of the clusters, extend and align them
     for (size_t read_num = 0 ; read_num < 2 ; read_num++) {
         Alignment& aln = read_num == 0 ? aln1 : aln2;
@@ -1116,7 +1253,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             cluster_score_cutoff = std::min(cluster_score_cutoff, second_best_cluster_score);
         }
 
-        if (track_provenance) {
+        if (track_stages()) {
             // Now we go from clusters to gapless extensions
             funnels[read_num].stage("extend");
         }
@@ -1203,7 +1340,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                     //Count how many of each minimizer is in each cluster extension
                     minimizer_extended_cluster_count_by_read[read_num].emplace_back(minimizers.size(), 0);
                     // Pack the seeds for GaplessExtender.
-                    GaplessExtender::cluster_type seed_matchings;
+                    GaplessExtender::cluster_type& seed_matchings = workspace.seed_matchings;
+                    seed_matchings.clear();
                     for (auto seed_index : cluster.seeds) {
                         // Insert the (graph position, read offset) pair.
                         const Seed& seed = seeds[seed_index];
@@ -1220,7 +1358,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                     }
                     
                     // Extend seed hits in the cluster into one or more gapless extensions
-                    cluster_extensions.emplace_back(std::move(extender.extend(seed_matchings, aln.sequence())), 
+                    cluster_extensions.emplace_back(std::move(extender.extend(seed_matchings, aln.sequence(), workspace.cached_graph.get())), 
                                                     cluster.fragment);
                     
                     kept_cluster_count++;
@@ -1276,7 +1414,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         // We now estimate the best possible alignment score for each cluster.
         std::vector<int> cluster_extension_scores = this->score_extensions(cluster_extensions, aln, funnels[read_num]);
         
-        if (track_provenance) {
+        if (track_stages()) {
             funnels[read_num].stage("align");
         }
         
@@ -1311,17 +1449,17 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 auto& extensions = cluster_extensions[extension_num].first;
                 
                 // Collect the top alignments. Make sure we have at least one always, starting with unaligned.
-                vector<Alignment> best_alignments(1, aln);
+                vector<CandidateAlignment> best_alignments(1);
                 
                 if (GaplessExtender::full_length_extensions(extensions)) {
                     // We got full-length extensions, so directly convert to an Alignment.
                     
-                    if (track_provenance) {
+                    if (track_stages()) {
                         funnels[read_num].substage("direct");
                     }
 
                     //Fill in the best alignments from the extension. We know the top one is always full length and exists.
-                    this->extension_to_alignment(extensions.front(), best_alignments.front());
+                    this->extension_to_candidate(extensions.front(), aln.sequence(), best_alignments.front());
                     
                     
                     if (show_work) {
@@ -1334,8 +1472,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                     for (auto next_ext_it = extensions.begin() + 1; next_ext_it != extensions.end() && next_ext_it->full(); ++next_ext_it) {
                         // For all subsequent full length extensions, make them into alignments too.
                         // We want them all to go on to the pairing stage so we don't miss a possible pairing in a tandem repeat.
-                        best_alignments.emplace_back(aln);
-                        this->extension_to_alignment(*next_ext_it, best_alignments.back());
+                        best_alignments.emplace_back();
+                        this->extension_to_candidate(*next_ext_it, aln.sequence(), best_alignments.back());
                         
                         if (show_work) {
                             #pragma omp critical (cerr)
@@ -1346,23 +1484,23 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                         
                     }
 
-                    if (track_provenance) {
+                    if (track_stages()) {
                         // Stop the current substage
                         funnels[read_num].substage_stop();
                     }
                 } else if (do_dp) {
                     // We need to do chaining.
                     
-                    if (track_provenance) {
+                    if (track_stages()) {
                         funnels[read_num].substage("chain");
                     }
                     
                     // Do the DP and compute up to 2 alignments
-                    best_alignments.emplace_back(aln);
+                    best_alignments.emplace_back();
                     find_optimal_tail_alignments(aln, extensions, best_alignments[0], best_alignments[1]);
 
                     
-                    if (track_provenance) {
+                    if (track_stages()) {
                         // We're done chaining. Next alignment may not go through this substage.
                         funnels[read_num].substage_stop();
                     }
@@ -1375,13 +1513,13 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 size_t fragment_num = cluster_extensions[extension_num].second;
                     
                 // Have a function to process the best alignments we obtained
-                auto observe_alignment = [&](Alignment& aln) {
+                auto observe_alignment = [&](CandidateAlignment& candidate) {
                     auto& best_score = read_num == 0 ? best_alignment_scores.first : best_alignment_scores.second;
-                    best_score = max(best_score, aln.score());
+                    best_score = max(best_score, candidate.score);
                     
                     auto& alignment_list = read_num == 0 ? alignments[fragment_num].first 
                                                          : alignments[fragment_num].second;
-                    alignment_list.emplace_back(std::move(aln));
+                    alignment_list.emplace_back(std::move(candidate));
                     
                     auto& indices_list = read_num == 0 ? alignment_indices[fragment_num].first 
                                                        : alignment_indices[fragment_num].second;
@@ -1390,19 +1528,19 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
                     if (track_provenance) {
                         funnels[read_num].project(extension_num);
-                        funnels[read_num].score(funnels[read_num].latest(), alignment_list.back().score());
+                        funnels[read_num].score(funnels[read_num].latest(), alignment_list.back().score);
                     }
                     
                     if (show_work) {
                         #pragma omp critical (cerr)
                         {
                             cerr << log_name() << "Produced fragment option " << fragment_num << " end " << read_num
-                                << " alignment with score " << alignment_list.back().score() << ": " << pb2json(alignment_list.back()) << endl;
+                                << " alignment with score " << alignment_list.back().score << ": " << debug_string(alignment_list.back().path) << endl;
                         }
                     }
                 };
                 
-                for(auto aln_it = best_alignments.begin() ; aln_it != best_alignments.end() && aln_it->score() != 0 && aln_it->score() >= best_alignments[0].score() * 0.8; ++aln_it) {
+                for(auto aln_it = best_alignments.begin() ; aln_it != best_alignments.end() && aln_it->score != 0 && aln_it->score >= best_alignments[0].score * 0.8; ++aln_it) {
                     //For each additional extension with score at least 0.8 of the best score
                     observe_alignment(*aln_it);
                 }
@@ -1435,13 +1573,17 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                     funnels[read_num].fail("extension-set", extension_num, cluster_extension_scores[extension_num]);
                 }
             });
-        
+
+        if (track_stages()) {
+            // Don't count the other read's work as part of this one's alignment stage
+            funnels[read_num].stage_stop();
+        }
     }
 
 
     //Now that we have alignments, figure out how to pair them up
     
-    if (track_provenance) {
+    if (track_stages()) {
         // Now say we are finding the pairs
         funnels[0].stage("pairing");
         funnels[1].stage("pairing");
@@ -1484,24 +1626,37 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     size_t unpaired_count_1 = 0;
     size_t unpaired_count_2 = 0;
 
+    //Find the distances for all the pairs in all the fragment clusters at
+    //once, so they can share their walks up the snarl tree
+    vector<pair<const CandidateAlignment*, const CandidateAlignment*>> alignment_pairs;
+    for (auto& fragment_alignments : alignments) {
+        for (auto& alignment1 : fragment_alignments.first) {
+            for (auto& alignment2 : fragment_alignments.second) {
+                alignment_pairs.emplace_back(&alignment1, &alignment2);
+            }
+        }
+    }
+    vector<int64_t> pair_distances = distances_between(alignment_pairs);
+    size_t pair_distance_index = 0;
+
     for (size_t fragment_num = 0 ; fragment_num < alignments.size() ; fragment_num ++ ) {
         //Get pairs of plausible alignments
         alignment_groups[fragment_num].first.resize(alignments[fragment_num].first.size());
         alignment_groups[fragment_num].second.resize(alignments[fragment_num].second.size());
         
-        pair<vector<Alignment>, vector<Alignment>>& fragment_alignments = alignments[fragment_num];
+        pair<vector<CandidateAlignment>, vector<CandidateAlignment>>& fragment_alignments = alignments[fragment_num];
         if (!fragment_alignments.first.empty() && ! fragment_alignments.second.empty()) {
             //Only keep pairs of alignments that were in the same fragment cluster
             found_pair = true;
             for (size_t aln_index1 = 0 ; aln_index1 < fragment_alignments.first.size() ; aln_index1++)  {
-                Alignment& alignment1 = fragment_alignments.first[aln_index1];
+                CandidateAlignment& alignment1 = fragment_alignments.first[aln_index1];
                 size_t funnel_index1 = alignment_indices[fragment_num].first[aln_index1];
                 for (size_t aln_index2 = 0 ; aln_index2 < fragment_alignments.second.size() ; aln_index2++) {
-                    Alignment& alignment2 = fragment_alignments.second[aln_index2];
+                    CandidateAlignment& alignment2 = fragment_alignments.second[aln_index2];
                     size_t funnel_index2 = alignment_indices[fragment_num].second[aln_index2];
 
                     //Get the likelihood of the fragment distance
-                    int64_t fragment_distance = distance_between(alignment1, alignment2); 
+                    int64_t fragment_distance = pair_distances[pair_distance_index++]; 
 
                     double score = score_alignment_pair(alignment1, alignment2, fragment_distance);
                     alignment_groups[fragment_num].first[aln_index1].emplace_back(paired_alignments.size());
@@ -1519,9 +1674,9 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                         #pragma omp critical (cerr)
                         {
                             cerr << log_name() << "Found pair of alignments from fragment " << fragment_num << " with scores " 
-                                 << alignment1.score() << " " << alignment2.score() << " at distance " << fragment_distance 
+                                 << alignment1.score << " " << alignment2.score << " at distance " << fragment_distance 
                                  << " gets pair score " << score << endl;
-                            cerr << log_name() << "Alignment 1: " << pb2json(alignment1) << endl << "Alignment 2: " << pb2json(alignment2) << endl;
+                            cerr << log_name() << "Alignment 1: " << debug_string(alignment1.path) << endl << "Alignment 2: " << debug_string(alignment2.path) << endl;
                         }
                     }
 
@@ -1558,7 +1713,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 if (show_work) {
                     #pragma omp critical (cerr)
                     {
-                        cerr << log_name() << "\t" << pb2json(fragment_alignments.first[i]) << endl;
+                        cerr << log_name() << "\t" << debug_string(fragment_alignments.first[i].path) << endl;
                     }
                 }
             }
@@ -1577,7 +1732,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 if (show_work) {
                     #pragma omp critical (cerr)
                     {
-                        cerr << log_name() << "\t" << pb2json(fragment_alignments.second[i]) << endl;
+                        cerr << log_name() << "\t" << debug_string(fragment_alignments.second[i].path) << endl;
                     }
                 }
             }
@@ -1607,71 +1762,74 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             int64_t best_score_2 = 0;
 
             for (tuple<size_t, size_t, bool> index : unpaired_alignments ) {
-                Alignment& alignment = std::get<2>(index) ? alignments[std::get<0>(index)].first[std::get<1>(index) ]
+                CandidateAlignment& alignment = std::get<2>(index) ? alignments[std::get<0>(index)].first[std::get<1>(index) ]
                                                           : alignments[std::get<0>(index)].second[std::get<1>(index)];
                 if (std::get<2>(index)) {
-                    unpaired_scores[0].emplace_back(alignment.score());
-                    if (alignment.score() > best_score_1) {
+                    unpaired_scores[0].emplace_back(alignment.score);
+                    if (alignment.score > best_score_1) {
                         best_index_1 = index;
-                        best_score_1 = alignment.score();
+                        best_score_1 = alignment.score;
                     }
                 } else {
-                    unpaired_scores[1].emplace_back(alignment.score());
-                    if (alignment.score() > best_score_2) {
+                    unpaired_scores[1].emplace_back(alignment.score);
+                    if (alignment.score > best_score_2) {
                         best_index_2 = index;
-                        best_score_2 = alignment.score();
+                        best_score_2 = alignment.score;
                     }
                 }
             }
             if (max_rescue_attempts == 0 ) { 
                 //If we aren't attempting rescue, just return the best alignment from each end
-                Alignment& best_aln1 = aln1;
-                Alignment& best_aln2 = aln2;
+                //Start with empty alignments
+                CandidateAlignment best_aln1;
+                CandidateAlignment best_aln2;
     
                 if (std::get<0>(best_index_1) != std::numeric_limits<size_t>::max()) {
                     //If there was a best alignment for 1, use it
-                    best_aln1 = alignments[std::get<0>(best_index_1)].first[std::get<1>(best_index_1)]; 
-                } else {
-                    //Otherwise return an empty alignment
-                    best_aln1.clear_refpos();
-                    best_aln1.clear_path();
-                    best_aln1.set_score(0);
-                    best_aln1.set_identity(0);
-                    best_aln1.set_mapping_quality(0);
+                    best_aln1 = std::move(alignments[std::get<0>(best_index_1)].first[std::get<1>(best_index_1)]); 
                 }
 
                 if (std::get<0>(best_index_2) != std::numeric_limits<size_t>::max()) {
                     //If there was a best alignment for 2, use it
-                    best_aln2 = alignments[std::get<0>(best_index_2)].second[std::get<2>(best_index_2)]; 
-                } else {
-                    //Otherwise return an empty alignment
-                    best_aln2.clear_refpos();
-                    best_aln2.clear_path();
-                    best_aln2.set_score(0);
-                    best_aln2.set_identity(0);
-                    best_aln2.set_mapping_quality(0);
+                    best_aln2 = std::move(alignments[std::get<0>(best_index_2)].second[std::get<2>(best_index_2)]); 
                 }
                 set_annotation(best_aln1, "unpaired", true);
                 set_annotation(best_aln2, "unpaired", true);
 
-                pair<vector<Alignment>, vector<Alignment>> paired_mappings;
+                pair<vector<CandidateAlignment>, vector<CandidateAlignment>> paired_mappings;
                 paired_mappings.first.emplace_back(std::move(best_aln1));
                 paired_mappings.second.emplace_back(std::move(best_aln2));
                 // Flip aln2 back to input orientation
-                reverse_complement_alignment_in_place(&paired_mappings.second.back(), [&](vg::id_t node_id) {
+                reverse_complement_path_in_place(&paired_mappings.second.back().path, [&](vg::id_t node_id) {
+                    return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
+                });
+                reverse_complement_alignment_in_place(&aln2, [&](vg::id_t node_id) {
                     return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
                 });
 
-                paired_mappings.first.back().set_mapping_quality(1);
-                paired_mappings.second.back().set_mapping_quality(1);
+                paired_mappings.first.back().mapping_quality = 1;
+                paired_mappings.second.back().mapping_quality = 1;
 
                 // Stop this alignment
                 funnels[0].stop();
                 funnels[1].stop();
+
+                if (stage_latencies) {
+                    stage_latencies->add(funnels[0]);
+                    stage_latencies->add(funnels[1]);
+                }
                 
                 if (track_provenance) {
+                    size_t heap_allocations = workspace.heap_allocations();
+                    
                     funnels[0].annotate_mapped_alignment(paired_mappings.first[0], track_correctness);
                     funnels[0].annotate_mapped_alignment(paired_mappings.second[0], track_correctness);
+                    
+                    workspace.count_buffer_growths();
+                    set_annotation(paired_mappings.first[0], "workspace_buffer_growths", (double) workspace.buffer_growths);
+                    set_annotation(paired_mappings.second[0], "workspace_buffer_growths", (double) workspace.buffer_growths);
+                    set_annotation(paired_mappings.first[0], "heap_allocations", (double) heap_allocations);
+                    set_annotation(paired_mappings.second[0], "heap_allocations", (double) heap_allocations);
                 }
                 return paired_mappings;
             } else if (best_score_1 != 0 and best_score_2 != 0) {
@@ -1679,8 +1837,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 pair<pair<size_t, size_t>, pair<size_t, size_t>> index_pair =  make_pair(make_pair(std::get<0>(best_index_1), std::get<1>(best_index_1)), 
                                                                                          make_pair(std::get<0>(best_index_2), std::get<1>(best_index_2)));
 
-                Alignment& aln1 = alignments[std::get<0>(best_index_1)].first[std::get<1>(best_index_1)];
-                Alignment& aln2 = alignments[std::get<0>(best_index_2)].second[std::get<1>(best_index_2)];
+                CandidateAlignment& aln1 = alignments[std::get<0>(best_index_1)].first[std::get<1>(best_index_1)];
+                CandidateAlignment& aln2 = alignments[std::get<0>(best_index_2)].second[std::get<1>(best_index_2)];
                 paired_alignments.push_back(index_pair);
                 //Assume the distance between them is infinite
                 double pair_score = score_alignment_pair(aln1, aln2, std::numeric_limits<int64_t>::max());
@@ -1696,8 +1854,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
             process_until_threshold_a(unpaired_alignments, (std::function<double(size_t)>) [&](size_t i) -> double{
                 tuple<size_t, size_t, bool>& index = unpaired_alignments.at(i);
-                return (double) std::get<2>(index) ? alignments[std::get<0>(index)].first[std::get<1>(index)].score()
-                                                   : alignments[std::get<0>(index)].second[std::get<1>(index)].score();
+                return (double) std::get<2>(index) ? alignments[std::get<0>(index)].first[std::get<1>(index)].score
+                                                   : alignments[std::get<0>(index)].second[std::get<1>(index)].score;
             }, 0, 1, max_rescue_attempts, [&](size_t i) {
                 tuple<size_t, size_t, bool>& index = unpaired_alignments.at(i);
                 bool found_first = std::get<2>(index); 
@@ -1705,23 +1863,31 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                                         : alignment_indices[std::get<0>(index)].second[std::get<1>(index)];
                 if (track_provenance) {
                     funnels[found_first ? 0 : 1].processing_input(j);
+                }
+                if (track_stages()) {
                     funnels[found_first ? 0 : 1].substage("rescue");
                 }
-                Alignment& mapped_aln = found_first ? alignments[std::get<0>(index)].first[std::get<1>(index)]
+                CandidateAlignment& mapped_aln = found_first ? alignments[std::get<0>(index)].first[std::get<1>(index)]
                                                     : alignments[std::get<0>(index)].second[std::get<1>(index)];
-                Alignment rescued_aln = found_first ? aln2 : aln1;
-                rescued_aln.clear_path();
 
-                if (found_pair && (double) mapped_aln.score() < (double) (found_first ? best_alignment_scores.first : best_alignment_scores.second) * paired_rescue_score_limit) {
+                if (found_pair && (double) mapped_aln.score < (double) (found_first ? best_alignment_scores.first : best_alignment_scores.second) * paired_rescue_score_limit) {
                     //If we have already found paired clusters and this unpaired alignment is not good enough, do nothing
                     return true;
                 }
 
-                //Rescue the alignment
-                attempt_rescue(mapped_aln, rescued_aln, minimizers_by_read[(found_first ? 1 : 0)], found_first);
+                //Rescue the alignment. The aligners need an Alignment, but only the sequence and qualities of the read.
+                const Alignment& rescued_read = found_first ? aln2 : aln1;
+                Alignment rescue_aln;
+                rescue_aln.set_sequence(rescued_read.sequence());
+                rescue_aln.set_quality(rescued_read.quality());
+                attempt_rescue(mapped_aln.path, rescue_aln, minimizers_by_read[(found_first ? 1 : 0)], found_first, workspace);
 
-                if (rescued_aln.path().mapping_size() != 0) {
+                if (rescue_aln.path().mapping_size() != 0) {
                     //If we actually found an alignment
+                    CandidateAlignment rescued_aln;
+                    from_proto_path(rescue_aln.path(), rescued_aln.path);
+                    rescued_aln.score = rescue_aln.score();
+                    rescued_aln.identity = rescue_aln.identity();
 
                     int64_t fragment_dist = found_first ? distance_between(mapped_aln, rescued_aln) 
                                                       : distance_between(rescued_aln, mapped_aln);
@@ -1766,6 +1932,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 }
                 if (track_provenance) {
                     funnels[found_first ? 0 : 1].processed_input();
+                }
+                if (track_stages()) {
                     funnels[found_first ? 0 : 1].substage_stop();
                 }
                 return true;
@@ -1795,14 +1963,14 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
     
     
-    if (track_provenance) {
+    if (track_stages()) {
         // Now say we are finding the winner(s)
         funnels[0].stage("winner");
         funnels[1].stage("winner");
     }
 
     // Fill this in with the alignments we will output
-    pair<vector<Alignment>, vector<Alignment>> mappings;
+    pair<vector<CandidateAlignment>, vector<CandidateAlignment>> mappings;
     // Grab all the scores in order for MAPQ computation.
     vector<double> scores;
     vector<double> scores_group_1;
@@ -1869,12 +2037,12 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
 
         // Flip aln2 back to input orientation
-        reverse_complement_alignment_in_place(&mappings.second.back(), [&](vg::id_t node_id) {
+        reverse_complement_path_in_place(&mappings.second.back().path, [&](vg::id_t node_id) {
             return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
         });
         if (mappings.first.size() > 1) {
-            mappings.first.back().set_is_secondary(true);
-            mappings.second.back().set_is_secondary(true);
+            mappings.first.back().is_secondary = true;
+            mappings.second.back().is_secondary = true;
         }
 
 #ifdef print_minimizer_table
@@ -1917,7 +2085,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         assert(false);
     });
 
-    if (track_provenance) {
+    if (track_stages()) {
         funnels[0].substage("mapq");
         funnels[1].substage("mapq");
     }
@@ -1938,25 +2106,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
     if (mappings.first.empty()) {
         //If we didn't get an alignment, return empty alignments
-        mappings.first.emplace_back(aln1);
-        mappings.second.emplace_back(aln2);
-
-        // Flip aln2 back to input orientation
-        reverse_complement_alignment_in_place(&mappings.second.back(), [&](vg::id_t node_id) {
-                return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
-                });
-
-        mappings.first.back().clear_refpos();
-        mappings.first.back().clear_path();
-        mappings.first.back().set_score(0);
-        mappings.first.back().set_identity(0);
-        mappings.first.back().set_mapping_quality(0);
-
-        mappings.second.back().clear_refpos();
-        mappings.second.back().clear_path();
-        mappings.second.back().set_score(0);
-        mappings.second.back().set_identity(0);
-        mappings.second.back().set_mapping_quality(0);
+        mappings.first.emplace_back();
+        mappings.second.emplace_back();
 #ifdef print_minimizer_table
         mapping_was_rescued.emplace_back(false, false);
         pair_indices.emplace_back(make_pair(std::numeric_limits<size_t>::infinity(), std::numeric_limits<size_t>::infinity()), 
@@ -2070,7 +2221,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             read_mapq = max(min(capped_mapq, 120.0) / 2.0, 0.0);
             
             // Save the MAPQ
-            to_annotate.set_mapping_quality(read_mapq);
+            to_annotate.mapping_quality = read_mapq;
             
             if (show_work) {
                 #pragma omp critical (cerr)
@@ -2094,10 +2245,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     
     }
     
-    // Make sure pair partners reference each other
-    pair_all(mappings);
-        
-    if (track_provenance) {
+    if (track_stages()) {
         funnels[0].substage_stop();
         funnels[1].substage_stop();
     }
@@ -2105,11 +2253,27 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     // Stop this alignment
     funnels[0].stop();
     funnels[1].stop();
+
+    if (stage_latencies) {
+        stage_latencies->add(funnels[0]);
+        stage_latencies->add(funnels[1]);
+    }
     
     if (track_provenance) {
+        // Count the heap allocations for this pair before annotating makes more.
+        size_t heap_allocations = workspace.heap_allocations();
+        
         funnels[0].annotate_mapped_alignment(mappings.first[0], track_correctness);
         funnels[1].annotate_mapped_alignment(mappings.second[0], track_correctness);
         
+        // Report how often the reused buffers had to grow for this pair, and
+        // how much allocating mapping it really took.
+        workspace.count_buffer_growths();
+        set_annotation(mappings.first[0], "workspace_buffer_growths", (double) workspace.buffer_growths);
+        set_annotation(mappings.second[0], "workspace_buffer_growths", (double) workspace.buffer_growths);
+        set_annotation(mappings.first[0], "heap_allocations", (double) heap_allocations);
+        set_annotation(mappings.second[0], "heap_allocations", (double) heap_allocations);
+        
         // Annotate with parameters used for the filters.
         set_annotation(mappings.first[0] , "param_hit-cap", (double) hit_cap);
         set_annotation(mappings.first[0] , "param_hard-hit-cap", (double) hard_hit_cap);
@@ -2159,11 +2323,11 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
          }
     }
     cerr << "\t" << uncapped_mapq << "\t" << fragment_cluster_cap << "\t" << mapq_score_groups[0] << "\t" 
-         << mapq_explored_caps[0] << "\t" << new_cluster_cap << "\t" << mappings.first.front().mapping_quality() << "\t";  
+         << mapq_explored_caps[0] << "\t" << new_cluster_cap << "\t" << mappings.first.front().mapping_quality << "\t";  
     for (size_t i = 0 ; i < scores.size() ; i++) {
         pair<pair<size_t, size_t>, pair<size_t, size_t>> indices = pair_indices[i];
-        Alignment& aln_1 = alignments[indices.first.first].first[indices.first.second];
-        Alignment& aln_2 = alignments[indices.second.first].second[indices.second.second];
+        CandidateAlignment& aln_1 = alignments[indices.first.first].first[indices.first.second];
+        CandidateAlignment& aln_2 = alignments[indices.second.first].second[indices.second.second];
 
         int64_t dist = distances[i];
         assert(dist == distance_between(aln_1, aln_2)); 
@@ -2172,8 +2336,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
         double multiplicity = paired_multiplicities.size() == scores.size() ? paired_multiplicities[i] : 1.0;
 
-        cerr << aln_1.score() << "," 
-             << aln_2.score() << "," 
+        cerr << aln_1.score << "," 
+             << aln_2.score << "," 
              << multiplicity << "," 
              << scores[i] << ";";
     }
@@ -2205,12 +2369,12 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
          }
     }
     cerr << "\t" << uncapped_mapq << "\t" << fragment_cluster_cap << "\t" << mapq_score_groups[1] << "\t" 
-         << mapq_explored_caps[1] << "\t" << new_cluster_cap << "\t" << mappings.second.front().mapping_quality() << "\t";
+         << mapq_explored_caps[1] << "\t" << new_cluster_cap << "\t" << mappings.second.front().mapping_quality << "\t";
 
     for (size_t i = 0 ; i < scores.size() ; i++) {
         pair<pair<size_t, size_t>, pair<size_t, size_t>> indices = pair_indices[i];
-        Alignment& aln_1 = alignments[indices.first.first].first[indices.first.second];
-        Alignment& aln_2 = alignments[indices.second.first].second[indices.second.second];
+        CandidateAlignment& aln_1 = alignments[indices.first.first].first[indices.first.second];
+        CandidateAlignment& aln_2 = alignments[indices.second.first].second[indices.second.second];
 
         int64_t dist = distances[i];
         assert(dist == distance_between(aln_1, aln_2)); 
@@ -2219,8 +2383,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
         double multiplicity = paired_multiplicities.size() == scores.size() ? paired_multiplicities[i] : 1.0;
 
-        cerr << aln_1.score() << "," 
-             << aln_2.score() << "," 
+        cerr << aln_1.score << "," 
+             << aln_2.score << "," 
              << multiplicity << "," 
              << scores[i] << ";";
     }
@@ -2241,6 +2405,11 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         }
     }
 
+    // Flip aln2 back to input orientation, to go with its alignments
+    reverse_complement_alignment_in_place(&aln2, [&](vg::id_t node_id) {
+        return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
+    });
+
     // Ship out all the aligned alignments
     return mappings;
 }
@@ -2479,47 +2648,41 @@ double MinimizerMapper::get_prob_of_disruption_in_column(const vector<Minimizer>
 
 //-----------------------------------------------------------------------------
 
-void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& rescued_alignment, const std::vector<Minimizer>& minimizers, bool rescue_forward ) {
+void MinimizerMapper::attempt_rescue(const path_t& aligned_path, Alignment& rescued_alignment, const std::vector<Minimizer>& minimizers, bool rescue_forward, Workspace& workspace) {
 
     if (this->rescue_algorithm == rescue_none) { return; }
 
     // We are traversing the same small subgraph repeatedly, so it's better to use a cache.
-    gbwtgraph::CachedGBWTGraph cached_graph(this->gbwt_graph);
+    gbwtgraph::CachedGBWTGraph& cached_graph = *workspace.cached_graph;
 
     if (show_work) {
         #pragma omp critical (cerr)
         {
-            cerr << log_name() << "Attempt rescue from: " << pb2json(aligned_read) << endl;
+            cerr << log_name() << "Attempt rescue from: " << debug_string(aligned_path) << endl;
         }
     }
 
-    // Find all nodes within a reasonable range from aligned_read.
-    std::unordered_set<id_t> rescue_nodes;
+    // Find all nodes within a reasonable range from aligned_path.
     int64_t min_distance = max(0.0, fragment_length_distr.mean() - rescued_alignment.sequence().size() - rescue_subgraph_stdevs * fragment_length_distr.std_dev());
     int64_t max_distance = fragment_length_distr.mean() + rescue_subgraph_stdevs * fragment_length_distr.std_dev();
-    distance_index.subgraph_in_range(aligned_read.path(), &cached_graph, min_distance, max_distance, rescue_nodes, rescue_forward);
+    auto subgraph_start = std::chrono::steady_clock::now();
+    shared_ptr<RescueSubgraph> subgraph = get_rescue_subgraph(aligned_path, min_distance, max_distance,
+                                                              rescued_alignment.sequence().size(), rescue_forward, workspace);
+    if (stage_latencies) {
+        stage_latencies->add_time("rescue-subgraph", std::chrono::duration<double>(std::chrono::steady_clock::now() - subgraph_start).count());
+    }
 
-    if (rescue_nodes.size() == 0) {
+    if (subgraph->nodes.size() == 0) {
         //If the rescue subgraph is empty
         return;
     }
-
-    // Remove node ids that do not exist in the GBWTGraph from the subgraph.
-    // We may be using the distance index of the original graph, and nodes
-    // not visited by any thread are missing from the GBWTGraph.
-    for (auto iter = rescue_nodes.begin(); iter != rescue_nodes.end(); ) {
-        if (!cached_graph.has_node(*iter)) {
-            iter = rescue_nodes.erase(iter);
-        } else {
-            ++iter;
-        }
-    }
+    const std::unordered_set<id_t>* rescue_nodes = &subgraph->nodes;
 
     // Get rid of the old path.
     rescued_alignment.clear_path();
 
     // Find all seeds in the subgraph and try to get a full-length extension.
-    GaplessExtender::cluster_type seeds = this->seeds_in_subgraph(minimizers, rescue_nodes);
+    GaplessExtender::cluster_type seeds = this->seeds_in_subgraph(minimizers, *rescue_nodes);
     std::vector<GaplessExtension> extensions = this->extender.extend(seeds, rescued_alignment.sequence(), &cached_graph);
 
     // If we have a full-length extension, use it as the rescued alignment.
@@ -2533,7 +2696,7 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
         // Find and unfold the local haplotypes in the subgraph.
         std::vector<std::vector<handle_t>> haplotype_paths;
         bdsg::HashGraph align_graph;
-        this->extender.unfold_haplotypes(rescue_nodes, haplotype_paths, align_graph);
+        this->extender.unfold_haplotypes(*rescue_nodes, haplotype_paths, align_graph);
 
         // Align to the subgraph.
         size_t gap_limit = this->get_regular_aligner()->longest_detectable_gap(rescued_alignment);
@@ -2555,12 +2718,21 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     }
 
     // Use the best extension as a seed for dozeu.
-    // Also ensure that the entire extension is in the subgraph.
+    // Also ensure that the entire extension is in the subgraph. If it isn't,
+    // we have to work on our own copy of the subgraph instead of the shared one.
     std::vector<MaximalExactMatch> dozeu_seed;
+    shared_ptr<RescueSubgraph> extended_subgraph;
     if (best < extensions.size()) {
         const GaplessExtension& extension = extensions[best];
         for (handle_t handle : extension.path) {
-            rescue_nodes.insert(cached_graph.get_id(handle));
+            id_t id = cached_graph.get_id(handle);
+            if (rescue_nodes->count(id) == 0) {
+                if (!extended_subgraph) {
+                    extended_subgraph = make_shared<RescueSubgraph>();
+                    extended_subgraph->nodes = *rescue_nodes;
+                }
+                extended_subgraph->nodes.insert(id);
+            }
         }
         dozeu_seed.emplace_back();
         dozeu_seed.back().begin = rescued_alignment.sequence().begin() + extension.read_interval.first;
@@ -2570,9 +2742,17 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
         gcsa::node_type node = gcsa::Node::encode(id, extension.offset, is_reverse);
         dozeu_seed.back().nodes.push_back(node);
     }
+    if (extended_subgraph) {
+        subgraph = extended_subgraph;
+        rescue_nodes = &subgraph->nodes;
+    }
 
     // GSSW and dozeu assume that the graph is a DAG.
-    std::vector<handle_t> topological_order = gbwtgraph::topological_order(cached_graph, rescue_nodes);
+    if (!subgraph->has_order) {
+        subgraph->topological_order = gbwtgraph::topological_order(cached_graph, *rescue_nodes);
+        subgraph->has_order = true;
+    }
+    const std::vector<handle_t>& topological_order = subgraph->topological_order;
     if (!topological_order.empty()) {
         if (rescue_algorithm == rescue_dozeu) {
             size_t gap_limit = this->get_regular_aligner()->longest_detectable_gap(rescued_alignment);
@@ -2585,19 +2765,29 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
         return;
     }
 
-    // Build a subgraph overlay.
-    SubHandleGraph sub_graph(&cached_graph);
-    for (id_t id : rescue_nodes) {
-        sub_graph.add_handle(cached_graph.get_handle(id));
-    }
+    if (!subgraph->dagified) {
+        // Build a subgraph overlay.
+        SubHandleGraph sub_graph(&cached_graph);
+        for (id_t id : *rescue_nodes) {
+            sub_graph.add_handle(cached_graph.get_handle(id));
+        }
 
-    // Create an overlay where each strand is a separate node.
-    StrandSplitGraph split_graph(&sub_graph);
+        // Create an overlay where each strand is a separate node.
+        StrandSplitGraph split_graph(&sub_graph);
 
-    // Dagify the subgraph.
-    bdsg::HashGraph dagified;
-    std::unordered_map<id_t, id_t> dagify_trans =
-        handlealgs::dagify(&split_graph, &dagified, rescued_alignment.sequence().size());
+        // Dagify the subgraph.
+        subgraph->dagified.reset(new bdsg::HashGraph());
+        std::unordered_map<id_t, id_t> dagify_trans =
+            handlealgs::dagify(&split_graph, subgraph->dagified.get(), rescued_alignment.sequence().size());
+
+        // Remember where each dagified node came from, since the overlays
+        // can't outlive this rescue.
+        for (auto& translation : dagify_trans) {
+            handle_t handle = split_graph.get_underlying_handle(split_graph.get_handle(translation.second));
+            subgraph->dagified_to_original[translation.first] = make_pair(sub_graph.get_id(handle), sub_graph.get_is_reverse(handle));
+        }
+    }
+    const bdsg::HashGraph& dagified = *subgraph->dagified;
 
     // Align to the subgraph.
     // TODO: Map the seed to the dagified subgraph.
@@ -2613,10 +2803,9 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     Path& path = *(rescued_alignment.mutable_path());
     for (size_t i = 0; i < path.mapping_size(); i++) {
         Position& pos = *(path.mutable_mapping(i)->mutable_position());
-        id_t id = dagify_trans[pos.node_id()];
-        handle_t handle = split_graph.get_underlying_handle(split_graph.get_handle(id));
-        pos.set_node_id(sub_graph.get_id(handle));
-        pos.set_is_reverse(sub_graph.get_is_reverse(handle));
+        const pair<id_t, bool>& original = subgraph->dagified_to_original.at(pos.node_id());
+        pos.set_node_id(original.first);
+        pos.set_is_reverse(original.second);
     }
     
     if (show_work) {
@@ -2627,6 +2816,61 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     }
 }
 
+shared_ptr<MinimizerMapper::RescueSubgraph> MinimizerMapper::get_rescue_subgraph(const path_t& aligned_path,
+    int64_t min_distance, int64_t max_distance, size_t read_length, bool rescue_forward, Workspace& workspace) {
+
+    gbwtgraph::CachedGBWTGraph& cached_graph = *workspace.cached_graph;
+    shared_ptr<RescueSubgraph> subgraph;
+
+    // Rescue looks out from one end of the aligned read, and the subgraph
+    // depends only on the exact position of that end.
+    Path anchor_path;
+    to_proto_path(aligned_path, anchor_path);
+    pos_t anchor = rescue_forward ? initial_position(anchor_path) : final_position(anchor_path);
+    RescueSubgraphKey key(id(anchor), is_rev(anchor), offset(anchor), rescue_forward, min_distance, max_distance, read_length);
+    if (rescue_subgraph_cache_size != 0) {
+        if (!workspace.rescue_subgraphs) {
+            workspace.rescue_subgraphs.reset(new LRUCache<RescueSubgraphKey, shared_ptr<RescueSubgraph>>(rescue_subgraph_cache_size));
+        }
+        workspace.rescue_subgraph_lookups++;
+        pair<shared_ptr<RescueSubgraph>, bool> cached = workspace.rescue_subgraphs->retrieve(key);
+        if (cached.second) {
+            workspace.rescue_subgraph_hits++;
+            return cached.first;
+        }
+    }
+
+    subgraph = make_shared<RescueSubgraph>();
+    distance_index.subgraph_in_range(anchor_path, &cached_graph, min_distance, max_distance, subgraph->nodes, rescue_forward);
+
+    // Remove node ids that do not exist in the GBWTGraph from the subgraph.
+    // We may be using the distance index of the original graph, and nodes
+    // not visited by any thread are missing from the GBWTGraph.
+    for (auto iter = subgraph->nodes.begin(); iter != subgraph->nodes.end(); ) {
+        if (!cached_graph.has_node(*iter)) {
+            iter = subgraph->nodes.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    if (rescue_subgraph_cache_size != 0) {
+        workspace.rescue_subgraphs->put(key, subgraph);
+    }
+    return subgraph;
+}
+
+std::pair<size_t, size_t> MinimizerMapper::get_rescue_subgraph_cache_stats() const {
+    std::pair<size_t, size_t> stats(0, 0);
+    for (auto& workspace : workspaces) {
+        if (workspace) {
+            stats.first += workspace->rescue_subgraph_lookups;
+            stats.second += workspace->rescue_subgraph_hits;
+        }
+    }
+    return stats;
+}
+
 GaplessExtender::cluster_type MinimizerMapper::seeds_in_subgraph(const std::vector<Minimizer>& minimizers,
                                                                  const std::unordered_set<id_t>& subgraph) const {
     std::vector<id_t> sorted_ids(subgraph.begin(), subgraph.end());
@@ -2663,17 +2907,45 @@ void MinimizerMapper::fix_dozeu_score(Alignment& rescued_alignment, const Handle
 
 //-----------------------------------------------------------------------------
 
-int64_t MinimizerMapper::distance_between(const Alignment& aln1, const Alignment& aln2) {
-    assert(aln1.path().mapping_size() != 0); 
-    assert(aln2.path().mapping_size() != 0); 
+int64_t MinimizerMapper::distance_between(const CandidateAlignment& aln1, const CandidateAlignment& aln2) {
+    assert(aln1.path.mapping_size() != 0); 
+    assert(aln2.path.mapping_size() != 0); 
      
-    pos_t pos1 = initial_position(aln1.path()); 
-    pos_t pos2 = final_position(aln2.path());
+    pos_t pos1 = initial_position(aln1.path); 
+    pos_t pos2 = final_position(aln2.path);
 
     int64_t min_dist = distance_index.min_distance(pos1, pos2);
     return min_dist == -1 ? numeric_limits<int64_t>::max() : min_dist;
 }
 
+vector<int64_t> MinimizerMapper::distances_between(const vector<pair<const CandidateAlignment*, const CandidateAlignment*>>& alignment_pairs) {
+    vector<pair<pos_t, pos_t>> position_pairs;
+    position_pairs.reserve(alignment_pairs.size());
+    for (auto& alignment_pair : alignment_pairs) {
+        assert(alignment_pair.first->path.mapping_size() != 0); 
+        assert(alignment_pair.second->path.mapping_size() != 0); 
+        position_pairs.emplace_back(initial_position(alignment_pair.first->path), 
+                                    final_position(alignment_pair.second->path));
+    }
+
+    vector<int64_t> min_dists = distance_index.min_distance(position_pairs);
+    for (int64_t& min_dist : min_dists) {
+        if (min_dist == -1) {
+            min_dist = numeric_limits<int64_t>::max();
+        }
+    }
+    return min_dists;
+}
+
+void MinimizerMapper::extension_to_candidate(const GaplessExtension& extension, const string& sequence, CandidateAlignment& candidate) const {
+    candidate.path = extension.to_path_t(this->gbwt_graph, sequence);
+    candidate.score = extension.score;
+    candidate.identity = 0.0;
+    if (!sequence.empty()) {
+        candidate.identity = (sequence.length() - extension.mismatches()) / static_cast<double>(sequence.length());
+    }
+}
+
 void MinimizerMapper::extension_to_alignment(const GaplessExtension& extension, Alignment& alignment) const {
     *(alignment.mutable_path()) = extension.to_path(this->gbwt_graph, alignment.sequence());
     alignment.set_score(extension.score);
@@ -2687,14 +2959,14 @@ void MinimizerMapper::extension_to_alignment(const GaplessExtension& extension,
 
 //-----------------------------------------------------------------------------
 
-std::vector<MinimizerMapper::Minimizer> MinimizerMapper::find_minimizers(const std::string& sequence, Funnel& funnel) const {
+void MinimizerMapper::find_minimizers(const std::string& sequence, std::vector<Minimizer>& result, Funnel& funnel) const {
 
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         // Start the minimizer finding stage
         funnel.stage("minimizer");
     }
 
-    std::vector<Minimizer> result;
+    result.clear();
     double base_score = 1.0 + std::log(this->hard_hit_cap);
     // Get minimizers and their window agglomeration starts and lengths
     // Starts and lengths are all 0 if we are using syncmers.
@@ -2736,13 +3008,11 @@ std::vector<MinimizerMapper::Minimizer> MinimizerMapper::find_minimizers(const s
         // Record how many we found, as new lines.
         funnel.introduce(result.size());
     }
-
-    return result;
 }
 
-std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const std::vector<Minimizer>& minimizers, const Alignment& aln, Funnel& funnel) const {
+void MinimizerMapper::find_seeds(const std::vector<Minimizer>& minimizers, const Alignment& aln, std::vector<Seed>& seeds, Funnel& funnel) const {
 
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         // Start the minimizer locating stage
         funnel.stage("seed");
     }
@@ -2770,7 +3040,7 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const std::vector
 
     // Select the minimizers we use for seeds.
     size_t rejected_count = 0;
-    std::vector<Seed> seeds;
+    seeds.clear();
     // Flag whether each minimizer in the read was located or not, for MAPQ capping.
     // We ignore minimizers with no hits (count them as not located), because
     // they would have to be created in the read no matter where we say it came
@@ -2898,8 +3168,6 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const std::vector
                 << rejected_count << std::endl;
         }
     }
-
-    return seeds;
 }
 
 //-----------------------------------------------------------------------------
@@ -3143,7 +3411,7 @@ int MinimizerMapper::score_extension_group(const Alignment& aln, const vector<Ga
 std::vector<int> MinimizerMapper::score_extensions(const std::vector<std::vector<GaplessExtension>>& extensions, const Alignment& aln, Funnel& funnel) const {
 
     // Extension scoring substage.
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         funnel.substage("score");
     }
 
@@ -3170,7 +3438,7 @@ std::vector<int> MinimizerMapper::score_extensions(const std::vector<std::vector
 std::vector<int> MinimizerMapper::score_extensions(const std::vector<std::pair<std::vector<GaplessExtension>, size_t>>& extensions, const Alignment& aln, Funnel& funnel) const {
 
     // Extension scoring substage.
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         funnel.substage("score");
     }
 
@@ -3246,7 +3514,39 @@ int32_t flank_penalty(size_t length, const std::vector<pareto_point>& frontier,
     return result;
 }
 
-void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, Alignment& best, Alignment& second_best) const {
+/// Append a piece of an alignment's path to a path_t. If the piece starts
+/// partway into a node, it must continue the last mapping, and its edits are
+/// merged into that mapping.
+static void append_path_piece(path_t& dest, const Path& piece) {
+    for (auto& mapping : piece.mapping()) {
+        if (mapping.position().offset() != 0 && dest.mapping_size() > 0) {
+            assert(mapping.position().node_id() == dest.mapping(dest.mapping_size() - 1).position().node_id());
+            auto* prev_mapping = dest.mutable_mapping(dest.mapping_size() - 1);
+            for (auto& edit : mapping.edit()) {
+                from_proto_edit(edit, *prev_mapping->add_edit());
+            }
+        } else {
+            from_proto_mapping(mapping, *dest.add_mapping());
+        }
+    }
+}
+
+/// Append a piece of an alignment's path to a path_t, as for a Path piece.
+static void append_path_piece(path_t& dest, path_t&& piece) {
+    for (auto& mapping : *piece.mutable_mapping()) {
+        if (mapping.position().offset() != 0 && dest.mapping_size() > 0) {
+            assert(mapping.position().node_id() == dest.mapping(dest.mapping_size() - 1).position().node_id());
+            auto* prev_mapping = dest.mutable_mapping(dest.mapping_size() - 1);
+            for (auto& edit : *mapping.mutable_edit()) {
+                *prev_mapping->add_edit() = std::move(edit);
+            }
+        } else {
+            *dest.add_mapping() = std::move(mapping);
+        }
+    }
+}
+
+void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, CandidateAlignment& best, CandidateAlignment& second_best) const {
 
     // This assumes that full-length extensions have the highest scores.
     // We want to align at least two extensions and at least one
@@ -3306,14 +3606,15 @@ void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const v
         }
     }
     
-    // We will keep the winning alignment here, in pieces
+    // We will keep the winning alignment here, in pieces. The middle piece
+    // is only made into a path once we know who won.
     Path winning_left;
-    Path winning_middle;
+    const GaplessExtension* winning_middle = nullptr;
     Path winning_right;
     int32_t winning_score = 0;
 
     Path second_left;
-    Path second_middle;
+    const GaplessExtension* second_middle = nullptr;
     Path second_right;
     int32_t second_score = 0;
     
@@ -3424,13 +3725,13 @@ void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const v
 
             // Get the node ids of the beginning and end of each alignment
             id_t winning_start = winning_score == 0 ? 0 : (winning_left.mapping_size() == 0
-                                          ? winning_middle.mapping(0).position().node_id()
+                                          ? gbwt_graph.get_id(winning_middle->path.front())
                                           : winning_left.mapping(0).position().node_id());
             id_t current_start = left_tail_result.first.mapping_size() == 0
                                      ? gbwt_graph.get_id(extension.path.front())
                                      : left_tail_result.first.mapping(0).position().node_id();
             id_t winning_end = winning_score == 0 ? 0 : (winning_right.mapping_size() == 0
-                                  ? winning_middle.mapping(winning_middle.mapping_size() - 1).position().node_id()
+                                  ? gbwt_graph.get_id(winning_middle->path.back())
                                   : winning_right.mapping(winning_right.mapping_size()-1).position().node_id());
             id_t current_end = right_tail_result.first.mapping_size() == 0
                                 ? gbwt_graph.get_id(extension.path.back())
@@ -3447,7 +3748,7 @@ void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const v
                 //The previous best scoring alignment replaces the second best
                     second_score = winning_score;
                     second_left = std::move(winning_left);
-                    second_middle = std::move(winning_middle);
+                    second_middle = winning_middle;
                     second_right = std::move(winning_right);
                 }
 
@@ -3455,7 +3756,7 @@ void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const v
                 winning_score = total_score;
                 // And the path parts
                 winning_left = std::move(left_tail_result.first);
-                winning_middle = extension.to_path(gbwt_graph, aln.sequence());
+                winning_middle = &extension;
                 winning_right = std::move(right_tail_result.first);
 
             } else if ((total_score > second_score || second_score == 0) && different_left && different_right) {
@@ -3466,7 +3767,7 @@ void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const v
                 second_score = total_score;
                 // And the path parts
                 second_left = std::move(left_tail_result.first);
-                second_middle = extension.to_path(gbwt_graph, aln.sequence());
+                second_middle = &extension;
                 second_right = std::move(right_tail_result.first);
             }
 
@@ -3480,68 +3781,27 @@ void MinimizerMapper::find_optimal_tail_alignments(const Alignment& aln, const v
         });
         
     // Now we know the winning path and score. Move them over to out
-    best.set_score(winning_score);
-    second_best.set_score(second_score);
+    best.score = winning_score;
+    second_best.score = second_score;
 
     // Concatenate the paths. We know there must be at least an edit boundary
     // between each part, because the maximal extension doesn't end in a
     // mismatch or indel and eats all matches.
     // We also don't need to worry about jumps that skip intervening sequence.
-    *best.mutable_path() = std::move(winning_left);
-
-    for (auto* to_append : {&winning_middle, &winning_right}) {
-        // For each path to append
-        for (auto& mapping : *to_append->mutable_mapping()) {
-            // For each mapping to append
-            
-            if (mapping.position().offset() != 0 && best.path().mapping_size() > 0) {
-                // If we have a nonzero offset in our mapping, and we follow
-                // something, we must be continuing on from a previous mapping to
-                // the node.
-                assert(mapping.position().node_id() == best.path().mapping(best.path().mapping_size() - 1).position().node_id());
-
-                // Find that previous mapping
-                auto* prev_mapping = best.mutable_path()->mutable_mapping(best.path().mapping_size() - 1);
-                for (auto& edit : *mapping.mutable_edit()) {
-                    // Move over all the edits in this mapping onto the end of that one.
-                    *prev_mapping->add_edit() = std::move(edit);
-                }
-            } else {
-                // If we start at offset 0 or there's nothing before us, we need to just move the whole mapping
-                *best.mutable_path()->add_mapping() = std::move(mapping);
-            }
-        }
-    }
-    best.set_identity(identity(best.path()));
-    //Do the same for the second best
-    *second_best.mutable_path() = std::move(second_left);
-
-    for (auto* to_append : {&second_middle, &second_right}) {
-        // For each path to append
-        for (auto& mapping : *to_append->mutable_mapping()) {
-            // For each mapping to append
-            
-            if (mapping.position().offset() != 0 && second_best.path().mapping_size() > 0) {
-                // If we have a nonzero offset in our mapping, and we follow
-                // something, we must be continuing on from a previous mapping to
-                // the node.
-                assert(mapping.position().node_id() == second_best.path().mapping(second_best.path().mapping_size() - 1).position().node_id());
-
-                // Find that previous mapping
-                auto* prev_mapping = second_best.mutable_path()->mutable_mapping(second_best.path().mapping_size() - 1);
-                for (auto& edit : *mapping.mutable_edit()) {
-                    // Move over all the edits in this mapping onto the end of that one.
-                    *prev_mapping->add_edit() = std::move(edit);
-                }
-            } else {
-                // If we start at offset 0 or there's nothing before us, we need to just move the whole mapping
-                *second_best.mutable_path()->add_mapping() = std::move(mapping);
-            }
+    for (auto* candidate : {&best, &second_best}) {
+        bool is_best = candidate == &best;
+        const GaplessExtension* middle = is_best ? winning_middle : second_middle;
+        if (middle == nullptr) {
+            // Nothing won this place
+            continue;
         }
+        append_path_piece(candidate->path, is_best ? winning_left : second_left);
+        append_path_piece(candidate->path, middle->to_path_t(gbwt_graph, aln.sequence()));
+        append_path_piece(candidate->path, is_best ? winning_right : second_right);
+        
+        // Compute the identity from the path.
+        candidate->identity = identity(candidate->path);
     }
-
-    // Compute the identity from the path.
-    second_best.set_identity(identity(second_best.path()));
 }
 
 //-----------------------------------------------------------------------------
@@ -3607,18 +3867,25 @@ pair<Path, size_t> MinimizerMapper::get_best_alignment_against_any_tree(const ve
             });
 #endif
 
-            if (show_work) {
-                #pragma omp critical (cerr)
-                {
-                    cerr << log_name() << "Limit gap length to " << longest_detectable_gap << " bp" << endl;
+            if (use_wavefront_tails && WavefrontAligner::can_emulate(*get_regular_aligner())) {
+                // Do wavefront alignment, which finds the best alignment against the tree
+                // with the same scores but doesn't need a gap length limit.
+                // It is also always left-pinned.
+                WavefrontAligner(*get_regular_aligner()).align_pinned(current_alignment, subgraph, subgraph.get_root());
+            } else {
+                if (show_work) {
+                    #pragma omp critical (cerr)
+                    {
+                        cerr << log_name() << "Limit gap length to " << longest_detectable_gap << " bp" << endl;
+                    }
                 }
+                
+                // X-drop align, accounting for full length bonus.
+                // We *always* do left-pinned alignment internally, since that's the shape of trees we get.
+                // Make sure to pass through the gap length limit so we don't just get the default.
+                get_regular_aligner()->align_pinned(current_alignment, subgraph, true, true, longest_detectable_gap);
             }
             
-            // X-drop align, accounting for full length bonus.
-            // We *always* do left-pinned alignment internally, since that's the shape of trees we get.
-            // Make sure to pass through the gap length limit so we don't just get the default.
-            get_regular_aligner()->align_pinned(current_alignment, subgraph, true, true, longest_detectable_gap);
-            
             if (show_work) {
                 #pragma omp critical (cerr)
                 {
@@ -3912,15 +4179,15 @@ void MinimizerMapper::dfs_gbwt(const gbwt::SearchState& start_state, size_t from
 
 }
 
-double MinimizerMapper::score_alignment_pair(Alignment& aln1, Alignment& aln2, int64_t fragment_distance) {
+double MinimizerMapper::score_alignment_pair(const CandidateAlignment& aln1, const CandidateAlignment& aln2, int64_t fragment_distance) {
     //Score a pair of alignments
 
     double dev = fragment_distance - fragment_length_distr.mean();
     double fragment_length_log_likelihood = (-dev * dev / (2.0 * fragment_length_distr.std_dev() * fragment_length_distr.std_dev()))/ get_aligner()->log_base;
-    double score = aln1.score() + aln2.score() +fragment_length_log_likelihood ;
+    double score = aln1.score + aln2.score +fragment_length_log_likelihood ;
 
     //Don't let the fragment length log likelihood bring score down below the score of the best alignment
-    double worse_score = std::min(aln1.score(), aln2.score());
+    double worse_score = std::min(aln1.score, aln2.score);
 
     return std::max(score, worse_score);;
 }
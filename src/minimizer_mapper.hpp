@@ -9,6 +9,7 @@
 #include "algorithms/nearest_offsets_in_paths.hpp"
 #include "aligner.hpp"
 #include "vg/io/alignment_emitter.hpp"
+#include "candidate_alignment_emitter.hpp"
 #include "gapless_extender.hpp"
 #include "mapper.hpp"
 #include "min_distance.hpp"
@@ -16,6 +17,7 @@
 #include "snarls.hpp"
 #include "tree_subgraph.hpp"
 #include "funnel.hpp"
+#include "lru_cache.h"
 
 #include <gbwtgraph/minimizer.h>
 #include <structures/immutable_list.hpp>
@@ -40,16 +42,24 @@ public:
          MinimumDistanceIndex& distance_index, const PathPositionHandleGraph* path_graph = nullptr);
 
     /**
-     * Map the given read, and send output to the given AlignmentEmitter. May be run from any thread.
+     * Map the given read, and send output to the given CandidateAlignmentEmitter. May be run from any thread.
      * TODO: Can't be const because the clusterer's cluster_seeds isn't const.
      */
-    void map(Alignment& aln, AlignmentEmitter& alignment_emitter);
+    void map(Alignment& aln, CandidateAlignmentEmitter& alignment_emitter);
     
     /**
      * Map the given read. Return a vector of alignments that it maps to, winner first.
      */
     vector<Alignment> map(Alignment& aln);
     
+    /**
+     * Map the given read. Return a vector of candidate alignments that it
+     * maps to, winner first. The read is left without a path, and
+     * candidate_to_alignment() can make it into an Alignment along each
+     * candidate.
+     */
+    vector<CandidateAlignment> map_candidates(Alignment& aln);
+    
     // The idea here is that the subcommand feeds all the reads to the version
     // of map_paired that takes a buffer, and then empties the buffer by
     // iterating over it in parallel with the version that doesn't.
@@ -77,6 +87,23 @@ public:
      * fragment length distribution.
      */
     pair<vector<Alignment>, vector<Alignment>> map_paired(Alignment& aln1, Alignment& aln2);
+    
+    /**
+     * Map the given pair of reads like map_paired(), but return candidate
+     * alignments, with corresponding entries paired together. The reads are
+     * left without paths and in their input orientations, and the candidates
+     * are in the same orientations as the reads.
+     */
+    pair<vector<CandidateAlignment>, vector<CandidateAlignment>> map_paired_candidates(Alignment& aln1, Alignment& aln2,
+        vector<pair<Alignment, Alignment>>& ambiguous_pair_buffer);
+    
+    /**
+     * Map the given pair of reads like map_paired(), but return candidate
+     * alignments, with corresponding entries paired together. The reads are
+     * left without paths and in their input orientations, and the candidates
+     * are in the same orientations as the reads.
+     */
+    pair<vector<CandidateAlignment>, vector<CandidateAlignment>> map_paired_candidates(Alignment& aln1, Alignment& aln2);
 
 
 
@@ -131,6 +158,13 @@ public:
     size_t max_multimaps = 1;
     size_t distance_limit = 200;
     bool do_dp = true;
+    
+    /// If set, align tails with the WavefrontAligner instead of X-drop DP,
+    /// when the alignment scores allow it. The wavefront aligner finds the
+    /// best alignment against each tree without a gap length limit, in time
+    /// that grows with how far the tail is from the graph.
+    bool use_wavefront_tails = false;
+    
     string sample_name;
     string read_group;
     
@@ -146,6 +180,10 @@ public:
     /// If set, log what the mapper is thinking in its mapping of each read.
     bool show_work = false;
 
+    /// If set, record how long each stage of mapping each read takes here.
+    /// Must have room for all the threads that map.
+    StageLatencyProfile* stage_latencies = nullptr;
+
     ////How many stdevs from fragment length distr mean do we cluster together?
     double paired_distance_stdevs = 2.0; 
 
@@ -167,6 +205,16 @@ public:
     /// The algorithm used for rescue.
     RescueAlgorithm rescue_algorithm = rescue_dozeu;
 
+    /// How many rescue subgraphs should each thread remember? Rescues from
+    /// the same anchor position with the same distance range then share one
+    /// subgraph. 0 turns the cache off.
+    size_t rescue_subgraph_cache_size = 256;
+
+    /// Get the number of rescue subgraph lookups over all threads, and how
+    /// many of them were answered from the cache. Must not be called while
+    /// reads are being mapped.
+    std::pair<size_t, size_t> get_rescue_subgraph_cache_stats() const;
+
     bool fragment_distr_is_finalized () {return fragment_length_distr.is_finalized();}
     void finalize_fragment_length_distr() {
         if (!fragment_length_distr.is_finalized()) {
@@ -188,6 +236,11 @@ public:
     }
 protected:
 
+    /// Should we be telling the funnels about stage changes, for provenance or timing?
+    bool track_stages() const {
+        return track_provenance || stage_latencies != nullptr;
+    }
+
     /**
      * We define our own type for minimizers, to use during mapping and to pass around between our internal functions.
      * Also used to represent syncmers, in which case the only window, the "minimizer", and the agglomeration are all the same region.
@@ -253,20 +306,107 @@ protected:
     FragmentLengthDistribution fragment_length_distr;
     atomic_flag warned_about_bad_distribution = ATOMIC_FLAG_INIT;
 
+    /**
+     * The part of a rescue subgraph that doesn't depend on the read being
+     * rescued. The topological order and dagified graph are filled in the
+     * first time a rescue needs them.
+     */
+    struct RescueSubgraph {
+        /// Nodes in range of the anchor that exist in the GBWTGraph
+        std::unordered_set<id_t> nodes;
+        /// Has the topological order been computed?
+        bool has_order = false;
+        /// Topological order of the nodes, or empty if they contain a cycle
+        std::vector<handle_t> topological_order;
+        /// If the nodes contain a cycle, the strand-split and dagified subgraph
+        std::unique_ptr<bdsg::HashGraph> dagified;
+        /// The GBWTGraph node and orientation for each dagified node ID
+        std::unordered_map<id_t, std::pair<id_t, bool>> dagified_to_original;
+    };
+
+    /// Rescue subgraphs are cached by the exact anchor position (node ID,
+    /// orientation, and offset), rescue direction, distance range, and
+    /// rescued read length.
+    typedef std::tuple<id_t, bool, size_t, bool, int64_t, int64_t, size_t> RescueSubgraphKey;
+
+    /**
+     * Buffers that a mapping thread keeps from read to read. They are reset
+     * instead of freed between reads, so once they have grown to fit typical
+     * reads, mapping does not have to go back to the heap for them.
+     */
+    struct Workspace {
+        /// Minimizers for each read being mapped (one for unpaired, two for paired).
+        std::vector<std::vector<Minimizer>> minimizers_by_read;
+        /// Seeds for each read being mapped.
+        std::vector<std::vector<Seed>> seeds_by_read;
+        /// Funnel instrumenters for each read being mapped.
+        std::vector<Funnel> funnels;
+        /// Seeds of the cluster currently being extended.
+        GaplessExtender::cluster_type seed_matchings;
+        /// Reusable state for clustering seeds.
+        SnarlSeedClusterer::ClusteringState cluster_state;
+        /// Cached view of the GBWTGraph shared by all extensions. Replaced
+        /// every CACHE_RESET_INTERVAL reads to keep its size bounded.
+        unique_ptr<gbwtgraph::CachedGBWTGraph> cached_graph;
+        /// How many reads have used the current cached graph?
+        size_t cached_graph_uses = 0;
+        /// How many times did the workspace's own buffers have to grow while
+        /// mapping the current read(s)? This doesn't count other allocations.
+        size_t buffer_growths = 0;
+        /// Buffer capacities as of the last check, for counting growths.
+        std::vector<size_t> known_capacities;
+        /// The thread's heap allocation count when the workspace was last reset.
+        size_t heap_allocations_at_reset = 0;
+        /// Rescue subgraphs recently used by this thread. Kept across reads.
+        unique_ptr<LRUCache<RescueSubgraphKey, shared_ptr<RescueSubgraph>>> rescue_subgraphs;
+        /// How many rescue subgraphs has this thread looked up?
+        size_t rescue_subgraph_lookups = 0;
+        /// And how many of those were in the cache?
+        size_t rescue_subgraph_hits = 0;
+
+        /// How many reads can share a cached graph before it is replaced?
+        static constexpr size_t CACHE_RESET_INTERVAL = 256;
+
+        Workspace();
+
+        /// Prepare to map a new read or pair, keeping all the buffers.
+        void reset(const gbwtgraph::GBWTGraph& graph);
+
+        /// Count any buffers that have had to grow since the last call.
+        void count_buffer_growths();
+
+        /// Get the number of heap allocations the thread has made since the
+        /// workspace was last reset, from all code and not just the
+        /// workspace.
+        size_t heap_allocations() const;
+    };
+
+    /// One workspace for each OMP thread, created on first use.
+    vector<unique_ptr<Workspace>> workspaces;
+
+    /**
+     * Get the current thread's workspace, reset for a new read or pair. If
+     * the thread has no workspace slot, the fallback is used to hold a fresh
+     * one.
+     */
+    Workspace& get_workspace(unique_ptr<Workspace>& fallback);
+
 //-----------------------------------------------------------------------------
 
     // Stages of mapping.
 
     /**
      * Find the minimizers in the sequence using all minimizer indexes and
-     * return them sorted in descending order by score.
+     * store them in result, sorted in descending order by score. Any previous
+     * contents of result are discarded.
      */
-    std::vector<Minimizer> find_minimizers(const std::string& sequence, Funnel& funnel) const;
+    void find_minimizers(const std::string& sequence, std::vector<Minimizer>& result, Funnel& funnel) const;
 
     /**
-     * Find seeds for all minimizers passing the filters.
+     * Find seeds for all minimizers passing the filters and store them in
+     * seeds. Any previous contents of seeds are discarded.
      */
-    std::vector<Seed> find_seeds(const std::vector<Minimizer>& minimizers, const Alignment& aln, Funnel& funnel) const;
+    void find_seeds(const std::vector<Minimizer>& minimizers, const Alignment& aln, std::vector<Seed>& seeds, Funnel& funnel) const;
 
     /**
      * Determine cluster score, read coverage, and a vector of flags for the
@@ -293,14 +433,23 @@ protected:
     // Rescue.
 
     /**
-     * Given an aligned read, extract a subgraph of the graph within a distance range
+     * Given the path of an aligned read, extract a subgraph of the graph within a distance range
      * based on the fragment length distribution and attempt to align the unaligned
-     * read to it.
+     * read to it. Only the sequence and qualities of the unaligned read are used.
      * Rescue_forward is true if the aligned read is the first and false otherwise.
      * Assumes that both reads are facing the same direction.
+     * Uses the workspace's cached graph and rescue subgraph cache.
      * TODO: This should be const, but some of the function calls are not.
      */
-    void attempt_rescue(const Alignment& aligned_read, Alignment& rescued_alignment, const std::vector<Minimizer>& minimizers, bool rescue_forward);
+    void attempt_rescue(const path_t& aligned_path, Alignment& rescued_alignment, const std::vector<Minimizer>& minimizers, bool rescue_forward, Workspace& workspace);
+
+    /**
+     * Get the subgraph to rescue into from the given aligned read path, for a read
+     * of the given length, from the workspace's cache if possible. Cached
+     * subgraphs cover the distance range from anywhere on the anchor node.
+     */
+    shared_ptr<RescueSubgraph> get_rescue_subgraph(const path_t& aligned_path, int64_t min_distance, int64_t max_distance,
+                                                   size_t read_length, bool rescue_forward, Workspace& workspace);
 
     /**
      * Return the all non-redundant seeds in the subgraph, including those from
@@ -326,7 +475,21 @@ protected:
     /**
      * Get the distance between a pair of read alignments
      */
-    int64_t distance_between(const Alignment& aln1, const Alignment& aln2);
+    int64_t distance_between(const CandidateAlignment& aln1, const CandidateAlignment& aln2);
+
+    /**
+     * Get the distances between many pairs of read alignments at once, in
+     * the same order as the pairs. Pairs can share work in the distance
+     * index, so this is faster than asking about each pair separately.
+     */
+    vector<int64_t> distances_between(const vector<pair<const CandidateAlignment*, const CandidateAlignment*>>& alignment_pairs);
+
+    /**
+     * Convert the GaplessExtension of the given read sequence into a
+     * candidate alignment. This assumes that the extension is a full-length
+     * alignment.
+     */
+    void extension_to_candidate(const GaplessExtension& extension, const string& sequence, CandidateAlignment& candidate) const;
 
     /**
      * Convert the GaplessExtension into an alignment. This assumes that the
@@ -340,6 +503,13 @@ protected:
      */
     void pair_all(pair<vector<Alignment>, vector<Alignment>>& mappings) const;
     
+    /**
+     * Make paired mapping results as candidates into paired Alignments of
+     * the given reads, with pair partner references set.
+     */
+    pair<vector<Alignment>, vector<Alignment>> candidates_to_alignments(const Alignment& aln1, const Alignment& aln2,
+        pair<vector<CandidateAlignment>, vector<CandidateAlignment>>&& mapped) const;
+    
 
 
 //-----------------------------------------------------------------------------
@@ -477,10 +647,10 @@ protected:
     /**
      * Operating on the given input alignment, align the tails dangling off the
      * given extended perfect-match seeds and produce an optimal alignment into
-     * the given output Alignment object, best, and the second best alignment
-     * into second_best.
+     * the given output candidate, best, and the second best alignment into
+     * second_best.
      */
-    void find_optimal_tail_alignments(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, Alignment& best, Alignment& second_best) const; 
+    void find_optimal_tail_alignments(const Alignment& aln, const vector<GaplessExtension>& extended_seeds, CandidateAlignment& best, CandidateAlignment& second_best) const; 
     
     /**
      * Find for each pair of extended seeds all the haplotype-consistent graph
@@ -598,7 +768,7 @@ protected:
     /**
      * Score a pair of alignments given the distance between them
      */
-    double score_alignment_pair(Alignment& aln1, Alignment& aln2, int64_t fragment_distance);
+    double score_alignment_pair(const CandidateAlignment& aln1, const CandidateAlignment& aln2, int64_t fragment_distance);
     
     /**
      * Given a vector of items, a function to get the score of each, a
@@ -1048,6 +1048,35 @@ namespace vg {
         suppress_p_value_memoization = false;
     }
 
+    void MultipathMapper::save_mismapping_calibration(ostream& out, const string& fingerprint) const {
+        out << "#vg mpmap calibration 1" << endl;
+        out << fingerprint << endl;
+        // write enough digits that the parameters come back exactly
+        out.precision(numeric_limits<double>::max_digits10);
+        out << max_exponential_rate_intercept << "\t" << max_exponential_rate_slope << "\t"
+            << max_exponential_shape_intercept << "\t" << max_exponential_shape_slope << endl;
+    }
+    
+    bool MultipathMapper::load_mismapping_calibration(istream& in, const string& fingerprint) {
+        string header;
+        string stored_fingerprint;
+        if (!getline(in, header) || header != "#vg mpmap calibration 1"
+            || !getline(in, stored_fingerprint) || stored_fingerprint != fingerprint) {
+            return false;
+        }
+        double rate_intercept, rate_slope, shape_intercept, shape_slope;
+        if (!(in >> rate_intercept >> rate_slope >> shape_intercept >> shape_slope)) {
+            return false;
+        }
+        max_exponential_rate_intercept = rate_intercept;
+        max_exponential_rate_slope = rate_slope;
+        max_exponential_shape_intercept = shape_intercept;
+        max_exponential_shape_slope = shape_slope;
+        // forget any p-values computed with the old parameters
+        p_value_memo.clear();
+        return true;
+    }
+
     unique_ptr<OrientedDistanceMeasurer> MultipathMapper::get_distance_measurer(MemoizingGraph& memoizing_graph) const {
         
         unique_ptr<OrientedDistanceMeasurer> distance_measurer;
@@ -93,6 +93,15 @@ namespace vg {
         /// when mappings are likely to have occurred by chance
         void calibrate_mismapping_detection(size_t num_simulations, const vector<size_t>& simulated_read_lengths);
         
+        /// Write the parameters fit by calibrate_mismapping_detection to a stream, along with a
+        /// one-line fingerprint of the indexes and mapping parameters they were fit against
+        void save_mismapping_calibration(ostream& out, const string& fingerprint) const;
+        
+        /// Load parameters written by save_mismapping_calibration in place of calibrating. Returns
+        /// true if they were loaded, or false if the stream doesn't hold a calibration with the
+        /// same fingerprint, in which case nothing is changed.
+        bool load_mismapping_calibration(istream& in, const string& fingerprint);
+        
         /// Should be called once after construction, or any time the band padding multiplier is changed
         void init_band_padding_memo();
         
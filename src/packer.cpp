@@ -133,6 +133,7 @@ void Packer::clear() {
         delete lru_cache;
         lru_cache = nullptr;
     }
+    count_buffers.clear();
 }
 
 Packer::~Packer() {
@@ -199,6 +200,7 @@ void Packer::merge_from_dynamic(vector<Packer*>& packers) {
     bool first = true;
     for (auto& p : packers) {
         auto& c = *p;
+        c.flush_count_buffers();
         c.close_edit_tmpfiles(); // flush and close temporaries
         // take bin size and counts from the first, assume they are all the same
         if (first) {
@@ -252,6 +254,9 @@ void Packer::write_edits(ostream& out, size_t bin) const {
 void Packer::collect_coverage(const vector<Packer*>& packers) {
     // assume the same basis vector
     assert(!is_compacted);
+    for (auto& p : packers) {
+        p->flush_count_buffers();
+    }
     if (record_bases) {
 #pragma omp parallel for
         for (size_t i = 0; i < coverage_dynamic.size(); ++i) {
@@ -326,6 +331,8 @@ void Packer::make_compact(void) {
         cerr << "Need to make packer compact" << endl;
 #endif
     }
+    // apply any buffered coverage
+    flush_count_buffers();
     // sync edit file
     close_edit_tmpfiles();
     
@@ -460,6 +467,8 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq) {
     if (mapping_quality < min_mapq) {
         return;
     }
+    // if we are buffering, increments go here instead of to the counters
+    CountBuffer* buffer = get_count_buffer();
     // count the nodes, edges, and edits
     Mapping prev_mapping;
     bool has_prev_mapping = false;
@@ -500,7 +509,11 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq) {
                         ++bq_count;
                         // base quality threshold filter (only if we found some kind of quality)
                         if (base_quality < 0 || base_quality >= min_baseq) {
-                            increment_coverage(coverage_idx);
+                            if (buffer) {
+                                buffer->bases.push_back(coverage_idx);
+                            } else {
+                                increment_coverage(coverage_idx);
+                            }
                             if (record_qualities && mapping_quality > 0) {
                                 total_node_quality += mapping_quality;
                             }
@@ -524,7 +537,11 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq) {
                 }
             }
             if (total_node_quality > 0) {
-                increment_node_quality(node_quality_index, total_node_quality);
+                if (buffer) {
+                    buffer->node_qualities.emplace_back(node_quality_index, total_node_quality);
+                } else {
+                    increment_node_quality(node_quality_index, total_node_quality);
+                }
             }
         }
         
@@ -552,7 +569,11 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq) {
                 }
                 // base quality threshold filter (only if we found some kind of quality)
                 if (avg_base_quality < 0 || avg_base_quality >= min_baseq) {
-                    increment_edge_coverage(edge_idx);
+                    if (buffer) {
+                        buffer->edges.push_back(edge_idx);
+                    } else {
+                        increment_edge_coverage(edge_idx);
+                    }
                 }
             }
         }
@@ -560,6 +581,105 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq) {
         prev_mapping = mapping;
         has_prev_mapping = true;
     }
+    
+    if (buffer && buffer->size() >= count_buffer_size) {
+        flush_count_buffer(*buffer);
+    }
+}
+
+void Packer::set_count_buffer_size(size_t entries) {
+    // get rid of anything buffered at the old size
+    flush_count_buffers();
+    count_buffer_size = entries;
+    count_buffers.clear();
+    if (count_buffer_size > 0) {
+        count_buffers.resize(get_thread_count());
+    }
+}
+
+size_t Packer::CountBuffer::size() const {
+    return bases.size() + edges.size() + node_qualities.size();
+}
+
+Packer::CountBuffer* Packer::get_count_buffer(void) {
+    if (count_buffers.empty()) {
+        return nullptr;
+    }
+    size_t thread_num = omp_get_thread_num();
+    if (thread_num >= count_buffers.size()) {
+        // we don't have a buffer for this thread, so it has to go direct
+        return nullptr;
+    }
+    return &count_buffers[thread_num];
+}
+
+void Packer::flush_count_buffers(void) {
+#pragma omp parallel for
+    for (size_t i = 0; i < count_buffers.size(); ++i) {
+        flush_count_buffer(count_buffers[i]);
+    }
+}
+
+void Packer::flush_count_buffer(CountBuffer& buffer) {
+    // Sorting the increments puts the ones for each bin together, so we can
+    // hold each bin's lock across all of them, and the ones for each
+    // position together, so we can add them up first.
+    if (!buffer.bases.empty()) {
+        std::sort(buffer.bases.begin(), buffer.bases.end());
+        size_t j = 0;
+        while (j < buffer.bases.size()) {
+            size_t bin = coverage_bin_offset(buffer.bases[j]).first;
+            std::lock_guard<std::mutex> guard(base_locks[bin]);
+            init_coverage_bin(bin);
+            while (j < buffer.bases.size() && coverage_bin_offset(buffer.bases[j]).first == bin) {
+                size_t k = j + 1;
+                while (k < buffer.bases.size() && buffer.bases[k] == buffer.bases[j]) {
+                    ++k;
+                }
+                coverage_dynamic[bin]->increment(coverage_bin_offset(buffer.bases[j]).second, k - j);
+                j = k;
+            }
+        }
+        buffer.bases.clear();
+    }
+    if (!buffer.edges.empty()) {
+        std::sort(buffer.edges.begin(), buffer.edges.end());
+        size_t j = 0;
+        while (j < buffer.edges.size()) {
+            size_t bin = edge_coverage_bin_offset(buffer.edges[j]).first;
+            std::lock_guard<std::mutex> guard(edge_locks[bin]);
+            init_edge_coverage_bin(bin);
+            while (j < buffer.edges.size() && edge_coverage_bin_offset(buffer.edges[j]).first == bin) {
+                size_t k = j + 1;
+                while (k < buffer.edges.size() && buffer.edges[k] == buffer.edges[j]) {
+                    ++k;
+                }
+                edge_coverage_dynamic[bin]->increment(edge_coverage_bin_offset(buffer.edges[j]).second, k - j);
+                j = k;
+            }
+        }
+        buffer.edges.clear();
+    }
+    if (!buffer.node_qualities.empty()) {
+        std::sort(buffer.node_qualities.begin(), buffer.node_qualities.end());
+        size_t j = 0;
+        while (j < buffer.node_qualities.size()) {
+            size_t bin = node_quality_bin_offset(buffer.node_qualities[j].first).first;
+            std::lock_guard<std::mutex> guard(node_quality_locks[bin]);
+            init_node_quality_bin(bin);
+            while (j < buffer.node_qualities.size() && node_quality_bin_offset(buffer.node_qualities[j].first).first == bin) {
+                size_t total = 0;
+                size_t k = j;
+                while (k < buffer.node_qualities.size() && buffer.node_qualities[k].first == buffer.node_qualities[j].first) {
+                    total += buffer.node_qualities[k].second;
+                    ++k;
+                }
+                node_quality_dynamic[bin]->increment(node_quality_bin_offset(buffer.node_qualities[j].first).second, total);
+                j = k;
+            }
+        }
+        buffer.node_qualities.clear();
+    }
 }
 
 // find the position on the forward strand in the sequence vector
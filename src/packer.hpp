@@ -57,6 +57,18 @@ public:
     /// min_baseq : ignore bases in the alignment if their read quality is below this value
     void add(const Alignment& aln, int min_mapq = 0, int min_baseq = 0);
 
+    /// Collect the coverage increments made by add() in per-OpenMP-thread
+    /// buffers of up to this many entries, and apply each full buffer to the
+    /// counters one bin at a time, so each bin's lock is taken once per
+    /// flush rather than once per increment. 0 (the default) applies
+    /// increments directly. Buffered coverage is not visible through the
+    /// coverage accessors until flush_count_buffers() is called, which
+    /// make_compact() and the merge functions do automatically.
+    void set_count_buffer_size(size_t entries);
+    /// Apply all buffered coverage increments. Must not be run at the same
+    /// time as add().
+    void flush_count_buffers(void);
+
     void merge_from_files(const vector<string>& file_names);
     void merge_from_dynamic(vector<Packer*>& packers);
     void load_from_file(const string& file_name);
@@ -123,6 +135,23 @@ private:
     void init_edge_coverage_bin(size_t i);
     void init_node_quality_bin(size_t i);
     
+    /// Coverage increments from add() waiting to be applied, for one thread
+    struct CountBuffer {
+        /// Positions of covered bases
+        vector<size_t> bases;
+        /// Indexes of covered edges
+        vector<size_t> edges;
+        /// Node ranks and the quality to add to each
+        vector<pair<size_t, size_t>> node_qualities;
+        
+        size_t size() const;
+    };
+    /// Get the buffer for the calling thread, or nullptr if increments
+    /// should be applied directly
+    CountBuffer* get_count_buffer(void);
+    /// Apply and empty one thread's buffer
+    void flush_count_buffer(CountBuffer& buffer);
+    
     void ensure_edit_tmpfiles_open(void);
     void close_edit_tmpfiles(void);
     void remove_edit_tmpfiles(void);
@@ -160,6 +189,10 @@ private:
     size_t num_nodes_dynamic;
     // one mutex per element of node_quality_dynamic
     std::mutex* node_quality_locks;
+    // per-thread buffers of increments waiting to be applied (if buffering)
+    vector<CountBuffer> count_buffers;
+    // entries a buffer can hold before it is flushed (0 for no buffering)
+    size_t count_buffer_size = 0;
     
     vector<string> edit_tmpfile_names;
     vector<ofstream*> tmpfstreams;
@@ -2565,6 +2565,20 @@ int path_to_length(const path_t& path) {
     return length;
 }
 
+double identity(const path_t& path) {
+    size_t total_length = 0;
+    size_t matched_length = 0;
+    for (const auto& mapping : path.mapping()) {
+        for (const auto& edit : mapping.edit()) {
+            total_length += edit.to_length();
+            if (edit.from_length() == edit.to_length() && edit.sequence().empty()) {
+                matched_length += edit.from_length();
+            }
+        }
+    }
+    return total_length == 0 ? 0.0 : (double) matched_length / (double) total_length;
+}
+
 
 void reverse_complement_mapping_in_place(path_mapping_t* m,
                                          const function<int64_t(id_t)>& node_length) {
@@ -0,0 +1,178 @@
+#include "pattern_matcher.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+/**
+ * \file pattern_matcher.cpp: implementations of PrefixTrie and AhoCorasick
+ */
+
+namespace vg {
+
+using namespace std;
+
+PrefixTrie::PrefixTrie(const vector<string>& patterns) {
+    if (patterns.empty()) {
+        return;
+    }
+
+    // Build a pointer-y trie first, and then lay it out in breadth-first order.
+    vector<map<char, uint32_t>> children(1);
+    vector<bool> terminal(1, false);
+    for (auto& pattern : patterns) {
+        uint32_t here = 0;
+        for (char c : pattern) {
+            auto found = children[here].find(c);
+            if (found == children[here].end()) {
+                children[here][c] = children.size();
+                here = children.size();
+                children.emplace_back();
+                terminal.push_back(false);
+            } else {
+                here = found->second;
+            }
+        }
+        terminal[here] = true;
+    }
+
+    vector<uint32_t> order(1, 0);
+    vector<uint32_t> new_id(children.size());
+    new_id[0] = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        for (auto& child : children[order[i]]) {
+            new_id[child.second] = order.size();
+            order.push_back(child.second);
+        }
+    }
+
+    nodes.resize(order.size());
+    edge_chars.reserve(order.size() - 1);
+    edge_targets.reserve(order.size() - 1);
+    for (size_t i = 0; i < order.size(); i++) {
+        Node& node = nodes[i];
+        node.terminal = terminal[order[i]];
+        node.first_edge = edge_chars.size();
+        node.edge_count = children[order[i]].size();
+        for (auto& child : children[order[i]]) {
+            edge_chars.push_back(child.first);
+            edge_targets.push_back(new_id[child.second]);
+        }
+    }
+
+    if (patterns.empty()) {
+        nodes.clear();
+    }
+}
+
+bool PrefixTrie::has_prefix_of(const string& text) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    uint32_t here = 0;
+    if (nodes[here].terminal) {
+        return true;
+    }
+    for (char c : text) {
+        const Node& node = nodes[here];
+        auto begin = edge_chars.begin() + node.first_edge;
+        auto end = begin + node.edge_count;
+        auto found = lower_bound(begin, end, c);
+        if (found == end || *found != c) {
+            return false;
+        }
+        here = edge_targets[found - edge_chars.begin()];
+        if (nodes[here].terminal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PrefixTrie::empty() const {
+    return nodes.empty();
+}
+
+AhoCorasick::AhoCorasick(const vector<string>& patterns) {
+    if (patterns.empty()) {
+        return;
+    }
+
+    // Give each character that appears in a pattern its own column.
+    for (auto& pattern : patterns) {
+        for (char c : pattern) {
+            uint8_t& column = char_class[(unsigned char) c];
+            if (column == 0) {
+                column = width++;
+            }
+        }
+    }
+
+    // Build the trie, with missing transitions marked.
+    const uint32_t missing = numeric_limits<uint32_t>::max();
+    transitions.assign(width, missing);
+    matches.assign(1, false);
+    for (auto& pattern : patterns) {
+        uint32_t here = 0;
+        for (char c : pattern) {
+            uint32_t& next = transitions[here * width + char_class[(unsigned char) c]];
+            if (next == missing) {
+                next = matches.size();
+                matches.push_back(false);
+                transitions.resize(transitions.size() + width, missing);
+            }
+            here = transitions[here * width + char_class[(unsigned char) c]];
+        }
+        matches[here] = true;
+    }
+
+    // Fill in the missing transitions breadth-first from the failure links,
+    // so that every state has a transition on every character.
+    vector<uint32_t> fail(matches.size(), 0);
+    vector<uint32_t> queue;
+    for (size_t column = 0; column < width; column++) {
+        uint32_t& next = transitions[column];
+        if (next == missing || column == 0) {
+            next = 0;
+        } else {
+            queue.push_back(next);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); i++) {
+        uint32_t here = queue[i];
+        matches[here] = matches[here] || matches[fail[here]];
+        for (size_t column = 0; column < width; column++) {
+            uint32_t& next = transitions[here * width + column];
+            uint32_t fallback = transitions[fail[here] * width + column];
+            if (next == missing || column == 0) {
+                next = fallback;
+            } else {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+bool AhoCorasick::occurs_in(const string& text) const {
+    if (matches.empty()) {
+        return false;
+    }
+    uint32_t here = 0;
+    if (matches[here]) {
+        return true;
+    }
+    for (char c : text) {
+        here = transitions[here * width + char_class[(unsigned char) c]];
+        if (matches[here]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AhoCorasick::empty() const {
+    return matches.empty();
+}
+
+}
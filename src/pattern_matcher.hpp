@@ -0,0 +1,97 @@
+#ifndef VG_PATTERN_MATCHER_HPP_INCLUDED
+#define VG_PATTERN_MATCHER_HPP_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * \file pattern_matcher.hpp
+ *
+ * Compiled matchers for checking strings against many patterns at once.
+ */
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A trie over a set of patterns that can tell if any of them is a prefix of a
+ * string, in time proportional to the length of the match rather than the
+ * number of patterns. Immutable once built, so it can be shared between
+ * threads.
+ */
+class PrefixTrie {
+public:
+
+    /// Make a trie that matches nothing.
+    PrefixTrie() = default;
+
+    /// Make a trie over the given patterns.
+    PrefixTrie(const vector<string>& patterns);
+
+    /// Return true if any pattern is a prefix of (or equal to) the given string.
+    bool has_prefix_of(const string& text) const;
+
+    /// Return true if the trie has no patterns.
+    bool empty() const;
+
+protected:
+
+    /// A node's children are a run of edges, sorted by character.
+    struct Node {
+        uint32_t first_edge = 0;
+        uint32_t edge_count = 0;
+        /// Does a pattern end here?
+        bool terminal = false;
+    };
+
+    vector<Node> nodes;
+    /// Character on each edge
+    vector<char> edge_chars;
+    /// Node each edge leads to
+    vector<uint32_t> edge_targets;
+};
+
+/**
+ * An Aho-Corasick automaton over a set of patterns that can tell if any of
+ * them occurs as a substring of a string, in one pass over the string.
+ * Transitions are stored as a dense table over only the characters that
+ * appear in the patterns. Immutable once built, so it can be shared between
+ * threads.
+ */
+class AhoCorasick {
+public:
+
+    /// Make an automaton that matches nothing.
+    AhoCorasick() = default;
+
+    /// Make an automaton over the given patterns.
+    AhoCorasick(const vector<string>& patterns);
+
+    /// Return true if any pattern occurs in the given string.
+    bool occurs_in(const string& text) const;
+
+    /// Return true if the automaton has no patterns.
+    bool empty() const;
+
+protected:
+
+    /// Column of each character in the transition table. Characters that
+    /// are in no pattern get column 0, which always goes back to the root.
+    array<uint8_t, 256> char_class{};
+
+    /// Number of columns in the transition table
+    size_t width = 1;
+
+    /// Next state for each state and character class, row-major
+    vector<uint32_t> transitions;
+
+    /// Whether a pattern ends at each state, or at any of its suffixes
+    vector<uint8_t> matches;
+};
+
+}
+
+#endif
@@ -14,6 +14,7 @@
 #include "IntervalTree.h"
 #include "annotation.hpp"
 #include "multipath_alignment_emitter.hpp"
+#include "pattern_matcher.hpp"
 #include <vg/io/alignment_emitter.hpp>
 #include <vg/vg.pb.h>
 #include <vg/io/stream.hpp>
@@ -39,14 +40,8 @@ public:
     
     /// Actually take the complement of the filter
     bool complement_filter = false;
-    /// Read name must have one of these prefixes, if any are present.
-    /// TODO: This should be a trie but I don't have one handy.
-    /// Must be sorted for vaguely efficient search.
-    vector<string> name_prefixes;
     /// Read must not have a refpos set with a contig name containing a match to any of these
     vector<regex> excluded_refpos_contigs;
-    /// Read must contain at least one of these strings as a subsequence
-    vector<string> subsequences;
     /// If a read has one of the features in this set as annotations, the read
     /// is filtered out.
     unordered_set<string> excluded_features;
@@ -96,6 +91,19 @@ public:
     int min_base_quality = numeric_limits<int>::min() / 2;
     // minimum fraction of bases in reads that must have quality at least <min_base_quality>
     double min_base_quality_fraction = numeric_limits<double>::lowest();
+    
+    /**
+     * Require read names to have one of these prefixes, if any are given.
+     * Builds the trie used for matching, replacing any earlier prefixes.
+     */
+    void set_name_prefixes(const vector<string>& prefixes);
+    
+    /**
+     * Require reads to contain at least one of these strings as a
+     * subsequence, if any are given. Builds the Aho-Corasick automaton used
+     * for matching, replacing any earlier subsequences.
+     */
+    void set_subsequences(const vector<string>& subsequences);
       
     /**
      * Run all the filters on an alignment. The alignment may get modified in-place by the defray filter
@@ -243,6 +251,11 @@ private:
     unique_ptr<AlignmentEmitter> aln_emitter;
     unique_ptr<MultipathAlignmentEmitter> mp_aln_emitter;
     
+    /// Trie over the name prefixes, shared by all threads
+    PrefixTrie name_prefix_trie;
+    /// Automaton over the subsequences, shared by all threads
+    AhoCorasick subsequence_matcher;
+    
     /// Helper function for filter
     void filter_internal(istream* in);
 };
@@ -418,14 +431,14 @@ Counts ReadFilter<Read>::filter_alignment(Read& read) {
     ++counts.counts[Counts::FilterName::read];
     bool keep = true;
     // filter (current) alignment
-    if (!name_prefixes.empty()) {
+    if (!name_prefix_trie.empty()) {
         if (!matches_name(read)) {
             // There are prefixes and we don't match any, so drop the read.
             ++counts.counts[Counts::FilterName::wrong_name];
             keep = false;
         }
     }
-    if ((keep || verbose) && !subsequences.empty()) {
+    if ((keep || verbose) && !subsequence_matcher.empty()) {
         if (!contains_subsequence(read)) {
             // There are subsequences and we don't match any, so drop the read.
             ++counts.counts[Counts::FilterName::subsequence];
@@ -579,78 +592,20 @@ inline double ReadFilter<MultipathAlignment>::get_score(const MultipathAlignment
     return score;
 }
 
+template<typename Read>
+void ReadFilter<Read>::set_name_prefixes(const vector<string>& prefixes) {
+    name_prefix_trie = PrefixTrie(prefixes);
+}
+
+template<typename Read>
+void ReadFilter<Read>::set_subsequences(const vector<string>& subsequences) {
+    subsequence_matcher = AhoCorasick(subsequences);
+}
+
 template<typename Read>
 bool ReadFilter<Read>::matches_name(const Read& aln) const {
-    bool keep = true;
-    // filter (current) alignment
-    if (!name_prefixes.empty()) {
-        // Make sure we match at least one name prefix
-        
-        bool found = false;
-        
-        // Do a binary search for the closest prefix and see if all of any prefix exists.
-        // We assume the prefixes are sorted.
-        size_t left_bound = 0;
-        size_t left_match = 0;
-        while (left_match < name_prefixes[left_bound].size() &&
-               left_match < aln.name().size() &&
-               name_prefixes[left_bound][left_match] == aln.name()[left_match]) {
-            // Scan all the matches at the start
-            left_match++;
-        }
-        
-        size_t right_bound = name_prefixes.size() - 1;
-        size_t right_match = 0;
-        while (right_match < name_prefixes[right_bound].size() &&
-               right_match < aln.name().size() &&
-               name_prefixes[right_bound][right_match] == aln.name()[right_match]) {
-            // Scan all the matches at the end
-            right_match++;
-        }
-        
-        if (left_match == name_prefixes[left_bound].size() || right_match == name_prefixes[right_bound].size()) {
-            // We found a match already
-            found = true;
-        } else {
-            while (left_bound + 1 < right_bound) {
-                // Until we run out of unexamined prefixes, do binary search
-                size_t center = (left_bound + right_bound) / 2;
-                // No need to re-check any common prefix
-                size_t center_match = min(left_match, right_match);
-                
-                while (center_match < name_prefixes[center].size() &&
-                       center_match < aln.name().size() &&
-                       name_prefixes[center][center_match] == aln.name()[center_match]) {
-                    // Scan all the matches here
-                    center_match++;
-                }
-                
-                if (center_match == name_prefixes[center].size()) {
-                    // We found a hit!
-                    found = true;
-                    break;
-                }
-                
-                if (center_match == aln.name().size() ||
-                    name_prefixes[center][center_match] > aln.name()[center_match]) {
-                    // The match, if it exists, must be before us
-                    right_bound = center;
-                    right_match = center_match;
-                }
-                else {
-                    // The match, if it exists, must be after us.
-                    left_bound = center;
-                    left_match = center_match;
-                }
-            }
-        }
-        
-        if (!found) {
-            // There are prefixes and we don't match any, so drop the read.
-            keep = false;
-        }
-    }
-    return keep;
+    // If there are prefixes, we must match at least one of them
+    return name_prefix_trie.empty() || name_prefix_trie.has_prefix_of(aln.name());
 }
 
 template<>
@@ -1239,14 +1194,7 @@ inline bool ReadFilter<MultipathAlignment>::get_is_paired(const MultipathAlignme
     
 template<typename Read>
 bool ReadFilter<Read>::contains_subsequence(const Read& read) const {
-    bool found = false;
-    for (const string& seq : subsequences) {
-        if (read.sequence().find(seq) != string::npos) {
-            found = true;
-            break;
-        }
-    }
-    return found;
+    return subsequence_matcher.occurs_in(read.sequence());
 }
 
 template<typename Read>
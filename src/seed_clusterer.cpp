@@ -1,6 +1,7 @@
 #include "seed_clusterer.hpp"
 
 #include <algorithm>
+#include <limits>
 
 //#define DEBUG_CLUSTER
 namespace vg {
@@ -9,13 +10,29 @@ namespace vg {
                                             dist_index(dist_index){
     };
 
+    SnarlSeedClusterer::ClusteringState::ClusteringState() : tree_state(new TreeState()) {
+        // Nothing to do
+    }
+
+    SnarlSeedClusterer::ClusteringState::~ClusteringState() {
+        // Nothing to do
+    }
+
     vector<SnarlSeedClusterer::Cluster> SnarlSeedClusterer::cluster_seeds (const vector<Seed>& seeds, int64_t read_distance_limit) const {
+        ClusteringState state;
+        return cluster_seeds(seeds, read_distance_limit, state);
+    }
+
+    vector<SnarlSeedClusterer::Cluster> SnarlSeedClusterer::cluster_seeds (const vector<Seed>& seeds, int64_t read_distance_limit,
+                                                                          ClusteringState& state) const {
         //Wrapper for single ended
 
         vector<const vector<Seed>*> all_seeds;
         all_seeds.push_back(&seeds);
-        std::vector<std::vector<size_t>> all_clusters =
-            std::get<0>(cluster_seeds_internal(all_seeds, read_distance_limit, 0))[0].all_groups();
+        TreeState& tree_state = *state.tree_state;
+        tree_state.reset(all_seeds, read_distance_limit, 0);
+        cluster_seeds_internal(tree_state);
+        std::vector<std::vector<size_t>> all_clusters = tree_state.read_union_find[0].all_groups();
 
         std::vector<Cluster> result;
         result.reserve(all_clusters.size());
@@ -34,6 +51,13 @@ namespace vg {
     vector<vector<SnarlSeedClusterer::Cluster>> SnarlSeedClusterer::cluster_seeds (
                   const vector<vector<Seed>>& all_seeds, int64_t read_distance_limit,
                   int64_t fragment_distance_limit) const {
+        ClusteringState state;
+        return cluster_seeds(all_seeds, read_distance_limit, fragment_distance_limit, state);
+    }
+
+    vector<vector<SnarlSeedClusterer::Cluster>> SnarlSeedClusterer::cluster_seeds (
+                  const vector<vector<Seed>>& all_seeds, int64_t read_distance_limit,
+                  int64_t fragment_distance_limit, ClusteringState& state) const {
 
         //Wrapper for paired end
         vector<const vector<Seed>*> seed_pointers;
@@ -41,10 +65,12 @@ namespace vg {
         for (const vector<Seed>& v : all_seeds) seed_pointers.push_back(&v);
 
         //Actually cluster the seeds
-        auto union_finds = cluster_seeds_internal(seed_pointers, read_distance_limit, fragment_distance_limit);
+        TreeState& tree_state = *state.tree_state;
+        tree_state.reset(seed_pointers, read_distance_limit, fragment_distance_limit);
+        cluster_seeds_internal(tree_state);
 
-        vector<structures::UnionFind>* read_union_finds = &std::get<0>(union_finds);
-        structures::UnionFind* fragment_union_find = &std::get<1>(union_finds);
+        vector<SeedUnionFind>* read_union_finds = &tree_state.read_union_find;
+        SeedUnionFind* fragment_union_find = &tree_state.fragment_union_find;
 
         std::vector<std::vector<Cluster>> result (all_seeds.size());
         //Map the old group heads to new indices
@@ -90,40 +116,159 @@ namespace vg {
         return static_cast<int64_t>(std::min(static_cast<uint64_t>(n1), static_cast<uint64_t>(n2)));
     }
 
-    tuple<vector<structures::UnionFind>, structures::UnionFind> SnarlSeedClusterer::cluster_seeds_internal (
-                  const vector<const vector<Seed>*>& all_seeds, int64_t read_distance_limit,
-                  int64_t fragment_distance_limit) const {
+    //Stable sort of items by an unsigned integer key, using buffer as
+    //scratch space. Large inputs get an LSD radix sort a byte at a time,
+    //skipping the high bytes that are zero in every key, so keys like snarl
+    //ranks and component numbers only take a pass or two.
+    template<typename Item, typename KeyFunction>
+    static void radix_sort_by_key(vector<Item>& items, vector<Item>& buffer, const KeyFunction& get_key) {
+        if (items.size() < 64) {
+            //Not worth counting for this few items
+            std::stable_sort(items.begin(), items.end(), [&](const Item& a, const Item& b) {
+                return get_key(a) < get_key(b);
+            });
+            return;
+        }
+        size_t max_key = 0;
+        for (const Item& item : items) {
+            max_key = std::max(max_key, (size_t) get_key(item));
+        }
+        buffer.resize(items.size());
+        for (size_t shift = 0 ; shift < 64 && (max_key >> shift) != 0 ; shift += 8) {
+            size_t bucket_starts[257] = {0};
+            for (const Item& item : items) {
+                bucket_starts[((get_key(item) >> shift) & 0xFF) + 1]++;
+            }
+            for (size_t i = 1 ; i < 257 ; i++) {
+                bucket_starts[i] += bucket_starts[i-1];
+            }
+            for (const Item& item : items) {
+                buffer[bucket_starts[(get_key(item) >> shift) & 0xFF]++] = item;
+            }
+            items.swap(buffer);
+        }
+    }
+
+    void SnarlSeedClusterer::SeedUnionFind::reset(size_t size) {
+        heads.resize(size);
+        for (size_t i = 0 ; i < size ; i++) {
+            heads[i] = i;
+        }
+        ranks.assign(size, 0);
+    }
+
+    size_t SnarlSeedClusterer::SeedUnionFind::find_group(size_t i) {
+        size_t group = i;
+        while (heads[group] != group) {
+            group = heads[group];
+        }
+        //Compress the path
+        while (heads[i] != group) {
+            size_t next = heads[i];
+            heads[i] = group;
+            i = next;
+        }
+        return group;
+    }
+
+    void SnarlSeedClusterer::SeedUnionFind::union_groups(size_t i, size_t j) {
+        size_t group_i = find_group(i);
+        size_t group_j = find_group(j);
+        if (group_i == group_j) {
+            return;
+        }
+        //Union by rank, with ties going to j's group
+        if (ranks[group_i] > ranks[group_j]) {
+            heads[group_j] = group_i;
+        } else {
+            heads[group_i] = group_j;
+            if (ranks[group_i] == ranks[group_j]) {
+                ranks[group_j]++;
+            }
+        }
+    }
+
+    vector<vector<size_t>> SnarlSeedClusterer::SeedUnionFind::all_groups() {
+        vector<vector<size_t>> groups;
+        group_indexes.assign(heads.size(), std::numeric_limits<size_t>::max());
+        for (size_t i = 0 ; i < heads.size() ; i++) {
+            size_t group = find_group(i);
+            if (group_indexes[group] == std::numeric_limits<size_t>::max()) {
+                group_indexes[group] = groups.size();
+                groups.emplace_back();
+            }
+            groups[group_indexes[group]].push_back(i);
+        }
+        return groups;
+    }
+
+    void SnarlSeedClusterer::TreeState::reset (const vector<const vector<Seed>*>& seeds, int64_t new_read_distance_limit,
+                                               int64_t new_fragment_distance_limit) {
+        seed_pointers = seeds;
+        all_seeds = &seed_pointers;
+        read_distance_limit = new_read_distance_limit;
+        fragment_distance_limit = new_fragment_distance_limit;
+
+        //Size the per-read structures, keeping what the inner vectors have
+        //already allocated
+        read_index_offsets.assign(1, 0);
+        read_union_find.resize(seeds.size());
+        read_cluster_dists.resize(seeds.size());
+        node_to_seeds.resize(seeds.size());
+        for (size_t i = 0 ; i < seeds.size() ; i++) {
+            size_t size = seeds[i]->size();
+            read_index_offsets.push_back(read_index_offsets.back() + size);
+            read_cluster_dists[i].assign(size, make_pair(-1,-1));
+            node_to_seeds[i].clear();
+            node_to_seeds[i].reserve(size);
+            read_union_find[i].reset(size);
+        }
+        fragment_union_find.reset(read_index_offsets.back());
+
+        seen_nodes.clear();
+        snarl_to_nodes_by_level.clear();
+        snarl_to_nodes.clear();
+        chain_to_snarls.clear();
+        parent_snarl_to_nodes.clear();
+
+        top_level_components.clear();
+        top_level_seeds.clear();
+        top_level_seed_starts.clear();
+        simple_snarl_nodes.clear();
+        simple_snarl_node_starts.clear();
+    }
+
+    size_t SnarlSeedClusterer::TreeState::component_index (size_t component) const {
+        auto found = std::lower_bound(top_level_components.begin(), top_level_components.end(), component);
+        if (found == top_level_components.end() || *found != component) {
+            return std::numeric_limits<size_t>::max();
+        }
+        return found - top_level_components.begin();
+    }
+
+    void SnarlSeedClusterer::cluster_seeds_internal (TreeState& tree_state) const {
         /* Given a vector of seeds and a limit, find a clustering of seeds where
          * seeds that are closer than the limit cluster together.
-         * Returns a vector of cluster assignments
+         * Leaves the cluster assignments in tree_state's union finds
          */
 #ifdef DEBUG_CLUSTER
 cerr << endl << endl << endl << endl << "New cluster calculation:" << endl;
 #endif
-        if (fragment_distance_limit != 0 &&
-            fragment_distance_limit < read_distance_limit) {
+        if (tree_state.fragment_distance_limit != 0 &&
+            tree_state.fragment_distance_limit < tree_state.read_distance_limit) {
             throw std::runtime_error("Fragment distance limit must be greater than read distance limit");
         }
 
         //For each level of the snarl tree, maps snarls (index into
         //dist_index.snarl_indexes) at that level to nodes belonging to the snarl
         //This is later used to populate snarl_to_node in the tree state
-        vector<hash_map<size_t, vector<pair<NetgraphNode, NodeClusters>>>> snarl_to_nodes_by_level;
+        vector<hash_map<size_t, vector<pair<NetgraphNode, NodeClusters>>>>& snarl_to_nodes_by_level = tree_state.snarl_to_nodes_by_level;
         snarl_to_nodes_by_level.reserve(dist_index.tree_depth+1);
 
 
-
-        //This stores all the tree relationships and cluster information
-        //for a single level of the snarl tree as it is being processed
-        //It also keeps track of the parents of the current level
-        size_t seed_count = 0;
-        for (auto v : all_seeds) seed_count+= v->size();
-        TreeState tree_state (&all_seeds, read_distance_limit, fragment_distance_limit, seed_count);
-
-
         //Populate tree_state.node_to_seeds (mapping each node to the seeds it
         //contains) and snarl_to_nodes_by_level
-        get_nodes(tree_state, snarl_to_nodes_by_level);
+        get_nodes(tree_state);
 
         //Initialize the tree state to be the bottom level
         tree_state.snarl_to_nodes = std::move(snarl_to_nodes_by_level[snarl_to_nodes_by_level.size() - 1]);
@@ -255,20 +400,18 @@ for (size_t i = 1 ; i < tree_state.all_seeds->size() ; i++) {
 
 
 #endif
-        return make_tuple(std::move(tree_state.read_union_find), std::move(tree_state.fragment_union_find));
 
     };
 
 
-    void SnarlSeedClusterer::get_nodes( TreeState& tree_state,
-              vector<hash_map<size_t,vector<pair<NetgraphNode, NodeClusters>>>>&
-                                                 snarl_to_nodes_by_level) const {
+    void SnarlSeedClusterer::get_nodes( TreeState& tree_state) const {
 #ifdef DEBUG_CLUSTER
 cerr << "Nested positions: " << endl << "\t";
 #endif
+        vector<hash_map<size_t,vector<pair<NetgraphNode, NodeClusters>>>>& snarl_to_nodes_by_level = tree_state.snarl_to_nodes_by_level;
 
         // Assign each seed to a node.
-        hash_set<id_t> seen_nodes;
+        hash_set<id_t>& seen_nodes = tree_state.seen_nodes;
         for (size_t read_num = 0 ; read_num < tree_state.all_seeds->size() ; read_num++){ 
             const vector<Seed>* seeds = tree_state.all_seeds->at(read_num);
             for (size_t i = 0; i < seeds->size(); i++) {
@@ -298,13 +441,7 @@ cerr << "Nested positions: " << endl << "\t";
                     } 
                 } else if (seeds->at(i).is_top_level_node) {
                     //If this is a top-level seed, defer clustering until we reach the top-level
-                    size_t component = seeds->at(i).component;
-                    if (tree_state.component_to_index.count(component) == 0) {
-                        tree_state.component_to_index.emplace(component, tree_state.top_level_seed_clusters.size());
-                        tree_state.top_level_seed_clusters.emplace_back();
-                        tree_state.simple_snarl_to_nodes_by_component.emplace_back();
-                    }
-                    tree_state.top_level_seed_clusters[tree_state.component_to_index.at(component)].emplace_back(read_num, i);
+                    tree_state.top_level_seeds.push_back({seeds->at(i).component, read_num, i});
 
                 } else if (seeds->at(i).is_top_level_snarl) {
                     //This is a top-level simple snarl
@@ -314,18 +451,11 @@ cerr << "Nested positions: " << endl << "\t";
 
                     tree_state.node_to_seeds[read_num].emplace_back(id, i);
 
-                    size_t component = dist_index.get_connected_component(id);
-                    if (tree_state.component_to_index.count(component) == 0) {
-                        tree_state.component_to_index.emplace(component, tree_state.top_level_seed_clusters.size());
-                        tree_state.top_level_seed_clusters.emplace_back();
-                        tree_state.simple_snarl_to_nodes_by_component.emplace_back();
-                    }
-                    hash_map<size_t, vector<tuple<id_t, bool, int64_t, int64_t, int64_t>>>& simple_snarl_to_nodes = 
-                        tree_state.simple_snarl_to_nodes_by_component[tree_state.component_to_index.at(component)];
                     if (seen_nodes.count(id) < 1) {
                         seen_nodes.insert(id);
-                        simple_snarl_to_nodes[seeds->at(i).snarl_rank].emplace_back(
-                            id, seeds->at(i).rev_in_chain, seeds->at(i).start_length, seeds->at(i).end_length, seeds->at(i).node_length);
+                        tree_state.simple_snarl_nodes.push_back({dist_index.get_connected_component(id), 
+                            seeds->at(i).snarl_rank, id, seeds->at(i).rev_in_chain, (int64_t)seeds->at(i).start_length, 
+                            (int64_t)seeds->at(i).end_length, (int64_t)seeds->at(i).node_length});
                     }
                 }
             }
@@ -335,12 +465,45 @@ cerr << "Nested positions: " << endl << "\t";
         if (snarl_to_nodes_by_level.empty()) {
             snarl_to_nodes_by_level.resize(1);
         }
+
+        //Group the top-level seeds by component, and the simple snarl nodes
+        //by component and then by snarl. The sorts are stable, so seeds and
+        //nodes otherwise stay in the order they were found.
+        radix_sort_by_key(tree_state.top_level_seeds, tree_state.top_level_seed_buffer,
+                          [](const TreeState::TopLevelSeed& seed) { return seed.component; });
+        radix_sort_by_key(tree_state.simple_snarl_nodes, tree_state.simple_snarl_node_buffer,
+                          [](const TreeState::SimpleSnarlNode& node) { return node.snarl_rank; });
+        radix_sort_by_key(tree_state.simple_snarl_nodes, tree_state.simple_snarl_node_buffer,
+                          [](const TreeState::SimpleSnarlNode& node) { return node.component; });
+
+        //Merge the components of both into one sorted list of components,
+        //and find where each component's range starts in each array
+        size_t seed_i = 0;
+        size_t node_i = 0;
+        while (seed_i < tree_state.top_level_seeds.size() || node_i < tree_state.simple_snarl_nodes.size()) {
+            size_t component = std::numeric_limits<size_t>::max();
+            if (seed_i < tree_state.top_level_seeds.size()) {
+                component = tree_state.top_level_seeds[seed_i].component;
+            }
+            if (node_i < tree_state.simple_snarl_nodes.size()) {
+                component = std::min(component, tree_state.simple_snarl_nodes[node_i].component);
+            }
+            tree_state.top_level_components.push_back(component);
+            tree_state.top_level_seed_starts.push_back(seed_i);
+            tree_state.simple_snarl_node_starts.push_back(node_i);
+            while (seed_i < tree_state.top_level_seeds.size() && tree_state.top_level_seeds[seed_i].component == component) {
+                seed_i++;
+            }
+            while (node_i < tree_state.simple_snarl_nodes.size() && tree_state.simple_snarl_nodes[node_i].component == component) {
+                node_i++;
+            }
+        }
+        tree_state.top_level_seed_starts.push_back(seed_i);
+        tree_state.simple_snarl_node_starts.push_back(node_i);
 #ifdef DEBUG_CLUSTER
         cerr << endl << "Top-level seeds:" << endl << "\t";
-        for (size_t component_num = 0 ; component_num < tree_state.top_level_seed_clusters.size() ; component_num++) {
-            for (pair<size_t, size_t> seed_index : tree_state.top_level_seed_clusters[component_num]) {
-                cerr << seed_index.first << ":" << tree_state.all_seeds->at(seed_index.first)->at(seed_index.second).pos << ", ";
-            }
+        for (const TreeState::TopLevelSeed& seed : tree_state.top_level_seeds) {
+            cerr << seed.read_num << ":" << tree_state.all_seeds->at(seed.read_num)->at(seed.seed_num).pos << ", ";
         }
         cerr << endl;
 #endif
@@ -419,7 +582,7 @@ cerr << "Nested positions: " << endl << "\t";
     }
 
     void SnarlSeedClusterer::cluster_chain_level(TreeState& tree_state, size_t depth) const {
-        vector<bool>  seen_components( tree_state.top_level_seed_clusters.size(), false);
+        vector<bool>  seen_components( tree_state.top_level_components.size(), false);
         for (auto& kv : tree_state.chain_to_snarls) {
             //For each chain at this level that has relevant child snarls in it,
             //find the clusters.
@@ -438,8 +601,9 @@ cerr << "Nested positions: " << endl << "\t";
 
             //Mark this component as being seen
             size_t component = dist_index.get_connected_component(dist_index.chain_indexes[chain_i].id_in_parent);
-            if (tree_state.component_to_index.count(component) != 0) {
-                seen_components[tree_state.component_to_index[component]] = true;
+            size_t component_i = tree_state.component_index(component);
+            if (component_i != std::numeric_limits<size_t>::max()) {
+                seen_components[component_i] = true;
             }
             // Compute the clusters for the chain
             if (depth == 0) {
@@ -479,15 +643,17 @@ cerr << "Nested positions: " << endl << "\t";
             // and cluster the top-level seeds and snarls
             for (size_t component_num = 0 ; component_num < seen_components.size() ; component_num++) {
                 if (!seen_components[component_num]) {
-                    if (tree_state.simple_snarl_to_nodes_by_component[component_num].empty()) {
+                    if (tree_state.simple_snarl_node_starts[component_num] == tree_state.simple_snarl_node_starts[component_num+1]) {
                         //If there are no top-level simple bubbles in this component, cluster only top level seeds
-                        cluster_only_top_level_chain_seeds(tree_state, tree_state.top_level_seed_clusters[component_num]);
+                        cluster_only_top_level_chain_seeds(tree_state, 
+                                tree_state.top_level_seeds.begin() + tree_state.top_level_seed_starts[component_num],
+                                tree_state.top_level_seeds.begin() + tree_state.top_level_seed_starts[component_num+1]);
                     } else {
                         //Cluster both top-level bubbles and chain nodes
 #ifdef DEBUG_CLUSTER
                         cerr << "Clustering top-level bubbles and nodes " << endl;
 #endif
-                        id_t node_id = std::get<0>(tree_state.simple_snarl_to_nodes_by_component[component_num].begin()->second.front());
+                        id_t node_id = tree_state.simple_snarl_nodes[tree_state.simple_snarl_node_starts[component_num]].node_id;
                         size_t chain_i = dist_index.component_to_chain_index[dist_index.get_connected_component(node_id)-1];
                         cluster_one_chain(tree_state, chain_i, depth);
                     }
@@ -1142,44 +1308,40 @@ cerr << "\t distances between ranks " << node_rank << " and " << other_rank
         cluster_head_indices.reserve(snarls_in_chain.size());
 
 
-        //Insert a cluster (offset in chain, read num, seed num) into a sorted list of clusters
-        auto insert_in_order = [&](vector<tuple<int64_t, size_t, size_t>>& input_vector, tuple<int64_t, size_t, size_t> item) {
-            //Get the offset of the thing we're inserting
-            const Seed& curr_seed = tree_state.all_seeds->at(std::get<1>(item))->at(std::get<2>(item));
-            pos_t pos =  curr_seed.pos;
+        //Get the offset of a cluster (offset in chain, read num, seed num) for sorting the list of clusters
+        auto cluster_offset = [&](const tuple<int64_t, size_t, size_t>& item) -> int64_t {
             //Offset in the chain (if its a top-level seed) or the offset of the end of the first boundary node in the chain
             //of a snarl if its a snarl cluster
-            //snarls always go after seeds on the same node since seeds will be added first
-            int64_t item_offset = std::get<0>(item) == -1 ? curr_seed.offset : std::get<0>(item);
-
-            //Get an iterator to where the thing we're inserting should go in the vector
-            std::vector<tuple<int64_t, size_t, size_t>>::iterator insert_itr = std::upper_bound(input_vector.begin(), input_vector.end(),
-               item_offset, [&](int64_t val, tuple<int64_t, size_t, size_t> vector_item) {
-                   int64_t offset = std::get<0>(vector_item) == -1 ? 
-                        tree_state.all_seeds->at(std::get<1>(vector_item))->at(std::get<2>(vector_item)).offset :
-                        std::get<0>(vector_item);
-                   return val < offset; 
-               });
-            //Add the item to the vector in sorted order
-            input_vector.insert(insert_itr, item);
+            return std::get<0>(item) == -1 ? 
+                tree_state.all_seeds->at(std::get<1>(item))->at(std::get<2>(item)).offset :
+                std::get<0>(item);
         };
 
         //Add top-level seed clusters and top-level simple snarl clusters to sorted list
-        if (depth == 0 && tree_state.component_to_index.count(connected_component_num) != 0) {
+        size_t component_i = depth == 0 ? tree_state.component_index(connected_component_num) 
+                                         : std::numeric_limits<size_t>::max();
+        if (component_i != std::numeric_limits<size_t>::max()) {
 
             //Add the top-level seeds
-            for (const pair<size_t, size_t>& indices : tree_state.top_level_seed_clusters[tree_state.component_to_index[connected_component_num]]) {
-                insert_in_order(cluster_head_indices, make_tuple(-1, indices.first, indices.second));
+            for (size_t i = tree_state.top_level_seed_starts[component_i] ; i < tree_state.top_level_seed_starts[component_i+1] ; i++) {
+                const TreeState::TopLevelSeed& seed = tree_state.top_level_seeds[i];
+                cluster_head_indices.emplace_back(-1, seed.read_num, seed.seed_num);
             }
 
             //Cluster top-level simple snarls and add them to the list of cluster heads after the seeds
-            for (auto& snarl_to_node : 
-                    tree_state.simple_snarl_to_nodes_by_component[tree_state.component_to_index[connected_component_num]] ){
+            //The nodes of the component are sorted by snarl, so each snarl is a run of nodes
+            auto snarl_begin = tree_state.simple_snarl_nodes.cbegin() + tree_state.simple_snarl_node_starts[component_i];
+            auto component_end = tree_state.simple_snarl_nodes.cbegin() + tree_state.simple_snarl_node_starts[component_i+1];
+            while (snarl_begin != component_end) {
+                auto snarl_end = snarl_begin;
+                while (snarl_end != component_end && snarl_end->snarl_rank == snarl_begin->snarl_rank) {
+                    ++snarl_end;
+                }
 
-                size_t start_rank = snarl_to_node.first;
-                bool rev_in_chain; id_t node_id; int64_t node_len; //Don't really need these
-                int64_t start_length ; int64_t end_length;
-                std::tie(node_id, rev_in_chain, start_length, end_length, node_len) = snarl_to_node.second[0];
+                size_t start_rank = snarl_begin->snarl_rank;
+                bool rev_in_chain = snarl_begin->rev_in_chain;
+                int64_t start_length = snarl_begin->start_length;
+                int64_t end_length = snarl_begin->end_length;
                 int64_t snarl_length = start_rank == 0 ? chain_index.prefix_sum[start_rank + 1] - start_length : 
                         chain_index.prefix_sum[start_rank + 1] - chain_index.prefix_sum[start_rank] - start_length; 
 
@@ -1196,7 +1358,7 @@ cerr << "\t distances between ranks " << node_rank << " and " << other_rank
                 //Updates distances to the ends of the node (not including boundary nodes of the snarl), sides
                 //are relative to the node, not orientation in the chain
                 hash_set<pair<size_t, size_t>> simple_snarl_clusters = 
-                        cluster_simple_snarl(tree_state, snarl_to_node.second, loop_left, loop_right, snarl_length); 
+                        cluster_simple_snarl(tree_state, snarl_begin, snarl_end, loop_left, loop_right, snarl_length); 
 
                 //The offset of this snarl in the chain for placement in cluster_head_indices
                 int64_t offset = start_rank == 0 ? start_length : chain_index.prefix_sum[start_rank] + start_length - 1;
@@ -1207,9 +1369,9 @@ cerr << "\t distances between ranks " << node_rank << " and " << other_rank
 #ifdef DEBUG_CLUSTER
                 cerr << "\tupdating simple snarl distances to the ends of the chain with additional distances " 
                      << add_dist_left_left << " " << add_dist_right_right << endl;
-                MinimumDistanceIndex::SnarlIndex& snarl_index = dist_index.snarl_indexes[dist_index.get_primary_assignment(node_id)];
+                MinimumDistanceIndex::SnarlIndex& snarl_index = dist_index.snarl_indexes[dist_index.get_primary_assignment(snarl_begin->node_id)];
                 assert(dist_index.get_chain_rank(snarl_index.id_in_parent) ==  start_rank);
-                assert(snarl_index.node_length(dist_index.get_primary_rank(node_id)) == node_len);
+                assert(snarl_index.node_length(dist_index.get_primary_rank(snarl_begin->node_id)) == snarl_begin->node_length);
                 if (snarl_index.rev_in_parent) {
                     assert(snarl_index.node_length(0) == end_length);
                     assert(snarl_index.node_length(snarl_index.num_nodes*2-1) == start_length);
@@ -1223,7 +1385,7 @@ cerr << "\t distances between ranks " << node_rank << " and " << other_rank
                 for (const pair<size_t, size_t>& cluster_head : simple_snarl_clusters) {
                     //Add this new snarl cluster to list. It will be treated as any other snarl cluster
 
-                    insert_in_order(cluster_head_indices, make_tuple( offset, cluster_head.first, cluster_head.second));
+                    cluster_head_indices.emplace_back(offset, cluster_head.first, cluster_head.second);
 
                     int64_t old_left = rev_in_chain ? tree_state.read_cluster_dists[cluster_head.first][cluster_head.second].second : 
                                                         tree_state.read_cluster_dists[cluster_head.first][cluster_head.second].first;
@@ -1244,6 +1406,7 @@ cerr << "\t distances between ranks " << node_rank << " and " << other_rank
 #endif
 
                 }
+                snarl_begin = snarl_end;
             }
         }
 
@@ -1456,7 +1619,7 @@ cerr << "  Maybe combining this cluster from the right" << endl;
             for (auto& cluster_head : to_add) {
                 //Add the clusters on this snarl to our overall list of clusters and update the distances
                 //for each of the clusters
-                insert_in_order(cluster_head_indices, make_tuple(offset_in_chain, cluster_head.first, cluster_head.second));
+                cluster_head_indices.emplace_back(offset_in_chain, cluster_head.first, cluster_head.second);
 
                 //Get the distance to the start side of the chain
                 int64_t dist_left_left = tree_state.read_cluster_dists[cluster_head.first][cluster_head.second].first == -1 ? -1 
@@ -1511,6 +1674,13 @@ cerr << "  Maybe combining this cluster from the right" << endl;
         //This will get updated as we traverse through the child clusters
         NodeClusters chain_clusters(tree_state.all_seeds->size());
 
+        //Put the clusters in order of their offsets in the chain. The sort is stable, so snarls always go after
+        //seeds on the same node since seeds were added first
+        std::stable_sort(cluster_head_indices.begin(), cluster_head_indices.end(),
+            [&](const tuple<int64_t, size_t, size_t>& a, const tuple<int64_t, size_t, size_t>& b) {
+                return cluster_offset(a) < cluster_offset(b);
+            });
+
         //Go through the clusters in order and cluster them. If the cluster was a real cluster, then compare it to the
         //last seed cluster we found. If it was a seed, compare it to all previous clusters since we last saw a seed
         for (tuple<int64_t, size_t, size_t>& seed_index : cluster_head_indices) {
@@ -1986,15 +2156,16 @@ cerr <<  "\t\t cluster" << read_num << " " << std::get<0>(prev_snarl_cluster_by_
     };
 
     void SnarlSeedClusterer::cluster_only_top_level_chain_seeds(TreeState& tree_state, 
-                                                                  vector<pair<size_t, size_t>>& seed_clusters) const {
+                                                                  vector<TreeState::TopLevelSeed>::iterator seeds_begin,
+                                                                  vector<TreeState::TopLevelSeed>::iterator seeds_end) const {
 #ifdef DEBUG_CLUSTER
         cerr << "Clustering top-level seeds" << endl;
 #endif
 
 
-        std::sort(seed_clusters.begin(), seed_clusters.end(), [&](pair<size_t, size_t> item1, pair<size_t, size_t> item2) {
-                   int64_t offset1 = tree_state.all_seeds->at(item1.first)->at(item1.second).offset ;
-                   int64_t offset2 = tree_state.all_seeds->at(item2.first)->at(item2.second).offset ;
+        std::sort(seeds_begin, seeds_end, [&](const TreeState::TopLevelSeed& item1, const TreeState::TopLevelSeed& item2) {
+                   int64_t offset1 = tree_state.all_seeds->at(item1.read_num)->at(item1.seed_num).offset ;
+                   int64_t offset2 = tree_state.all_seeds->at(item2.read_num)->at(item2.seed_num).offset ;
                    return offset1 < offset2; 
                });
 
@@ -2002,7 +2173,8 @@ cerr <<  "\t\t cluster" << read_num << " " << std::get<0>(prev_snarl_cluster_by_
 
         vector<tuple<int64_t, size_t, size_t>> last_by_read (tree_state.all_seeds->size(), make_tuple(-1, 0, 0));
 
-        for (pair<size_t, size_t> seed_cluster : seed_clusters) {
+        for (auto seed_itr = seeds_begin ; seed_itr != seeds_end ; ++seed_itr) {
+            pair<size_t, size_t> seed_cluster (seed_itr->read_num, seed_itr->seed_num);
             int64_t offset = tree_state.all_seeds->at(seed_cluster.first)->at(seed_cluster.second).offset ;
 
 #ifdef DEBUG_CLUSTER
@@ -2041,7 +2213,9 @@ cerr <<  "\t\t cluster" << read_num << " " << std::get<0>(prev_snarl_cluster_by_
     };
 
 
-    hash_set<pair<size_t, size_t>> SnarlSeedClusterer::cluster_simple_snarl(TreeState& tree_state, vector<tuple<id_t, bool, int64_t, int64_t, int64_t>> nodes, 
+    hash_set<pair<size_t, size_t>> SnarlSeedClusterer::cluster_simple_snarl(TreeState& tree_state, 
+                                vector<TreeState::SimpleSnarlNode>::const_iterator nodes_begin,
+                                vector<TreeState::SimpleSnarlNode>::const_iterator nodes_end,
                                 int64_t loop_left, int64_t loop_right, int64_t snarl_length) const {
         //Cluster a top-level simple snarl and save the distances to the ends of the node in tree_state.read_cluster_dists 
         //Returns a vector of cluster heads (<read_num, seed num>)
@@ -2059,9 +2233,9 @@ cerr <<  "\t\t cluster" << read_num << " " << std::get<0>(prev_snarl_cluster_by_
         vector<int64_t> best_right (tree_state.all_seeds->size(), -1);
 
 
-        for (tuple<id_t, bool, int64_t, int64_t, int64_t> node : nodes) {
-            id_t node_id = std::get<0>(node);
-            int64_t node_len = std::get<4>(node);
+        for (auto node = nodes_begin ; node != nodes_end ; ++node) {
+            id_t node_id = node->node_id;
+            int64_t node_len = node->node_length;
 
             //Cluster this node
             SnarlSeedClusterer::NodeClusters clusters =  cluster_one_node(tree_state, node_id, node_len);
@@ -11,6 +11,9 @@ namespace vg{
 
 class SnarlSeedClusterer {
 
+    private:
+        struct TreeState;
+
     public:
 
         /// Seed information used in Giraffe.
@@ -42,6 +45,20 @@ class SnarlSeedClusterer {
             SmallBitset present; // Minimizers that are present in the cluster.
         };
 
+        /// Scratch space for clustering that can be kept between calls.
+        /// Clustering with the same state object over and over (for
+        /// example, one per mapping thread) reuses its buffers instead of
+        /// building fresh ones for every read. A state may only be used by
+        /// one thread at a time.
+        class ClusteringState {
+            public:
+                ClusteringState();
+                ~ClusteringState();
+            private:
+                friend class SnarlSeedClusterer;
+                unique_ptr<TreeState> tree_state;
+        };
+
         SnarlSeedClusterer(MinimumDistanceIndex& dist_index);
 
         //TODO: I don't want to be too tied to the minimizer_mapper implementation with seed structs
@@ -52,6 +69,10 @@ class SnarlSeedClusterer {
         // the distance limit are in the same cluster
 
         vector<Cluster> cluster_seeds ( const vector<Seed>& seeds, int64_t read_distance_limit) const;
+
+        ///The same thing, but reusing the given clustering state
+        vector<Cluster> cluster_seeds ( const vector<Seed>& seeds, int64_t read_distance_limit,
+                ClusteringState& state) const;
         
         ///The same thing, but for paired end reads.
         //Given seeds from multiple reads of a fragment, cluster each read
@@ -67,13 +88,17 @@ class SnarlSeedClusterer {
         vector<vector<Cluster>> cluster_seeds ( 
                 const vector<vector<Seed>>& all_seeds, int64_t read_distance_limit, int64_t fragment_distance_limit=0) const;
 
+        ///The same thing for paired end reads, but reusing the given clustering state
+        vector<vector<Cluster>> cluster_seeds ( 
+                const vector<vector<Seed>>& all_seeds, int64_t read_distance_limit, int64_t fragment_distance_limit,
+                ClusteringState& state) const;
+
     private:
 
 
-        //Actual clustering function that takes a vector of pointers to seeds
-        tuple<vector<structures::UnionFind>, structures::UnionFind> cluster_seeds_internal ( 
-                const vector<const vector<Seed>*>& all_seeds,
-                int64_t read_distance_limit, int64_t fragment_distance_limit=0) const;
+        //Actual clustering function. Clusters the seeds that tree_state has
+        //been reset to, leaving the clusters in its union finds
+        void cluster_seeds_internal (TreeState& tree_state) const;
 
         MinimumDistanceIndex& dist_index;
 
@@ -166,15 +191,47 @@ class SnarlSeedClusterer {
                 read_best_left(read_count, -1), read_best_right(read_count, -1){}
         };
 
+        //Union-find over seed indexes, working like structures::UnionFind
+        //without group tracking, but able to be reset in place so that a
+        //TreeState can be reused without rebuilding it
+        class SeedUnionFind {
+            public:
+                //Make this hold size singleton groups, keeping the memory
+                //that has already been allocated
+                void reset(size_t size);
+
+                //Get the group ID that index i belongs to (can change after
+                //calling union_groups)
+                size_t find_group(size_t i);
+
+                //Merge the group containing index i with the group
+                //containing index j
+                void union_groups(size_t i, size_t j);
+
+                //Get all the groups, each sorted, in order of their
+                //smallest members
+                vector<vector<size_t>> all_groups();
+
+            private:
+                vector<size_t> heads;
+                vector<size_t> ranks;
+                //Scratch space for all_groups()
+                vector<size_t> group_indexes;
+        };
+
 
         struct TreeState {
             //Hold all the tree relationships, seed locations, and cluster info
             //for the current level of the snarl tree and the parent level
             //As clustering occurs at the current level, the parent level
             //is updated to know about its children
+            //A TreeState can be reset and reused for another set of seeds,
+            //which keeps the memory that has already been allocated
 
             //Vector of all the seeds for each read
+            //Points to seed_pointers
             const vector<const vector<Seed>*>* all_seeds; 
+            vector<const vector<Seed>*> seed_pointers;
 
             //prefix sum vector of the number of seeds per read
             //To get the index of a seed for the fragment clusters
@@ -189,8 +246,8 @@ class SnarlSeedClusterer {
             //////////Data structures to hold clustering information
 
             //Structure to hold the clustering of the seeds
-            vector<structures::UnionFind> read_union_find;
-            structures::UnionFind fragment_union_find;
+            vector<SeedUnionFind> read_union_find;
+            SeedUnionFind fragment_union_find;
 
             //For each seed, store the distances to the left and right ends
             //of the netgraph node of the cluster it belongs to
@@ -208,6 +265,14 @@ class SnarlSeedClusterer {
             //The array is sorted.
             vector<vector<pair<id_t, size_t>>> node_to_seeds;
 
+            //Nodes that have already been assigned to a snarl
+            hash_set<id_t> seen_nodes;
+
+            //For each level of the snarl tree, maps snarls (index into
+            //dist_index.snarl_indexes) at that level to nodes belonging to the snarl
+            //This is used to populate snarl_to_nodes as each level is processed
+            vector<hash_map<size_t, vector<pair<NetgraphNode, NodeClusters>>>> snarl_to_nodes_by_level;
+
             //Map from snarl (index into dist_index.snarl_indexes) i
             //to the netgraph nodes contained in the snarl as well as the 
             //clusters at the node
@@ -218,8 +283,6 @@ class SnarlSeedClusterer {
             //Snarls and chains represented as their indexes into 
             //dist_index.chain/snarl_indexes
             //Map maps the rank of the snarl to the snarl and snarl's clusters
-            //  Since maps are ordered, it will be in the order of traversal
-            //  of the snarls in the chain
             hash_map<size_t, hash_map<size_t, pair<size_t, NodeClusters>>> chain_to_snarls;
 
 
@@ -231,45 +294,61 @@ class SnarlSeedClusterer {
 
             /////////////////// Hold the top-level clusters
 
-
-            //maps connected component number to index into top_level_seed_clusters and top_level_clusters
-            hash_map<size_t, size_t> component_to_index;
-
-            //Indexes of seeds that occur on a top level chain, separated into components
-            vector<vector<pair<size_t, size_t>>> top_level_seed_clusters;
-
-            //For each component, maps each snarl (as the rank of the snarl in the chain) to
-            //a list of nodes it contains as <node id, is rev in chain, node length, start length, end length>
-            //where start length and end length are the lengths of the start and end nodes of
-            //the snarl (relative to the orientation in the chain
-            //TODO: this is a mess
+            //A seed that occurs on a top-level chain
+            struct TopLevelSeed {
+                size_t component; //Connected component number
+                size_t read_num;
+                size_t seed_num;
+            };
+
+            //A node in a top-level simple snarl
+            struct SimpleSnarlNode {
+                size_t component; //Connected component number
+                size_t snarl_rank; //Rank of the snarl in the chain
+                id_t node_id;
+                bool rev_in_chain;
+                //Lengths of the start and end nodes of the snarl (relative
+                //to the orientation in the chain) and of this node
+                int64_t start_length;
+                int64_t end_length;
+                int64_t node_length;
+            };
+
+            //Sorted connected component numbers of all components that have
+            //top-level seeds or top-level simple snarls
+            vector<size_t> top_level_components;
+
+            //Seeds that occur on a top-level chain, sorted by component and
+            //otherwise in the order of the input. The seeds of the ith
+            //component in top_level_components are in the range
+            //[top_level_seed_starts[i], top_level_seed_starts[i+1])
+            vector<TopLevelSeed> top_level_seeds;
+            vector<size_t> top_level_seed_starts;
+
+            //Nodes of top-level simple snarls, sorted by component and then
+            //by the rank of the snarl in the chain. Ranges for each component
+            //are in simple_snarl_node_starts, like top_level_seed_starts
             //Only for top-level simple snarls, instead of snarl_to_nodes
-            vector<hash_map<size_t, vector<tuple<id_t, bool, int64_t, int64_t, int64_t>>>> simple_snarl_to_nodes_by_component;
+            vector<SimpleSnarlNode> simple_snarl_nodes;
+            vector<size_t> simple_snarl_node_starts;
 
+            //Scratch space for sorting
+            vector<TopLevelSeed> top_level_seed_buffer;
+            vector<SimpleSnarlNode> simple_snarl_node_buffer;
 
 
             /////////////////////////////////////////////////////////
 
-            //Constructor takes in a pointer to the seeds, the distance limits, and 
-            //the total number of seeds in all_seeds
-            TreeState (const vector<const vector<Seed>*>* all_seeds, int64_t read_distance_limit, 
-                       int64_t fragment_distance_limit, size_t seed_count) :
-                all_seeds(all_seeds),
-                read_distance_limit(read_distance_limit),
-                fragment_distance_limit(fragment_distance_limit),
-                fragment_union_find (seed_count, false),
-                read_index_offsets(1,0){
-
-                for (size_t i = 0 ; i < all_seeds->size() ; i++) {
-                    size_t size = all_seeds->at(i)->size();
-                    size_t offset = read_index_offsets.back() + size;
-                    read_index_offsets.push_back(offset);
-                    read_cluster_dists.emplace_back(size, make_pair(-1,-1));
-                    node_to_seeds.emplace_back();
-                    node_to_seeds.back().reserve(size);
-                    read_union_find.emplace_back(size, false);
-                }
-            }
+            TreeState () : all_seeds(&seed_pointers), read_distance_limit(0),
+                fragment_distance_limit(0), fragment_union_find(0, false) {}
+
+            //Get ready to cluster a new set of seeds with the given distance limits
+            void reset (const vector<const vector<Seed>*>& seeds, int64_t new_read_distance_limit,
+                        int64_t new_fragment_distance_limit);
+
+            //Get the index of a connected component in top_level_components, or
+            //numeric_limits<size_t>::max() if it has no top-level seeds or snarls
+            size_t component_index (size_t component) const;
         };
 
         //Find which nodes contain seeds and assign those nodes to the 
@@ -279,9 +358,8 @@ class SnarlSeedClusterer {
         //seeds to a snarl, organized by the level of the snarl in the snarl 
         //tree. snarl_to_nodes_by_level will be used to populate snarl_to_nodes
         //in the tree state as each level is processed
-        void get_nodes( TreeState& tree_state,
-                        vector<hash_map<size_t, 
-                                  vector<pair<NetgraphNode, NodeClusters>>>>& snarl_to_nodes_by_level) const;
+        //Also fills in and sorts the flat top-level seed and simple snarl arrays
+        void get_nodes( TreeState& tree_state) const;
 
         //Cluster all the snarls at the current level and update the tree_state
         //to add each of the snarls to the parent level
@@ -302,17 +380,21 @@ class SnarlSeedClusterer {
 
         //Cluster the seeds in a chain given by chain_index_i, an index into
         //dist_index.chain_indexes
-        //If the depth is 0, also incorporate the top-level seeds from tree_state.top_level_seed_clusters
+        //If the depth is 0, also incorporate the top-level seeds from tree_state.top_level_seeds
         NodeClusters cluster_one_chain(TreeState& tree_state, size_t chain_i, size_t depth) const;
 
-        //Given a vector of only top level seeds, cluster them
-        void cluster_only_top_level_chain_seeds(TreeState& tree_state, vector<pair<size_t, size_t>>& seed_clusters) const;
+        //Given a range of only top level seeds, cluster them
+        void cluster_only_top_level_chain_seeds(TreeState& tree_state,
+                vector<TreeState::TopLevelSeed>::iterator seeds_begin,
+                vector<TreeState::TopLevelSeed>::iterator seeds_end) const;
 
         //For one simple snarl (a bubble where all non-boundary nodes only connect to the boundary nodes) 
         //cluster its seeds and return the cluster heads
-        //Nodes if taken from tree_state.simple_snarl_to_nodes_by_component and each element in it is
-        //the node id of the node
-        hash_set<pair<size_t, size_t>> cluster_simple_snarl(TreeState& tree_state, vector<tuple<id_t, bool, int64_t, int64_t, int64_t>> nodes, int64_t loop_left, int64_t loop_right, int64_t snarl_length) const;
+        //Nodes are a range of tree_state.simple_snarl_nodes that all belong to the snarl
+        hash_set<pair<size_t, size_t>> cluster_simple_snarl(TreeState& tree_state,
+                vector<TreeState::SimpleSnarlNode>::const_iterator nodes_begin,
+                vector<TreeState::SimpleSnarlNode>::const_iterator nodes_end,
+                int64_t loop_left, int64_t loop_right, int64_t snarl_length) const;
 
 };
 }
@@ -159,6 +159,17 @@ string SourceSinkOverlay::get_sequence(const handle_t& handle) const {
     }
 }
 
+char SourceSinkOverlay::get_base(const handle_t& handle, size_t index) const {
+    if (handle == source_fwd || handle == sink_rev) {
+        return '#';
+    } else if (handle == source_rev || handle == sink_fwd) {
+        return '$';
+    } else {
+        assert(!is_ours(handle));
+        return backing->get_base(to_backing(handle), index);
+    }
+}
+
 bool SourceSinkOverlay::follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
     if (is_ours(handle)) {
         // We only care about the right of the source and the left of the sink
@@ -78,6 +78,10 @@ public:
     /// orientation.
     virtual string get_sequence(const handle_t& handle) const;
     
+    /// Get one base of a node, in the handle's local forward orientation,
+    /// without copying out the whole sequence.
+    virtual char get_base(const handle_t& handle, size_t index) const;
+    
     /// Loop over all the handles to next/previous (right/left) nodes. Passes
     /// them to a callback which returns false to stop iterating and true to
     /// continue. Returns true if we finished and false if we stopped early.
@@ -10,6 +10,8 @@
 #include "stream_index.hpp"
 #include "utility.hpp"
 #include "vg/io/json2pb.h"
+#include <ips4o.hpp>
+#include <omp.h>
 #include <string>
 #include <queue>
 #include <sstream>
@@ -20,6 +22,8 @@
 #include <vector>
 #include <unordered_map>
 #include <tuple>
+#include <chrono>
+#include <future>
 
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -70,12 +74,38 @@ public:
     // Supporting API
     //////////////////
 
-    /// Sort a vector of messages, in place.
+    /// Statistics about the most recent sort, for reporting throughput.
+    struct Stats {
+        /// Number of messages sorted
+        size_t messages = 0;
+        /// Serialized, uncompressed size of the messages sorted
+        size_t bytes = 0;
+        /// Number of sorted chunks written to temp files
+        size_t temp_files = 0;
+        /// Time spent reading and sorting, including writing chunks
+        double sort_seconds = 0;
+        /// Time spent merging and writing the output
+        double merge_seconds = 0;
+    };
+    
+    /// Get statistics about the most recent sort.
+    const Stats& get_stats() const;
+
+    /// Sort a vector of messages, in place, using all OMP threads. Messages
+    /// that tie keep their relative order.
     void sort(vector<Message>& msgs) const;
 
     /// Return true if out of Messages a and b, a must come before b, and false otherwise.
     bool less_than(const Message& a, const Message& b) const;
     
+    /// Key that orders messages the same way as less_than(): the node ID,
+    /// strand, and offset of the message's minimum Position.
+    using sort_key_t = tuple<int64_t, bool, int64_t>;
+    
+    /// Compute the sort key for a message, so it only needs to be scanned once
+    /// no matter how many times it is compared.
+    sort_key_t get_sort_key(const Message& msg) const;
+    
     /// Determine the minumum Position visited by an Message. The minumum
     /// Position is the lowest node ID visited by the message, with the
     /// lowest offset visited on that node ID as the offset, and the
@@ -97,6 +127,12 @@ public:
     /// What's the max fan-in when combining temp files, during the streaming sort?
     /// This will be computed based on the max file descriptor limit from the OS.
     size_t max_fan_in;
+    /// How many messages should the merge decode ahead of the messages being
+    /// written?
+    static const size_t merge_batch_size = 4096;
+    
+    /// Statistics from the most recent sort
+    Stats stats;
     
     using cursor_t = vg::io::ProtobufIterator<Message>;
     using emitter_t = vg::io::ProtobufEmitter<Message>;
@@ -171,23 +207,50 @@ StreamSorter<Message>::StreamSorter(bool show_progress) {
     }
 }
 
+template<typename Message>
+auto StreamSorter<Message>::get_stats() const -> const Stats& {
+    return stats;
+}
+
 template<typename Message>
 void StreamSorter<Message>::sort(vector<Message>& msgs) const {
-    std::sort(msgs.begin(), msgs.end(), [&](const Message& a, const Message& b) {
-        return this->less_than(a, b);
-    });
+    // Compute each key once, and break ties by original index so the sort is
+    // stable no matter how the parallel sort divides up the work.
+    vector<pair<sort_key_t, size_t>> keyed(msgs.size());
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < msgs.size(); i++) {
+        keyed[i] = make_pair(get_sort_key(msgs[i]), i);
+    }
+    
+    ips4o::parallel::sort(keyed.begin(), keyed.end());
+    
+    // Move the messages into their sorted places
+    vector<Message> sorted(msgs.size());
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < keyed.size(); i++) {
+        sorted[i] = std::move(msgs[keyed[i].second]);
+    }
+    msgs = std::move(sorted);
 }
 
 template<typename Message>
 void StreamSorter<Message>::easy_sort(istream& stream_in, ostream& stream_out, StreamIndex<Message>* index_to) {
+    stats = Stats();
+    auto sort_start = chrono::steady_clock::now();
+    
     std::vector<Message> sort_buffer;
 
     vg::io::for_each<Message>(stream_in, [&](Message &msg) {
+        stats.bytes += msg.ByteSizeLong();
         sort_buffer.push_back(msg);
     });
+    stats.messages = sort_buffer.size();
 
     this->sort(sort_buffer);
     
+    auto merge_start = chrono::steady_clock::now();
+    stats.sort_seconds = chrono::duration<double>(merge_start - sort_start).count();
+    
     // Maintain our own group buffer at a higher scope than the emitter.
     vector<Message> group_buffer;
     
@@ -216,6 +279,8 @@ void StreamSorter<Message>::easy_sort(istream& stream_in, ostream& stream_out, S
         
         // Emitter destruction will terminate the file with an EOF marker
     }
+    
+    stats.merge_seconds = chrono::duration<double>(chrono::steady_clock::now() - merge_start).count();
 }
 
 template<typename Message>
@@ -243,6 +308,9 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
     }
     
     
+    stats = Stats();
+    auto sort_start = chrono::steady_clock::now();
+    
     // Don't give an actual 0 to the progress code or it will NaN
     create_progress("break into sorted chunks", file_size == 0 ? 1 : file_size);
 
@@ -257,59 +325,61 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
     // This cursor will read in the input file.
     cursor_t input_cursor(stream_in);
     
-    #pragma omp parallel shared(stream_in, input_cursor, outstanding_temp_files, messages_per_file, total_messages_read)
-    {
-    
-        while(true) {
-    
-            vector<Message> thread_buffer;
+    // Decodes the next chunk of input. Only one of these runs at a time.
+    auto read_chunk = [&]() {
+        vector<Message> chunk;
+        size_t buffered_message_bytes = 0;
+        while (input_cursor.has_current() && buffered_message_bytes < max_buf_size) {
+            // Until we run out of input messages or space, buffer each, recording its size.
+            chunk.emplace_back(std::move(input_cursor.take()));
+            // Note that the message has to be small enough for its size to fit in a signed int
+            buffered_message_bytes += chunk.back().ByteSize();
+        }
+        stats.bytes += buffered_message_bytes;
         
-            #pragma omp critical (input_cursor)
-            {
-                // Each thread fights for the file and the winner takes some data
-                size_t buffered_message_bytes = 0;
-                while (input_cursor.has_current() && buffered_message_bytes < max_buf_size) {
-                    // Until we run out of input messages or space, buffer each, recording its size.
-                    thread_buffer.emplace_back(std::move(input_cursor.take()));
-                    // Note that the message has to be small enough for its size to fit in a signed int
-                    buffered_message_bytes += thread_buffer.back().ByteSize();
-                }
-            
-                // Update the progress bar
-                update_progress(stream_in.tellg());
-            }
-            
-            if (thread_buffer.empty()) {
-                // No data was found
-                break;
-            }
-            
-            // Do a sort of the data we grabbed
-            this->sort(thread_buffer);
-            
-            // Save it to a temp file.
-            string temp_name = temp_file::create();
-            ofstream temp_stream(temp_name);
-            // OK to save as one massive group here.
-            // TODO: This write could also be in a thread.
-            vg::io::write_buffered(temp_stream, thread_buffer, 0);
-            
-            #pragma omp critical (outstanding_temp_files)
-            {
-                // Remember the temp file name
-                outstanding_temp_files.push_back(temp_name);
-                // Remember the messages in the file, for progress purposes
-                messages_per_file[temp_name] = thread_buffer.size();
-                // Remember how many messages we found in the total
-                total_messages_read += thread_buffer.size();
-            }
+        // Update the progress bar
+        update_progress(stream_in.tellg());
+        return chunk;
+    };
+    
+    // Decode each chunk in the background while the chunk before it is sorted
+    // by all the threads and written out. This keeps at most two chunks in memory.
+    future<vector<Message>> next_chunk = async(launch::async, read_chunk);
+    while (true) {
+        vector<Message> chunk = next_chunk.get();
+        if (chunk.empty()) {
+            // No data was found
+            break;
         }
+        next_chunk = async(launch::async, read_chunk);
+        
+        // Do a sort of the data we grabbed
+        this->sort(chunk);
+        
+        // Save it to a temp file.
+        string temp_name = temp_file::create();
+        ofstream temp_stream(temp_name);
+        // OK to save as one massive group here.
+        vg::io::write_buffered(temp_stream, chunk, 0);
+        
+        // Remember the temp file name
+        outstanding_temp_files.push_back(temp_name);
+        // Remember the messages in the file, for progress purposes
+        messages_per_file[temp_name] = chunk.size();
+        // Remember how many messages we found in the total
+        total_messages_read += chunk.size();
     }
     
-    // Now we know the reader thmessages have taken care of the input, and all the data is in temp files.
+    stats.messages = total_messages_read;
+    stats.temp_files = outstanding_temp_files.size();
+    
+    // Now we know the reader has taken care of the input, and all the data is in temp files.
     
     destroy_progress();
     
+    auto merge_start = chrono::steady_clock::now();
+    stats.sort_seconds = chrono::duration<double>(merge_start - sort_start).count();
+    
     while (outstanding_temp_files.size() > max_fan_in) {
         // We can't merge them all at once, so merge subsets of them.
         outstanding_temp_files = streaming_merge(outstanding_temp_files, &messages_per_file);
@@ -353,7 +423,8 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
     for (auto& filename : outstanding_temp_files) {
         temp_file::remove(filename);
     }
-            
+    
+    stats.merge_seconds = chrono::duration<double>(chrono::steady_clock::now() - merge_start).count();
 }
 
 template<typename Message>
@@ -383,43 +454,57 @@ void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t&
     // Count the messages we actually see
     size_t observed_messages = 0;
 
-    // Put all the files in a priority queue based on which has a message that comes first.
-    // We work with pointers to cursors because we don't want to be copying the actual cursors around the heap.
-    // We also *reverse* the order, because priority queues put the "greatest" element first
-    auto cursor_order = [&](cursor_t*& a, cursor_t*& b) {
-        if (b->has_current()) {
-            if(!a->has_current()) {
-                // Cursors that aren't empty come first
-                return true;
-            }
-            return less_than(*(*b), *(*a));
-        }
-        return false;
-    };
-    priority_queue<cursor_t*, vector<cursor_t*>, decltype(cursor_order)> cursor_queue(cursor_order);
+    // Put all the files in a priority queue based on the sort key of their
+    // current messages, which we compute once per message. We *reverse* the
+    // order, because priority queues put the "greatest" element first. Ties
+    // go to the earlier file, which holds the earlier messages.
+    vector<cursor_t*> sources;
+    using entry_t = pair<sort_key_t, size_t>;
+    priority_queue<entry_t, vector<entry_t>, greater<entry_t>> source_queue;
 
     for (auto& cursor : cursors) {
-        // Put the cursor pointers in the queue
-        cursor_queue.push(&cursor);
+        if (cursor.has_current()) {
+            source_queue.emplace(get_sort_key(*cursor), sources.size());
+        }
+        sources.push_back(&cursor);
     }
     
-    while(!cursor_queue.empty() && cursor_queue.top()->has_current()) {
-        // Until we have run out of data in all the temp files
-        
-        // Pop off the winning cursor
-        cursor_t* winner = cursor_queue.top();
-        cursor_queue.pop();
-        
-        // Grab and emit its message, and advance it
-        emitter.write(std::move(winner->take()));
+    // Decodes and merges the next batch of messages. Only one of these runs at a time.
+    auto merge_batch = [&]() {
+        vector<Message> batch;
+        batch.reserve(merge_batch_size);
+        while (!source_queue.empty() && batch.size() < merge_batch_size) {
+            // Pop off the winning cursor
+            size_t winner = source_queue.top().second;
+            source_queue.pop();
+            
+            // Grab its message, and advance it
+            batch.emplace_back(std::move(sources[winner]->take()));
+            
+            // Put it back in the heap if it is not depleted
+            if (sources[winner]->has_current()) {
+                source_queue.emplace(get_sort_key(*(*sources[winner])), winner);
+            }
+        }
+        return batch;
+    };
+    
+    // Decode and merge each batch in the background while the batch before it
+    // is encoded and written.
+    future<vector<Message>> next_batch = async(launch::async, merge_batch);
+    while (true) {
+        vector<Message> batch = next_batch.get();
+        if (batch.empty()) {
+            // We have run out of data in all the temp files
+            break;
+        }
+        next_batch = async(launch::async, merge_batch);
         
-        // Put it back in the heap if it is not depleted
-        if (winner->has_current()) {
-            cursor_queue.push(winner);
+        for (auto& msg : batch) {
+            emitter.write(std::move(msg));
         }
-        // TODO: Maybe keep it off the heap for the next loop somehow if it still wins
         
-        observed_messages++;
+        observed_messages += batch.size();
         if (expected_messages != 0) {
             update_progress(observed_messages);
         }
@@ -446,7 +531,7 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         // Open up cursors into all the files.
         list<ifstream> temp_ifstreams;
         list<cursor_t> temp_cursors;
-        open_all(vector<string>(&temp_files_out[start_file], &temp_files_out[start_file + file_count]), temp_ifstreams, temp_cursors);
+        open_all(vector<string>(temp_files_in.begin() + start_file, temp_files_in.begin() + start_file + file_count), temp_ifstreams, temp_cursors);
         
         // Work out how many messages to expect
         size_t expected_messages = 0;
@@ -472,7 +557,7 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         // Clean up the input files we used
         temp_cursors.clear();
         temp_ifstreams.clear();
-        for (size_t i = start_file; i < file_count; i++) {
+        for (size_t i = start_file; i < start_file + file_count; i++) {
             temp_file::remove(temp_files_in.at(i));
         }
         
@@ -488,7 +573,13 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
 
 template<typename Message>
 bool StreamSorter<Message>::less_than(const Message &a, const Message &b) const {
-    return less_than(get_min_position(a), get_min_position(b));
+    return get_sort_key(a) < get_sort_key(b);
+}
+
+template<typename Message>
+auto StreamSorter<Message>::get_sort_key(const Message& msg) const -> sort_key_t {
+    Position min_pos = get_min_position(msg);
+    return sort_key_t(min_pos.node_id(), min_pos.is_reverse(), min_pos.offset());
 }
 
 template<typename Message>
@@ -3,7 +3,9 @@
  * Defines the "vg autoindex" subcommand, which produces indexes needed for other subcommands
  */
 #include <getopt.h>
+#include <omp.h>
 #include <iostream>
+#include <cmath>
 
 #include <htslib/hts.h>
 #include <htslib/vcf.h>
@@ -82,6 +84,18 @@ bool vcf_is_phased(const string& filepath) {
     return found_phased;
 }
 
+/// Parse a byte count with an optional K, M, G, or T suffix
+size_t parse_memory_size(const string& size_str) {
+    string number = size_str;
+    double multiplier = 1.0;
+    size_t suffix_pos = number.empty() ? string::npos : string("KMGT").find(toupper(number.back()));
+    if (suffix_pos != string::npos) {
+        multiplier = pow(1024.0, suffix_pos + 1);
+        number.pop_back();
+    }
+    return parse<double>(number) * multiplier;
+}
+
 void help_autoindex(char** argv) {
     cerr
     << "usage: " << argv[0] << " autoindex [options]" << endl
@@ -96,7 +110,9 @@ void help_autoindex(char** argv) {
     << "    -g, --gfa FILE        GFA file to make a graph from" << endl
     << "  logging and computation:" << endl
     << "    -T, --tmp-dir DIR     temporary directory to use for intermediate files" << endl
-    << "    -V, --verbose         log progress to stderr" << endl
+    << "    -t, --threads NUM     number of threads shared by concurrent indexing steps (default: all available)" << endl
+    << "    -M, --target-mem MEM  limit the memory of concurrent indexing steps, with K/M/G/T suffix (default: physical memory)" << endl
+    << "    -V, --verbose         log progress to stderr, and report time and memory use of each step" << endl
     << "    -d, --dot             print the dot-formatted graph of index recipes and exit" << endl
     << "    -h, --help            print this help message to stderr and exit" << endl;
 }
@@ -125,6 +141,8 @@ int main_autoindex(int argc, char** argv) {
             {"ins-fasta", required_argument, 0, 'i'},
             {"gfa", required_argument, 0, 'g'},
             {"tmp-dir", required_argument, 0, 'T'},
+            {"threads", required_argument, 0, 't'},
+            {"target-mem", required_argument, 0, 'M'},
             {"verbose", no_argument, 0, 'V'},
             {"dot", no_argument, 0, 'd'},
             {"help", no_argument, 0, 'h'},
@@ -132,7 +150,7 @@ int main_autoindex(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "p:w:r:v:i:g:T:dVh",
+        c = getopt_long (argc, argv, "p:w:r:v:i:g:T:t:M:dVh",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -183,6 +201,19 @@ int main_autoindex(int argc, char** argv) {
             case 'T':
                 temp_file::set_dir(optarg);
                 break;
+            case 't':
+            {
+                int num_threads = parse<int>(optarg);
+                if (num_threads <= 0) {
+                    cerr << "error: Thread count (-t) must be positive" << endl;
+                    return 1;
+                }
+                omp_set_num_threads(num_threads);
+                break;
+            }
+            case 'M':
+                registry.set_memory_limit(parse_memory_size(optarg));
+                break;
             case 'V':
                 IndexingParameters::verbose = true;
                 break;
@@ -210,6 +241,11 @@ int main_autoindex(int argc, char** argv) {
     
     registry.make_indexes(targets);
     
+    if (IndexingParameters::verbose) {
+        cerr << "[IndexRegistry]: Time and memory used by each indexing step:" << endl;
+        registry.print_report(cerr);
+    }
+    
     return 0;
 
 }
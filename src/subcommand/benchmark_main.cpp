@@ -8,6 +8,7 @@
 #include <getopt.h>
 
 #include <iostream>
+#include <sstream>
 
 #include "subcommand.hpp"
 
@@ -16,7 +17,18 @@
 
 #include "../vg.hpp"
 #include "xg.hpp"
+#include <bdsg/hash_graph.hpp>
 #include "../indexed_vg.hpp"
+#include "../gapless_extender.hpp"
+#include "../mapper.hpp"
+#include "../build_index.hpp"
+#include "../gcsa_jump_table.hpp"
+#include "../pattern_matcher.hpp"
+#include "../min_distance.hpp"
+#include "../integrated_snarl_finder.hpp"
+#include "../tree_subgraph.hpp"
+#include "../wavefront_aligner.hpp"
+#include "../candidate_alignment.hpp"
 #include "../algorithms/extract_connecting_graph.hpp"
 
 
@@ -38,6 +50,12 @@ int main_benchmark(int argc, char** argv) {
     // Which experiments should we run?
     bool sort_and_order_experiment = false;
     bool get_sequence_experiment = true;
+    bool gapless_kernel_experiment = true;
+    bool mem_finding_experiment = true;
+    bool pattern_matching_experiment = true;
+    bool distance_batch_experiment = true;
+    bool tail_alignment_experiment = true;
+    bool candidate_output_experiment = true;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -169,6 +187,407 @@ int main_benchmark(int argc, char** argv) {
         
     }
     
+    if (gapless_kernel_experiment) {
+    
+        // Make some read/haplotype pairs with a few mismatches each
+        vector<pair<string, string>> pairs;
+        size_t seed = 1;
+        for (size_t i = 0; i < 1000; i++) {
+            string read(150, 'A');
+            for (char& c : read) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                c = "ACGT"[seed >> 62];
+            }
+            string haplotype = read;
+            for (size_t j = 0; j < i % 4; j++) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                haplotype[(seed >> 33) % haplotype.size()] = 'N';
+            }
+            pairs.emplace_back(read, haplotype);
+        }
+        
+        for (auto kernel : {gapless_kernel::kernel_scalar, gapless_kernel::kernel_sse, gapless_kernel::kernel_avx2}) {
+            if (!gapless_kernel::supported(kernel)) {
+                continue;
+            }
+            results.push_back(run_benchmark(string("gapless_kernel::scan_forward ") + gapless_kernel::name(kernel), 1000, [&]() {
+                uint32_t mismatches = 0;
+                size_t matched = 0;
+                for (auto& p : pairs) {
+                    matched += gapless_kernel::scan_forward(kernel, p.first.data(), p.second.data(), p.first.size(), 2, mismatches);
+                }
+                assert(matched > 0);
+            }));
+            results.push_back(run_benchmark(string("gapless_kernel::scan_backward ") + gapless_kernel::name(kernel), 1000, [&]() {
+                uint32_t mismatches = 0;
+                size_t matched = 0;
+                for (auto& p : pairs) {
+                    matched += gapless_kernel::scan_backward(kernel, p.first.data() + p.first.size(), p.second.data() + p.second.size(), p.first.size(), 2, mismatches);
+                }
+                assert(matched > 0);
+            }));
+        }
+    
+    }
+    
+    if (mem_finding_experiment) {
+    
+        // Make a linear graph over a random sequence, with a bubble every so often
+        bdsg::HashGraph mem_graph;
+        string reference;
+        size_t seed = 2;
+        handle_t prev;
+        for (size_t i = 0; i < 1000; i++) {
+            string node_seq(32, 'A');
+            for (char& c : node_seq) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                c = "ACGT"[seed >> 62];
+            }
+            reference += node_seq;
+            handle_t node = mem_graph.create_handle(node_seq);
+            if (i != 0) {
+                mem_graph.create_edge(prev, node);
+                if (i % 10 == 0) {
+                    // Add an alternate allele beside the previous node
+                    string alt_seq = mem_graph.get_sequence(prev);
+                    alt_seq[alt_seq.size() / 2] = alt_seq[alt_seq.size() / 2] == 'A' ? 'C' : 'A';
+                    handle_t alt = mem_graph.create_handle(alt_seq);
+                    mem_graph.follow_edges(prev, true, [&](const handle_t& before) {
+                        mem_graph.create_edge(before, alt);
+                    });
+                    mem_graph.create_edge(alt, node);
+                }
+            }
+            prev = node;
+        }
+        
+        // Sample reads with a few errors
+        vector<string> reads;
+        for (size_t i = 0; i < 1000; i++) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            string read = reference.substr((seed >> 33) % (reference.size() - 150), 150);
+            for (size_t j = 0; j < 3; j++) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                read[(seed >> 33) % read.size()] = "ACGT"[seed >> 62];
+            }
+            reads.push_back(read);
+        }
+        
+        gcsa::TempFile::setDirectory(temp_file::get_dir());
+        gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+        gcsa::GCSA* gcsa_index = nullptr;
+        gcsa::LCPArray* lcp_array = nullptr;
+        build_gcsa_lcp(mem_graph, gcsa_index, lcp_array, 16, 2);
+        
+        xg::XG mem_xg;
+        mem_xg.from_path_handle_graph(mem_graph);
+        
+        Mapper mapper(&mem_xg, gcsa_index, lcp_array);
+        GCSAJumpTable jump_table(*gcsa_index, 10);
+        
+        for (bool record_max_lcp : {false, true}) {
+            // Single-end vg map records the max LCP; paired rescue and mpmap don't
+            for (bool use_jump_table : {false, true}) {
+                mapper.gcsa_jump_table = use_jump_table ? &jump_table : nullptr;
+                results.push_back(run_benchmark(string("BaseMapper::find_mems_deep ") + (use_jump_table ? "with" : "without") + " jump table"
+                                                + (record_max_lcp ? ", recording max LCP" : ""), 100, [&]() {
+                    double longest_lcp, fraction_filtered;
+                    size_t found = 0;
+                    for (auto& read : reads) {
+                        found += mapper.find_mems_deep(read.begin(), read.end(), longest_lcp, fraction_filtered,
+                                                       0, 16, 32, false, true, true, record_max_lcp).size();
+                    }
+                    assert(found > 0);
+                }));
+            }
+        }
+        
+        delete gcsa_index;
+        delete lcp_array;
+    }
+    
+    if (distance_batch_experiment) {
+    
+        // Make a chain of bubbles, with a bubble nested in every third one
+        bdsg::HashGraph distance_graph;
+        handle_t prev = distance_graph.create_handle("GATTACA");
+        for (size_t i = 0; i < 1000; i++) {
+            handle_t ref = distance_graph.create_handle("ACGT");
+            handle_t alt = distance_graph.create_handle("ACGTACGT");
+            handle_t next = distance_graph.create_handle("GATTACA");
+            distance_graph.create_edge(prev, ref);
+            distance_graph.create_edge(prev, alt);
+            distance_graph.create_edge(alt, next);
+            if (i % 3 == 0) {
+                handle_t inner_ref = distance_graph.create_handle("T");
+                handle_t inner_alt = distance_graph.create_handle("G");
+                handle_t inner_next = distance_graph.create_handle("CA");
+                distance_graph.create_edge(ref, inner_ref);
+                distance_graph.create_edge(ref, inner_alt);
+                distance_graph.create_edge(inner_ref, inner_next);
+                distance_graph.create_edge(inner_alt, inner_next);
+                distance_graph.create_edge(inner_next, next);
+            } else {
+                distance_graph.create_edge(ref, next);
+            }
+            prev = next;
+        }
+        
+        SnarlManager distance_snarls = IntegratedSnarlFinder(distance_graph).find_snarls_parallel();
+        MinimumDistanceIndex distance_index(&distance_graph, &distance_snarls);
+        
+        // Make seed-like positions that come in clumps, the way a read's seeds
+        // do, and ask about all the pairs within each clump as one batch
+        size_t seed = 4;
+        id_t max_id = distance_graph.max_node_id();
+        vector<vector<pair<pos_t, pos_t>>> query_batches;
+        for (size_t i = 0; i < 1000; i++) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            id_t clump_start = 1 + (seed >> 33) % (max_id - 30);
+            vector<pos_t> clump;
+            for (size_t j = 0; j < 10; j++) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                clump.push_back(make_pos_t(clump_start + (seed >> 33) % 30, false, 0));
+            }
+            query_batches.emplace_back();
+            for (auto& pos1 : clump) {
+                for (auto& pos2 : clump) {
+                    query_batches.back().emplace_back(pos1, pos2);
+                }
+            }
+        }
+        
+        results.push_back(run_benchmark("MinimumDistanceIndex::min_distance one pair at a time", 10, [&]() {
+            int64_t total = 0;
+            for (auto& queries : query_batches) {
+                for (auto& query : queries) {
+                    total += distance_index.min_distance(query.first, query.second);
+                }
+            }
+            assert(total != 0);
+        }));
+        results.push_back(run_benchmark("MinimumDistanceIndex::min_distance batched", 10, [&]() {
+            int64_t total = 0;
+            for (auto& queries : query_batches) {
+                for (int64_t distance : distance_index.min_distance(queries)) {
+                    total += distance;
+                }
+            }
+            assert(total != 0);
+        }));
+    
+    }
+    
+    if (tail_alignment_experiment) {
+    
+        // Make a chain of SNPs 30 bp apart
+        bdsg::HashGraph tail_graph;
+        size_t seed = 9;
+        auto random_sequence = [&](size_t length) {
+            string sequence;
+            for (size_t i = 0; i < length; i++) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                sequence.push_back("ACGT"[(seed >> 33) % 4]);
+            }
+            return sequence;
+        };
+        vector<handle_t> segments;
+        vector<pair<handle_t, handle_t>> snps;
+        string reference;
+        for (size_t i = 0; i < 12; i++) {
+            segments.push_back(tail_graph.create_handle(random_sequence(29)));
+            if (!snps.empty()) {
+                tail_graph.create_edge(snps.back().first, segments.back());
+                tail_graph.create_edge(snps.back().second, segments.back());
+            }
+            string ref_base = random_sequence(1);
+            snps.emplace_back(tail_graph.create_handle(ref_base), tail_graph.create_handle(ref_base == "A" ? "C" : "A"));
+            tail_graph.create_edge(segments.back(), snps.back().first);
+            tail_graph.create_edge(segments.back(), snps.back().second);
+            reference += tail_graph.get_sequence(segments.back()) + ref_base;
+        }
+        
+        // Unfold it into a haplotype tree that branches at the first few
+        // SNPs, like the trees giraffe aligns read tails to
+        vector<pair<int64_t, handle_t>> tree;
+        function<void(int64_t, size_t)> add_haplotypes = [&](int64_t parent, size_t i) {
+            if (i == segments.size()) {
+                return;
+            }
+            tree.emplace_back(parent, segments[i]);
+            int64_t segment_index = tree.size() - 1;
+            tree.emplace_back(segment_index, snps[i].first);
+            add_haplotypes(tree.size() - 1, i + 1);
+            if (i < 3) {
+                tree.emplace_back(segment_index, snps[i].second);
+                add_haplotypes(tree.size() - 1, i + 1);
+            }
+        };
+        add_haplotypes(-1, 0);
+        TreeSubgraph tail_tree(&tail_graph, std::move(tree));
+        
+        Aligner tail_aligner;
+        WavefrontAligner wavefront_aligner(tail_aligner);
+        
+        for (size_t read_length : {150, 250}) {
+            // Simulate a read from the reference with a few mismatches and a deletion
+            string read = reference.substr(0, 70) + reference.substr(72, read_length);
+            for (size_t offset : {40, 110, 200}) {
+                if (offset < read.size()) {
+                    read[offset] = (read[offset] == 'A' ? 'C' : 'A');
+                }
+            }
+            read.resize(read_length);
+            
+            results.push_back(run_benchmark("Aligner::align_pinned X-drop " + to_string(read_length) + " bp tail", 100, [&]() {
+                Alignment aln;
+                aln.set_sequence(read);
+                tail_aligner.align_pinned(aln, tail_tree, true, true, 20);
+                assert(aln.score() > 0);
+            }));
+            results.push_back(run_benchmark("Aligner::align_pinned full DP " + to_string(read_length) + " bp tail", 100, [&]() {
+                Alignment aln;
+                aln.set_sequence(read);
+                tail_aligner.align_pinned(aln, tail_tree, true);
+                assert(aln.score() > 0);
+            }));
+            results.push_back(run_benchmark("WavefrontAligner::align_pinned " + to_string(read_length) + " bp tail", 100, [&]() {
+                Alignment aln;
+                aln.set_sequence(read);
+                wavefront_aligner.align_pinned(aln, tail_tree, tail_tree.get_root());
+                assert(aln.score() > 0);
+            }));
+        }
+    
+    }
+    
+    if (candidate_output_experiment) {
+    
+        // Make a chain of nodes and a 150 bp read along it with a
+        // substitution, annotated like a giraffe winner
+        bdsg::HashGraph output_graph;
+        size_t seed = 5;
+        vector<handle_t> nodes;
+        for (size_t i = 0; i < 8; i++) {
+            string sequence;
+            for (size_t j = 0; j < 32; j++) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                sequence.push_back("ACGT"[seed >> 62]);
+            }
+            nodes.push_back(output_graph.create_handle(sequence));
+            if (i != 0) {
+                output_graph.create_edge(nodes[i - 1], nodes[i]);
+            }
+        }
+        
+        Alignment read;
+        read.set_name("benchmark_read");
+        read.set_quality(string(150, 30));
+        CandidateAlignment candidate;
+        string sequence;
+        size_t remaining = 150;
+        for (size_t i = 1; remaining > 0; i++) {
+            size_t length = min<size_t>(remaining, output_graph.get_length(nodes[i]));
+            path_mapping_t* mapping = candidate.path.add_mapping();
+            mapping->mutable_position()->set_node_id(output_graph.get_id(nodes[i]));
+            edit_t* edit = mapping->add_edit();
+            edit->set_from_length(length);
+            edit->set_to_length(length);
+            sequence += output_graph.get_subsequence(nodes[i], 0, length);
+            remaining -= length;
+        }
+        read.set_sequence(sequence);
+        candidate.score = 160;
+        candidate.identity = 1.0;
+        candidate.mapping_quality = 60;
+        set_annotation(candidate, "mapq_uncapped", 120.0);
+        set_annotation(candidate, "secondary_scores", vector<double>{160.0, 110.0, 95.0});
+        
+        results.push_back(run_benchmark("GAF output through a new Alignment", 100, [&]() {
+            stringstream out;
+            for (size_t i = 0; i < 100; i++) {
+                out << vg::io::alignment_to_gaf(output_graph, candidate_to_alignment(read, candidate)) << "\n";
+            }
+            assert(out.tellp() > 0);
+        }));
+        results.push_back(run_benchmark("GAF output through candidate_to_gaf", 100, [&]() {
+            stringstream out;
+            for (size_t i = 0; i < 100; i++) {
+                candidate_to_gaf(out, output_graph, read, candidate);
+                out << "\n";
+            }
+            assert(out.tellp() > 0);
+        }));
+    }
+    
+    if (pattern_matching_experiment) {
+    
+        // Make 10k read name prefixes and 10k adapter-like motifs, like vg
+        // filter might be given, and some reads to check against them.
+        size_t seed = 3;
+        auto random_bases = [&](size_t length) {
+            string bases(length, 'A');
+            for (char& c : bases) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                c = "ACGT"[seed >> 62];
+            }
+            return bases;
+        };
+        vector<string> prefixes;
+        vector<string> motifs;
+        for (size_t i = 0; i < 10000; i++) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            prefixes.push_back("sample" + to_string(seed >> 40) + ".");
+            motifs.push_back(random_bases(12));
+        }
+        vector<string> names;
+        vector<string> sequences;
+        for (size_t i = 0; i < 1000; i++) {
+            names.push_back((i % 2 ? prefixes[i * 7] : string("other.")) + to_string(i));
+            sequences.push_back(random_bases(150));
+        }
+        
+        vector<string> sorted_prefixes = prefixes;
+        sort(sorted_prefixes.begin(), sorted_prefixes.end());
+        PrefixTrie trie(prefixes);
+        AhoCorasick automaton(motifs);
+        
+        results.push_back(run_benchmark("name prefixes by binary search", 100, [&]() {
+            size_t found = 0;
+            for (auto& name : names) {
+                auto it = upper_bound(sorted_prefixes.begin(), sorted_prefixes.end(), name);
+                found += (it != sorted_prefixes.begin() && name.compare(0, (it - 1)->size(), *(it - 1)) == 0);
+            }
+            assert(found > 0);
+        }));
+        results.push_back(run_benchmark("name prefixes by PrefixTrie", 100, [&]() {
+            size_t found = 0;
+            for (auto& name : names) {
+                found += trie.has_prefix_of(name);
+            }
+            assert(found > 0);
+        }));
+        results.push_back(run_benchmark("subsequences one at a time", 1, [&]() {
+            size_t found = 0;
+            for (auto& sequence : sequences) {
+                for (auto& motif : motifs) {
+                    if (sequence.find(motif) != string::npos) {
+                        found++;
+                        break;
+                    }
+                }
+            }
+            assert(found > 0);
+        }));
+        results.push_back(run_benchmark("subsequences by AhoCorasick", 100, [&]() {
+            size_t found = 0;
+            for (auto& sequence : sequences) {
+                found += automaton.occurs_in(sequence);
+            }
+            assert(found > 0);
+        }));
+    }
+    
     // Do the control against itself
     results.push_back(run_benchmark("control", 1000, benchmark_control));
 
@@ -33,6 +33,8 @@ void help_call(char** argv) {
        << "    -e, --baseline-error X,Y Baseline error rates for Poisson model for small (X) and large (Y) variants [default= 0.005,0.001]" << endl
        << "    -B, --bias-mode          Use old ratio-based genotyping algorithm as opposed to porbablistic model" << endl
        << "    -b, --het-bias M,N       Homozygous alt/ref allele must have >= M/N times more support than the next best allele [default = 6,6]" << endl
+       << "    -S, --support-table      Precompute node supports in one table shared by all threads, instead of caching them per thread" << endl
+       << "    --cache-stats            Print the hit rates of the per-thread support caches to stderr" << endl
        << "GAF options:" << endl
        << "    -G, --gaf               Output GAF genotypes instead of VCF" << endl
        << "    -T, --traversals        Output all candidate traversals in GAF without doing any genotyping" << endl
@@ -49,6 +51,7 @@ void help_call(char** argv) {
        << "    -o, --ref-offset N      Offset in reference path (multiple allowed, 1 per path)" << endl
        << "    -l, --ref-length N      Override length of reference in the contig field of output VCF" << endl
        << "    -d, --ploidy N          Ploidy of sample.  Only 1 and 2 supported. (default: 2)" << endl
+       << "    -w, --window N          Call snarls in reference order, N at a time, writing VCF as we go (0: write at end) [default=10000, or 0 with -v]" << endl
        << "    -t, --threads N         number of threads to use" << endl;
 }    
 
@@ -74,6 +77,10 @@ int main_call(int argc, char** argv) {
     bool gaf_output = false;
     size_t trav_padding = 0;
     bool genotype_snarls = false;
+    size_t window_size = 10000;
+    bool window_size_set = false;
+    bool support_table = false;
+    bool cache_stats = false;
 
     // constants
     const size_t avg_trav_threshold = 50;
@@ -86,6 +93,8 @@ int main_call(int argc, char** argv) {
     const size_t max_chain_edges = 1000; 
     const size_t max_chain_trivial_travs = 5;
     
+    #define OPT_CACHE_STATS 1000
+
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -95,6 +104,8 @@ int main_call(int argc, char** argv) {
             {"bias-mode", no_argument, 0, 'B'},
             {"baseline-error", required_argument, 0, 'e'},
             {"het-bias", required_argument, 0, 'b'},
+            {"support-table", no_argument, 0, 'S'},
+            {"cache-stats", no_argument, 0, OPT_CACHE_STATS},
             {"min-support", required_argument, 0, 'm'},
             {"vcf", required_argument, 0, 'v'},
             {"genotype-snarls", no_argument, 0, 'a'},
@@ -111,6 +122,7 @@ int main_call(int argc, char** argv) {
             {"traversals", no_argument, 0, 'T'},
             {"min-trav-len", required_argument, 0, 'M'},
             {"legacy", no_argument, 0, 'L'},
+            {"window", required_argument, 0, 'w'},
             {"threads", required_argument, 0, 't'},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
@@ -118,7 +130,7 @@ int main_call(int argc, char** argv) {
 
         int option_index = 0;
 
-        c = getopt_long (argc, argv, "k:Be:b:m:v:af:i:s:r:g:p:o:l:d:GTLM:t:h",
+        c = getopt_long (argc, argv, "k:Be:b:Sm:v:af:i:s:r:g:p:o:l:d:GTLM:w:t:h",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -136,6 +148,12 @@ int main_call(int argc, char** argv) {
         case 'b':
             bias_string = optarg;
             break;
+        case 'S':
+            support_table = true;
+            break;
+        case OPT_CACHE_STATS:
+            cache_stats = true;
+            break;
         case 'm':
             min_support_string = optarg;
             break;
@@ -188,6 +206,10 @@ int main_call(int argc, char** argv) {
         case 'L':
             legacy = true;
             break;
+        case 'w':
+            window_size = parse<size_t>(optarg);
+            window_size_set = true;
+            break;
         case 't':
         {
             int num_threads = parse<int>(optarg);
@@ -266,6 +288,12 @@ int main_call(int argc, char** argv) {
         cerr << "error [vg call]: -v and -a options cannot be used together" << endl;
         return 1;
     }
+
+    if (!vcf_filename.empty() && !window_size_set) {
+        // Windows need path positions, which genotyping a VCF otherwise
+        // doesn't, so only use them if asked.
+        window_size = 0;
+    }
     
     // Read the graph
     unique_ptr<PathHandleGraph> path_handle_graph;
@@ -275,7 +303,8 @@ int main_call(int argc, char** argv) {
     PathHandleGraph* graph = path_handle_graph.get();
 
     // Apply overlays as necessary
-    bool need_path_positions = vcf_filename.empty();
+    // (we use path positions to order snarls when writing VCF in windows)
+    bool need_path_positions = vcf_filename.empty() || (window_size > 0 && !gaf_output);
     bool need_vectorizable = !pack_filename.empty();
     bdsg::PathPositionOverlayHelper pp_overlay_helper;
     bdsg::PathPositionVectorizableOverlayHelper ppv_overlay_helper;
@@ -370,8 +399,15 @@ int main_call(int argc, char** argv) {
         // Load our packed supports (they must have come from vg pack on graph)
         packer = unique_ptr<Packer>(new Packer(graph));
         packer->load_from_file(pack_filename);
-        // Make a packed traversal support finder (using cached veresion important for poisson caller)
-        PackedTraversalSupportFinder* packed_support_finder = new CachedPackedTraversalSupportFinder(*packer, *snarl_manager);
+        // Make a packed traversal support finder (using cached or tabled version important for poisson caller)
+        PackedTraversalSupportFinder* packed_support_finder;
+        if (support_table) {
+            packed_support_finder = new TabledPackedTraversalSupportFinder(*packer, *snarl_manager);
+        } else {
+            CachedPackedTraversalSupportFinder* cached_support_finder = new CachedPackedTraversalSupportFinder(*packer, *snarl_manager);
+            cached_support_finder->set_count_cache_stats(cache_stats);
+            packed_support_finder = cached_support_finder;
+        }
         support_finder = unique_ptr<TraversalSupportFinder>(packed_support_finder);
         
         // need to use average support when genotyping as small differences in between sample and graph
@@ -507,6 +543,15 @@ int main_call(int argc, char** argv) {
         graph_caller = unique_ptr<GraphCaller>(flow_caller);
     }
 
+    if (!gaf_output) {
+        // Write the VCF header up front, so variants can be streamed out as we call
+        VCFOutputCaller* vcf_caller = dynamic_cast<VCFOutputCaller*>(graph_caller.get());
+        assert(vcf_caller != nullptr);
+        cout << vcf_caller->vcf_header(*graph, ref_paths, ref_path_lengths) << flush;
+        vcf_caller->set_output_stream(&cout);
+        graph_caller->set_window_size(window_size);
+    }
+
     // Call the graph
     if (!traversals_only) {
 
@@ -519,12 +564,16 @@ int main_call(int argc, char** argv) {
         graph_caller->call_top_level_chains(*graph, ploidy, max_chain_edges,  max_chain_trivial_travs);
     }
 
+    if (cache_stats) {
+        CachedPackedTraversalSupportFinder* cached_support_finder = dynamic_cast<CachedPackedTraversalSupportFinder*>(support_finder.get());
+        if (cached_support_finder != nullptr) {
+            cached_support_finder->report_cache_stats(cerr);
+        }
+    }
+
     if (!gaf_output) {
-        // Output VCF
-        VCFOutputCaller* vcf_caller = dynamic_cast<VCFOutputCaller*>(graph_caller.get());
-        assert(vcf_caller != nullptr);
-        cout << vcf_caller->vcf_header(*graph, ref_paths, ref_path_lengths) << flush;
-        vcf_caller->write_variants(cout);
+        // Output whatever VCF is left over
+        dynamic_cast<VCFOutputCaller*>(graph_caller.get())->write_variants(cout);
     }
     
     return 0;
@@ -178,7 +178,7 @@ int main_cluster(int argc, char** argv) {
     if (!minimizer_name.empty()) {
         minimizer_index = vg::io::VPKG::load_one<gbwtgraph::DefaultMinimizerIndex>(minimizer_name);
     }
-    unique_ptr<MinimumDistanceIndex> distance_index = vg::io::VPKG::load_one<MinimumDistanceIndex>(distance_name);
+    unique_ptr<MinimumDistanceIndex> distance_index = load_minimum_distance_index(distance_name);
     
     // Make the clusterer
     SnarlSeedClusterer clusterer(*distance_index);
@@ -15,6 +15,7 @@
 #include "../vg.hpp"
 #include "../deconstructor.hpp"
 #include "../integrated_snarl_finder.hpp"
+#include "../gbwt_helper.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
 #include <bdsg/overlays/overlay_helper.hpp>
@@ -32,6 +33,7 @@ void help_deconstruct(char** argv){
          << "    -A, --alt-prefix NAME    Non-reference paths beginning with NAME get lumped together to same sample in VCF (multiple allowed).  Other non-ref paths not considered as samples." << endl
          << "    -r, --snarls FILE        Snarls file (from vg snarls) to avoid recomputing." << endl
          << "    -e, --path-traversals    Only consider traversals that correspond to paths in the grpah." << endl
+         << "    -g, --gbwt FILE          Only consider alt traversals that correspond to GBWT haplotypes, and use the GBWT samples (implies -e)." << endl
          << "    -a, --all-snarls         Process all snarls, including nested snarls (by default only top-level snarls reported)." << endl
          << "    -d, --ploidy N           Expected ploidy.  If more traversals found, they will be flagged as conflicts (default: 2)" << endl
          << "    -t, --threads N          Use N threads" << endl
@@ -50,6 +52,7 @@ int main_deconstruct(int argc, char** argv){
     vector<string> altpath_prefixes;
     string graphname;
     string snarl_file_name;
+    string gbwt_file_name;
     bool path_restricted_traversals = false;
     bool show_progress = false;
     int ploidy = 2;
@@ -66,6 +69,7 @@ int main_deconstruct(int argc, char** argv){
                 {"alt-prefix", required_argument, 0, 'A'},
                 {"snarls", required_argument, 0, 'r'},
                 {"path-traversals", no_argument, 0, 'e'},
+                {"gbwt", required_argument, 0, 'g'},
                 {"ploidy", required_argument, 0, 'd'},
                 {"all-snarls", no_argument, 0, 'a'},
                 {"threads", required_argument, 0, 't'},
@@ -75,7 +79,7 @@ int main_deconstruct(int argc, char** argv){
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hp:P:A:r:ed:at:v",
+        c = getopt_long (argc, argv, "hp:P:A:r:eg:d:at:v",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -99,6 +103,10 @@ int main_deconstruct(int argc, char** argv){
         case 'e':
             path_restricted_traversals = true;
             break;
+        case 'g':
+            gbwt_file_name = optarg;
+            path_restricted_traversals = true;
+            break;
         case 'd':
             ploidy = parse<int>(optarg);
             break;
@@ -131,6 +139,11 @@ int main_deconstruct(int argc, char** argv){
         cerr << "Error [vg decontruct]: -A can only be used with -e" << endl;
     }
 
+    if (!altpath_prefixes.empty() && !gbwt_file_name.empty()) {
+        cerr << "Error [vg deconstruct]: -A cannot be used with -g" << endl;
+        return 1;
+    }
+
     // Read the graph
     unique_ptr<PathHandleGraph> path_handle_graph;
     get_input_file(optind, argc, argv, [&](istream& in) {
@@ -196,13 +209,30 @@ int main_deconstruct(int argc, char** argv){
         return 1;
     }
 
+    // Load the GBWT, if we are taking haplotypes from it
+    unique_ptr<gbwt::GBWT> gbwt_index;
+    if (!gbwt_file_name.empty()) {
+        if (show_progress) {
+            cerr << "Loading GBWT" << endl;
+        }
+        gbwt_index = vg::io::VPKG::load_one<gbwt::GBWT>(gbwt_file_name);
+        if (gbwt_index.get() == nullptr) {
+            cerr << "Error [vg deconstruct]: Unable to load gbwt index file: " << gbwt_file_name << endl;
+            return 1;
+        }
+        if (!gbwt_index->hasMetadata() || !gbwt_index->metadata.hasSampleNames() || !gbwt_index->metadata.hasPathNames()) {
+            cerr << "Error [vg deconstruct]: GBWT index " << gbwt_file_name << " has no sample and path names" << endl;
+            return 1;
+        }
+    }
+
     // Deconstruct
     Deconstructor dd;
     if (show_progress) {
         cerr << "Decsontructing top-level snarls" << endl;
     }
     dd.deconstruct(refpaths, graph, snarl_manager.get(), path_restricted_traversals, ploidy, all_snarls,
-                   !alt_path_to_prefix.empty() ? &alt_path_to_prefix : nullptr);
+                   !alt_path_to_prefix.empty() ? &alt_path_to_prefix : nullptr, gbwt_index.get());
     return 0;
 }
 
@@ -323,9 +323,6 @@ int main_filter(int argc, char** argv) {
     // What should our return code be?
     int error_code = 0;
     
-    // Sort the prefixes for reads we will accept, for efficient search
-    sort(name_prefixes.begin(), name_prefixes.end());
-    
      // If the user gave us an XG index, we probably ought to load it up.
     PathPositionHandleGraph* xindex = nullptr;
     unique_ptr<PathHandleGraph> path_handle_graph;
@@ -338,8 +335,8 @@ int main_filter(int argc, char** argv) {
     
     // template lambda to set parameters
     auto set_params = [&](auto& filter) {
-        filter.name_prefixes = name_prefixes;
-        filter.subsequences = subsequences;
+        filter.set_name_prefixes(name_prefixes);
+        filter.set_subsequences(subsequences);
         filter.excluded_refpos_contigs = excluded_refpos_contigs;
         filter.excluded_features = excluded_features;
         if (set_min_secondary) {
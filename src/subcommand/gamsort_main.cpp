@@ -18,7 +18,7 @@ void help_gamsort(char **argv)
          << "Options:" << endl
          << "  -i / --index FILE       produce an index of the sorted GAM file" << endl
          << "  -d / --dumb-sort        use naive sorting algorithm (no tmp files, faster for small GAMs)" << endl
-         << "  -p / --progress         Show progress." << endl
+         << "  -p / --progress         Show progress and report sorting throughput." << endl
          << "  -t / --threads          Use the specified number of threads." << endl
          << endl;
 }
@@ -28,10 +28,8 @@ int main_gamsort(int argc, char **argv)
     string index_filename;
     bool easy_sort = false;
     bool show_progress = false;
-    // We limit the max threads, and only allow thread count to be lowered, to
-    // prevent tcmalloc from giving each thread a very large heap for many
-    // threads.
-    // On my machine we can keep about 4 threads busy.
+    // All the threads work on one chunk at a time, so memory use doesn't grow
+    // with the thread count, but we still default to a modest number.
     size_t num_threads = 4;
     int c;
     optind = 2; // force optind past command positional argument
@@ -65,7 +63,11 @@ int main_gamsort(int argc, char **argv)
             show_progress = true;
             break;
         case 't':
-            num_threads = min(parse<size_t>(optarg), num_threads);
+            num_threads = parse<size_t>(optarg);
+            if (num_threads == 0) {
+                cerr << "error:[vg gamsort] Thread count (-t) must be positive" << endl;
+                exit(1);
+            }
             break;
         case 'h':
         case '?':
@@ -103,6 +105,22 @@ int main_gamsort(int argc, char **argv)
             gs.stream_sort(gam_in, cout, index.get());
         }
         
+        if (show_progress) {
+            // Report how fast we went
+            auto& stats = gs.get_stats();
+            double seconds = stats.sort_seconds + stats.merge_seconds;
+            cerr << "Sorted " << stats.messages << " alignments (" << stats.bytes / (1024.0 * 1024.0) << " MiB";
+            if (!easy_sort) {
+                cerr << " in " << stats.temp_files << " chunks";
+            }
+            cerr << ") with " << num_threads << " threads in " << seconds << " seconds ("
+                 << stats.sort_seconds << " sorting, " << stats.merge_seconds << " merging)" << endl;
+            if (seconds > 0) {
+                cerr << "Throughput: " << stats.messages / seconds << " alignments/second, "
+                     << stats.bytes / (1024.0 * 1024.0) / seconds << " MiB/second" << endl;
+            }
+        }
+        
         if (index.get() != nullptr) {
             // Save the index
             ofstream index_out(index_filename);
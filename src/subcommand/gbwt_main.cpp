@@ -231,6 +231,8 @@ void help_gbwt(char** argv) {
     std::cerr << "        --inputs-as-jobs    create one build job for each input instead of using first-fit heuristic" << std::endl;
     std::cerr << "        --parse-only        store the VCF parses without building GBWTs" << std::endl;
     std::cerr << "                            (use -o for the file name prefix; skips subsequent steps)" << std::endl;
+    std::cerr << "        --parse-threads N   parse each VCF contig using N threads (default 1)" << std::endl;
+    std::cerr << "        --parse-region N    split contigs into regions of N bp for parallel parsing (default 100000)" << std::endl;
     std::cerr << "        --ignore-missing    do not warn when variants are missing from the graph" << std::endl;
     std::cerr << "        --actual-phasing    do not interpret unphased homozygous genotypes as phased" << std::endl;
     std::cerr << "        --force-phasing     replace unphased genotypes with randomly phased ones" << std::endl;
@@ -339,6 +341,8 @@ GBWTConfig parse_gbwt_config(int argc, char** argv) {
     constexpr int OPT_TRANSLATION = 1117;
     constexpr int OPT_PATHS_AS_SAMPLES = 1118;
     constexpr int OPT_GAM_FORMAT = 1119;
+    constexpr int OPT_PARSE_THREADS = 1120;
+    constexpr int OPT_PARSE_REGION = 1121;
     constexpr int OPT_CHUNK_SIZE = 1200;
     constexpr int OPT_POS_BUFFER = 1201;
     constexpr int OPT_THREAD_BUFFER = 1202;
@@ -366,6 +370,8 @@ GBWTConfig parse_gbwt_config(int argc, char** argv) {
         { "num-jobs", required_argument, 0, OPT_NUM_JOBS },
         { "inputs-as-jobs", no_argument, 0, OPT_INPUTS_AS_JOBS },
         { "parse-only", no_argument, 0, OPT_PARSE_ONLY },
+        { "parse-threads", required_argument, 0, OPT_PARSE_THREADS },
+        { "parse-region", required_argument, 0, OPT_PARSE_REGION },
         { "ignore-missing", no_argument, 0, OPT_IGNORE_MISSING },
         { "actual-phasing", no_argument, 0, OPT_ACTUAL_PHASING },
         { "force-phasing", no_argument, 0, OPT_FORCE_PHASING },
@@ -493,6 +499,12 @@ GBWTConfig parse_gbwt_config(int argc, char** argv) {
         case OPT_PARSE_ONLY:
             config.parse_only = true;
             break;
+        case OPT_PARSE_THREADS:
+            config.haplotype_indexer.parse_threads = std::max(parse<size_t>(optarg), 1ul);
+            break;
+        case OPT_PARSE_REGION:
+            config.haplotype_indexer.parse_region_length = std::max(parse<size_t>(optarg), 1ul);
+            break;
         case OPT_IGNORE_MISSING:
             config.haplotype_indexer.warn_on_missing_variants = false;
             break;
@@ -1015,7 +1027,15 @@ void step_1_build_gbwts(GBWTHandler& gbwts, GraphHandler& graphs, GBWTConfig& co
         }
         std::vector<std::vector<std::string>> vcf_parses(jobs.size());
         if (config.show_progress) {
-            std::cerr << "Parsing " << jobs.size() << " VCF files using up to " << config.build_jobs << " parallel jobs" << std::endl;
+            std::cerr << "Parsing " << jobs.size() << " VCF files using up to " << config.build_jobs << " parallel jobs";
+            if (config.haplotype_indexer.parse_threads > 1) {
+                std::cerr << " with " << config.haplotype_indexer.parse_threads << " threads each";
+            }
+            std::cerr << std::endl;
+        }
+        if (config.haplotype_indexer.parse_threads > 1) {
+            // Each job parses its contigs in parallel.
+            omp_set_nested(1);
         }
         #pragma omp parallel for schedule(dynamic, 1)
         for (size_t i = 0; i < jobs.size(); i++) {
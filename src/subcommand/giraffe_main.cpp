@@ -22,6 +22,7 @@
 #include <vg/io/vpkg.hpp>
 #include <vg/io/stream.hpp>
 #include "../hts_alignment_emitter.hpp"
+#include "../candidate_alignment_emitter.hpp"
 #include "../gapless_extender.hpp"
 #include "../minimizer_mapper.hpp"
 #include "../index_manager.hpp"
@@ -300,6 +301,8 @@ void help_giraffe(char** argv) {
     << "  -G, --gam-in FILE             read and realign GAM-format reads from FILE" << endl
     << "  -f, --fastq-in FILE           read and align FASTQ-format reads from FILE (two are allowed, one for each mate)" << endl
     << "  -i, --interleaved             GAM/FASTQ input is interleaved pairs, for paired-end alignment" << endl
+    << "  --reader-threads INT          decompress and parse FASTQ input on INT threads besides the compute threads [1]" << endl
+    << "  --writer-threads INT          encode, compress, and write output on INT threads besides the compute threads [0]" << endl
     << "output options:" << endl
     << "  -M, --max-multimaps INT       produce up to INT alignments for each read [1]" << endl
     << "  -N, --sample NAME             add this sample name" << endl
@@ -309,6 +312,7 @@ void help_giraffe(char** argv) {
     << "  -n, --discard                 discard all output alignments (for profiling)" << endl
     << "  --output-basename NAME        write output to a GAM file beginning with the given prefix for each setting combination" << endl
     << "  --report-name NAME            write a TSV of output file and mapping speed to the given file" << endl
+    << "  --stage-times NAME            write per-stage mapping time statistics to the given file (JSON if it ends in .json, else TSV)" << endl
     << "  --show-work                   log how the mapper comes to its conclusions about mapping locations" << endl
     << "algorithm presets:" << endl
     << "  -b, --parameter-preset NAME   set computational parameters (fast / default) [default]" << endl
@@ -325,6 +329,7 @@ void help_giraffe(char** argv) {
     << "  -v, --extension-score INT     only align extensions if their score is within INT of the best score [1]" << endl
     << "  -w, --extension-set INT       only align extension sets if their score is within INT of the best score [20]" << endl
     << "  -O, --no-dp                   disable all gapped alignment" << endl
+    << "  --wavefront-tails             align read tails with wavefronts instead of X-drop DP" << endl
     << "  -r, --rescue-attempts         attempt up to INT rescues per read in a pair [15]" << endl
     << "  -A, --rescue-algorithm NAME   use algorithm NAME for rescue (none / dozeu / gssw / haplotypes) [dozeu]" << endl
     << "  -L, --max-fragment-length INT assume that fragment lengths should be smaller than INT when estimating the fragment length distribution" << endl
@@ -332,6 +337,7 @@ void help_giraffe(char** argv) {
     << "  --fragment-stdev FLOAT        force the fragment length distribution to have this standard deviation (requires --fragment-mean)" << endl
     << "  --paired-distance-limit FLOAT cluster pairs of read using a distance limit FLOAT standard deviations greater than the mean [2.0]" << endl
     << "  --rescue-subgraph-size FLOAT  search for rescued alignments FLOAT standard deviations greater than the mean [4.0]" << endl
+    << "  --rescue-cache-size INT       remember up to INT rescue subgraphs per thread, or 0 to disable [256]" << endl
     << "  --track-provenance            track how internal intermediate alignment candidates were arrived at" << endl
     << "  --track-correctness           track if internal intermediate alignment candidates are correct (implies --track-provenance)" << endl
     << "  -t, --threads INT             number of compute threads to use" << endl;
@@ -356,6 +362,11 @@ int main_giraffe(int argc, char** argv) {
     #define OPT_RESCUE_STDEV 1008
     #define OPT_REF_PATHS 1009
     #define OPT_SHOW_WORK 1010
+    #define OPT_READER_THREADS 1011
+    #define OPT_STAGE_TIMES 1012
+    #define OPT_WRITER_THREADS 1013
+    #define OPT_WAVEFRONT_TAILS 1014
+    #define OPT_RESCUE_CACHE_SIZE 1015
     
 
     // initialize parameters with their default options
@@ -364,13 +375,22 @@ int main_giraffe(int argc, char** argv) {
     IndexManager indexes;
     string output_basename;
     string report_name;
+    // Where should we write stage timing statistics, if anywhere?
+    string stage_times_name;
     // How close should two hits be to be in the same cluster?
     Range<size_t> distance_limit = 200;
     Range<size_t> hit_cap = 10, hard_hit_cap = 500;
     Range<double> minimizer_score_fraction = 0.9;
     bool show_progress = false;
+    // How many threads should read FASTQ input in the background?
+    size_t reader_threads = 1;
+    // How many threads should write output in the background? If 0, the
+    // mapping threads write it themselves.
+    size_t writer_threads = 0;
     // Should we try chaining or just give up if we can't find a full length gapless alignment?
     bool do_dp = true;
+    // Should we align tails with the wavefront aligner?
+    bool use_wavefront_tails = false;
     // What GAM should we realign?
     string gam_filename;
     // What FASTQs should we align.
@@ -415,6 +435,8 @@ int main_giraffe(int argc, char** argv) {
     double cluster_stdev = 2.0;
     //How many stdevs do we look out when rescuing? 
     double rescue_stdev = 4.0;
+    // How many rescue subgraphs should each thread remember?
+    size_t rescue_cache_size = 256;
     // How many pairs should we be willing to buffer before giving up on fragment length estimation?
     size_t MAX_BUFFERED_PAIRS = 100000;
     // What sample name if any should we apply?
@@ -491,6 +513,7 @@ int main_giraffe(int argc, char** argv) {
             {"discard", no_argument, 0, 'n'},
             {"output-basename", required_argument, 0, OPT_OUTPUT_BASENAME},
             {"report-name", required_argument, 0, OPT_REPORT_NAME},
+            {"stage-times", required_argument, 0, OPT_STAGE_TIMES},
             {"fast-mode", no_argument, 0, 'b'},
             {"hit-cap", required_argument, 0, 'c'},
             {"hard-hit-cap", required_argument, 0, 'C'},
@@ -504,16 +527,20 @@ int main_giraffe(int argc, char** argv) {
             {"extension-set", required_argument, 0, 'w'},
             {"score-fraction", required_argument, 0, 'F'},
             {"no-dp", no_argument, 0, 'O'},
+            {"wavefront-tails", no_argument, 0, OPT_WAVEFRONT_TAILS},
             {"rescue-attempts", required_argument, 0, 'r'},
             {"rescue-algorithm", required_argument, 0, 'A'},
             {"paired-distance-limit", required_argument, 0, OPT_CLUSTER_STDEV },
             {"rescue-subgraph-size", required_argument, 0, OPT_RESCUE_STDEV },
+            {"rescue-cache-size", required_argument, 0, OPT_RESCUE_CACHE_SIZE },
             {"max-fragment-length", required_argument, 0, 'L' },
             {"fragment-mean", required_argument, 0, OPT_FRAGMENT_MEAN },
             {"fragment-stdev", required_argument, 0, OPT_FRAGMENT_STDEV },
             {"track-provenance", no_argument, 0, OPT_TRACK_PROVENANCE},
             {"track-correctness", no_argument, 0, OPT_TRACK_CORRECTNESS},
             {"show-work", no_argument, 0, OPT_SHOW_WORK},
+            {"reader-threads", required_argument, 0, OPT_READER_THREADS},
+            {"writer-threads", required_argument, 0, OPT_WRITER_THREADS},
             {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
@@ -647,6 +674,10 @@ int main_giraffe(int argc, char** argv) {
             case OPT_REPORT_NAME:
                 report_name = optarg;
                 break;
+
+            case OPT_STAGE_TIMES:
+                stage_times_name = optarg;
+                break;
             case 'b':
                 param_preset = optarg;
 
@@ -784,6 +815,10 @@ int main_giraffe(int argc, char** argv) {
                 do_dp = false;
                 break;
                 
+            case OPT_WAVEFRONT_TAILS:
+                use_wavefront_tails = true;
+                break;
+                
             case 'r':
                 {
                     forced_rescue_attempts = true;
@@ -831,6 +866,10 @@ int main_giraffe(int argc, char** argv) {
                 rescue_stdev = parse<double>(optarg);
                 break;
 
+            case OPT_RESCUE_CACHE_SIZE:
+                rescue_cache_size = parse<size_t>(optarg);
+                break;
+
             case OPT_TRACK_PROVENANCE:
                 track_provenance = true;
                 break;
@@ -844,6 +883,28 @@ int main_giraffe(int argc, char** argv) {
                 show_work = true;
                 break;
                 
+            case OPT_READER_THREADS:
+            {
+                int num_threads = parse<int>(optarg);
+                if (num_threads <= 0) {
+                    cerr << "error:[vg giraffe] Reader thread count (--reader-threads) set to " << num_threads << ", must set to a positive integer." << endl;
+                    exit(1);
+                }
+                reader_threads = num_threads;
+            }
+                break;
+                
+            case OPT_WRITER_THREADS:
+            {
+                int num_threads = parse<int>(optarg);
+                if (num_threads < 0) {
+                    cerr << "error:[vg giraffe] Writer thread count (--writer-threads) set to " << num_threads << ", must set to a non-negative integer." << endl;
+                    exit(1);
+                }
+                writer_threads = num_threads;
+            }
+                break;
+                
             case 't':
             {
                 int num_threads = parse<int>(optarg);
@@ -1039,6 +1100,13 @@ int main_giraffe(int argc, char** argv) {
         report << "#file\treads/second/thread" << endl;
     }
 
+    // Set up to collect how long each stage of mapping takes, if requested.
+    unique_ptr<StageLatencyProfile> stage_latencies;
+    if (!stage_times_name.empty()) {
+        stage_latencies.reset(new StageLatencyProfile(omp_get_max_threads()));
+        minimizer_mapper.stage_latencies = stage_latencies.get();
+    }
+
     // We need to loop over all the ranges...
     for_each_combo([&]() {
     
@@ -1137,6 +1205,11 @@ int main_giraffe(int argc, char** argv) {
         }
         minimizer_mapper.do_dp = do_dp;
 
+        if (show_progress && use_wavefront_tails) {
+            cerr << "--wavefront-tails " << endl;
+        }
+        minimizer_mapper.use_wavefront_tails = use_wavefront_tails;
+
         if (show_progress) {
             cerr << "--max-multimaps " << max_multimaps << endl;
         }
@@ -1171,12 +1244,15 @@ int main_giraffe(int argc, char** argv) {
             cerr << "--rescue-subgraph-size " << rescue_stdev << endl;
             cerr << "--rescue-attempts " << rescue_attempts << endl;
             cerr << "--rescue-algorithm " << algorithm_names[rescue_algorithm] << endl;
+            cerr << "--rescue-cache-size " << rescue_cache_size << endl;
         }
         minimizer_mapper.max_fragment_length = fragment_length;
         minimizer_mapper.paired_distance_stdevs = cluster_stdev;
         minimizer_mapper.rescue_subgraph_stdevs = rescue_stdev;
         minimizer_mapper.max_rescue_attempts = rescue_attempts;
         minimizer_mapper.rescue_algorithm = rescue_algorithm;
+        minimizer_mapper.rescue_subgraph_cache_size = rescue_cache_size;
+        pair<size_t, size_t> rescue_cache_stats_before = minimizer_mapper.get_rescue_subgraph_cache_stats();
 
         minimizer_mapper.sample_name = sample_name;
         minimizer_mapper.read_group = read_group;
@@ -1187,6 +1263,12 @@ int main_giraffe(int argc, char** argv) {
         // Set up counters per-thread for total reads mapped
         vector<size_t> reads_mapped_by_thread(thread_count, 0);
         
+        // Track how long the mapping threads waited on FASTQ input
+        double input_starved_seconds = 0;
+        
+        // Track how full the output queue got, if writing in the background
+        AsyncAlignmentEmitter::Stats writer_stats;
+        
         // For timing, we may run one thread first and then switch to all threads. So track both start times.
         std::chrono::time_point<std::chrono::system_clock> first_thread_start;
         std::chrono::time_point<std::chrono::system_clock> all_threads_start;
@@ -1204,9 +1286,18 @@ int main_giraffe(int argc, char** argv) {
             // Set up output to an emitter that will handle serialization and surjection.
             // Unless we want to discard all the alignments in which case do that.
             // We send along the positional graph when we have it, and otherwise we send the GBWTGraph which is sufficient for GAF output.
-            unique_ptr<AlignmentEmitter> alignment_emitter = discard_alignments ?
-                make_unique<NullAlignmentEmitter>() :
-                get_alignment_emitter("-", output_format, paths, thread_count, path_position_graph ? (const HandleGraph*)path_position_graph : (const HandleGraph*)gbwt_graph.get());
+            const HandleGraph* output_graph = path_position_graph ? (const HandleGraph*)path_position_graph : (const HandleGraph*)gbwt_graph.get();
+            unique_ptr<CandidateAlignmentEmitter> alignment_emitter;
+            if (!discard_alignments && output_format == "GAF" && writer_threads == 0) {
+                // GAF can be written from the mapper's candidate alignments, reusing one Alignment per thread.
+                alignment_emitter = make_unique<CandidateAlignmentEmitter>("-", thread_count, *output_graph);
+            } else {
+                unique_ptr<AlignmentEmitter> backing_emitter = discard_alignments ?
+                    make_unique<NullAlignmentEmitter>() :
+                    get_alignment_emitter("-", output_format, paths, thread_count, output_graph,
+                                          false, false, writer_threads, &writer_stats);
+                alignment_emitter = make_unique<CandidateAlignmentEmitter>(std::move(backing_emitter));
+            }
             
 #ifdef USE_CALLGRIND
             // We want to profile the alignment, not the loading.
@@ -1255,7 +1346,7 @@ int main_giraffe(int argc, char** argv) {
                 // Define how to align and output a read pair, in a thread.
                 auto map_read_pair = [&](Alignment& aln1, Alignment& aln2) {
                     
-                    pair<vector<Alignment>, vector<Alignment>> mapped_pairs = minimizer_mapper.map_paired(aln1, aln2, ambiguous_pair_buffer);
+                    auto mapped_pairs = minimizer_mapper.map_paired_candidates(aln1, aln2, ambiguous_pair_buffer);
                     if (!mapped_pairs.first.empty() && !mapped_pairs.second.empty()) {
                         //If we actually tried to map this paired end
                         
@@ -1272,7 +1363,11 @@ int main_giraffe(int argc, char** argv) {
                              tlen_limit = minimizer_mapper.get_fragment_length_mean() + 6 * minimizer_mapper.get_fragment_length_stdev();
                         }
                         // Emit it
-                        alignment_emitter->emit_mapped_pair(std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
+                        auto output_start = std::chrono::steady_clock::now();
+                        alignment_emitter->emit_pair(aln1, aln2, std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
+                        if (stage_latencies) {
+                            stage_latencies->add_time("output", std::chrono::duration<double>(std::chrono::steady_clock::now() - output_start).count());
+                        }
                         // Record that we mapped a read.
                         reads_mapped_by_thread.at(omp_get_thread_num()) += 2;
                     }
@@ -1294,12 +1389,14 @@ int main_giraffe(int argc, char** argv) {
                     });
                 } else if (!fastq_filename_2.empty()) {
                     //A pair of FASTQ files to map
-                    fastq_paired_two_files_for_each_parallel_after_wait(fastq_filename_1, fastq_filename_2, map_read_pair, distribution_is_ready);
+                    fastq_paired_two_files_for_each_parallel_after_wait(fastq_filename_1, fastq_filename_2, map_read_pair, distribution_is_ready,
+                                                                        reader_threads, &input_starved_seconds);
 
 
                 } else if ( !fastq_filename_1.empty()) {
                     // An interleaved FASTQ file to map, map all its pairs in parallel.
-                    fastq_paired_interleaved_for_each_parallel_after_wait(fastq_filename_1, map_read_pair, distribution_is_ready);
+                    fastq_paired_interleaved_for_each_parallel_after_wait(fastq_filename_1, map_read_pair, distribution_is_ready,
+                                                                          reader_threads, &input_starved_seconds);
                 }
 
                 // Now map all the ambiguous pairs
@@ -1307,14 +1404,15 @@ int main_giraffe(int argc, char** argv) {
                 require_distribution_finalized();
                 for (pair<Alignment, Alignment>& alignment_pair : ambiguous_pair_buffer) {
 
-                    auto mapped_pairs = minimizer_mapper.map_paired(alignment_pair.first, alignment_pair.second);
+                    auto mapped_pairs = minimizer_mapper.map_paired_candidates(alignment_pair.first, alignment_pair.second);
                     // Work out whether it could be properly paired or not, if that is relevant.
                     int64_t tlen_limit = 0;
                     if (hts_output && minimizer_mapper.fragment_distr_is_finalized()) {
                          tlen_limit = minimizer_mapper.get_fragment_length_mean() + 6 * minimizer_mapper.get_fragment_length_stdev();
                     }
                     // Emit the read
-                    alignment_emitter->emit_mapped_pair(std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
+                    alignment_emitter->emit_pair(alignment_pair.first, alignment_pair.second,
+                                                 std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
                     // Record that we mapped a read.
                     reads_mapped_by_thread.at(omp_get_thread_num()) += 2;
                 }
@@ -1342,7 +1440,7 @@ int main_giraffe(int argc, char** argv) {
                 
                 if (!fastq_filename_1.empty()) {
                     // FASTQ file to map, map all its reads in parallel.
-                    fastq_unpaired_for_each_parallel(fastq_filename_1, map_read);
+                    fastq_unpaired_for_each_parallel(fastq_filename_1, map_read, reader_threads, &input_starved_seconds);
                 }
             }
         
@@ -1371,6 +1469,28 @@ int main_giraffe(int argc, char** argv) {
             
             cerr << "Mapping speed: " << reads_per_second_per_thread
                 << " reads per second per thread" << endl;
+            
+            if (!fastq_filename_1.empty()) {
+                cerr << "Waited " << input_starved_seconds << " seconds for FASTQ input on "
+                    << reader_threads << " reader threads." << endl;
+            }
+            
+            if (writer_threads > 0) {
+                cerr << "Output queue held up to " << writer_stats.max_queue_depth << " batches (mean "
+                    << writer_stats.mean_queue_depth << ") across " << writer_stats.batches << " batches; mapping threads waited "
+                    << writer_stats.blocked_seconds << " seconds on " << writer_threads << " writer threads." << endl;
+            }
+
+            if (paired) {
+                pair<size_t, size_t> rescue_cache_stats = minimizer_mapper.get_rescue_subgraph_cache_stats();
+                size_t lookups = rescue_cache_stats.first - rescue_cache_stats_before.first;
+                size_t hits = rescue_cache_stats.second - rescue_cache_stats_before.second;
+                cerr << "Rescue subgraph cache answered " << hits << " of " << lookups << " lookups";
+                if (lookups != 0) {
+                    cerr << " (" << (100.0 * hits / lookups) << "%)";
+                }
+                cerr << "." << endl;
+            }
 
             cerr << "Memory footprint: " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB" << endl;
         }
@@ -1382,6 +1502,20 @@ int main_giraffe(int argc, char** argv) {
         }
         
     });
+
+    if (stage_latencies) {
+        // Write out where the time went
+        ofstream stage_times(stage_times_name);
+        if (!stage_times) {
+            cerr << "error[vg giraffe]: Could not open stage times file " << stage_times_name << endl;
+            exit(1);
+        }
+        if (stage_times_name.size() >= 5 && stage_times_name.substr(stage_times_name.size() - 5) == ".json") {
+            stage_latencies->write_json(stage_times);
+        } else {
+            stage_latencies->write_tsv(stage_times);
+        }
+    }
         
     return 0;
 }
@@ -21,6 +21,7 @@
 #include "../region.hpp"
 #include "../snarls.hpp"
 #include "../min_distance.hpp"
+#include "../gcsa_jump_table.hpp"
 #include "../source_sink_overlay.hpp"
 #include "../gbwt_helper.hpp"
 
@@ -70,6 +71,7 @@ void help_index(char** argv) {
          << "    -X, --doubling-steps N use this number of doubling steps for GCSA2 construction (default " << gcsa::ConstructionParameters::DOUBLING_STEPS << ")" << endl
          << "    -Z, --size-limit N     limit temporary disk space usage to N gigabytes (default " << gcsa::ConstructionParameters::SIZE_LIMIT << ")" << endl
          << "    -V, --verify-index     validate the GCSA2 index using the input kmers (important for testing)" << endl
+         << "    --jump-table N         also write a table of GCSA2 ranges for all kmers up to length N (at most " << GCSAJumpTable::MAX_LENGTH << ") to FILE.jmp" << endl
          << "gam indexing options:" << endl
          << "    -l, --index-sorted-gam input is sorted .gam format alignments, store a GAI index of the sorted GAM in INPUT.gam.gai" << endl
          << "vg in-place indexing options:" << endl
@@ -86,6 +88,16 @@ void multiple_thread_sources() {
     std::exit(EXIT_FAILURE);
 }
 
+// Write the distance index bare, so that it can be memory-mapped when loaded.
+void save_distance_index(const MinimumDistanceIndex& distance_index, const string& filename) {
+    ofstream out(filename);
+    if (!out) {
+        std::cerr << "error: [vg index] cannot write distance index to " << filename << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    distance_index.serialize(out);
+}
+
 int main_index(int argc, char** argv) {
 
     if (argc == 2) {
@@ -96,6 +108,7 @@ int main_index(int argc, char** argv) {
     #define OPT_BUILD_VGI_INDEX 1000
     #define OPT_RENAME_VARIANTS 1001
     #define OPT_PATHS_AS_SAMPLES 1002
+    #define OPT_JUMP_TABLE 1003
 
     // Which indexes to build.
     bool build_xg = false, build_gbwt = false, build_gcsa = false, build_dist = false;
@@ -120,6 +133,7 @@ int main_index(int argc, char** argv) {
     gcsa::size_type kmer_size = gcsa::Key::MAX_LENGTH;
     gcsa::ConstructionParameters params;
     bool verify_gcsa = false;
+    size_t jump_table_length = 0;
     
     // Gam index (GAI)
     bool build_gai_index = false;
@@ -177,6 +191,7 @@ int main_index(int argc, char** argv) {
             {"doubling-steps", required_argument, 0, 'X'},
             {"size-limit", required_argument, 0, 'Z'},
             {"verify-index", no_argument, 0, 'V'},
+            {"jump-table", required_argument, 0, OPT_JUMP_TABLE},
             
             // GAM index (GAI)
             {"index-sorted-gam", no_argument, 0, 'l'},
@@ -356,6 +371,9 @@ int main_index(int argc, char** argv) {
         case 'V':
             verify_gcsa = true;
             break;
+        case OPT_JUMP_TABLE:
+            jump_table_length = parse<size_t>(optarg);
+            break;
             
         // Gam index (GAI)
         case 'l':
@@ -460,6 +478,11 @@ int main_index(int argc, char** argv) {
         return 1;
     }
     
+    if (jump_table_length > GCSAJumpTable::MAX_LENGTH) {
+        cerr << "error: [vg index] GCSA2 jump table cannot hold kmers longer than " << GCSAJumpTable::MAX_LENGTH << endl;
+        return 1;
+    }
+    
     if (build_xg && build_gcsa && file_names.empty()) {
         // Really we want to build a GCSA by *reading* and XG
         build_xg = false;
@@ -597,6 +620,18 @@ int main_index(int argc, char** argv) {
         }
         vg::io::VPKG::save(gcsa_index, gcsa_name);
         vg::io::VPKG::save(lcp_array, gcsa_name + ".lcp");
+        if (jump_table_length > 0) {
+            if (show_progress) {
+                cerr << "Building the jump table for kmers up to length " << jump_table_length << "..." << endl;
+            }
+            GCSAJumpTable jump_table(gcsa_index, jump_table_length);
+            ofstream jump_out(gcsa_name + ".jmp", ios::binary);
+            if (!jump_out) {
+                cerr << "error: [vg index] could not open " << gcsa_name << ".jmp for writing" << endl;
+                return 1;
+            }
+            jump_table.serialize(jump_out);
+        }
 
         // Verify the index
         if (verify_gcsa) {
@@ -694,7 +729,7 @@ int main_index(int argc, char** argv) {
                 // Create the MinimumDistanceIndex
                 MinimumDistanceIndex di(xg.get(), snarl_manager);
                 // Save the completed DistanceIndex
-                vg::io::VPKG::save(di, dist_name);
+                save_distance_index(di, dist_name);
 
             } else {
                 // We were given a graph generically
@@ -702,7 +737,7 @@ int main_index(int argc, char** argv) {
     
                 // Create the MinimumDistanceIndex
                 MinimumDistanceIndex di(graph.get(), snarl_manager);
-                vg::io::VPKG::save(di, dist_name);
+                save_distance_index(di, dist_name);
             }
           
             
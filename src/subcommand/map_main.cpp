@@ -26,6 +26,7 @@ void help_map(char** argv) {
          << "    -1, --gbwt-name FILE          use this GBWT haplotype index (defaults to <graph>"<<gbwt::GBWT::EXTENSION << ")" << endl
          << "algorithm:" << endl
          << "    -t, --threads N               number of compute threads to use" << endl
+         << "    --reader-threads N            decompress and parse FASTQ input on N threads besides the compute threads [1]" << endl
          << "    -k, --min-mem INT             minimum MEM length (if 0 estimate via -e) [0]" << endl
          << "    -e, --mem-chance FLOAT        set {-k} such that this fraction of {-k} length hits will by chance [5e-4]" << endl
          << "    -c, --hit-max N               ignore MEMs who have >N hits in our index (0 for no limit) [2048]" << endl
@@ -111,6 +112,7 @@ int main_map(int argc, char** argv) {
     #define OPT_RECOMBINATION_PENALTY 1001
     #define OPT_EXCLUDE_UNALIGNED 1002
     #define OPT_REF_PATHS 1003
+    #define OPT_READER_THREADS 1004
     string matrix_file_name;
     string seq;
     string qual;
@@ -126,6 +128,7 @@ int main_map(int argc, char** argv) {
     int hit_max = 2048;
     int max_multimaps = 1;
     int thread_count = 1;
+    int reader_threads = 1;
     string output_format = "GAM";
     string ref_paths_name;
     bool exclude_unaligned = false;
@@ -260,6 +263,7 @@ int main_map(int argc, char** argv) {
                 {"refpos-table", no_argument, 0, 'v'},
                 {"surject-to", required_argument, 0, '5'},
                 {"ref-paths", required_argument, 0, OPT_REF_PATHS},
+                {"reader-threads", required_argument, 0, OPT_READER_THREADS},
                 {"no-patch-aln", no_argument, 0, '8'},
                 {"drop-full-l-bonus", no_argument, 0, '2'},
                 {"unpaired-cost", required_argument, 0, 'S'},
@@ -533,6 +537,14 @@ int main_map(int argc, char** argv) {
         case OPT_REF_PATHS:
             ref_paths_name = optarg;
             break;
+            
+        case OPT_READER_THREADS:
+            reader_threads = parse<int>(optarg);
+            if (reader_threads <= 0) {
+                cerr << "error:[vg map] Reader thread count (--reader-threads) must be a positive integer." << endl;
+                exit(1);
+            }
+            break;
 
         case '8':
             patch_alignments = false;
@@ -669,6 +681,7 @@ int main_map(int argc, char** argv) {
     PathPositionHandleGraph* xgidx = nullptr;
     unique_ptr<gcsa::GCSA> gcsa;
     unique_ptr<gcsa::LCPArray> lcp;
+    unique_ptr<GCSAJumpTable> gcsa_jump_table;
     unique_ptr<gbwt::GBWT> gbwt;
     // Used only for memory management:
     unique_ptr<PathHandleGraph> path_handle_graph;
@@ -714,6 +727,14 @@ int main_map(int argc, char** argv) {
         lcp = vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream);
     }
     
+    if (gcsa) {
+        // Use precomputed k-mer ranges to start MEM searches, if available
+        gcsa_jump_table = load_gcsa_jump_table(gcsa_name, *gcsa);
+        if (debug && gcsa_jump_table) {
+            cerr << "Loaded GCSA2 jump table " << gcsa_name << ".jmp" << endl;
+        }
+    }
+    
     ifstream gbwt_stream(gbwt_name);
     if(gbwt_stream) {
         // We have a GBWT index too!
@@ -789,6 +810,7 @@ int main_map(int argc, char** argv) {
             // Can't continue with null
             throw runtime_error("Need XG, GCSA, and LCP to create a Mapper");
         }
+        m->gcsa_jump_table = gcsa_jump_table.get();
         m->hit_max = hit_max;
         m->max_multimaps = max_multimaps;
         m->min_multimaps = max(min_multimaps, max_multimaps);
@@ -848,6 +870,8 @@ int main_map(int argc, char** argv) {
         mapper[i] = m;
     }
     vector<size_t> reads_mapped_by_thread(thread_count, 0);
+    // Track how long the mapping threads waited on FASTQ input
+    double input_starved_seconds = 0;
 
     std::chrono::time_point<std::chrono::system_clock> init = std::chrono::system_clock::now();
 
@@ -1039,7 +1063,7 @@ int main_map(int argc, char** argv) {
 
                 reads_mapped_by_thread[omp_get_thread_num()] += 2;
             };
-            fastq_paired_interleaved_for_each_parallel(fastq1, lambda);
+            fastq_paired_interleaved_for_each_parallel(fastq1, lambda, reader_threads, &input_starved_seconds);
 #pragma omp parallel
             { // clean up buffered alignments that weren't perfect
                 auto our_mapper = mapper[omp_get_thread_num()];
@@ -1072,7 +1096,7 @@ int main_map(int argc, char** argv) {
                         output_alignments(alignments, empty_alns);
                         reads_mapped_by_thread[tid] += 1;
                     };
-            fastq_unpaired_for_each_parallel(fastq1, lambda);
+            fastq_unpaired_for_each_parallel(fastq1, lambda, reader_threads, &input_starved_seconds);
         } else {
             // paired two-file
             auto output_func = [&](Alignment& aln1,
@@ -1115,7 +1139,7 @@ int main_map(int argc, char** argv) {
 
                 reads_mapped_by_thread[omp_get_thread_num()] += 2;
             };
-            fastq_paired_two_files_for_each_parallel(fastq1, fastq2, lambda);
+            fastq_paired_two_files_for_each_parallel(fastq1, fastq2, lambda, reader_threads, &input_starved_seconds);
 #pragma omp parallel
             {
                 auto our_mapper = mapper[omp_get_thread_num()];
@@ -1256,6 +1280,9 @@ int main_map(int argc, char** argv) {
         cerr << "Index load time: " << index_load_seconds.count() << endl;
         cerr << "Mapped " << total_reads_mapped << " reads" << endl;
         cerr << "Mapping speed: " << reads_per_second_per_thread << " reads per second per thread" << endl; 
+        if (!fastq1.empty()) {
+            cerr << "FASTQ input wait time: " << input_starved_seconds << endl;
+        }
     }
     
     cout.flush();
@@ -225,7 +225,7 @@ int main_minimizer(int argc, char** argv) {
         if (progress) {
             std::cerr << "Loading MinimumDistanceIndex " << distance_name << std::endl;
         }
-        distance_index = vg::io::VPKG::load_one<MinimumDistanceIndex>(distance_name);
+        distance_index = load_minimum_distance_index(distance_name);
     }
 
     // Build the index.
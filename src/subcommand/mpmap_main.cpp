@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <ctime>
 #include <getopt.h>
+#include <sys/stat.h>
 
 #include "subcommand.hpp"
 
@@ -73,6 +74,7 @@ void help_mpmap(char** argv) {
 //    << "  -E, --long-read-scoring      set alignment scores to long-read defaults: -q1 -z1 -o1 -y1 -L0 (can be overridden)" << endl
     << "computational parameters:" << endl
     << "  -t, --threads INT         number of compute threads to use [all available]" << endl
+    << "  --reader-threads INT      decompress and parse FASTQ input on INT threads besides the compute threads [1]" << endl
     << endl
     << "advanced options:" << endl
     << "algorithm:" << endl
@@ -88,6 +90,8 @@ void help_mpmap(char** argv) {
     << "  -I, --frag-mean FLOAT     mean for a pre-determined fragment length distribution (also requires -D)" << endl
     << "  -D, --frag-stddev FLOAT   standard deviation for a pre-determined fragment length distribution (also requires -I)" << endl
     //<< "  -B, --no-calibrate           do not auto-calibrate mismapping dectection" << endl
+    << "  --calibration FILE        reuse or save the mismapping detection calibration in FILE" << endl
+    << "  --calibrate-only          save the mismapping detection calibration to the --calibration FILE and exit without mapping" << endl
     << "  -G, --gam-input FILE      input GAM (for stdin, use -)" << endl
     //<< "  -P, --max-p-val FLOAT        background model p-value must be less than this to avoid mismapping detection [0.0001]" << endl
     << "  -U, --report-group-mapq   add an annotation for the collective mapping quality of all reported alignments" << endl
@@ -122,6 +126,61 @@ void help_mpmap(char** argv) {
 
 
 
+// Identify a file by its size and modification time, which is much cheaper than reading it
+static string file_fingerprint(const string& filename) {
+    struct stat file_info;
+    if (filename.empty() || stat(filename.c_str(), &file_info) != 0) {
+        return "-";
+    }
+    return to_string(file_info.st_size) + "@" + to_string(file_info.st_mtime);
+}
+
+// Make a one-line key for everything that the mismapping detection null model depends on
+static string calibration_fingerprint(const MultipathMapper& mapper, const vector<string>& index_names,
+                                      const vector<int>& scores, size_t num_simulations,
+                                      const vector<size_t>& read_lengths) {
+    stringstream strm;
+    strm.precision(numeric_limits<double>::max_digits10);
+    strm << "indexes";
+    for (const string& index_name : index_names) {
+        strm << " " << file_fingerprint(index_name);
+    }
+    strm << " scores";
+    for (int score : scores) {
+        strm << " " << score;
+    }
+    strm << " simulations " << num_simulations << " lengths";
+    for (size_t read_length : read_lengths) {
+        strm << " " << read_length;
+    }
+    // the parameters that the simulated reads are mapped with
+    strm << " mapping " << mapper.band_padding_multiplier << " " << mapper.hit_max << " " << mapper.hard_hit_max
+         << " " << mapper.mem_reseed_length << " " << mapper.fast_reseed_length_diff << " " << mapper.sub_mem_count_thinning
+         << " " << mapper.sub_mem_thinning_burn_in << " " << mapper.order_length_repeat_hit_max
+         << " " << mapper.stripped_match_alg_strip_length << " " << mapper.stripped_match_alg_max_length
+         << " " << mapper.stripped_match_alg_target_count << " " << mapper.use_greedy_mem_restarts
+         << " " << mapper.greedy_restart_min_length << " " << mapper.greedy_restart_max_count
+         << " " << mapper.greedy_restart_max_lcp << " " << mapper.greedy_restart_assume_substitution
+         << " " << mapper.use_stripped_match_alg << " " << mapper.filter_short_mems << " " << mapper.short_mem_filter_factor
+         << " " << mapper.use_fanout_match_alg << " " << mapper.max_fans_out << " " << mapper.fanout_length_threshold
+         << " " << mapper.adaptive_reseed_diff << " " << mapper.adaptive_diff_exponent
+         << " " << mapper.prefilter_redundant_hits << " " << mapper.precollapse_order_length_hits
+         << " " << mapper.max_sub_mem_recursion_depth << " " << mapper.no_clustering << " " << mapper.use_tvs_clusterer
+         << " " << mapper.use_min_dist_clusterer << " " << mapper.greedy_min_dist << " " << mapper.component_min_dist
+         << " " << mapper.max_expected_dist_approx_error << " " << mapper.mem_coverage_min_ratio
+         << " " << mapper.log_likelihood_approx_factor << " " << mapper.num_mapping_attempts
+         << " " << mapper.min_median_mem_coverage_for_split << " " << mapper.suppress_cluster_merging
+         << " " << mapper.suppress_multicomponent_splitting << " " << mapper.reversing_walk_length
+         << " " << mapper.max_alignment_gap << " " << mapper.use_pessimistic_tail_alignment
+         << " " << mapper.pessimistic_gap_multiplier << " " << mapper.restrained_graph_extraction
+         << " " << mapper.max_snarl_cut_size << " " << mapper.max_branch_trim_length << " " << mapper.suppress_tail_anchors
+         << " " << mapper.num_alt_alns << " " << mapper.dynamic_max_alt_alns << " " << mapper.simplify_topologies
+         << " " << mapper.max_suboptimal_path_score_ratio << " " << mapper.agglomerate_multipath_alns
+         << " " << mapper.use_population_mapqs << " " << mapper.population_max_paths << " " << mapper.top_tracebacks
+         << " " << mapper.recombination_penalty << " " << mapper.mapping_quality_method << " " << mapper.max_mapping_quality;
+    return strm.str();
+}
+
 int main_mpmap(int argc, char** argv) {
     
     if (argc == 2) {
@@ -162,6 +221,9 @@ int main_mpmap(int argc, char** argv) {
     #define OPT_ALT_PATHS 1030
     #define OPT_SUPPRESS_SUPPRESSION 1031
     #define OPT_NOT_SPLICED 1032
+    #define OPT_READER_THREADS 1033
+    #define OPT_CALIBRATION 1034
+    #define OPT_CALIBRATE_ONLY 1035
     string matrix_file_name;
     string graph_name;
     string gcsa_name;
@@ -174,6 +236,8 @@ int main_mpmap(int argc, char** argv) {
     string fastq_name_2;
     string gam_file_name;
     string ref_paths_name;
+    string calibration_name;
+    bool calibrate_only = false;
     int match_score = default_match;
     int mismatch_score = default_mismatch;
     int gap_open_score = default_gap_open;
@@ -310,6 +374,9 @@ int main_mpmap(int argc, char** argv) {
     bool suppress_progress = false;
     int fragment_length_warning_factor = 25;
     
+    // input
+    int reader_threads = 1;
+    
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -344,6 +411,8 @@ int main_mpmap(int argc, char** argv) {
             {"secondary-diff", required_argument, 0, OPT_SECONDARY_MAX_DIFF},
             {"path-rescue-graph", no_argument, 0, OPT_PATH_RESCUE_GRAPH},
             {"no-calibrate", no_argument, 0, 'B'},
+            {"calibration", required_argument, 0, OPT_CALIBRATION},
+            {"calibrate-only", no_argument, 0, OPT_CALIBRATE_ONLY},
             {"max-p-val", required_argument, 0, 'P'},
             {"max-rescue-p-val", required_argument, 0, OPT_MAX_RESCUE_P_VALUE},
             {"mq-max", required_argument, 0, 'Q'},
@@ -380,6 +449,7 @@ int main_mpmap(int argc, char** argv) {
             {"prune-exp", required_argument, 0, OPT_PRUNE_EXP},
             {"long-read-scoring", no_argument, 0, 'E'},
             {"not-spliced", no_argument, 0, OPT_NOT_SPLICED},
+            {"reader-threads", required_argument, 0, OPT_READER_THREADS},
             {"read-length", required_argument, 0, 'l'},
             {"nt-type", required_argument, 0, 'n'},
             {"error-rate", required_argument, 0, 'e'},
@@ -572,6 +642,18 @@ int main_mpmap(int argc, char** argv) {
                 auto_calibrate_mismapping_detection = false;
                 break;
                 
+            case OPT_CALIBRATION:
+                calibration_name = optarg;
+                if (calibration_name.empty()) {
+                    cerr << "error:[vg mpmap] Must provide calibration file with --calibration." << endl;
+                    exit(1);
+                }
+                break;
+                
+            case OPT_CALIBRATE_ONLY:
+                calibrate_only = true;
+                break;
+                
             case 'P':
                 max_mapping_p_value = parse<double>(optarg);
                 break;
@@ -729,6 +811,14 @@ int main_mpmap(int argc, char** argv) {
                 override_spliced_alignment = true;
                 break;
                 
+            case OPT_READER_THREADS:
+                reader_threads = parse<int>(optarg);
+                if (reader_threads <= 0) {
+                    cerr << "error:[vg mpmap] Reader thread count (--reader-threads) set to " << reader_threads << ", must set to a positive integer." << endl;
+                    exit(1);
+                }
+                break;
+                
             case 'l':
                 read_length = optarg;
                 break;
@@ -1074,7 +1164,7 @@ int main_mpmap(int argc, char** argv) {
         exit(1);
     }
     
-    if (fastq_name_1.empty() && gam_file_name.empty()) {
+    if (fastq_name_1.empty() && gam_file_name.empty() && !calibrate_only) {
         cerr << "error:[vg mpmap] Must designate reads to map from either FASTQ (-f) or GAM (-G) file." << endl;
         exit(1);
     }
@@ -1339,6 +1429,16 @@ int main_mpmap(int argc, char** argv) {
         exit(1);
     }
     
+    if (calibrate_only && (!auto_calibrate_mismapping_detection || suppress_mismapping_detection)) {
+        cerr << "error:[vg mpmap] Cannot calibrate mismapping detection (--calibrate-only) when it is turned off, as it is for very short reads." << endl;
+        exit(1);
+    }
+    
+    if (calibrate_only && calibration_name.empty()) {
+        cerr << "error:[vg mpmap] Saving the mismapping detection calibration (--calibrate-only) requires a file to save it in (--calibration)." << endl;
+        exit(1);
+    }
+    
     
 #ifdef mpmap_instrument_mem_statistics
     if (auto_calibrate_mismapping_detection) {
@@ -1573,6 +1673,11 @@ int main_mpmap(int argc, char** argv) {
         }
         lcp_array = vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream);
     }
+    // Use precomputed k-mer ranges to start MEM searches, if available
+    unique_ptr<GCSAJumpTable> gcsa_jump_table = load_gcsa_jump_table(gcsa_name, *gcsa_index);
+    if (gcsa_jump_table && !suppress_progress) {
+        cerr << progress_boilerplate() << "Loaded GCSA2 jump table from " << gcsa_name << ".jmp" << endl;
+    }
     
     // Load optional indexes
     
@@ -1623,7 +1728,7 @@ int main_mpmap(int argc, char** argv) {
         }
         
         // Load the index
-        distance_index = vg::io::VPKG::load_one<MinimumDistanceIndex>(distance_index_stream);
+        distance_index = load_minimum_distance_index(distance_index_name);
         
     }
     
@@ -1662,6 +1767,7 @@ int main_mpmap(int argc, char** argv) {
     
     MultipathMapper multipath_mapper(path_position_handle_graph, gcsa_index.get(), lcp_array.get(), haplo_score_provider,
         snarl_manager.get(), distance_index.get());
+    multipath_mapper.gcsa_jump_table = gcsa_jump_table.get();
     
     // set alignment parameters
     if (matrix_stream.is_open()) {
@@ -1792,10 +1898,61 @@ int main_mpmap(int argc, char** argv) {
     
     // if directed to, auto calibrate the mismapping detection to the graph
     if (auto_calibrate_mismapping_detection && !suppress_mismapping_detection) {
-        if (!suppress_progress) {
-            cerr << progress_boilerplate() << "Building null model to calibrate mismapping detection (can take some time)." << endl;
+        
+        // the null model only depends on the indexes and the mapping parameters, so an earlier
+        // run with the same ones can have saved it for us, if we were given a file to keep it in
+        string fingerprint;
+        ifstream calibration_in;
+        if (!calibration_name.empty()) {
+            fingerprint = calibration_fingerprint(multipath_mapper,
+                                                  {graph_name, gcsa_name, lcp_name, gbwt_name, sublinearLS_name,
+                                                   snarls_name, distance_index_name, matrix_file_name},
+                                                  {match_score, mismatch_score, gap_open_score, gap_extension_score,
+                                                   full_length_bonus},
+                                                  num_calibration_simulations, calibration_read_lengths);
+            calibration_in.open(calibration_name);
+        }
+        if (calibration_in && multipath_mapper.load_mismapping_calibration(calibration_in, fingerprint)) {
+            if (!suppress_progress) {
+                cerr << progress_boilerplate() << "Loaded mismapping detection calibration from " << calibration_name << endl;
+            }
         }
-        multipath_mapper.calibrate_mismapping_detection(num_calibration_simulations, calibration_read_lengths);
+        else {
+            if (!suppress_progress) {
+                cerr << progress_boilerplate() << "Building null model to calibrate mismapping detection (can take some time)." << endl;
+            }
+            multipath_mapper.calibrate_mismapping_detection(num_calibration_simulations, calibration_read_lengths);
+            
+            if (!calibration_name.empty()) {
+                // write to a temporary file and move it into place, so that concurrent runs never see a
+                // partial file, and carry on without it if that isn't possible
+                string temp_name = calibration_name + ".tmp" + to_string(getpid());
+                ofstream calibration_out(temp_name);
+                if (calibration_out) {
+                    multipath_mapper.save_mismapping_calibration(calibration_out, fingerprint);
+                    calibration_out.close();
+                }
+                if (calibration_out && rename(temp_name.c_str(), calibration_name.c_str()) == 0) {
+                    if (!suppress_progress) {
+                        cerr << progress_boilerplate() << "Saved mismapping detection calibration to " << calibration_name << endl;
+                    }
+                }
+                else {
+                    remove(temp_name.c_str());
+                    cerr << "warning:[vg mpmap] Could not save mismapping detection calibration to " << calibration_name << endl;
+                }
+            }
+        }
+    }
+    
+    if (calibrate_only) {
+        if (haplo_score_provider != nullptr) {
+            delete haplo_score_provider;
+        }
+        if (sublinearLS != nullptr) {
+            delete sublinearLS;
+        }
+        return 0;
     }
     
     // now we can start doing spliced alignment
@@ -2120,6 +2277,9 @@ int main_mpmap(int argc, char** argv) {
         return multipath_mapper.has_fixed_fragment_length_distr();
     };
     
+    // how long the mapping threads waited for FASTQ input
+    double input_starved_seconds = 0.0;
+    
     // FASTQ input
     if (!fastq_name_1.empty()) {
         if (!suppress_progress) {
@@ -2128,14 +2288,17 @@ int main_mpmap(int argc, char** argv) {
         
         if (interleaved_input) {
             fastq_paired_interleaved_for_each_parallel_after_wait(fastq_name_1, do_paired_alignments,
-                                                                  multi_threaded_condition);
+                                                                  multi_threaded_condition,
+                                                                  reader_threads, &input_starved_seconds);
         }
         else if (fastq_name_2.empty()) {
-            fastq_unpaired_for_each_parallel(fastq_name_1, do_unpaired_alignments);
+            fastq_unpaired_for_each_parallel(fastq_name_1, do_unpaired_alignments,
+                                             reader_threads, &input_starved_seconds);
         }
         else {
             fastq_paired_two_files_for_each_parallel_after_wait(fastq_name_1, fastq_name_2, do_paired_alignments,
-                                                                multi_threaded_condition);
+                                                                multi_threaded_condition,
+                                                                reader_threads, &input_starved_seconds);
         }
     }
     
@@ -2210,6 +2373,9 @@ int main_mpmap(int argc, char** argv) {
             num_reads_mapped += uncounted_mappings;
         }
         cerr << progress_boilerplate() << "Mapping finished. Mapped " << num_reads_mapped << " " << (fastq_name_2.empty() && !interleaved_input ? "reads" : "read pairs") << "." << endl;
+        if (!fastq_name_1.empty()) {
+            cerr << progress_boilerplate() << "Mapping threads waited " << input_starved_seconds << " seconds for FASTQ input." << endl;
+        }
     }
     
 #ifdef record_read_run_times
@@ -31,6 +31,8 @@ void help_pack(char** argv) {
          << "    -N, --node-list FILE   a white space or line delimited list of nodes to collect" << endl
          << "    -Q, --min-mapq N       ignore reads with MAPQ < N and positions with base quality < N [default: 0]" << endl
          << "    -c, --expected-cov N   expected coverage.  used only for memory tuning [default : 128]" << endl
+         << "    -B, --count-buffer N   buffer up to N coverage increments per thread before applying them" << endl
+         << "                           (only used with more than one thread; 0 to disable) [default: 65536]" << endl
          << "    -t, --threads N        use N threads (defaults to numCPUs)" << endl;
 }
 
@@ -52,6 +54,7 @@ int main_pack(int argc, char** argv) {
     int min_mapq = 0;
     int min_baseq = 0;
     size_t expected_coverage = 128;
+    size_t count_buffer_size = 65536;
 
     if (argc == 2) {
         help_pack(argv);
@@ -79,11 +82,12 @@ int main_pack(int argc, char** argv) {
             {"bin-size", required_argument, 0, 'b'},
             {"min-mapq", required_argument, 0, 'Q'},
             {"expected-cov", required_argument, 0, 'c'},
+            {"count-buffer", required_argument, 0, 'B'},
             {0, 0, 0, 0}
 
         };
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:o:i:g:a:dDut:eb:n:N:Q:c:",
+        c = getopt_long (argc, argv, "hx:o:i:g:a:dDut:eb:n:N:Q:c:B:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -150,6 +154,9 @@ int main_pack(int argc, char** argv) {
         case 'c':
             expected_coverage = parse<size_t>(optarg);
             break;
+        case 'B':
+            count_buffer_size = parse<size_t>(optarg);
+            break;
         default:
             abort();
         }
@@ -211,6 +218,10 @@ int main_pack(int argc, char** argv) {
 
     // create our packer
     Packer packer(graph, bin_size, bin_count, data_width, true, true, record_edits);
+    if (num_threads > 1) {
+        // let each thread batch up its increments so the threads don't fight over the bin locks
+        packer.set_count_buffer_size(count_buffer_size);
+    }
     
     // todo one packer per thread and merge
     if (packs_in.size() == 1) {
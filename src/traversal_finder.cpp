@@ -3415,13 +3415,71 @@ vector<SnarlTraversal> GBWTTraversalFinder::find_traversals(const Snarl& site) {
 }
 
 
+pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> GBWTTraversalFinder::find_path_traversals(const Snarl& site) {
+
+    pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> results;
+
+    // Each distinct thread through the site, with where we put it in the results
+    map<vector<gbwt::node_type>, size_t> thread_to_index;
+
+    auto add_haplotypes = [&](const vector<gbwt::node_type>& thread, const gbwt::SearchState& state) {
+        auto found = thread_to_index.find(thread);
+        if (found == thread_to_index.end()) {
+            found = thread_to_index.emplace(thread, results.first.size()).first;
+            results.first.emplace_back();
+            for (auto& gnode : thread) {
+                Visit* visit = results.first.back().add_visit();
+                *visit = to_visit(gbwt::Node::id(gnode), gbwt::Node::is_reverse(gnode));
+            }
+            results.second.emplace_back();
+        }
+        // All the haplotypes that took this thread share the search state
+        for (gbwt::size_type sequence : gbwt.locate(state)) {
+            results.second[found->second].push_back(gbwt.bidirectional() ? gbwt::Path::id(sequence) : sequence);
+        }
+    };
+
+    // In a bidirectional GBWT every haplotype is stored in both orientations,
+    // so searching forward through the site finds all of them once.
+    for (auto& thread_state : get_spanning_haplotype_states(
+             graph.get_handle(site.start().node_id(), site.start().backward()),
+             graph.get_handle(site.end().node_id(), site.end().backward()))) {
+        add_haplotypes(thread_state.first, thread_state.second);
+    }
+
+    if (!gbwt.bidirectional()) {
+        // Otherwise, we have to look for the haplotypes that cross backward.
+        for (auto& thread_state : get_spanning_haplotype_states(
+                 graph.get_handle(site.end().node_id(), !site.end().backward()),
+                 graph.get_handle(site.start().node_id(), !site.start().backward()))) {
+            // orient along the snarl
+            vector<gbwt::node_type>& thread = thread_state.first;
+            std::reverse(thread.begin(), thread.end());
+            for (auto& gnode : thread) {
+                gnode = gbwt::Node::encode(gbwt::Node::id(gnode), !gbwt::Node::is_reverse(gnode));
+            }
+            add_haplotypes(thread, thread_state.second);
+        }
+    }
+
+    return results;
+}
+
 vector<vector<gbwt::node_type>> GBWTTraversalFinder::get_spanning_haplotypes(handle_t start, handle_t end) {
+    vector<vector<gbwt::node_type>> search_results;
+    for (auto& thread_state : get_spanning_haplotype_states(start, end)) {
+        search_results.push_back(std::move(thread_state.first));
+    }
+    return search_results;
+}
+
+vector<pair<vector<gbwt::node_type>, gbwt::SearchState>> GBWTTraversalFinder::get_spanning_haplotype_states(handle_t start, handle_t end) {
 
     // Note: this code is derived from list_haplotypes() in haplotype_extractor.cpp
     
     // Keep track of all the different paths we're extending
     vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > search_intermediates;
-    vector<vector<gbwt::node_type>> search_results;
+    vector<pair<vector<gbwt::node_type>, gbwt::SearchState>> search_results;
 
     // Look up the start node in GBWT and start a thread
     gbwt::node_type start_node = handle_to_gbwt(graph, start);    
@@ -3468,7 +3526,7 @@ vector<vector<gbwt::node_type>> GBWTTraversalFinder::get_spanning_haplotypes(han
 #ifdef debug
                         cerr << "\tGot " << new_state.size() << " results at limit; emitting" << endl;
 #endif
-                        search_results.push_back(std::move(new_thread));
+                        search_results.push_back(make_pair(std::move(new_thread), new_state));
                     }
                     else {
 #ifdef debug
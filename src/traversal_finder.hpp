@@ -628,6 +628,15 @@ public:
 
     virtual vector<SnarlTraversal> find_traversals(const Snarl& site);
 
+    /**
+     * Return each distinct traversal through the site that is taken by
+     * haplotypes in the GBWT, once, along with the GBWT path ids of all the
+     * haplotypes that take it. A haplotype that crosses the site more than
+     * once is listed once per crossing. Traversals are oriented along the
+     * site, no matter which way the haplotypes cross it.
+     */
+    virtual pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> find_path_traversals(const Snarl& site);
+
 protected:
 
     /**
@@ -635,6 +644,12 @@ protected:
      * in the GBWT, and returning all unique haplotypes found. 
      */
     vector<vector<gbwt::node_type>> get_spanning_haplotypes(handle_t start, handle_t end);
+
+    /**
+     * Like get_spanning_haplotypes(), but also return the GBWT search state
+     * at the end of each haplotype, which holds all the haplotypes that share it.
+     */
+    vector<pair<vector<gbwt::node_type>, gbwt::SearchState>> get_spanning_haplotype_states(handle_t start, handle_t end);
     
 };
 
@@ -488,6 +488,7 @@ CachedPackedTraversalSupportFinder::CachedPackedTraversalSupportFinder(const Pac
         avg_node_support_cache[i] = new LRUCache<nid_t, Support>(cache_size);
         edge_support_cache[i] = new LRUCache<edge_t, Support>(cache_size);
         avg_node_mapq_cache[i] = new LRUCache<nid_t, size_t>(cache_size);
+        cache_counts.push_back(new CacheCounts());
     }
 }
 
@@ -497,6 +498,7 @@ CachedPackedTraversalSupportFinder::~CachedPackedTraversalSupportFinder() {
         delete avg_node_support_cache[i];
         delete edge_support_cache[i];
         delete avg_node_mapq_cache[i];
+        delete cache_counts[i];
     }
 }
 
@@ -507,10 +509,17 @@ Support CachedPackedTraversalSupportFinder::get_edge_support(id_t from, bool fro
                                      graph->get_handle(to, to_reverse));
     
     auto& support_cache = *edge_support_cache[omp_get_thread_num()];
+    CacheCounts* counts = count_cache_stats ? cache_counts[omp_get_thread_num()] : nullptr;
+    if (counts) {
+        ++counts->lookups[0];
+    }
     pair<Support, bool> cached = support_cache.retrieve(edge);
     if (cached.second == true) {
         return cached.first;
     } else {
+        if (counts) {
+            ++counts->misses[0];
+        }
         Support support = PackedTraversalSupportFinder::get_edge_support(from, from_reverse, to, to_reverse);
         support_cache.put(edge, support);
         return support;
@@ -519,10 +528,17 @@ Support CachedPackedTraversalSupportFinder::get_edge_support(id_t from, bool fro
 
 Support CachedPackedTraversalSupportFinder::get_min_node_support(id_t node) const {
     auto& support_cache = *min_node_support_cache[omp_get_thread_num()];
+    CacheCounts* counts = count_cache_stats ? cache_counts[omp_get_thread_num()] : nullptr;
+    if (counts) {
+        ++counts->lookups[1];
+    }
     pair<Support, bool> cached = support_cache.retrieve(node);
     if (cached.second == true) {
         return cached.first;
     } else {
+        if (counts) {
+            ++counts->misses[1];
+        }
         Support support = PackedTraversalSupportFinder::get_min_node_support(node);
         support_cache.put(node, support);
         return support;
@@ -531,10 +547,17 @@ Support CachedPackedTraversalSupportFinder::get_min_node_support(id_t node) cons
 
 Support CachedPackedTraversalSupportFinder::get_avg_node_support(id_t node) const {
     auto& support_cache = *avg_node_support_cache[omp_get_thread_num()];
+    CacheCounts* counts = count_cache_stats ? cache_counts[omp_get_thread_num()] : nullptr;
+    if (counts) {
+        ++counts->lookups[2];
+    }
     pair<Support, bool> cached = support_cache.retrieve(node);
     if (cached.second == true) {
         return cached.first;
     } else {
+        if (counts) {
+            ++counts->misses[2];
+        }
         Support support = PackedTraversalSupportFinder::get_avg_node_support(node);
         support_cache.put(node, support);
         return support;
@@ -543,10 +566,17 @@ Support CachedPackedTraversalSupportFinder::get_avg_node_support(id_t node) cons
 
 size_t CachedPackedTraversalSupportFinder::get_avg_node_mapq(id_t node) const {
     auto& mapq_cache = *avg_node_mapq_cache[omp_get_thread_num()];
+    CacheCounts* counts = count_cache_stats ? cache_counts[omp_get_thread_num()] : nullptr;
+    if (counts) {
+        ++counts->lookups[3];
+    }
     pair<size_t, bool> cached = mapq_cache.retrieve(node);
     if (cached.second == true) {
         return cached.first;
     } else {
+        if (counts) {
+            ++counts->misses[3];
+        }
         size_t mapq = PackedTraversalSupportFinder::get_avg_node_mapq(node);
         mapq_cache.put(node, mapq);
         return mapq;
@@ -554,4 +584,60 @@ size_t CachedPackedTraversalSupportFinder::get_avg_node_mapq(id_t node) const {
     
 }
 
+void CachedPackedTraversalSupportFinder::set_count_cache_stats(bool count) {
+    count_cache_stats = count;
+}
+
+void CachedPackedTraversalSupportFinder::report_cache_stats(ostream& out) const {
+    const char* names[4] = {"edge support", "min node support", "avg node support", "avg node mapq"};
+    for (int i = 0; i < 4; ++i) {
+        size_t lookups = 0;
+        size_t misses = 0;
+        for (const CacheCounts* counts : cache_counts) {
+            lookups += counts->lookups[i];
+            misses += counts->misses[i];
+        }
+        out << names[i] << " cache: " << lookups << " lookups, " << (lookups - misses) << " hits";
+        if (lookups > 0) {
+            out << " (" << (100. * (lookups - misses) / lookups) << "%)";
+        }
+        out << endl;
+    }
+}
+
+TabledPackedTraversalSupportFinder::TabledPackedTraversalSupportFinder(const Packer& packer, SnarlManager& snarl_manager) :
+    PackedTraversalSupportFinder(packer, snarl_manager) {
+    // node indexes are 1-based ranks
+    size_t table_size = graph.get_node_count() + 1;
+    min_node_support.resize(table_size);
+    avg_node_support.resize(table_size);
+    avg_node_mapq.resize(table_size);
+    graph.for_each_handle([&](handle_t handle) {
+            id_t node = graph.get_id(handle);
+            size_t i = packer.node_index(node);
+            min_node_support[i] = PackedTraversalSupportFinder::get_min_node_support(node).forward();
+            avg_node_support[i] = PackedTraversalSupportFinder::get_avg_node_support(node).forward();
+            avg_node_mapq[i] = PackedTraversalSupportFinder::get_avg_node_mapq(node);
+        }, true);
+}
+
+TabledPackedTraversalSupportFinder::~TabledPackedTraversalSupportFinder() {
+}
+
+Support TabledPackedTraversalSupportFinder::get_min_node_support(id_t node) const {
+    Support support;
+    support.set_forward(min_node_support[packer.node_index(node)]);
+    return support;
+}
+
+Support TabledPackedTraversalSupportFinder::get_avg_node_support(id_t node) const {
+    Support support;
+    support.set_forward(avg_node_support[packer.node_index(node)]);
+    return support;
+}
+
+size_t TabledPackedTraversalSupportFinder::get_avg_node_mapq(id_t node) const {
+    return avg_node_mapq[packer.node_index(node)];
+}
+
 }
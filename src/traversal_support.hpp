@@ -162,6 +162,13 @@ public:
 
     /// Average MAPQ of reads that map to a node
     virtual size_t get_avg_node_mapq(id_t node) const;
+
+    /// Turn on counting cache lookups and misses, for report_cache_stats().
+    /// Counting is off by default, to keep it out of the lookups.
+    void set_count_cache_stats(bool count);
+
+    /// Print the hit rate of each cache, summed over all the threads
+    void report_cache_stats(ostream& out) const;
     
 protected:
 
@@ -170,6 +177,48 @@ protected:
     mutable vector<LRUCache<nid_t, Support>*> min_node_support_cache;
     mutable vector<LRUCache<nid_t, Support>*> avg_node_support_cache;
     mutable vector<LRUCache<nid_t, size_t>*> avg_node_mapq_cache;
+
+    /// Should lookups and misses be counted?
+    bool count_cache_stats = false;
+
+    /// Lookup and miss counts for each of the above caches (in the order declared), on one thread
+    struct CacheCounts {
+        size_t lookups[4] = {0, 0, 0, 0};
+        size_t misses[4] = {0, 0, 0, 0};
+        /// Keep the next thread's counts, allocated after these, out of our cache line
+        char padding[64];
+    };
+    /// One set of counts per thread (allocated separately to keep them out of each other's cache lines)
+    mutable vector<CacheCounts*> cache_counts;
+};
+
+/**
+ * Alternative to the CachedPackedTraversalSupportFinder that computes the min
+ * and average support and the average MAPQ of every node in one parallel pass
+ * over the Packer, so all threads share one table of lock-free lookups instead of
+ * each warming up its own cache.  Costs a few words per node in the graph, up front.
+ * Edge supports come straight from the Packer.
+ */
+class TabledPackedTraversalSupportFinder : public PackedTraversalSupportFinder {
+public:
+    TabledPackedTraversalSupportFinder(const Packer& packer, SnarlManager& snarl_manager);
+    virtual ~TabledPackedTraversalSupportFinder();
+
+    /// Minimum support of a node
+    virtual Support get_min_node_support(id_t node) const;
+
+    /// Average support of a node
+    virtual Support get_avg_node_support(id_t node) const;
+
+    /// Average MAPQ of reads that map to a node
+    virtual size_t get_avg_node_mapq(id_t node) const;
+
+protected:
+
+    /// Per-node values, indexed by Packer::node_index()
+    vector<size_t> min_node_support;
+    vector<double> avg_node_support;
+    vector<size_t> avg_node_mapq;
 };
 
 
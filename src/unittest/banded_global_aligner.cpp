@@ -12,6 +12,9 @@
 #include "banded_global_aligner.hpp"
 #include "vg/io/json2pb.h"
 #include "bdsg/hash_graph.hpp"
+#include "randomness.hpp"
+
+#include <random>
 
 using namespace google::protobuf;
 using namespace vg::io;
@@ -3562,6 +3565,133 @@ namespace vg {
             
             aligner.align_global_banded(aln, graph, 1, true);
         }
+    
+        TEST_CASE( "Banded global aligner gives the same alignments with every fill kernel",
+                  "[alignment][banded][mapping]" ) {
+            
+            default_random_engine generator(test_seed_source());
+            uniform_int_distribution<int> base_distr(0, 3);
+            uniform_int_distribution<int> qual_distr(0, 40);
+            uniform_real_distribution<double> prob_distr(0.0, 1.0);
+            
+            auto random_sequence = [&](size_t length) {
+                string seq;
+                for (size_t i = 0; i < length; i++) {
+                    seq.push_back("ACGT"[base_distr(generator)]);
+                }
+                return seq;
+            };
+            
+            banded_kernel::kernel_type original_kernel = banded_kernel::get_kernel();
+            
+            for (size_t trial = 0; trial < 100; trial++) {
+                
+                // alternate between graphs small enough for 8-bit matrices with unit scores
+                // and larger ones that need 16-bit matrices with the default scores
+                bool narrow = trial % 2 == 0;
+                
+                // make a random DAG with SNP, indel, and deletion bubbles along a backbone
+                bdsg::HashGraph graph;
+                size_t backbone_length = narrow ? 8 : 30;
+                uniform_int_distribution<size_t> length_distr(1, narrow ? 6 : 12);
+                vector<handle_t> backbone;
+                for (size_t i = 0; i < backbone_length; i++) {
+                    backbone.push_back(graph.create_handle(random_sequence(length_distr(generator))));
+                    if (i != 0) {
+                        graph.create_edge(backbone[i - 1], backbone[i]);
+                    }
+                }
+                for (size_t i = 1; i + 1 < backbone_length; i++) {
+                    double p = prob_distr(generator);
+                    if (p < 0.3) {
+                        handle_t alt = graph.create_handle(random_sequence(length_distr(generator)));
+                        graph.create_edge(backbone[i - 1], alt);
+                        graph.create_edge(alt, backbone[i + 1]);
+                    }
+                    else if (p < 0.4) {
+                        graph.create_edge(backbone[i - 1], backbone[i + 1]);
+                    }
+                }
+                
+                // sample a read from a random walk, with some errors
+                string walk;
+                handle_t here = backbone.front();
+                while (true) {
+                    walk += graph.get_sequence(here);
+                    vector<handle_t> nexts;
+                    graph.follow_edges(here, false, [&](const handle_t& next) {
+                        nexts.push_back(next);
+                    });
+                    if (nexts.empty()) {
+                        break;
+                    }
+                    here = nexts[uniform_int_distribution<size_t>(0, nexts.size() - 1)(generator)];
+                }
+                string read;
+                for (char base : walk) {
+                    double p = prob_distr(generator);
+                    if (p < 0.05) {
+                        read.push_back("ACGT"[base_distr(generator)]);
+                    }
+                    else if (p < 0.08) {
+                        continue;
+                    }
+                    else if (p < 0.11) {
+                        read.push_back(base);
+                        read.push_back("ACGT"[base_distr(generator)]);
+                    }
+                    else {
+                        read.push_back(base);
+                    }
+                }
+                if (read.empty()) {
+                    read = "A";
+                }
+                string quality;
+                for (size_t i = 0; i < read.size(); i++) {
+                    quality.push_back((char) qual_distr(generator));
+                }
+                
+                TestAligner aligner_source;
+                if (narrow) {
+                    aligner_source.set_alignment_scores(1, 1, 1, 1, 0);
+                }
+                
+                for (bool qual_adjusted : {false, true}) {
+                    
+                    vector<string> results;
+                    for (auto kernel : {banded_kernel::kernel_scalar, banded_kernel::kernel_sse41}) {
+                        if (!banded_kernel::supported(kernel)) {
+                            continue;
+                        }
+                        banded_kernel::set_kernel(kernel);
+                        
+                        Alignment aln;
+                        aln.set_sequence(read);
+                        aln.set_quality(quality);
+                        vector<Alignment> alt_alns;
+                        if (qual_adjusted) {
+                            aligner_source.get_qual_adj_aligner()->align_global_banded_multi(aln, alt_alns, graph, 5, 1, true);
+                        }
+                        else {
+                            aligner_source.get_regular_aligner()->align_global_banded_multi(aln, alt_alns, graph, 5, 1, true);
+                        }
+                        
+                        string result = pb2json(aln);
+                        for (const Alignment& alt_aln : alt_alns) {
+                            result += pb2json(alt_aln);
+                        }
+                        results.push_back(result);
+                    }
+                    
+                    for (size_t i = 1; i < results.size(); i++) {
+                        REQUIRE(results[i] == results.front());
+                    }
+                }
+            }
+            
+            banded_kernel::set_kernel(original_kernel);
+        }
     }
 }
 
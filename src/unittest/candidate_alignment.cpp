@@ -0,0 +1,193 @@
+/// \file candidate_alignment.cpp
+///
+/// unit tests for candidate alignments and their output formats
+
+#include <iostream>
+#include <sstream>
+#include "vg/io/json2pb.h"
+#include <vg/vg.pb.h>
+#include "../candidate_alignment.hpp"
+#include "../alignment.hpp"
+#include "../annotation.hpp"
+#include "bdsg/hash_graph.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+
+/// Make sure that writing GAF from a candidate gives the same line as writing
+/// the Alignment we would make from it, whatever the last candidate written
+/// on this thread left behind.
+static void require_same_gaf(const HandleGraph& graph, const string& aln_json,
+                             const string* prev_name = nullptr, const string* next_name = nullptr) {
+    Alignment aln;
+    json2pb(aln, aln_json.c_str(), aln_json.size());
+
+    // Split the alignment into the read and the candidate
+    CandidateAlignment candidate;
+    from_proto_path(aln.path(), candidate.path);
+    candidate.score = aln.score();
+    candidate.identity = aln.identity();
+    candidate.mapping_quality = aln.mapping_quality();
+    Alignment read = aln;
+    read.clear_path();
+    read.set_score(0);
+    read.set_mapping_quality(0);
+
+    Alignment converted = candidate_to_alignment(read, candidate);
+    if (prev_name) {
+        converted.mutable_fragment_prev()->set_name(*prev_name);
+    }
+    if (next_name) {
+        converted.mutable_fragment_next()->set_name(*next_name);
+    }
+
+    stringstream expected;
+    expected << vg::io::alignment_to_gaf(graph, converted);
+
+    stringstream found;
+    candidate_to_gaf(found, graph, read, candidate, prev_name, next_name);
+
+    REQUIRE(found.str() == expected.str());
+}
+
+TEST_CASE("Candidate alignments convert to the same Alignment", "[giraffe][candidate]") {
+
+    Alignment read;
+    read.set_name("read");
+    read.set_sequence("GATT");
+    read.set_score(5);
+    read.mutable_path()->add_mapping()->mutable_position()->set_node_id(9);
+    set_annotation(read, "from_read", true);
+
+    CandidateAlignment candidate;
+    candidate.path.add_mapping()->mutable_position()->set_node_id(1);
+    edit_t* edit = candidate.path.mutable_mapping(0)->add_edit();
+    edit->set_from_length(4);
+    edit->set_to_length(4);
+    candidate.score = 4;
+    candidate.mapping_quality = 60;
+    candidate.is_secondary = true;
+    set_annotation(candidate, "from_candidate", 0.5);
+    set_annotation(candidate, "from_candidate", 1.0);
+    set_annotation(candidate, "flag", true);
+    set_annotation(candidate, "text", string("words"));
+    set_annotation(candidate, "list", vector<double>{1.0, 2.0});
+
+    // Setting an annotation again replaces it
+    REQUIRE(candidate.number_annotations.size() == 1);
+
+    Alignment converted = candidate_to_alignment(read, candidate);
+
+    REQUIRE(converted.name() == "read");
+    REQUIRE(converted.sequence() == "GATT");
+    REQUIRE(converted.path().mapping_size() == 1);
+    REQUIRE(converted.path().mapping(0).position().node_id() == 1);
+    REQUIRE(converted.path().mapping(0).edit(0).from_length() == 4);
+    REQUIRE(converted.score() == 4);
+    REQUIRE(converted.mapping_quality() == 60);
+    REQUIRE(converted.is_secondary());
+    REQUIRE(get_annotation<bool>(converted, "from_read") == true);
+    REQUIRE(get_annotation<double>(converted, "from_candidate") == 1.0);
+    REQUIRE(get_annotation<bool>(converted, "flag") == true);
+    REQUIRE(get_annotation<string>(converted, "text") == "words");
+    REQUIRE(get_annotation<vector<double>>(converted, "list") == vector<double>{1.0, 2.0});
+}
+
+TEST_CASE("Candidate alignments write the same GAF as Alignments", "[giraffe][candidate][gaf]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATTACA", 1);
+    handle_t h2 = graph.create_handle("CATTAG", 2);
+    handle_t h3 = graph.create_handle("AAGG", 3);
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, h3);
+
+    SECTION("Matches across several nodes") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "TTACACATTAGAA", "score": 13, "mapping_quality": 60, "path": {"mapping": [
+            {"position": {"node_id": 1, "offset": 2}, "edit": [{"from_length": 5, "to_length": 5}]},
+            {"position": {"node_id": 2}, "edit": [{"from_length": 6, "to_length": 6}]},
+            {"position": {"node_id": 3}, "edit": [{"from_length": 2, "to_length": 2}]}
+        ]}})");
+    }
+
+    SECTION("A substitution") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "TTACACAGTAGAA", "score": 8, "mapping_quality": 12, "path": {"mapping": [
+            {"position": {"node_id": 1, "offset": 2}, "edit": [{"from_length": 5, "to_length": 5}]},
+            {"position": {"node_id": 2}, "edit": [{"from_length": 2, "to_length": 2}, {"from_length": 1, "to_length": 1, "sequence": "G"}, {"from_length": 3, "to_length": 3}]},
+            {"position": {"node_id": 3}, "edit": [{"from_length": 2, "to_length": 2}]}
+        ]}})");
+    }
+
+    SECTION("An insertion and a deletion") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "GATTCCACAT", "score": 1, "path": {"mapping": [
+            {"position": {"node_id": 1}, "edit": [{"from_length": 4, "to_length": 4}, {"to_length": 2, "sequence": "CC"}, {"from_length": 2}, {"from_length": 1, "to_length": 1}]},
+            {"position": {"node_id": 2}, "edit": [{"from_length": 3, "to_length": 3}]}
+        ]}})");
+    }
+
+    SECTION("Soft clips") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "NNATTATT", "score": 4, "path": {"mapping": [
+            {"position": {"node_id": 2, "offset": 1}, "edit": [{"to_length": 2, "sequence": "NN"}, {"from_length": 4, "to_length": 4}, {"to_length": 2, "sequence": "TT"}]}
+        ]}})");
+    }
+
+    SECTION("The reverse strand") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "CCTTCTAATG", "score": 10, "path": {"mapping": [
+            {"position": {"node_id": 3, "is_reverse": true}, "edit": [{"from_length": 4, "to_length": 4}]},
+            {"position": {"node_id": 2, "is_reverse": true}, "edit": [{"from_length": 6, "to_length": 6}]}
+        ]}})");
+    }
+
+    SECTION("Skipped parts of nodes") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "GATTT", "path": {"mapping": [
+            {"position": {"node_id": 1}, "edit": [{"from_length": 3, "to_length": 3}]},
+            {"position": {"node_id": 2, "offset": 2}, "edit": [{"from_length": 2, "to_length": 2}]}
+        ]}})");
+    }
+
+    SECTION("Several mappings on one node") {
+        require_same_gaf(graph, R"({"name": "read", "sequence": "GATTACA", "score": 7, "path": {"mapping": [
+            {"position": {"node_id": 1}, "edit": [{"from_length": 3, "to_length": 3}]},
+            {"position": {"node_id": 1, "offset": 3}, "edit": [{"from_length": 4, "to_length": 4}]}
+        ]}})");
+    }
+
+    SECTION("Base qualities") {
+        Alignment aln;
+        aln.set_name("read");
+        aln.set_sequence("GATT");
+        aln.set_quality(string({30, 30, 20, 10}));
+        aln.set_score(4);
+        Mapping* mapping = aln.mutable_path()->add_mapping();
+        mapping->mutable_position()->set_node_id(1);
+        Edit* edit = mapping->add_edit();
+        edit->set_from_length(4);
+        edit->set_to_length(4);
+
+        require_same_gaf(graph, pb2json(aln));
+    }
+
+    SECTION("An unmapped read") {
+        Alignment aln;
+        aln.set_name("read");
+        aln.set_sequence("GATT");
+        aln.set_quality(string({30, 30, 20, 10}));
+
+        require_same_gaf(graph, pb2json(aln));
+    }
+
+    SECTION("Pair partners") {
+        string aln_json = R"({"name": "read/1", "sequence": "TTACA", "score": 5, "mapping_quality": 30, "path": {"mapping": [
+            {"position": {"node_id": 1, "offset": 2}, "edit": [{"from_length": 5, "to_length": 5}]}
+        ]}})";
+        string prev_name = "read/0";
+        string next_name = "read/2";
+
+        require_same_gaf(graph, aln_json, &prev_name, nullptr);
+        require_same_gaf(graph, aln_json, nullptr, &next_name);
+    }
+}
+
+}
+}
@@ -0,0 +1,130 @@
+/// \file fastq_reader.cpp
+///
+/// unit tests for the background FASTQ reader
+///
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <random>
+#include <vg/vg.pb.h>
+#include "../fastq_reader.hpp"
+#include "../alignment.hpp"
+#include "../utility.hpp"
+#include "randomness.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("FastqReader produces the same records as the sequential FASTQ parser", "[fastq][alignment]") {
+
+    default_random_engine generator(test_seed_source());
+    uniform_int_distribution<int> base_distr(0, 3);
+    uniform_int_distribution<int> qual_distr(2, 40);
+
+    // Write enough records to span several decompression chunks and batches.
+    string fastq_filename = temp_file::create();
+    {
+        ofstream out(fastq_filename);
+        for (size_t i = 0; i < 30000; i++) {
+            out << "@read" << i;
+            if (i % 3 == 0) {
+                out << " comment that should be dropped";
+            }
+            out << "\n";
+            for (size_t j = 0; j < 100; j++) {
+                out << "ACGT"[base_distr(generator)];
+            }
+            out << "\n+\n";
+            for (size_t j = 0; j < 100; j++) {
+                out << (char) (33 + qual_distr(generator));
+            }
+            out << "\n";
+        }
+    }
+
+    vector<Alignment> expected;
+    fastq_unpaired_for_each(fastq_filename, [&](Alignment& aln) {
+        expected.push_back(aln);
+    });
+    REQUIRE(expected.size() == 30000);
+
+    for (size_t reader_threads : {1, 4}) {
+        FastqReader reader(fastq_filename, reader_threads);
+        Alignment aln;
+        size_t i = 0;
+        while (reader.get_next_alignment(aln)) {
+            REQUIRE(i < expected.size());
+            REQUIRE(aln.name() == expected[i].name());
+            REQUIRE(aln.sequence() == expected[i].sequence());
+            REQUIRE(aln.quality() == expected[i].quality());
+            i++;
+        }
+        REQUIRE(i == expected.size());
+    }
+
+    temp_file::remove(fastq_filename);
+}
+
+TEST_CASE("FastqReader reads FASTA records without a trailing newline", "[fastq][alignment]") {
+
+    string fasta_filename = temp_file::create();
+    {
+        ofstream out(fasta_filename);
+        out << ">first desc\nGATTACA\n>second\nCATTAG";
+    }
+
+    FastqReader reader(fasta_filename);
+    Alignment aln;
+    REQUIRE(reader.get_next_alignment(aln));
+    REQUIRE(aln.name() == "first");
+    REQUIRE(aln.sequence() == "GATTACA");
+    REQUIRE(aln.quality().empty());
+    REQUIRE(reader.get_next_alignment(aln));
+    REQUIRE(aln.name() == "second");
+    REQUIRE(aln.sequence() == "CATTAG");
+    REQUIRE(!reader.get_next_alignment(aln));
+
+    temp_file::remove(fasta_filename);
+}
+
+TEST_CASE("FastqReader reads a pair of files as interleaved mates", "[fastq][alignment]") {
+
+    // Write more pairs than fit in one batch, with mate 2 missing a partner
+    // at the end.
+    string fastq_filename_1 = temp_file::create();
+    string fastq_filename_2 = temp_file::create();
+    {
+        ofstream out1(fastq_filename_1);
+        ofstream out2(fastq_filename_2);
+        for (size_t i = 0; i < 1000; i++) {
+            out1 << "@pair" << i << "/1\nGATTACA\n+\nIIIIIII\n";
+            out2 << "@pair" << i << "/2\nCATTAG\n+\nIIIIII\n";
+        }
+        out2 << "@extra/2\nCATTAG\n+\nIIIIII\n";
+    }
+
+    for (size_t reader_threads : {1, 2, 3}) {
+        FastqReader reader(fastq_filename_1, fastq_filename_2, reader_threads);
+        Alignment mate1;
+        Alignment mate2;
+        size_t i = 0;
+        while (reader.get_next_alignment(mate1)) {
+            REQUIRE(reader.get_next_alignment(mate2));
+            REQUIRE(mate1.name() == "pair" + to_string(i) + "/1");
+            REQUIRE(mate1.sequence() == "GATTACA");
+            REQUIRE(mate2.name() == "pair" + to_string(i) + "/2");
+            REQUIRE(mate2.sequence() == "CATTAG");
+            i++;
+        }
+        REQUIRE(i == 1000);
+    }
+
+    temp_file::remove(fastq_filename_1);
+    temp_file::remove(fastq_filename_2);
+}
+
+}
+}
@@ -10,7 +10,9 @@
 
 #include "catch.hpp"
 
+#include <limits>
 #include <map>
+#include <random>
 #include <unordered_set>
 #include <vector>
 
@@ -185,6 +187,13 @@ void paths_match(const Path& path, const Path& correct_path) {
     }
 }
 
+// Convert the extension to a path_t, and then to a Path for comparison.
+Path path_t_as_path(const GaplessExtension& extension, const HandleGraph& graph, const std::string& read) {
+    Path result;
+    to_proto_path(extension.to_path_t(graph, read), result);
+    return result;
+}
+
 void full_length_match(const std::vector<std::pair<pos_t, size_t>>& seeds, const std::string& read, const std::vector<std::pair<pos_t, std::string>>& correct_alignment, const GaplessExtender& extender, size_t error_bound, bool check_seeds) {
     GaplessExtender::cluster_type cluster;
     for (auto seed : seeds) {
@@ -206,6 +215,7 @@ void full_length_match(const std::vector<std::pair<pos_t, size_t>>& seeds, const
         REQUIRE(result.front().mismatches() <= error_bound);
         correct_score(result.front(), *(extender.aligner));
         paths_match(result.front().to_path(*(extender.graph), read), get_path(correct_alignment));
+        paths_match(path_t_as_path(result.front(), *(extender.graph), read), get_path(correct_alignment));
 
         // This extension should contain all the seeds. Check that contains() works correctly.
         if (check_seeds) {
@@ -230,6 +240,7 @@ void full_length_matches(const std::vector<std::pair<pos_t, size_t>>& seeds, con
         REQUIRE(result[i].mismatches() <= error_bound);
         correct_score(result[i], *(extender.aligner));
         paths_match(result[i].to_path(*(extender.graph), read), get_path(correct_alignments[i]));
+        paths_match(path_t_as_path(result[i], *(extender.graph), read), get_path(correct_alignments[i]));
     }
 }
 
@@ -249,6 +260,7 @@ void partial_matches(const std::vector<std::pair<pos_t, size_t>>& seeds, const s
         REQUIRE(result[i].read_interval.first == correct_offsets[i]);
         correct_score(result.front(), *(extender.aligner));
         paths_match(result[i].to_path(*(extender.graph), read), get_path(correct_extensions[i]));
+        paths_match(path_t_as_path(result[i], *(extender.graph), read), get_path(correct_extensions[i]));
     }
 }
 
@@ -1025,5 +1037,44 @@ TEST_CASE("Alignment transformations", "[gapless_extender]") {
 
 //------------------------------------------------------------------------------
 
+TEST_CASE("Sequence comparison kernels agree with the scalar kernel", "[gapless_extender]") {
+    std::mt19937 rng(12345);
+    std::vector<gapless_kernel::kernel_type> kernels = { gapless_kernel::kernel_sse, gapless_kernel::kernel_avx2 };
+    for (gapless_kernel::kernel_type kernel : kernels) {
+        if (!gapless_kernel::supported(kernel)) {
+            continue;
+        }
+        SECTION(std::string("Kernel ") + gapless_kernel::name(kernel)) {
+            for (size_t iteration = 0; iteration < 10000; iteration++) {
+                size_t length = rng() % 150;
+                std::string read(length, 'A');
+                for (char& c : read) {
+                    c = "ACGT"[rng() % 4];
+                }
+                std::string node = read;
+                size_t edits = rng() % 8;
+                for (size_t i = 0; length > 0 && i < edits; i++) {
+                    node[rng() % length] = "ACGTX"[rng() % 5];
+                }
+                size_t budget = (rng() % 4 == 0 ? std::numeric_limits<size_t>::max() : rng() % 5);
+
+                uint32_t expected_mismatches = 0, mismatches = 0;
+                size_t expected = gapless_kernel::scan_forward(gapless_kernel::kernel_scalar, read.data(), node.data(), length, budget, expected_mismatches);
+                size_t result = gapless_kernel::scan_forward(kernel, read.data(), node.data(), length, budget, mismatches);
+                REQUIRE(result == expected);
+                REQUIRE(mismatches == expected_mismatches);
+
+                expected_mismatches = 0; mismatches = 0;
+                expected = gapless_kernel::scan_backward(gapless_kernel::kernel_scalar, read.data() + length, node.data() + length, length, budget, expected_mismatches);
+                result = gapless_kernel::scan_backward(kernel, read.data() + length, node.data() + length, length, budget, mismatches);
+                REQUIRE(result == expected);
+                REQUIRE(mismatches == expected_mismatches);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
 }
 }
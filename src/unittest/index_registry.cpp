@@ -3,7 +3,13 @@
 /// unit tests for the vg-file-backed handle graph implementation
 
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <omp.h>
 #include "../index_registry.hpp"
+#include "../utility.hpp"
 #include "catch.hpp"
 
 namespace vg {
@@ -215,5 +221,116 @@ TEST_CASE("IndexRegistry can make plans on a dummy recipe graph", "[indexregistr
     }
 }
 
+
+TEST_CASE("IndexRegistry runs independent recipes concurrently", "[indexregistry]") {
+    
+    TestIndexRegistry registry;
+    
+    registry.register_index("FASTA", "fasta");
+    registry.register_index("VG", "vg");
+    registry.register_index("XG", "xg");
+    registry.register_index("GBWT", "gbwt");
+    registry.register_index("GCSA+LCP", "gcsa_lcp");
+    
+    // XG and GBWT wait a while for each other to start, which they can only
+    // both do if they are running at the same time
+    atomic<int> started(0);
+    atomic<bool> overlapped(true);
+    auto wait_for_partner = [&]() {
+        started++;
+        auto start = chrono::steady_clock::now();
+        while (started.load() < 2) {
+            if (chrono::steady_clock::now() - start > chrono::seconds(10)) {
+                overlapped = false;
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    };
+    atomic<bool> dependencies_done(false);
+    bool ran_in_order = false;
+    
+    registry.register_recipe("VG", {"FASTA"},
+                             [&] (const vector<const IndexFile*>& inputs,
+                                  const string& prefix,
+                                  const string& suffix) {
+        return vector<string>(1, "vg-file");
+    });
+    registry.register_recipe("XG", {"VG"},
+                             [&] (const vector<const IndexFile*>& inputs,
+                                  const string& prefix,
+                                  const string& suffix) {
+        wait_for_partner();
+        return vector<string>(1, "xg-file");
+    });
+    registry.register_recipe("GBWT", {"VG"},
+                             [&] (const vector<const IndexFile*>& inputs,
+                                  const string& prefix,
+                                  const string& suffix) {
+        wait_for_partner();
+        dependencies_done = true;
+        return vector<string>(1, "gbwt-file");
+    });
+    registry.register_recipe("GCSA+LCP", {"XG", "GBWT"},
+                             [&] (const vector<const IndexFile*>& inputs,
+                                  const string& prefix,
+                                  const string& suffix) {
+        ran_in_order = dependencies_done.load() && started.load() == 2;
+        return vector<string>{"gcsa-file", "lcp-file"};
+    });
+    
+    registry.provide("FASTA", "fasta-name");
+    
+    int original_threads = omp_get_max_threads();
+    omp_set_num_threads(2);
+    registry.make_indexes({"GCSA+LCP"});
+    omp_set_num_threads(original_threads);
+    
+    REQUIRE(overlapped);
+    REQUIRE(ran_in_order);
+    REQUIRE(registry.get_index("GCSA+LCP")->get_filenames().size() == 2);
+    
+    auto& runs = registry.get_recipe_runs();
+    REQUIRE(runs.size() == 4);
+    REQUIRE(runs.front().identifier == "VG");
+    REQUIRE(runs.back().identifier == "GCSA+LCP");
+    REQUIRE(runs.front().threads == 2);
+    REQUIRE(runs[1].threads == 1);
+    REQUIRE(runs[2].threads == 1);
+}
+
+TEST_CASE("IndexRegistry estimates recipe memory from the input sizes on disk", "[indexregistry]") {
+    
+    TestIndexRegistry registry;
+    
+    registry.register_index("FASTA", "fasta");
+    registry.register_index("VCF", "vcf");
+    registry.register_index("VG", "vg");
+    
+    registry.register_recipe("VG", {"FASTA", "VCF"},
+                             [&] (const vector<const IndexFile*>& inputs,
+                                  const string& prefix,
+                                  const string& suffix) {
+        return vector<string>(1, "vg-file");
+    });
+    
+    string fasta_name = temp_file::create();
+    string vcf_name = temp_file::create();
+    {
+        ofstream fasta_out(fasta_name);
+        fasta_out << string(1000, 'A');
+        ofstream vcf_out(vcf_name);
+        vcf_out << string(234, 'C');
+    }
+    
+    registry.provide("FASTA", fasta_name);
+    registry.provide("VCF", vcf_name);
+    
+    REQUIRE(registry.get_index("VG")->estimate_memory(0) == 1234);
+    
+    temp_file::remove(fasta_name);
+    temp_file::remove(vcf_name);
+}
+
 }
 }
@@ -0,0 +1,66 @@
+/**
+ * \file
+ * unittest/kmer.cpp: test cases for kmer enumeration for GCSA2.
+ */
+
+#include "catch.hpp"
+
+#include "random_graph.hpp"
+
+#include "../source_sink_overlay.hpp"
+#include "../kmer.hpp"
+#include "../vg.hpp"
+
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+
+using namespace std;
+
+/// Collect the KMers from the kmer_t-based enumeration.
+static multiset<tuple<uint64_t, uint64_t, uint64_t>> kmer_t_gcsa_kmers(const HandleGraph& graph, size_t k,
+                                                                       id_t head_id, id_t tail_id) {
+    const gcsa::Alphabet alpha;
+    multiset<tuple<uint64_t, uint64_t, uint64_t>> found;
+    for_each_kmer(graph, k, [&](const kmer_t& kmer) {
+        kmer_to_gcsa_kmers(kmer, alpha, [&](const gcsa::KMer& gcsa_kmer) {
+#pragma omp critical (found)
+            found.emplace(gcsa_kmer.key, gcsa_kmer.from, gcsa_kmer.to);
+        });
+    }, head_id, tail_id);
+    return found;
+}
+
+TEST_CASE("for_each_gcsa_kmer_batch agrees with kmer_t enumeration in random graphs", "[kmer][gcsa]") {
+
+    for (size_t trial = 0; trial < 100; trial++) {
+
+        VG random;
+        random_graph(100, 3, 30, &random);
+
+        id_t start_id = random.max_node_id() + 1;
+        id_t end_id = start_id + 1;
+        SourceSinkOverlay overlay(&random, 10, start_id, end_id);
+
+        for (size_t k : {1, 4, 16}) {
+            auto expected = kmer_t_gcsa_kmers(overlay, k, start_id, end_id);
+
+            multiset<tuple<uint64_t, uint64_t, uint64_t>> found;
+            for_each_gcsa_kmer_batch(overlay, k, 50, [&](vector<gcsa::KMer>& batch) {
+#pragma omp critical (found)
+                for (auto& gcsa_kmer : batch) {
+                    found.emplace(gcsa_kmer.key, gcsa_kmer.from, gcsa_kmer.to);
+                }
+            }, start_id, end_id);
+
+            REQUIRE(!found.empty());
+            REQUIRE(found == expected);
+        }
+    }
+}
+
+}
+}
@@ -3,6 +3,8 @@
 /// unit tests for the mapper
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include "vg/io/json2pb.h"
 #include <vg/vg.pb.h>
 #include <bdsg/hash_graph.hpp>
@@ -11,6 +13,8 @@
 #include "../build_index.hpp"
 #include "catch.hpp"
 #include "../algorithms/alignment_path_offsets.hpp"
+#include "random_graph.hpp"
+#include "randomness.hpp"
 
 namespace vg {
 namespace unittest {
@@ -654,5 +658,237 @@ TEST_CASE( "Mapper can walk paths from fan-out MEM algorithm", "[mapping][mapper
     delete lcpidx;
 }
 
+TEST_CASE( "GCSA jump table does not change MEMs", "[mapping][mapper][mem]" ) {
+    
+    bdsg::HashGraph graph;
+    random_graph(2000, 10, 40, &graph);
+    
+    // Configure GCSA temp directory to the system temp directory
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    // And make it quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    
+    // Build the GCSA index
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    // Build the xg index
+    xg::XG xg_index;
+    xg_index.from_path_handle_graph(graph);
+    
+    GCSAJumpTable built(*gcsaidx, 6);
+    REQUIRE(built.matches(*gcsaidx));
+    
+    // Round-trip the table through serialization
+    stringstream serialized;
+    built.serialize(serialized);
+    GCSAJumpTable jump_table;
+    jump_table.load(serialized);
+    REQUIRE(jump_table.max_length() == 6);
+    REQUIRE(jump_table.matches(*gcsaidx));
+    
+    Mapper plain_mapper(&xg_index, gcsaidx, lcpidx);
+    Mapper jumping_mapper(&xg_index, gcsaidx, lcpidx);
+    jumping_mapper.gcsa_jump_table = &jump_table;
+    
+    // Make reads from random walks through the graph, with some errors and Ns
+    vector<handle_t> handles;
+    graph.for_each_handle([&](const handle_t& h) {
+        handles.push_back(h);
+    });
+    default_random_engine generator(test_seed_source());
+    uniform_int_distribution<size_t> handle_distr(0, handles.size() - 1);
+    uniform_int_distribution<int> base_distr(0, 3);
+    uniform_int_distribution<int> error_distr(0, 29);
+    vector<string> reads;
+    for (size_t i = 0; i < 200; i++) {
+        string read;
+        handle_t here = handles[handle_distr(generator)];
+        if (base_distr(generator) % 2) {
+            here = graph.flip(here);
+        }
+        while (read.size() < 100) {
+            read += graph.get_sequence(here);
+            vector<handle_t> next;
+            graph.follow_edges(here, false, [&](const handle_t& h) {
+                next.push_back(h);
+            });
+            if (next.empty()) {
+                break;
+            }
+            here = next[base_distr(generator) % next.size()];
+        }
+        for (char& c : read) {
+            int roll = error_distr(generator);
+            if (roll == 0) {
+                c = "ACGT"[base_distr(generator)];
+            } else if (roll == 1 && i % 5 == 0) {
+                c = 'N';
+            }
+        }
+        reads.push_back(read);
+    }
+    
+    auto require_same = [](const vector<MaximalExactMatch>& expected, const vector<MaximalExactMatch>& observed) {
+        REQUIRE(observed.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            REQUIRE(observed[i].begin == expected[i].begin);
+            REQUIRE(observed[i].end == expected[i].end);
+            REQUIRE(observed[i].range == expected[i].range);
+            REQUIRE(observed[i].match_count == expected[i].match_count);
+            REQUIRE(observed[i].nodes == expected[i].nodes);
+        }
+    };
+    
+    for (auto& read : reads) {
+        for (int max_mem_length : {0, 4, 20}) {
+            require_same(plain_mapper.find_mems_simple(read.begin(), read.end(), max_mem_length, 1, 0),
+                         jumping_mapper.find_mems_simple(read.begin(), read.end(), max_mem_length, 1, 0));
+            
+            double plain_lcp, plain_filtered, jumping_lcp, jumping_filtered;
+            require_same(plain_mapper.find_mems_deep(read.begin(), read.end(), plain_lcp, plain_filtered,
+                                                     max_mem_length, 8, 16),
+                         jumping_mapper.find_mems_deep(read.begin(), read.end(), jumping_lcp, jumping_filtered,
+                                                       max_mem_length, 8, 16));
+            
+            // This is how single-end vg map searches, recording the max LCP
+            plain_lcp = 0;
+            jumping_lcp = 0;
+            require_same(plain_mapper.find_mems_deep(read.begin(), read.end(), plain_lcp, plain_filtered,
+                                                     max_mem_length, 8, 16, false, true, true, true),
+                         jumping_mapper.find_mems_deep(read.begin(), read.end(), jumping_lcp, jumping_filtered,
+                                                       max_mem_length, 8, 16, false, true, true, true));
+            REQUIRE(jumping_lcp == plain_lcp);
+        }
+    }
+    
+    delete gcsaidx;
+    delete lcpidx;
+}
+
+/// A jump table whose ranges can be overwritten, to see if anyone looks at them.
+class TamperedJumpTable : public GCSAJumpTable {
+public:
+    using GCSAJumpTable::GCSAJumpTable;
+    
+    void set_all_ranges(const gcsa::range_type& range) {
+        for (auto& r : ranges) {
+            r = range;
+        }
+    }
+};
+
+TEST_CASE( "GCSA jump table is used when recording the max LCP", "[mapping][mapper][mem]" ) {
+    
+    bdsg::HashGraph graph;
+    random_graph(2000, 10, 40, &graph);
+    
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    xg::XG xg_index;
+    xg_index.from_path_handle_graph(graph);
+    
+    // Claim that every k-mer matches everywhere. Stepping would never reach
+    // that state, so the MEMs change if and only if the table is used.
+    TamperedJumpTable jump_table(*gcsaidx, 6);
+    jump_table.set_all_ranges(gcsa::range_type(0, gcsaidx->size() - 1));
+    
+    Mapper plain_mapper(&xg_index, gcsaidx, lcpidx);
+    Mapper jumping_mapper(&xg_index, gcsaidx, lcpidx);
+    jumping_mapper.gcsa_jump_table = &jump_table;
+    
+    // Take a read from the graph
+    string read;
+    graph.for_each_handle([&](const handle_t& h) {
+        if (read.size() < 100) {
+            read += graph.get_sequence(h);
+        }
+    });
+    read.resize(min<size_t>(read.size(), 100));
+    
+    double plain_lcp, plain_filtered, jumping_lcp, jumping_filtered;
+    auto plain_mems = plain_mapper.find_mems_deep(read.begin(), read.end(), plain_lcp, plain_filtered,
+                                                  0, 8, 16, false, true, true, true);
+    auto jumping_mems = jumping_mapper.find_mems_deep(read.begin(), read.end(), jumping_lcp, jumping_filtered,
+                                                      0, 8, 16, false, true, true, true);
+    
+    bool same = plain_mems.size() == jumping_mems.size();
+    for (size_t i = 0; same && i < plain_mems.size(); i++) {
+        same = (plain_mems[i].begin == jumping_mems[i].begin && plain_mems[i].end == jumping_mems[i].end
+                && plain_mems[i].range == jumping_mems[i].range);
+    }
+    REQUIRE(!same);
+    
+    delete gcsaidx;
+    delete lcpidx;
+}
+
+TEST_CASE( "Unusable GCSA jump table files are ignored", "[mapping][mapper][mem]" ) {
+    
+    bdsg::HashGraph graph;
+    random_graph(2000, 10, 40, &graph);
+    
+    gcsa::TempFile::setDirectory(temp_file::get_dir());
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 3);
+    
+    string gcsa_name = temp_file::create();
+    string jump_table_name = gcsa_name + ".jmp";
+    
+    SECTION( "A table built from the GCSA is loaded" ) {
+        GCSAJumpTable jump_table(*gcsaidx, 6);
+        ofstream out(jump_table_name, ios::binary);
+        jump_table.serialize(out);
+        out.close();
+        
+        REQUIRE(load_gcsa_jump_table(gcsa_name, *gcsaidx) != nullptr);
+    }
+    
+    SECTION( "A truncated table is not loaded" ) {
+        GCSAJumpTable jump_table(*gcsaidx, 6);
+        stringstream serialized;
+        jump_table.serialize(serialized);
+        string truncated = serialized.str().substr(0, serialized.str().size() / 2);
+        ofstream out(jump_table_name, ios::binary);
+        out << truncated;
+        out.close();
+        
+        REQUIRE(load_gcsa_jump_table(gcsa_name, *gcsaidx) == nullptr);
+    }
+    
+    SECTION( "A file that is not a table is not loaded" ) {
+        ofstream out(jump_table_name, ios::binary);
+        out << "not a jump table";
+        out.close();
+        
+        REQUIRE(load_gcsa_jump_table(gcsa_name, *gcsaidx) == nullptr);
+    }
+    
+    SECTION( "A table with the wrong ranges is not loaded" ) {
+        TamperedJumpTable jump_table(*gcsaidx, 6);
+        jump_table.set_all_ranges(gcsa::range_type(0, gcsaidx->size() - 1));
+        ofstream out(jump_table_name, ios::binary);
+        jump_table.serialize(out);
+        out.close();
+        
+        REQUIRE(load_gcsa_jump_table(gcsa_name, *gcsaidx) == nullptr);
+    }
+    
+    temp_file::remove(jump_table_name);
+    temp_file::remove(gcsa_name);
+    
+    delete gcsaidx;
+    delete lcpidx;
+}
+
 }
 }
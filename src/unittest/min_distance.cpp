@@ -11,6 +11,7 @@
 #include "../position.hpp"
 #include "../min_distance.hpp"
 #include "../genotypekit.hpp"
+#include "../utility.hpp"
 #include "random_graph.hpp"
 #include "randomness.hpp"
 #include <fstream>
@@ -224,6 +225,143 @@ int64_t min_distance(VG* graph, pos_t pos1, pos_t pos2){
 
     }//End test case
 
+    TEST_CASE( "Distance index can be loaded from a stream or mapped in place",
+                   "[min_dist][serial]" ) {
+        VG graph;
+
+        Node* n1 = graph.create_node("GCA");
+        Node* n2 = graph.create_node("T");
+        Node* n3 = graph.create_node("G");
+        Node* n4 = graph.create_node("CTGA");
+        Node* n5 = graph.create_node("GCA");
+        Node* n6 = graph.create_node("T");
+        Node* n7 = graph.create_node("G");
+        Node* n8 = graph.create_node("CTGA");
+
+        Edge* e1 = graph.create_edge(n1, n2);
+        Edge* e2 = graph.create_edge(n1, n8);
+        Edge* e3 = graph.create_edge(n2, n3);
+        Edge* e4 = graph.create_edge(n2, n6);
+        Edge* e5 = graph.create_edge(n3, n4);
+        Edge* e6 = graph.create_edge(n3, n5);
+        Edge* e7 = graph.create_edge(n4, n5);
+        Edge* e8 = graph.create_edge(n5, n7);
+        Edge* e9 = graph.create_edge(n6, n7);
+        Edge* e10 = graph.create_edge(n7, n8);
+
+        CactusSnarlFinder bubble_finder(graph);
+        SnarlManager snarl_manager = bubble_finder.find_snarls(); 
+
+        MinimumDistanceIndex di (&graph, &snarl_manager, 20);
+
+        string filename = temp_file::create();
+        {
+            ofstream out(filename);
+            di.serialize(out);
+        }
+
+        ifstream in(filename);
+        MinimumDistanceIndex streamed (in);
+        in.close();
+
+        MinimumDistanceIndex mapped;
+        REQUIRE(mapped.load_mapped(filename));
+
+        for (id_t id1 = 1; id1 <= 8; id1++) {
+            for (id_t id2 = 1; id2 <= 8; id2++) {
+                for (bool rev : {false, true}) {
+                    pos_t pos1 = make_pos_t(id1, false, 0);
+                    pos_t pos2 = make_pos_t(id2, rev, 0);
+                    int64_t distance = di.min_distance(pos1, pos2);
+                    REQUIRE(streamed.min_distance(pos1, pos2) == distance);
+                    REQUIRE(mapped.min_distance(pos1, pos2) == distance);
+                    REQUIRE(mapped.max_distance(pos1, pos2) == di.max_distance(pos1, pos2));
+                }
+            }
+            REQUIRE(mapped.into_which_snarl(id1, false) == di.into_which_snarl(id1, false));
+            REQUIRE(mapped.get_connected_component(id1) == di.get_connected_component(id1));
+        }
+
+        temp_file::remove(filename);
+    }//End test case
+
+    TEST_CASE( "Distance index answers batches of queries like single queries",
+                   "[min_dist]" ) {
+        VG graph;
+
+        Node* n1 = graph.create_node("GCA");
+        Node* n2 = graph.create_node("T");
+        Node* n3 = graph.create_node("G");
+        Node* n4 = graph.create_node("CTGA");
+        Node* n5 = graph.create_node("GCA");
+        Node* n6 = graph.create_node("T");
+        Node* n7 = graph.create_node("G");
+        Node* n8 = graph.create_node("CTGA");
+//Disconnected
+        Node* n9 = graph.create_node("T");
+        Node* n10 = graph.create_node("G");
+        Node* n11 = graph.create_node("CTGA");
+
+        Edge* e1 = graph.create_edge(n1, n2);
+        Edge* e2 = graph.create_edge(n1, n8);
+        Edge* e3 = graph.create_edge(n2, n3);
+        Edge* e4 = graph.create_edge(n2, n6);
+        Edge* e5 = graph.create_edge(n3, n4);
+        Edge* e6 = graph.create_edge(n3, n5);
+        Edge* e7 = graph.create_edge(n4, n5);
+        Edge* e8 = graph.create_edge(n5, n7);
+        Edge* e9 = graph.create_edge(n6, n7);
+        Edge* e10 = graph.create_edge(n7, n8);
+
+        Edge* e11 = graph.create_edge(n9, n10);
+        Edge* e12 = graph.create_edge(n9, n11);
+        Edge* e13 = graph.create_edge(n10, n11);
+
+        CactusSnarlFinder bubble_finder(graph);
+        SnarlManager snarl_manager = bubble_finder.find_snarls(); 
+
+        MinimumDistanceIndex di (&graph, &snarl_manager);
+
+        //Ask about every pair, out of order, so the batch has to sort them
+        vector<pair<pos_t, pos_t>> queries;
+        for (id_t id1 = 11; id1 >= 1; id1--) {
+            for (id_t id2 = 1; id2 <= 11; id2++) {
+                for (bool rev : {false, true}) {
+                    queries.emplace_back(make_pos_t(id1, rev, 0), make_pos_t(id2, false, 0));
+                    queries.emplace_back(make_pos_t(id2, false, 0), make_pos_t(id1, rev, 0));
+                }
+            }
+        }
+
+        vector<int64_t> distances = di.min_distance(queries);
+        REQUIRE(distances.size() == queries.size());
+        for (size_t i = 0 ; i < queries.size() ; i++) {
+            REQUIRE(distances[i] == di.min_distance(queries[i].first, queries[i].second));
+        }
+        REQUIRE(di.min_distance(make_pos_t(1, false, 0), make_pos_t(9, false, 0)) == -1);
+        REQUIRE(di.min_distance(vector<pair<pos_t, pos_t>>()).empty());
+
+        //Positions and ancestors that repeat within a batch are looked up
+        //once, so ask about the same pairs twice
+        vector<pair<pos_t, pos_t>> known;
+        vector<int64_t> expected;
+        for (size_t repeat = 0 ; repeat < 2 ; repeat++) {
+            known.emplace_back(make_pos_t(1, false, 0), make_pos_t(2, false, 0));
+            expected.push_back(3);
+            known.emplace_back(make_pos_t(1, false, 0), make_pos_t(8, false, 0));
+            expected.push_back(3);
+            known.emplace_back(make_pos_t(1, false, 0), make_pos_t(6, false, 0));
+            expected.push_back(4);
+            known.emplace_back(make_pos_t(2, false, 0), make_pos_t(6, false, 0));
+            expected.push_back(1);
+            known.emplace_back(make_pos_t(1, false, 0), make_pos_t(7, false, 0));
+            expected.push_back(5);
+            known.emplace_back(make_pos_t(1, false, 0), make_pos_t(9, false, 0));
+            expected.push_back(-1);
+        }
+        REQUIRE(di.min_distance(known) == expected);
+    }//End test case
+
     TEST_CASE( "Create min distance index disconnected graph",
                    "[min_dist]" ) {
         VG graph;
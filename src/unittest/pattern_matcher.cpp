@@ -0,0 +1,76 @@
+/// \file pattern_matcher.cpp
+///
+/// unit tests for the multi-pattern string matchers
+///
+
+#include <random>
+#include <string>
+#include <vector>
+#include "../pattern_matcher.hpp"
+#include "randomness.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("PrefixTrie and AhoCorasick agree with matching patterns one at a time", "[pattern_matcher]") {
+
+    default_random_engine generator(test_seed_source());
+    uniform_int_distribution<int> pattern_count_distr(0, 8);
+    uniform_int_distribution<int> pattern_length_distr(0, 5);
+    uniform_int_distribution<int> text_length_distr(0, 15);
+
+    for (string alphabet : {"ACGT", "ACGTN_.:/1"}) {
+        uniform_int_distribution<int> char_distr(0, alphabet.size() - 1);
+        auto random_string = [&](size_t length) {
+            string result;
+            for (size_t i = 0; i < length; i++) {
+                result.push_back(alphabet[char_distr(generator)]);
+            }
+            return result;
+        };
+
+        for (size_t trial = 0; trial < 2000; trial++) {
+            vector<string> patterns;
+            for (size_t i = pattern_count_distr(generator); i > 0; i--) {
+                patterns.push_back(random_string(pattern_length_distr(generator)));
+            }
+            PrefixTrie trie(patterns);
+            AhoCorasick automaton(patterns);
+            REQUIRE(trie.empty() == patterns.empty());
+            REQUIRE(automaton.empty() == patterns.empty());
+
+            for (size_t i = 0; i < 20; i++) {
+                string text = random_string(text_length_distr(generator));
+                bool has_prefix = false;
+                bool occurs = false;
+                for (auto& pattern : patterns) {
+                    has_prefix = has_prefix || text.compare(0, pattern.size(), pattern) == 0;
+                    occurs = occurs || text.find(pattern) != string::npos;
+                }
+                REQUIRE(trie.has_prefix_of(text) == has_prefix);
+                REQUIRE(automaton.occurs_in(text) == occurs);
+            }
+        }
+    }
+}
+
+TEST_CASE("AhoCorasick finds patterns that are suffixes of other partial matches", "[pattern_matcher]") {
+    AhoCorasick automaton({"GATTACA", "TTAG", "ACAT"});
+    REQUIRE(automaton.occurs_in("CCGATTAGC"));
+    REQUIRE(automaton.occurs_in("GATTACAT"));
+    REQUIRE(automaton.occurs_in("GGACATT"));
+    REQUIRE(!automaton.occurs_in("GATTAC"));
+    REQUIRE(!automaton.occurs_in(""));
+
+    PrefixTrie trie({"read1", "read10", "frag"});
+    REQUIRE(trie.has_prefix_of("read1"));
+    REQUIRE(trie.has_prefix_of("read123"));
+    REQUIRE(trie.has_prefix_of("fragment"));
+    REQUIRE(!trie.has_prefix_of("read"));
+    REQUIRE(!trie.has_prefix_of("xread1"));
+}
+
+}
+}
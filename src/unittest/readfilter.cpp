@@ -273,6 +273,37 @@ TEST_CASE("reads with ambiguous ends can be trimmed", "[filter]") {
 
 }
 
+TEST_CASE("name and subsequence filters work without running the whole filter", "[filter]") {
+    
+    ReadFilter<Alignment> filter;
+    filter.set_name_prefixes({"read1", "sim_"});
+    filter.set_subsequences({"GATTACA", "CAT"});
+    filter.verbose = true;
+    
+    Alignment read;
+    read.set_name("sim_42");
+    read.set_sequence("AAGATTACAA");
+    
+    Counts counts = filter.filter_alignment(read);
+    REQUIRE(counts.counts[Counts::FilterName::wrong_name] == 0);
+    REQUIRE(counts.counts[Counts::FilterName::subsequence] == 0);
+    
+    read.set_name("read2");
+    read.set_sequence("AAGATTTACAA");
+    
+    counts = filter.filter_alignment(read);
+    REQUIRE(counts.counts[Counts::FilterName::wrong_name] == 1);
+    REQUIRE(counts.counts[Counts::FilterName::subsequence] == 1);
+    
+    // Changing the patterns takes effect right away
+    filter.set_name_prefixes({"read2"});
+    filter.set_subsequences({});
+    
+    counts = filter.filter_alignment(read);
+    REQUIRE(counts.counts[Counts::FilterName::wrong_name] == 0);
+    REQUIRE(counts.counts[Counts::FilterName::subsequence] == 0);
+    REQUIRE(counts.keep());
+}
 
 }
 }
@@ -10,6 +10,7 @@
 #include "../integrated_snarl_finder.hpp"
 #include "../genotypekit.hpp"
 #include "random_graph.hpp"
+#include "randomness.hpp"
 #include "../seed_clusterer.hpp"
 #include <random>
 #include <time.h>
@@ -2042,5 +2043,121 @@ namespace unittest {
             }
         }
     } //end test case
+
+    TEST_CASE("Reused clustering state gives the right clusters", "[cluster]"){
+
+        default_random_engine generator(test_seed_source());
+
+        // One state is shared by all graphs and reads, and by single and
+        // paired end clustering, the way a mapping thread would use it.
+        SnarlSeedClusterer::ClusteringState state;
+
+        for (int i = 0; i < 5; i++) {
+            // For each random graph
+            uniform_int_distribution<int> variant_count(5, 200);
+            uniform_int_distribution<int> chrom_len(10, 1000);
+
+            //Make a random graph with three chromosomes of random lengths
+            VG graph;
+            random_graph({chrom_len(generator), chrom_len(generator), chrom_len(generator)}, 30, variant_count(generator), &graph);
+
+            IntegratedSnarlFinder bubble_finder(graph);
+            SnarlManager snarl_manager = bubble_finder.find_snarls();
+            MinimumDistanceIndex dist_index (&graph, &snarl_manager);
+            SnarlSeedClusterer clusterer(dist_index);
+
+            vector<id_t> all_nodes;
+            graph.for_each_handle([&](const handle_t& h)->bool{
+                all_nodes.push_back(graph.get_id(h));
+                return true;
+            });
+            uniform_int_distribution<int> randPosIndex(0, all_nodes.size()-1);
+
+            // Work out the right clusters without the clusterer: seeds are
+            // together if they are connected by minimum distances in either
+            // orientation that are within the limit.
+            auto brute_force_clusters = [&](const vector<pos_t>& positions, int64_t limit) {
+                structures::UnionFind union_find (positions.size(), false);
+                for (size_t i1 = 0 ; i1 < positions.size() ; i1++) {
+                    pos_t pos1 = positions[i1];
+                    pos_t rev1 = make_pos_t(get_id(pos1), !is_rev(pos1),
+                                            graph.get_length(graph.get_handle(get_id(pos1), false)) - get_offset(pos1) - 1);
+                    for (size_t i2 = 0 ; i2 < i1 ; i2++) {
+                        pos_t pos2 = positions[i2];
+                        pos_t rev2 = make_pos_t(get_id(pos2), !is_rev(pos2),
+                                                graph.get_length(graph.get_handle(get_id(pos2), false)) - get_offset(pos2) - 1);
+                        int64_t dist = MinimumDistanceIndex::min_pos({dist_index.min_distance(pos1, pos2),
+                                                                      dist_index.min_distance(pos1, rev2),
+                                                                      dist_index.min_distance(rev1, pos2),
+                                                                      dist_index.min_distance(rev1, rev2)});
+                        if (dist != -1 && dist <= limit) {
+                            union_find.union_groups(i1, i2);
+                        }
+                    }
+                }
+                set<set<size_t>> clusters;
+                for (auto& group : union_find.all_groups()) {
+                    clusters.emplace(group.begin(), group.end());
+                }
+                return clusters;
+            };
+
+            for (size_t k = 0; k < 10 ; k++) {
+                // Make random seeds for a pair of reads. Big reads get enough
+                // seeds to use the radix sorts.
+                vector<vector<SnarlSeedClusterer::Seed>> all_seeds(2);
+                vector<vector<pos_t>> positions(2);
+                vector<pos_t> all_positions;
+                for (size_t read = 0 ; read < 2 ; read ++) {
+                    size_t seed_count = uniform_int_distribution<int>(0, k % 2 == 0 ? 20 : 100)(generator);
+                    for (size_t j = 0; j < seed_count; j++) {
+                        id_t node_id = all_nodes[randPosIndex(generator)];
+                        size_t offset = uniform_int_distribution<int>(0, graph.get_length(graph.get_handle(node_id)) - 1)(generator);
+                        pos_t pos = make_pos_t(node_id, uniform_int_distribution<int>(0,1)(generator) == 0, offset);
+                        std::tuple<bool, size_t, size_t, bool, size_t, size_t, size_t, size_t, bool> chain_info = dist_index.get_minimizer_distances(pos);
+                        all_seeds[read].push_back({ pos, 0, std::get<0>(chain_info), std::get<1>(chain_info), std::get<2>(chain_info),
+                           std::get<3>(chain_info), std::get<4>(chain_info), std::get<5>(chain_info), std::get<6>(chain_info), std::get<7>(chain_info), std::get<8>(chain_info)});
+                        positions[read].push_back(pos);
+                        all_positions.push_back(pos);
+                    }
+                }
+                int64_t read_lim = uniform_int_distribution<int>(5, 50)(generator);
+                int64_t fragment_lim = read_lim + uniform_int_distribution<int>(0, 50)(generator);
+
+                // Single end clustering with the reused state
+                vector<SnarlSeedClusterer::Cluster> single = clusterer.cluster_seeds(all_seeds[0], read_lim, state);
+                set<set<size_t>> single_found;
+                for (auto& cluster : single) {
+                    single_found.emplace(cluster.seeds.begin(), cluster.seeds.end());
+                }
+                REQUIRE(single_found.size() == single.size());
+                REQUIRE(single_found == brute_force_clusters(positions[0], read_lim));
+
+                // And paired end clustering. Fragment clusters number seeds
+                // as if the reads' seeds were appended together.
+                vector<vector<SnarlSeedClusterer::Cluster>> paired = clusterer.cluster_seeds(all_seeds, read_lim, fragment_lim, state);
+                REQUIRE(paired.size() == 2);
+                map<size_t, set<size_t>> fragments;
+                size_t offset = 0;
+                for (size_t read = 0 ; read < paired.size() ; read++) {
+                    set<set<size_t>> read_found;
+                    for (auto& cluster : paired[read]) {
+                        read_found.emplace(cluster.seeds.begin(), cluster.seeds.end());
+                        for (size_t seed : cluster.seeds) {
+                            fragments[cluster.fragment].insert(seed + offset);
+                        }
+                    }
+                    REQUIRE(read_found.size() == paired[read].size());
+                    REQUIRE(read_found == brute_force_clusters(positions[read], read_lim));
+                    offset += all_seeds[read].size();
+                }
+                set<set<size_t>> fragments_found;
+                for (auto& fragment : fragments) {
+                    fragments_found.insert(fragment.second);
+                }
+                REQUIRE(fragments_found == brute_force_clusters(all_positions, fragment_lim));
+            }
+        }
+    } //end test case
 }
 }
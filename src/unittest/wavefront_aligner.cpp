@@ -0,0 +1,133 @@
+/// \file wavefront_aligner.cpp
+///
+/// Unit tests for the WavefrontAligner, which does pinned alignment to trees.
+///
+
+#include <iostream>
+#include <string>
+#include "../wavefront_aligner.hpp"
+#include "../tree_subgraph.hpp"
+#include "../path.hpp"
+#include "test_aligner.hpp"
+#include "catch.hpp"
+
+#include <bdsg/hash_graph.hpp>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("WavefrontAligner scores tree alignments the same as the DP aligner", "[alignment][pinned][wavefront]") {
+
+    // Make up a base graph with a SNP, an indel, and a long tail
+    bdsg::HashGraph base;
+
+    handle_t start = base.create_handle("GATTACA");
+    handle_t snp1 = base.create_handle("C");
+    handle_t snp2 = base.create_handle("T");
+    handle_t middle = base.create_handle("GGAC");
+    handle_t insertion = base.create_handle("TTG");
+    handle_t end = base.create_handle("AATCTGCAGGTACC");
+
+    base.create_edge(start, snp1);
+    base.create_edge(start, snp2);
+    base.create_edge(snp1, middle);
+    base.create_edge(snp2, middle);
+    base.create_edge(middle, insertion);
+    base.create_edge(middle, end);
+    base.create_edge(insertion, end);
+
+    // Unfold it into a tree of all the haplotypes
+    vector<pair<int64_t, handle_t>> tree;
+    tree.emplace_back(-1, start);
+    tree.emplace_back(0, snp1);
+    tree.emplace_back(0, snp2);
+    tree.emplace_back(1, middle);
+    tree.emplace_back(2, middle);
+    tree.emplace_back(3, insertion);
+    tree.emplace_back(3, end);
+    tree.emplace_back(4, insertion);
+    tree.emplace_back(4, end);
+    tree.emplace_back(5, end);
+    tree.emplace_back(7, end);
+
+    TreeSubgraph subgraph(&base, std::move(tree), 2);
+
+    TestAligner aligner_source;
+    const Aligner& aligner = *aligner_source.get_regular_aligner();
+    REQUIRE(WavefrontAligner::can_emulate(aligner));
+    WavefrontAligner wavefront_aligner(aligner);
+
+    for (string read : {
+        // Exact matches down each branch
+        "TTACACGGACAATCTGCAGGTACC",
+        "TTACATGGACTTGAATCTGCAGGTACC",
+        // A mismatch
+        "TTACACGGACAATCAGCAGGTACC",
+        // Something that has to go off the end
+        "TTACACGGACAATCTGCAGGTACCGATTACA",
+        // Junk that should be softclipped after a while
+        "TTACACGGACAATCGGGGGGGGGGGGGGGGGGG",
+        // A deletion and an insertion
+        "TTACACGGACAATGCAGGTAAAACC",
+        // An N
+        "TTACANGGACAATCTGCAGGTACC",
+        // Lowercase bases, which still match, and a lowercase mismatch
+        "ttacacGGACAATCTGCAGGTACC",
+        "TTACACGGACAATCaGCAGGTACC"}) {
+
+        Alignment dp_alignment;
+        dp_alignment.set_sequence(read);
+        aligner.align_pinned(dp_alignment, subgraph, true);
+
+        Alignment wavefront_alignment;
+        wavefront_alignment.set_sequence(read);
+        wavefront_aligner.align_pinned(wavefront_alignment, subgraph, subgraph.get_root());
+
+        SECTION("Alignment of " + read + " gets the right score") {
+            REQUIRE(wavefront_alignment.score() == dp_alignment.score());
+        }
+
+        SECTION("Alignment of " + read + " covers the read from the root") {
+            const Path& path = wavefront_alignment.path();
+            REQUIRE(path.mapping_size() > 0);
+            REQUIRE(path.mapping(0).position().node_id() == subgraph.get_id(subgraph.get_root()));
+            REQUIRE(path.mapping(0).position().offset() == 0);
+            REQUIRE((size_t) path_to_length(path) == read.size());
+        }
+
+        SECTION("Alignment of " + read + " translates into the base graph") {
+            Path translated = subgraph.translate_down(wavefront_alignment.path());
+            REQUIRE((size_t) path_to_length(translated) == read.size());
+            REQUIRE(translated.mapping(0).position().node_id() == base.get_id(start));
+            REQUIRE(translated.mapping(0).position().offset() == 2);
+        }
+    }
+}
+
+TEST_CASE("WavefrontAligner refuses graphs that aren't trees", "[alignment][pinned][wavefront]") {
+
+    bdsg::HashGraph graph;
+
+    handle_t start = graph.create_handle("GAT");
+    handle_t snp1 = graph.create_handle("C");
+    handle_t snp2 = graph.create_handle("T");
+    handle_t end = graph.create_handle("ACA");
+
+    graph.create_edge(start, snp1);
+    graph.create_edge(start, snp2);
+    graph.create_edge(snp1, end);
+    graph.create_edge(snp2, end);
+
+    TestAligner aligner_source;
+    WavefrontAligner wavefront_aligner(*aligner_source.get_regular_aligner());
+
+    // Mismatch both SNP alleles, so the alignment has to look past both of
+    // them before it finds the end node is shared
+    Alignment alignment;
+    alignment.set_sequence("GATGACA");
+    REQUIRE_THROWS_AS(wavefront_aligner.align_pinned(alignment, graph, start), runtime_error);
+}
+
+}
+}
@@ -0,0 +1,556 @@
+#include "wavefront_aligner.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+
+/**
+ * \file wavefront_aligner.cpp: implementation of the WavefrontAligner
+ */
+
+//#define debug_wavefront
+
+namespace vg {
+
+using namespace std;
+
+WavefrontAligner::WavefrontAligner(int32_t match, int32_t mismatch, int32_t gap_open, int32_t gap_extension,
+                                   int32_t full_length_bonus) :
+    mismatch_penalty(2 * (mismatch + match)),
+    n_penalty(2 * match),
+    gap_open_penalty(2 * gap_open + match),
+    gap_extend_penalty(2 * gap_extension + match),
+    match(match),
+    full_length_bonus(full_length_bonus) {
+
+    if (mismatch_penalty <= 0 || n_penalty <= 0 || gap_open_penalty <= 0 || gap_extend_penalty <= 0) {
+        throw runtime_error("WavefrontAligner needs a positive match score and no free edits");
+    }
+}
+
+WavefrontAligner::WavefrontAligner(const GSSWAligner& aligner) :
+    WavefrontAligner(aligner.match, aligner.mismatch, aligner.gap_open, aligner.gap_extension,
+                     aligner.full_length_bonus) {
+    // Nothing to do!
+}
+
+bool WavefrontAligner::can_emulate(const GSSWAligner& aligner) {
+    if (aligner.match <= 0 || aligner.mismatch + aligner.match <= 0 ||
+        2 * aligner.gap_open + aligner.match <= 0 || 2 * aligner.gap_extension + aligner.match <= 0) {
+        return false;
+    }
+    if (aligner.score_matrix != nullptr) {
+        // The matrix has a 5th row and column for N
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                if (aligner.score_matrix[i * 5 + j] != (i == j ? aligner.match : -aligner.mismatch)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+WavefrontAligner::Tree::Tree(const HandleGraph& graph, const handle_t& root) : graph(graph) {
+    nodes.emplace_back();
+    nodes.back().handle = root;
+    nodes.back().sequence = graph.get_sequence(root);
+    nodes.back().depth = 0;
+    nodes.back().parent = -1;
+    seen.insert(root);
+}
+
+const vector<size_t>& WavefrontAligner::Tree::children(size_t node) {
+    if (!nodes[node].expanded) {
+        size_t child_depth = nodes[node].depth + nodes[node].sequence.size();
+        // Copy the handle, since the nodes can move as they grow
+        handle_t here = nodes[node].handle;
+        graph.follow_edges(here, false, [&](const handle_t& next) {
+            if (!seen.insert(next).second) {
+                throw runtime_error("WavefrontAligner can only align to trees, but node " +
+                                    to_string(graph.get_id(next)) + " is reachable in more than one way");
+            }
+            nodes[node].children.push_back(nodes.size());
+            nodes.emplace_back();
+            nodes.back().handle = next;
+            nodes.back().sequence = graph.get_sequence(next);
+            nodes.back().depth = child_depth;
+            nodes.back().parent = node;
+        });
+        nodes[node].expanded = true;
+    }
+    return nodes[node].children;
+}
+
+WavefrontAligner::TreeEnd WavefrontAligner::find_best_end(const string& sequence, Tree& tree) const {
+
+    // Points are stored by node and diagonal (node offset minus read offset),
+    // with the furthest read offset reached on that diagonal.
+    typedef unordered_map<uint64_t, int64_t> Wave;
+    auto to_key = [](size_t node, int64_t diagonal) -> uint64_t {
+        return ((uint64_t) node << 32) | (uint32_t) (int32_t) diagonal;
+    };
+    auto key_node = [](uint64_t key) -> size_t {
+        return key >> 32;
+    };
+    auto key_diagonal = [](uint64_t key) -> int64_t {
+        return (int32_t) (uint32_t) key;
+    };
+    // Put a point in a wave if it is further along than what is there.
+    auto raise = [&](Wave& wave, size_t node, int64_t node_offset, int64_t read_offset) -> bool {
+        auto inserted = wave.emplace(to_key(node, node_offset - read_offset), read_offset);
+        if (!inserted.second) {
+            if (inserted.first->second >= read_offset) {
+                return false;
+            }
+            inserted.first->second = read_offset;
+        }
+        return true;
+    };
+    // Call the iteratee with the position after consuming the next graph
+    // base from the given position, for each such base.
+    // The iteratee must not grow the tree.
+    auto consume_graph = [&](size_t node, int64_t node_offset, const function<void(size_t, int64_t, char)>& iteratee) {
+        if (node_offset < (int64_t) tree.nodes[node].sequence.size()) {
+            iteratee(node, node_offset + 1, tree.nodes[node].sequence[node_offset]);
+        } else {
+            for (size_t child : tree.children(node)) {
+                iteratee(child, 1, tree.nodes[child].sequence.front());
+            }
+        }
+    };
+
+    /// Matches, and alignments ending in insertions or deletions, by penalty
+    struct Wavefront {
+        Wave matches;
+        Wave insertions;
+        Wave deletions;
+    };
+    vector<Wavefront> wavefronts;
+
+    int64_t length = sequence.size();
+    // We keep twice the score, since penalties are in half points
+    int64_t best_doubled_score = 0;
+    TreeEnd best;
+
+    // Every graph base an alignment uses beyond what a full-length gapless
+    // alignment would use costs at least this much more than it adds.
+    int64_t min_gap = min(gap_open_penalty, gap_extend_penalty) - match;
+    int64_t max_step = max(max(mismatch_penalty, n_penalty), max(gap_open_penalty, gap_extend_penalty));
+    int64_t last_live = 0;
+
+    for (int64_t penalty = 0; ; penalty++) {
+        wavefronts.emplace_back();
+        Wavefront& wavefront = wavefronts.back();
+
+        if (penalty == 0) {
+            wavefront.matches.emplace(to_key(0, 0), 0);
+        }
+
+        // Make substitutions
+        for (int64_t step : {mismatch_penalty, n_penalty}) {
+            if (penalty < step) {
+                continue;
+            }
+            for (auto& point : wavefronts[penalty - step].matches) {
+                int64_t read_offset = point.second;
+                if (read_offset >= length) {
+                    continue;
+                }
+                char read_base = sequence[read_offset];
+                consume_graph(key_node(point.first), key_diagonal(point.first) + read_offset,
+                              [&](size_t node, int64_t node_offset, char graph_base) {
+                    if (!is_match(read_base, graph_base) && substitution_penalty(read_base, graph_base) == step) {
+                        raise(wavefront.matches, node, node_offset, read_offset + 1);
+                    }
+                });
+            }
+            if (mismatch_penalty == n_penalty) {
+                // Both kinds of substitution were just done
+                break;
+            }
+        }
+
+        // Open and extend gaps
+        auto gap_sources = [&](const function<Wave&(Wavefront&)>& gap_wave, const function<void(uint64_t, int64_t)>& iteratee) {
+            if (penalty >= gap_open_penalty) {
+                for (auto& point : wavefronts[penalty - gap_open_penalty].matches) {
+                    iteratee(point.first, point.second);
+                }
+            }
+            if (penalty >= gap_extend_penalty) {
+                for (auto& point : gap_wave(wavefronts[penalty - gap_extend_penalty])) {
+                    iteratee(point.first, point.second);
+                }
+            }
+        };
+        gap_sources([](Wavefront& w) -> Wave& { return w.insertions; }, [&](uint64_t key, int64_t read_offset) {
+            if (read_offset < length) {
+                raise(wavefront.insertions, key_node(key), key_diagonal(key) + read_offset, read_offset + 1);
+            }
+        });
+        gap_sources([](Wavefront& w) -> Wave& { return w.deletions; }, [&](uint64_t key, int64_t read_offset) {
+            consume_graph(key_node(key), key_diagonal(key) + read_offset, [&](size_t node, int64_t node_offset, char) {
+                raise(wavefront.deletions, node, node_offset, read_offset);
+            });
+        });
+        for (Wave* gaps : {&wavefront.insertions, &wavefront.deletions}) {
+            for (auto& point : *gaps) {
+                raise(wavefront.matches, key_node(point.first), key_diagonal(point.first) + point.second, point.second);
+            }
+        }
+
+        // Follow matches as far as they go, into every child they can
+        vector<uint64_t> to_extend;
+        to_extend.reserve(wavefront.matches.size());
+        for (auto& point : wavefront.matches) {
+            to_extend.push_back(point.first);
+        }
+        for (size_t i = 0; i < to_extend.size(); i++) {
+            uint64_t key = to_extend[i];
+            size_t node = key_node(key);
+            const string& node_sequence = tree.nodes[node].sequence;
+            int64_t read_offset = wavefront.matches[key];
+            int64_t node_offset = key_diagonal(key) + read_offset;
+            while (read_offset < length && node_offset < (int64_t) node_sequence.size() &&
+                   is_match(sequence[read_offset], node_sequence[node_offset])) {
+                read_offset++;
+                node_offset++;
+            }
+            wavefront.matches[key] = read_offset;
+            // Growing the tree below can move node_sequence
+            bool at_node_end = node_offset == (int64_t) node_sequence.size();
+
+            int64_t doubled_score = match * (read_offset + tree.nodes[node].depth + node_offset) - penalty;
+            if (read_offset == length) {
+                doubled_score += 2 * full_length_bonus;
+            }
+            if (doubled_score > best_doubled_score) {
+                best_doubled_score = doubled_score;
+                best.penalty = penalty;
+                best.node = node;
+                best.node_offset = node_offset;
+                best.read_offset = read_offset;
+            }
+
+            if (read_offset < length && at_node_end) {
+                for (size_t child : tree.children(node)) {
+                    if (is_match(sequence[read_offset], tree.nodes[child].sequence.front()) &&
+                        raise(wavefront.matches, child, 0, read_offset)) {
+                        to_extend.push_back(to_key(child, -read_offset));
+                    }
+                }
+            }
+        }
+
+#ifdef debug_wavefront
+        cerr << "Penalty " << penalty << ": " << wavefront.matches.size() << " match points, best doubled score "
+             << best_doubled_score << endl;
+#endif
+
+        if (!wavefront.matches.empty()) {
+            last_live = penalty;
+        }
+        if (penalty - last_live > max_step) {
+            // Nothing can come after this
+            break;
+        }
+        // Anything with a bigger penalty has at most twice the score
+        // 2 * (match * length + bonus) - penalty * min_gap / (min_gap + match),
+        // so stop once that can't beat what we have.
+        if (min_gap > 0 && (2 * (match * length + full_length_bonus) - best_doubled_score) * (min_gap + match)
+                           <= (penalty + 1) * min_gap) {
+            break;
+        }
+    }
+
+    return best;
+}
+
+vector<WavefrontAligner::Operation> WavefrontAligner::align_global(const string& read, const string& graph) const {
+
+    // This is plain gap-affine WFA, with diagonals numbered as graph offset
+    // minus read offset, and read offsets stored for each diagonal.
+    int64_t read_length = read.size();
+    int64_t graph_length = graph.size();
+
+    struct Wavefront {
+        int64_t low = 0;
+        int64_t high = -1;
+        vector<int64_t> matches;
+        vector<int64_t> insertions;
+        vector<int64_t> deletions;
+
+        int64_t get(const vector<int64_t>& wave, int64_t diagonal) const {
+            return (diagonal < low || diagonal > high) ? -1 : wave[diagonal - low];
+        }
+    };
+    vector<Wavefront> wavefronts;
+    auto get = [&](int64_t penalty, vector<int64_t> Wavefront::*wave, int64_t diagonal) -> int64_t {
+        if (penalty < 0) {
+            return -1;
+        }
+        const Wavefront& wavefront = wavefronts[penalty];
+        return wavefront.get(wavefront.*wave, diagonal);
+    };
+
+    // Work out where each kind of edit could come from. These are used both
+    // going forward and in the traceback.
+    auto substitution_from = [&](int64_t penalty, int64_t diagonal) -> int64_t {
+        int64_t best = -1;
+        for (int64_t step : {mismatch_penalty, n_penalty}) {
+            int64_t read_offset = get(penalty - step, &Wavefront::matches, diagonal);
+            int64_t graph_offset = read_offset + diagonal;
+            if (read_offset >= 0 && read_offset < read_length && graph_offset < graph_length &&
+                !is_match(read[read_offset], graph[graph_offset]) &&
+                substitution_penalty(read[read_offset], graph[graph_offset]) == step) {
+                best = max(best, read_offset + 1);
+            }
+        }
+        return best;
+    };
+    auto insertion_from = [&](int64_t penalty, int64_t diagonal, vector<int64_t> Wavefront::*wave, int64_t step) -> int64_t {
+        int64_t read_offset = get(penalty - step, wave, diagonal + 1);
+        return (read_offset >= 0 && read_offset < read_length) ? read_offset + 1 : -1;
+    };
+    auto deletion_from = [&](int64_t penalty, int64_t diagonal, vector<int64_t> Wavefront::*wave, int64_t step) -> int64_t {
+        int64_t read_offset = get(penalty - step, wave, diagonal - 1);
+        return (read_offset >= 0 && read_offset + diagonal <= graph_length) ? read_offset : -1;
+    };
+
+    int64_t end_diagonal = graph_length - read_length;
+    int64_t max_step = max(max(mismatch_penalty, n_penalty), max(gap_open_penalty, gap_extend_penalty));
+    int64_t penalty = 0;
+    for (; ; penalty++) {
+        wavefronts.emplace_back();
+        Wavefront& wavefront = wavefronts.back();
+
+        if (penalty == 0) {
+            wavefront.low = 0;
+            wavefront.high = 0;
+        } else {
+            int64_t low = numeric_limits<int64_t>::max();
+            int64_t high = numeric_limits<int64_t>::min();
+            for (int64_t step = 1; step <= max_step && step <= penalty; step++) {
+                const Wavefront& source = wavefronts[penalty - step];
+                if (source.low <= source.high) {
+                    low = min(low, source.low - 1);
+                    high = max(high, source.high + 1);
+                }
+            }
+            wavefront.low = max(low, -read_length);
+            wavefront.high = min(high, graph_length);
+        }
+        if (wavefront.low > wavefront.high) {
+            if (penalty > 0 && wavefronts.size() > (size_t) max_step) {
+                bool all_empty = true;
+                for (int64_t step = 1; step <= max_step; step++) {
+                    const Wavefront& source = wavefronts[penalty - step];
+                    all_empty = all_empty && source.low > source.high;
+                }
+                if (all_empty) {
+                    throw runtime_error("WavefrontAligner could not find a global alignment");
+                }
+            }
+            continue;
+        }
+
+        size_t width = wavefront.high - wavefront.low + 1;
+        wavefront.matches.resize(width, -1);
+        wavefront.insertions.resize(width, -1);
+        wavefront.deletions.resize(width, -1);
+        for (int64_t diagonal = wavefront.low; diagonal <= wavefront.high; diagonal++) {
+            size_t i = diagonal - wavefront.low;
+            wavefront.insertions[i] = max(insertion_from(penalty, diagonal, &Wavefront::matches, gap_open_penalty),
+                                          insertion_from(penalty, diagonal, &Wavefront::insertions, gap_extend_penalty));
+            wavefront.deletions[i] = max(deletion_from(penalty, diagonal, &Wavefront::matches, gap_open_penalty),
+                                         deletion_from(penalty, diagonal, &Wavefront::deletions, gap_extend_penalty));
+            int64_t read_offset = max(substitution_from(penalty, diagonal),
+                                      max(wavefront.insertions[i], wavefront.deletions[i]));
+            if (penalty == 0 && diagonal == 0) {
+                read_offset = 0;
+            }
+            if (read_offset >= 0) {
+                while (read_offset < read_length && read_offset + diagonal < graph_length &&
+                       is_match(read[read_offset], graph[read_offset + diagonal])) {
+                    read_offset++;
+                }
+            }
+            wavefront.matches[i] = read_offset;
+        }
+
+        if (wavefront.get(wavefront.matches, end_diagonal) == read_length) {
+            break;
+        }
+    }
+
+    // Trace back from the end
+    vector<Operation> reversed;
+    auto add = [&](char type, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        if (!reversed.empty() && reversed.back().type == type) {
+            reversed.back().length += count;
+        } else {
+            reversed.push_back({type, count});
+        }
+    };
+
+    char state = 'M';
+    int64_t diagonal = end_diagonal;
+    int64_t read_offset = read_length;
+    while (true) {
+        if (state == 'M') {
+            int64_t substitution = substitution_from(penalty, diagonal);
+            int64_t insertion = get(penalty, &Wavefront::insertions, diagonal);
+            int64_t deletion = get(penalty, &Wavefront::deletions, diagonal);
+            int64_t start = max(substitution, max(insertion, deletion));
+            if (penalty == 0) {
+                // We must be back at the start
+                add('M', read_offset);
+                break;
+            }
+            add('M', read_offset - start);
+            read_offset = start;
+            if (start == substitution) {
+                add('M', 1);
+                penalty -= substitution_penalty(read[read_offset - 1], graph[read_offset - 1 + diagonal]);
+                read_offset--;
+            } else if (start == insertion) {
+                state = 'I';
+            } else {
+                state = 'D';
+            }
+        } else if (state == 'I') {
+            add('I', 1);
+            if (insertion_from(penalty, diagonal, &Wavefront::matches, gap_open_penalty) == read_offset) {
+                penalty -= gap_open_penalty;
+                state = 'M';
+            } else {
+                penalty -= gap_extend_penalty;
+            }
+            diagonal++;
+            read_offset--;
+        } else {
+            add('D', 1);
+            if (deletion_from(penalty, diagonal, &Wavefront::matches, gap_open_penalty) == read_offset) {
+                penalty -= gap_open_penalty;
+                state = 'M';
+            } else {
+                penalty -= gap_extend_penalty;
+            }
+            diagonal--;
+        }
+    }
+
+    return vector<Operation>(reversed.rbegin(), reversed.rend());
+}
+
+void WavefrontAligner::align_pinned(Alignment& alignment, const HandleGraph& graph, const handle_t& root) const {
+
+    const string& sequence = alignment.sequence();
+    alignment.clear_path();
+    alignment.set_score(0);
+    if (sequence.empty()) {
+        return;
+    }
+
+    Tree explored(graph, root);
+    TreeEnd end = find_best_end(sequence, explored);
+    const vector<TreeNode>& tree = explored.nodes;
+
+    // Pull out the tree nodes the alignment goes through
+    vector<size_t> visited;
+    for (int64_t node = end.node; node != -1; node = tree[node].parent) {
+        visited.push_back(node);
+    }
+    reverse(visited.begin(), visited.end());
+    string graph_sequence;
+    for (size_t node : visited) {
+        graph_sequence += tree[node].sequence;
+    }
+    graph_sequence.resize(tree[end.node].depth + end.node_offset);
+
+    // Now that there are no more choices of where to go in the graph, get
+    // the actual alignment with a linear traceback.
+    vector<Operation> operations = align_global(sequence.substr(0, end.read_offset), graph_sequence);
+
+    Path& path = *alignment.mutable_path();
+    size_t visited_index = 0;
+    size_t node_offset = 0;
+    auto add_mapping = [&]() {
+        Mapping* mapping = path.add_mapping();
+        const handle_t& handle = tree[visited[visited_index]].handle;
+        mapping->mutable_position()->set_node_id(graph.get_id(handle));
+        mapping->mutable_position()->set_is_reverse(graph.get_is_reverse(handle));
+        mapping->set_rank(path.mapping_size());
+    };
+    // Add an edit to the last mapping, merging it into the last edit if they are the same kind
+    auto add_edit = [&](size_t from_length, size_t to_length, const string& edit_sequence) {
+        Mapping* mapping = path.mutable_mapping(path.mapping_size() - 1);
+        if (mapping->edit_size() > 0) {
+            Edit* last = mapping->mutable_edit(mapping->edit_size() - 1);
+            bool same_kind = (last->from_length() == 0) == (from_length == 0) &&
+                             (last->to_length() == 0) == (to_length == 0) &&
+                             last->sequence().empty() == edit_sequence.empty();
+            if (same_kind) {
+                last->set_from_length(last->from_length() + from_length);
+                last->set_to_length(last->to_length() + to_length);
+                last->mutable_sequence()->append(edit_sequence);
+                return;
+            }
+        }
+        Edit* edit = mapping->add_edit();
+        edit->set_from_length(from_length);
+        edit->set_to_length(to_length);
+        edit->set_sequence(edit_sequence);
+    };
+    // Get the next graph base, moving on to the next node if necessary
+    auto next_graph_base = [&]() -> char {
+        if (node_offset == tree[visited[visited_index]].sequence.size()) {
+            visited_index++;
+            node_offset = 0;
+            add_mapping();
+        }
+        return tree[visited[visited_index]].sequence[node_offset++];
+    };
+
+    add_mapping();
+    size_t read_offset = 0;
+    int64_t doubled_score = 0;
+    for (auto& operation : operations) {
+        for (size_t i = 0; i < operation.length; i++) {
+            if (operation.type == 'M') {
+                char graph_base = next_graph_base();
+                char read_base = sequence[read_offset++];
+                if (read_base == graph_base) {
+                    add_edit(1, 1, "");
+                } else {
+                    add_edit(1, 1, string(1, read_base));
+                }
+                doubled_score += is_match(read_base, graph_base) ? 2 * match : 2 * match - substitution_penalty(read_base, graph_base);
+            } else if (operation.type == 'I') {
+                add_edit(0, 1, string(1, sequence[read_offset++]));
+                doubled_score += match - (i == 0 ? gap_open_penalty : gap_extend_penalty);
+            } else {
+                next_graph_base();
+                add_edit(1, 0, "");
+                doubled_score += match - (i == 0 ? gap_open_penalty : gap_extend_penalty);
+            }
+        }
+    }
+    if (read_offset < sequence.size()) {
+        // Softclip the rest
+        add_edit(0, sequence.size() - read_offset, sequence.substr(read_offset));
+    } else {
+        doubled_score += 2 * full_length_bonus;
+    }
+
+    alignment.set_score(doubled_score / 2);
+}
+
+}
@@ -0,0 +1,174 @@
+#ifndef VG_WAVEFRONT_ALIGNER_HPP_INCLUDED
+#define VG_WAVEFRONT_ALIGNER_HPP_INCLUDED
+
+/** \file wavefront_aligner.hpp
+ * Pinned gap-affine alignment against tree-shaped graphs using wavefronts,
+ * in time that depends on how good the alignment is instead of on the size
+ * of the graph.
+ */
+
+#include "aligner.hpp"
+#include "handle.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An aligner that reproduces the scores of an ordinary Aligner for
+ * left-pinned alignments against a graph that is a tree rooted at the left
+ * end of a given handle, such as a TreeSubgraph.
+ *
+ * Scores are turned into non-negative penalties the way WFA does it, so that
+ * matches are free: a mismatch costs 2 * (match + mismatch), the first base
+ * of a gap costs 2 * gap_open + match, and each further base of a gap costs
+ * 2 * gap_extension + match. Alignment then proceeds in order of increasing
+ * penalty, following runs of matches for free, and stops as soon as no
+ * alignment with a higher penalty could outscore the best one found. Reads
+ * that align well therefore only visit a narrow band of the graph.
+ *
+ * As in the DP aligners, bases are compared without regard to case, and
+ * non-ACGT characters score 0 against anything.
+ *
+ * Immutable once built, so it can be shared between threads.
+ */
+class WavefrontAligner {
+public:
+
+    /// Make an aligner with the given scores, all given as positive numbers.
+    WavefrontAligner(int32_t match, int32_t mismatch, int32_t gap_open, int32_t gap_extension,
+                     int32_t full_length_bonus);
+
+    /// Make an aligner with the same scores as the given aligner, which must
+    /// pass can_emulate().
+    WavefrontAligner(const GSSWAligner& aligner);
+
+    /// Return true if the given aligner's scores can be reproduced: the
+    /// score matrix has to be a plain match/mismatch matrix, and no operation
+    /// but a match can be free.
+    static bool can_emulate(const GSSWAligner& aligner);
+
+    /// Align the alignment's sequence against the given graph, pinned to the
+    /// start of the read and the left end of the root, and store the score
+    /// and the path (which covers the whole read, ending in a softclip if
+    /// necessary). Everything reachable rightward from the root must form a
+    /// tree. Nodes are only looked at once the alignment reaches them, and
+    /// throws runtime_error if it reaches a node that can be reached in two
+    /// ways.
+    void align_pinned(Alignment& alignment, const HandleGraph& graph, const handle_t& root) const;
+
+protected:
+
+    /// Penalty for a mismatch
+    int64_t mismatch_penalty;
+    /// Penalty for aligning against a non-ACGT character
+    int64_t n_penalty;
+    /// Penalty for the first base of a gap
+    int64_t gap_open_penalty;
+    /// Penalty for each further base of a gap
+    int64_t gap_extend_penalty;
+
+    int32_t match;
+    int32_t full_length_bonus;
+
+    /// A node of the tree, as seen from the root.
+    struct TreeNode {
+        handle_t handle;
+        string sequence;
+        /// Number of graph bases before this node on the way from the root
+        size_t depth;
+        /// Index of the parent, or -1 for the root
+        int64_t parent;
+        /// Set once the children have been added to the tree
+        bool expanded = false;
+        vector<size_t> children;
+    };
+
+    /// The part of the tree the alignment has reached so far. Nodes are
+    /// numbered in the order they are added, so parents always come before
+    /// children.
+    struct Tree {
+        /// Start a tree with just the root.
+        Tree(const HandleGraph& graph, const handle_t& root);
+
+        /// Get the children of a node, adding them to the tree the first
+        /// time they are asked for. Throws runtime_error if one of them is
+        /// already in the tree.
+        const vector<size_t>& children(size_t node);
+
+        const HandleGraph& graph;
+        vector<TreeNode> nodes;
+        /// Every handle in the tree
+        unordered_set<handle_t> seen;
+    };
+
+    /// Where the best alignment against the tree ends, and what it costs.
+    struct TreeEnd {
+        /// Penalty of the alignment
+        int64_t penalty = 0;
+        /// Node it ends on
+        size_t node = 0;
+        /// Graph bases of that node it uses
+        size_t node_offset = 0;
+        /// Read bases it uses
+        size_t read_offset = 0;
+    };
+
+    /// Find the best end for a left-pinned alignment of the sequence against
+    /// the tree, exploring wavefronts of increasing penalty, and growing the
+    /// tree when they reach the end of a node.
+    TreeEnd find_best_end(const string& sequence, Tree& tree) const;
+
+    /// An alignment operation for the traceback. Matches and substitutions
+    /// are both 'M'; insertions into the read are 'I' and deletions 'D'.
+    struct Operation {
+        char type;
+        size_t length;
+    };
+
+    /// Globally align the read and graph sequences with wavefronts, and
+    /// return the operations of an alignment with the least penalty.
+    vector<Operation> align_global(const string& read, const string& graph) const;
+
+    /// Return true if a pair of characters is a match.
+    inline static bool is_match(char a, char b);
+
+    /// Return true if a pair of characters involves a non-ACGT character.
+    inline static bool is_n_pair(char a, char b);
+
+    /// Get the penalty of substituting one character for another, which must
+    /// not be a match.
+    inline int64_t substitution_penalty(char a, char b) const;
+};
+
+inline bool WavefrontAligner::is_n_pair(char a, char b) {
+    auto is_base = [](char c) {
+        switch (c) {
+        case 'A': case 'C': case 'G': case 'T':
+        case 'a': case 'c': case 'g': case 't':
+            return true;
+        default:
+            return false;
+        }
+    };
+    return !is_base(a) || !is_base(b);
+}
+
+inline bool WavefrontAligner::is_match(char a, char b) {
+    return toupper(a) == toupper(b) && !is_n_pair(a, b);
+}
+
+inline int64_t WavefrontAligner::substitution_penalty(char a, char b) const {
+    return is_n_pair(a, b) ? n_penalty : mismatch_penalty;
+}
+
+}
+
+#endif
@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order 
 
-plan tests 28
+plan tests 29
 
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg stats -z - | grep nodes | cut -f 2) 210 "construction produces the right number of nodes"
 
@@ -67,6 +67,12 @@ x3=$(for i in $(seq 100); do
 
 is $x3 1 "the number of threads and regions used in construction has no effect on the graph"
 
+vg construct -r small/x.fa -v small/x.vcf.gz -z 5 -t 1 | vg view -g - > construct_1.gfa
+vg construct -r small/x.fa -v small/x.vcf.gz -z 5 -t 8 | vg view -g - > construct_8.gfa
+diff construct_1.gfa construct_8.gfa
+is $? 0 "chunks constructed in parallel are emitted in the same order with the same IDs"
+rm -f construct_1.gfa construct_8.gfa
+
 vg construct -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz -R z:10-20 >/dev/null
 is $? 0 "construction of a graph with two head nodes succeeds"
 
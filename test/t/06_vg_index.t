@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="en_US.utf8" # force ekg's favorite sort order
 
-plan tests 51
+plan tests 52
 
 # Single graph without haplotypes
 vg construct -r small/x.fa -v small/x.vcf.gz > x.vg
@@ -254,4 +254,6 @@ is $? 0 "building a distance index of a graph"
 vg index -s snarls.pb -j distIndex x.vg
 is $? 0 "building a distance index of a graph without maximum index"
 
+is "$(head -c 24 distIndex)" "distance index version 3" "distance indexes are saved bare so they can be memory-mapped"
+
 rm -f x.vg distIndex snarls.pb
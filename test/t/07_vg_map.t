@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 54
+plan tests 56
 
 vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg -g x.gcsa -k 11 x.vg
@@ -39,6 +39,14 @@ is $(vg map -s TCAGATTCTCATCCCTCCTCAAGGGCGTCTAACTACTCCACATCAAAGCTACCCAGGCCATTTTA
 
 is $(vg map --reads <(vg sim -n 1000 -l 100 -x x.xg) -x x.xg -g x.gcsa  | vg view -a - | jq -r -c '.score == 110 // [.score, .sequence]' | grep true | wc -l) 1000 "alignment works on a small graph"
 
+vg sim -n 500 -l 100 -e 0.02 -s 17 -x x.xg -a > jump.sim.gam
+vg map -t 1 -G jump.sim.gam -x x.xg -g x.gcsa -j | jq -c '.path' > jump.before.json
+vg index -g x.jmp.gcsa -k 11 --jump-table 8 x.vg
+is "$(vg map -t 1 -G jump.sim.gam -x x.xg -g x.jmp.gcsa -j | jq -c '.path')" "$(cat jump.before.json)" "mapping with a GCSA2 jump table produces the same alignments"
+head -c 100 x.jmp.gcsa.jmp > truncated.jmp && mv truncated.jmp x.jmp.gcsa.jmp
+is "$(vg map -t 1 -G jump.sim.gam -x x.xg -g x.jmp.gcsa -j 2>/dev/null | jq -c '.path')" "$(cat jump.before.json)" "mapping falls back to LF steps when the GCSA2 jump table is corrupt"
+rm -f jump.sim.gam jump.before.json x.jmp.gcsa x.jmp.gcsa.lcp x.jmp.gcsa.jmp
+
 seq=TCAGATTCTCATCCCTCCTCAAGGGCTTCTAACTACTCCACATCAAAGCTACCCAGGCCATTTTAAGTTTCCTGTGGACTAAGGACAAAGGTGCGGGGAG
 is $(vg map -s $seq -x x.xg -g x.gcsa | vg view -a - | jq -r -c '[.score, .sequence, .path.node_id]' | md5sum | awk '{print $1}') \
    $(vg map -s $seq -j -x x.xg -g x.gcsa | jq -r -c '[.score, .sequence, .path.node_id]' | md5sum | awk '{print $1}') \
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 12
+plan tests 15
 
 # Toy example of hand-made pileup (and hand inspected truth) to make sure some
 # obvious (and only obvious) SNPs are detected by vg call
@@ -106,7 +106,18 @@ LESS_THREE=$(if (( $DIFF_COUNT < 3 )); then echo 1; else echo 0; fi)
 # there is some wobble here
 is "${LESS_THREE}" "1" "Fewer than 3 differences between allales called via traversals or directly"
 
-rm -f HGSVC_alts.vg HGSVC_alts.xg HGSVC_alts.pack HGSVC.vcf baseline_gts.txt gts.txt HGSVC1.vcf HGSVC2.vcf HGSVC_travs.gaf.gz HGSVC_travs.gbwt HGSVC_travs.vcf HGSVC_direct.vcf baseline_gts1.txt gts1.txt gts-travs.txt gts-direct.txt calls-travs.txt calls-direct.txt
+# stream the VCF out a snarl at a time, and all at the end
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -w 1 -t 2 > HGSVC_windowed.vcf
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -w 0 -t 2 > HGSVC_unwindowed.vcf
+diff <(sort HGSVC_windowed.vcf) <(sort HGSVC_unwindowed.vcf)
+is "$?" "0" "Calling in windows produces the same VCF records as calling all at once"
+grep -v '^#' HGSVC_windowed.vcf | sort -c -s -k1,1d -k2,2n
+is "$?" "0" "Calling in windows produces sorted VCF"
+vg call HGSVC_alts.xg -k HGSVC_alts.pack -s HG00514 -S -t 2 > HGSVC_tabled.vcf
+diff <(sort HGSVC_tabled.vcf) <(sort HGSVC_unwindowed.vcf)
+is "$?" "0" "Looking supports up in a precomputed table produces the same VCF as caching them"
+
+rm -f HGSVC_alts.vg HGSVC_alts.xg HGSVC_alts.pack HGSVC.vcf baseline_gts.txt gts.txt HGSVC1.vcf HGSVC2.vcf HGSVC_travs.gaf.gz HGSVC_travs.gbwt HGSVC_travs.vcf HGSVC_direct.vcf baseline_gts1.txt gts1.txt gts-travs.txt gts-direct.txt calls-travs.txt calls-direct.txt HGSVC_windowed.vcf HGSVC_unwindowed.vcf HGSVC_tabled.vcf
 
 vg construct -a -r small/x.fa -v small/x.vcf.gz > x.vg
 vg index -x x.xg x.vg -L
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 19
+plan tests 21
 
 vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz > tiny.vg
 vg index tiny.vg -x tiny.xg
@@ -125,3 +125,11 @@ is "$?" 0 "deconstructing vg graph gives same output as xg graph"
 
 rm -f tiny_names.gfa tiny_names.vg tiny_names.xg tiny_names_decon.vcf tiny_names_decon_vg.vcf
 
+vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz -a > tiny.vg
+vg gbwt -x tiny.vg -o tiny.gbwt -v tiny/tiny.vcf.gz
+vg index tiny.vg -x tiny.xg
+vg deconstruct tiny.xg -p x -g tiny.gbwt -t 1 > tiny_decon.vcf
+is $(grep "#CHROM" tiny_decon.vcf | cut -f 10-) "1" "deconstruct with a GBWT uses the GBWT samples"
+is $(grep -v "#" tiny_decon.vcf | awk '$2 == 34 || $2 == 39 {print $2 ":" $10}' | sort -n | tr '\n' ',') "34:1|1,39:1|0," "deconstruct with a GBWT gives phased genotypes from the haplotypes"
+
+rm -f tiny.vg tiny.gbwt tiny.xg tiny_decon.vcf
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 17
+plan tests 21
 
 
 # Exercise the GBWT
@@ -88,7 +88,14 @@ HHHHHHHHHH" > t.fq
 
 is "$(vg mpmap -B -x t.xg -g t.gcsa -f t.fq | vg view -Kj - | wc -l)" "3" "multipath mapping works in scenarios that trigger branch point trimming"
 
-rm t.vg t.xg t.gcsa t.gcsa.lcp t.fq
+vg mpmap -x t.xg -g t.gcsa -f t.fq > /dev/null
+is "$(ls t.gcsa.calib t.gcsa.calib.tmp* 2>/dev/null | wc -l)" "0" "mismapping detection calibration is not saved unless asked for"
+vg mpmap --calibrate-only --calibration t.calib -x t.xg -g t.gcsa
+is "$(head -n 1 t.calib)" "#vg mpmap calibration 1" "mismapping detection calibration can be saved ahead of time"
+is "$(vg mpmap --calibration t.calib -x t.xg -g t.gcsa -f t.fq 2>&1 >/dev/null | grep -c 'Loaded mismapping detection calibration')" "1" "saved mismapping detection calibration is reused"
+is "$(vg mpmap --calibration no_such_dir/t.calib -x t.xg -g t.gcsa -f t.fq 2>/dev/null | vg view -Kj - | wc -l)" "3" "mapping goes on when the mismapping detection calibration cannot be saved"
+
+rm t.vg t.xg t.gcsa t.gcsa.lcp t.calib t.fq
 
 # test spliced alignment
 
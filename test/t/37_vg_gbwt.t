@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 107
+plan tests 111
 
 
 # Build vg graphs for two chromosomes
@@ -25,6 +25,10 @@ vg index -G x2.gbwt -v small/xy2.vcf.gz x.vg
 is $? 0 "chromosome X GBWT with vg index"
 cmp x.gbwt x2.gbwt
 is $? 0 "identical construction results with vg gbwt and vg index"
+vg gbwt -x x.vg -o x.regions.gbwt --parse-threads 4 --parse-region 100 -v small/xy2.vcf.gz
+is $? 0 "chromosome X GBWT with parallel VCF parsing"
+cmp x.gbwt x.regions.gbwt
+is $? 0 "identical construction results with sequential and parallel VCF parsing"
 vg gbwt -x x.vg -o parse --parse-only -v small/xy2.vcf.gz
 is $? 0 "chromosome X VCF parse"
 ../deps/gbwt/build_gbwt -p -r parse_x > /dev/null 2> /dev/null
@@ -42,7 +46,7 @@ is $(vg gbwt -T x.gbwt | wc -l) 2 "chromosome X: 2 thread names"
 is $(vg gbwt -C -L x.gbwt | wc -l) 1 "chromosome X: 1 contig name"
 is $(vg gbwt -S -L x.gbwt | wc -l) 1 "chromosome X: 1 sample name"
 
-rm -f x.gbwt x2.gbwt x.bare.gbwt parse_x.gbwt
+rm -f x.gbwt x2.gbwt x.regions.gbwt x.bare.gbwt parse_x.gbwt
 rm -f parse_x parse_x_0_1
 
 
@@ -114,6 +118,10 @@ is $? 0 "identical construction results with a single VCF and multiple VCFs"
 # Multiple chromosomes: haplotypes with presets
 vg gbwt -x xy-alt.xg -o xy.1000gp.gbwt --preset 1000gp -v small/xy2.vcf.gz
 is $? 0 "construction preset: 1000gp"
+vg gbwt -x xy-alt.xg -o xy.1000gp.regions.gbwt --preset 1000gp --parse-threads 3 --parse-region 50 -v small/xy2.vcf.gz
+is $? 0 "construction preset: 1000gp with parallel VCF parsing"
+cmp xy.1000gp.gbwt xy.1000gp.regions.gbwt
+is $? 0 "identical construction results with forced phasing and parallel VCF parsing"
 
 # Multiple chromosomes: metadata for haplotypes
 is $(vg gbwt -c xy.merge.gbwt) 4 "multiple chromosomes: 4 threads"
@@ -122,7 +130,7 @@ is $(vg gbwt -H xy.merge.gbwt) 2 "multiple chromosomes: 2 haplotypes"
 is $(vg gbwt -S xy.merge.gbwt) 1 "multiple chromosomes: 1 sample"
 
 rm -f x.gbwt y.gbwt xy.merge.gbwt xy.fast.gbwt xy.parallel.gbwt xy.direct.gbwt xy.multi.gbwt
-rm -f xy.1000gp.gbwt
+rm -f xy.1000gp.gbwt xy.1000gp.regions.gbwt
 
 
 # Multiple chromosomes: paths as contigs
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 2
+plan tests 5
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg  x.vg
@@ -22,5 +22,14 @@ is "$(md5sum <min_ids.gamsorted.txt)" "$(md5sum <min_ids.sorted.txt)" "Sorting a
 vg gamsort x.gam -i x.sorted.gam.gai >x.sorted.gam
 is "$?" "0" "sorted GAMs can be indexed during the sort"
 
+vg gamsort -t 1 x.gam >x.sorted.1.gam
+vg gamsort -t 8 x.gam >x.sorted.8.gam
+is "$(vg view -aj x.sorted.1.gam | md5sum)" "$(vg view -aj x.sorted.8.gam | md5sum)" "sorting is deterministic across thread counts"
 
-rm -f x.vg x.xg x.gam x.sorted.gam x.sorted.2.gam min_ids.gamsorted.txt min_ids.sorted.txt x.sorted.gam.gai x.sorted.2.gam.gai
+vg gamsort -d x.gam >x.sorted.2.gam
+is "$(vg view -aj x.sorted.2.gam | md5sum)" "$(vg view -aj x.sorted.8.gam | md5sum)" "in-memory and streaming sorts produce the same order"
+
+is "$(vg gamsort -p -t 2 x.gam 2>&1 >/dev/null | grep -c 'Throughput')" "1" "sorting with progress reports throughput"
+
+
+rm -f x.vg x.xg x.gam x.sorted.gam x.sorted.1.gam x.sorted.2.gam x.sorted.8.gam min_ids.gamsorted.txt min_ids.sorted.txt x.sorted.gam.gai x.sorted.2.gam.gai
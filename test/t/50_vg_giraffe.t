@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 20
+plan tests 25
 
 vg construct -a -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg -G x.gbwt -v small/x.vcf.gz x.vg
@@ -52,10 +52,23 @@ is "$(jq '.path' mapped1.json)" "$(jq '.path' mapped.sync.json)" "mapping with s
 rm -rf mapped1.gam mapped1.json mapped2.gam mapped2.json mapped.sync.gam mapped.sync.json
 
 vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq > single.gam
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq --stage-times stages.tsv > /dev/null
+is "$(grep -c -P '^(minimizer|seed|cluster|extend|align|winner|output)\t' stages.tsv)" "7" "stage times are collected for each stage"
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq --stage-times stages.json > /dev/null
+is "$(jq '.stages | length' stages.json)" "$(tail -n +2 stages.tsv | wc -l)" "stage times can be written as JSON"
+rm -f stages.tsv stages.json
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -t 2 --writer-threads 2 > single.async.gam
+is "$(vg view -aj single.async.gam | jq -r '.name + " " + (.path | tostring)' | sort | md5sum)" "$(vg view -aj single.gam | jq -r '.name + " " + (.path | tostring)' | sort | md5sum)" "writing output on writer threads produces the same alignments"
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 -o BAM --writer-threads 1 > paired.async.bam
+is "$(samtools view paired.async.bam | wc -l)" "2000" "writing BAM on a writer thread produces all the records"
+rm -f single.async.gam paired.async.bam
 is "$(vg view -aj single.gam | jq -c 'select((.fragment_next | not) and (.fragment_prev | not))' | wc -l)" "1000" "unpaired reads lack cross-references"
 
 vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 > paired.gam
 is "$(vg view -aj paired.gam | jq -c 'select((.fragment_next | not) and (.fragment_prev | not))' | wc -l)" "0" "paired reads have cross-references"
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 --rescue-cache-size 0 > paired.nocache.gam
+is "$(vg view -aj paired.nocache.gam | jq -c '[.name, .path, .score, .mapping_quality]' | sort | md5sum)" "$(vg view -aj paired.gam | jq -c '[.name, .path, .score, .mapping_quality]' | sort | md5sum)" "the rescue subgraph cache does not change paired alignments"
+rm -f paired.nocache.gam
 
 # Test paired surjected mapping
 vg giraffe x.fa x.vcf.gz -iG <(vg view -a small/x-s13241-n1-p500-v300.gam | sed 's%_1%/1%' | sed 's%_2%/2%' | vg view -JaG - ) --output-format SAM >surjected.sam